@@ -0,0 +1,254 @@
+#include "animation.hpp"
+
+#include <cassert>
+#include <cmath>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+#include "jobs.hpp"
+
+namespace glint::animation {
+
+namespace {
+
+constexpr uint32_t lane_count = 4;
+
+// Players sampled per job
+constexpr uint32_t player_grain = 16;
+
+// Four joints of one key component at a time
+#if defined(__SSE2__) || defined(_M_X64)
+struct Lanes {
+	__m128 v;
+};
+
+inline Lanes load(const float* p) { return {_mm_loadu_ps(p)}; }
+inline void store(float* p, Lanes a) { _mm_storeu_ps(p, a.v); }
+inline Lanes splat(float x) { return {_mm_set1_ps(x)}; }
+
+inline Lanes operator+(Lanes a, Lanes b) { return {_mm_add_ps(a.v, b.v)}; }
+inline Lanes operator-(Lanes a, Lanes b) { return {_mm_sub_ps(a.v, b.v)}; }
+inline Lanes operator*(Lanes a, Lanes b) { return {_mm_mul_ps(a.v, b.v)}; }
+inline Lanes operator/(Lanes a, Lanes b) { return {_mm_div_ps(a.v, b.v)}; }
+inline Lanes sqrt(Lanes a) { return {_mm_sqrt_ps(a.v)}; }
+
+// Plus or minus one, minus where a is negative
+inline Lanes signOf(Lanes a) {
+	const __m128 sign_bit = _mm_set1_ps(-0.0f);
+	return {_mm_or_ps(_mm_and_ps(a.v, sign_bit), _mm_set1_ps(1.0f))};
+}
+#else
+struct Lanes {
+	float v[lane_count];
+};
+
+template<typename F>
+inline Lanes each(F&& function) {
+	Lanes result;
+	for (uint32_t i = 0; i < lane_count; ++i) {
+		result.v[i] = function(i);
+	}
+
+	return result;
+}
+
+inline Lanes load(const float* p) { return each([&](uint32_t i) { return p[i]; }); }
+inline void store(float* p, Lanes a) { std::copy_n(a.v, lane_count, p); }
+inline Lanes splat(float x) { return each([&](uint32_t) { return x; }); }
+
+inline Lanes operator+(Lanes a, Lanes b) {
+	return each([&](uint32_t i) { return a.v[i] + b.v[i]; });
+}
+
+inline Lanes operator-(Lanes a, Lanes b) {
+	return each([&](uint32_t i) { return a.v[i] - b.v[i]; });
+}
+
+inline Lanes operator*(Lanes a, Lanes b) {
+	return each([&](uint32_t i) { return a.v[i] * b.v[i]; });
+}
+
+inline Lanes operator/(Lanes a, Lanes b) {
+	return each([&](uint32_t i) { return a.v[i] / b.v[i]; });
+}
+
+inline Lanes sqrt(Lanes a) { return each([&](uint32_t i) { return std::sqrt(a.v[i]); }); }
+
+inline Lanes signOf(Lanes a) {
+	return each([&](uint32_t i) { return std::copysign(1.0f, a.v[i]); });
+}
+#endif
+
+// Rows of a * b, both affine
+inline JointMatrix multiply(const JointMatrix& a, const JointMatrix& b) {
+	JointMatrix result;
+
+#if defined(__SSE2__) || defined(_M_X64)
+	const __m128 b0 = _mm_loadu_ps(&b.rows[0].x);
+	const __m128 b1 = _mm_loadu_ps(&b.rows[1].x);
+	const __m128 b2 = _mm_loadu_ps(&b.rows[2].x);
+	const __m128 w = _mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f);
+
+	for (uint32_t i = 0; i < 3; ++i) {
+		const __m128 row = _mm_loadu_ps(&a.rows[i].x);
+		__m128 sum = _mm_mul_ps(row, w);
+		sum = _mm_add_ps(sum, _mm_mul_ps(_mm_shuffle_ps(row, row, 0x00), b0));
+		sum = _mm_add_ps(sum, _mm_mul_ps(_mm_shuffle_ps(row, row, 0x55), b1));
+		sum = _mm_add_ps(sum, _mm_mul_ps(_mm_shuffle_ps(row, row, 0xAA), b2));
+		_mm_storeu_ps(&result.rows[i].x, sum);
+	}
+#else
+	for (uint32_t i = 0; i < 3; ++i) {
+		const glm::vec4& row = a.rows[i];
+		result.rows[i] = row.x * b.rows[0] + row.y * b.rows[1] + row.z * b.rows[2] +
+		                 glm::vec4(0.0f, 0.0f, 0.0f, row.w);
+	}
+#endif
+
+	return result;
+}
+
+} // namespace
+
+Clip::Clip(uint32_t joint_count, uint32_t key_count, float rate)
+	: joint_count_{joint_count}, key_count_{key_count}, rate_{rate},
+	  stride_{(joint_count + lane_count - 1) / lane_count * lane_count} {
+	assert(joint_count > 0 && key_count > 0 && rate > 0.0f);
+
+	for (auto& axis : translations_) {
+		axis.assign(size_t(stride_) * key_count_, 0.0f);
+	}
+
+	for (auto& axis : rotations_) {
+		axis.assign(size_t(stride_) * key_count_, 0.0f);
+	}
+
+	std::fill(rotations_[3].begin(), rotations_[3].end(), 1.0f);
+}
+
+void Clip::setKey(uint32_t key, uint32_t joint, glm::vec3 translation, glm::quat rotation) {
+	assert(key < key_count_ && joint < joint_count_);
+
+	const size_t index = size_t(key) * stride_ + joint;
+	for (uint32_t i = 0; i < 3; ++i) {
+		translations_[i][index] = translation[i];
+	}
+
+	rotation = glm::normalize(rotation);
+	rotations_[0][index] = rotation.x;
+	rotations_[1][index] = rotation.y;
+	rotations_[2][index] = rotation.z;
+	rotations_[3][index] = rotation.w;
+}
+
+void sample(const Skeleton& skeleton, std::span<const Player> players,
+            std::span<JointMatrix> palettes) {
+	const uint32_t joint_count = skeleton.size();
+	assert(skeleton.inverse_binds.size() == joint_count);
+	assert(palettes.size() >= size_t(players.size()) * joint_count);
+
+	jobs::parallelFor(players.size(), player_grain, [&](uint32_t begin, uint32_t end, uint32_t) {
+		for (uint32_t p = begin; p < end; ++p) {
+			const Clip& clip = *players[p].clip;
+			assert(clip.joint_count_ == joint_count);
+
+			JointMatrix* palette = palettes.data() + size_t(p) * joint_count;
+
+			float position = std::fmod(players[p].time * clip.rate_, float(clip.key_count_));
+			if (position < 0.0f) {
+				position += clip.key_count_;
+			}
+
+			const uint32_t key = std::min(uint32_t(position), clip.key_count_ - 1);
+			const uint32_t next = key + 1 == clip.key_count_ ? 0 : key + 1;
+			const size_t from = size_t(key) * clip.stride_;
+			const size_t to = size_t(next) * clip.stride_;
+
+			const float alpha = position - key;
+			const Lanes t = splat(alpha);
+			const Lanes one = splat(1.0f);
+			const Lanes two = splat(2.0f);
+
+			for (uint32_t j = 0; j < joint_count; j += lane_count) {
+				Lanes translation[3];
+				for (uint32_t i = 0; i < 3; ++i) {
+					const Lanes t0 = load(&clip.translations_[i][from + j]);
+					const Lanes t1 = load(&clip.translations_[i][to + j]);
+					translation[i] = t0 + (t1 - t0) * t;
+				}
+
+				Lanes q0[4];
+				Lanes q1[4];
+				for (uint32_t i = 0; i < 4; ++i) {
+					q0[i] = load(&clip.rotations_[i][from + j]);
+					q1[i] = load(&clip.rotations_[i][to + j]);
+				}
+
+				// Shortest arc, then nlerp with its parameter bent towards
+				// slerp's constant angular speed, after Kapoulkine's fit
+				Lanes cosine = q0[0] * q1[0] + q0[1] * q1[1] + q0[2] * q1[2] + q0[3] * q1[3];
+				const Lanes sign = signOf(cosine);
+				cosine = cosine * sign;
+
+				const Lanes a = splat(1.0904f) + cosine * (splat(-3.2452f) + cosine *
+				                (splat(3.55645f) - cosine * splat(1.43519f)));
+				const Lanes b = splat(0.848013f) + cosine * (splat(-1.06021f) +
+				                cosine * splat(0.215638f));
+				const Lanes centered = t - splat(0.5f);
+				const Lanes k = a * centered * centered + b;
+				const Lanes bent = t + t * centered * (t - one) * k;
+
+				Lanes q[4];
+				for (uint32_t i = 0; i < 4; ++i) {
+					q[i] = q0[i] + (q1[i] * sign - q0[i]) * bent;
+				}
+
+				const Lanes scale = one / sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] +
+				                               q[3] * q[3]);
+				const Lanes x = q[0] * scale, y = q[1] * scale, z = q[2] * scale,
+				            w = q[3] * scale;
+
+				const Lanes xx = x * x, yy = y * y, zz = z * z;
+				const Lanes xy = x * y, xz = x * z, yz = y * z;
+				const Lanes wx = w * x, wy = w * y, wz = w * z;
+
+				const Lanes rows[12] = {
+					one - two * (yy + zz), two * (xy - wz), two * (xz + wy), translation[0],
+					two * (xy + wz), one - two * (xx + zz), two * (yz - wx), translation[1],
+					two * (xz - wy), two * (yz + wx), one - two * (xx + yy), translation[2],
+				};
+
+				float elements[12][lane_count];
+				for (uint32_t i = 0; i < 12; ++i) {
+					store(elements[i], rows[i]);
+				}
+
+				const uint32_t lanes = std::min(lane_count, joint_count - j);
+				for (uint32_t l = 0; l < lanes; ++l) {
+					for (uint32_t i = 0; i < 12; ++i) {
+						palette[j + l].rows[i / 4][i % 4] = elements[i][l];
+					}
+				}
+			}
+
+			// Local to model space, parents being done first
+			for (uint32_t j = 0; j < joint_count; ++j) {
+				const uint32_t parent = skeleton.parents[j];
+				if (parent != no_joint) {
+					assert(parent < j);
+					palette[j] = multiply(palette[parent], palette[j]);
+				}
+			}
+
+			// Only now, as children needed their parents' model transforms
+			for (uint32_t j = 0; j < joint_count; ++j) {
+				palette[j] = multiply(palette[j], skeleton.inverse_binds[j]);
+			}
+		}
+	});
+}
+
+} // namespace glint::animation
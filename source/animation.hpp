@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <vector>
+
+#include <glm/ext/vector_float3.hpp>
+#include <glm/ext/vector_float4.hpp>
+#include <glm/ext/quaternion_float.hpp>
+#include <glm/ext/quaternion_geometric.hpp>
+
+namespace glint::animation {
+
+constexpr uint32_t no_joint = std::numeric_limits<uint32_t>::max();
+
+// Affine transform as the top three rows of its matrix, the layout the
+// skinning shader reads
+struct JointMatrix final {
+	glm::vec4 rows[3];
+};
+
+static_assert(sizeof(JointMatrix) == 48);
+
+// Joints are ordered so parents come before their children
+struct Skeleton final {
+	std::vector<uint32_t> parents;
+	// From model space into each joint's space in the bind pose
+	std::vector<JointMatrix> inverse_binds;
+
+	uint32_t size() const noexcept { return parents.size(); }
+};
+
+class Clip;
+
+struct Player final {
+	const Clip* clip;
+	float time = 0.0f;
+};
+
+// Local joint transforms keyed at a fixed rate, looping from the last key
+// back to the first. Keys are stored as structure of arrays, every component
+// of a key in its own run over the joints, so joints are blended four at a
+// time.
+class Clip final {
+public:
+	Clip(uint32_t joint_count, uint32_t key_count, float rate);
+	~Clip() = default;
+
+	Clip(const Clip&) = delete;
+	Clip(Clip&&) noexcept = default;
+
+	Clip& operator=(const Clip&) = delete;
+	Clip& operator=(Clip&&) noexcept = default;
+
+	void setKey(uint32_t key, uint32_t joint, glm::vec3 translation, glm::quat rotation);
+
+	uint32_t jointCount() const noexcept { return joint_count_; }
+	uint32_t keyCount() const noexcept { return key_count_; }
+	float duration() const noexcept { return key_count_ / rate_; }
+
+private:
+	friend void sample(const Skeleton&, std::span<const Player>, std::span<JointMatrix>);
+
+	uint32_t joint_count_;
+	uint32_t key_count_;
+	float rate_;
+
+	// Joints per key rounded up to whole groups of four
+	uint32_t stride_;
+
+	std::vector<float> translations_[3];
+	std::vector<float> rotations_[4];
+};
+
+// Samples each player's clip at its time and writes skeleton.size() joint
+// matrices per player to palettes, player i's from i * skeleton.size() on,
+// each taking the bind pose to the posed one. Players are spread over the
+// job workers. Rotations are blended with a corrected nlerp, close to slerp
+// without any trigonometry.
+void sample(const Skeleton& skeleton, std::span<const Player> players,
+            std::span<JointMatrix> palettes);
+
+} // namespace glint::animation
@@ -0,0 +1,231 @@
+#include "frame.hpp"
+
+#include <cassert>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+
+#include <glad/gles2.h>
+
+#include "profiler.hpp"
+
+namespace glint::frame {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using Seconds = std::chrono::duration<double>;
+
+// Anything beyond this is dropped, so a long stall does not snowball
+constexpr uint32_t max_steps_per_frame = 8;
+
+constexpr Clock::duration min_sleep_margin = std::chrono::microseconds(100);
+constexpr Clock::duration max_sleep_margin = std::chrono::milliseconds(4);
+
+PresentMode present_mode = PresentMode::vsync;
+double frame_cap = 60.0;
+// Read by the thread owning the context, which may not be the one setting it
+std::atomic<uint32_t> queued_frames = 2;
+double simulation_rate = 60.0;
+
+Clock::duration frame_interval;
+Clock::duration simulation_step;
+Clock::duration accumulator;
+Clock::duration sleep_margin;
+Clock::duration last_frame_time;
+Clock::time_point last_frame_start;
+Clock::time_point next_deadline;
+
+uint64_t simulation_steps;
+uint64_t frame_index;
+
+std::array<GLsync, max_queued_frames> fences;
+uint64_t completed_frames;
+
+inline Clock::duration interval(double rate) {
+	return std::chrono::duration_cast<Clock::duration>(Seconds(1.0 / rate));
+}
+
+// The OS sleep is only trusted up to sleep_margin before the deadline, the
+// rest is spun away. The margin follows the largest recent oversleep.
+void waitUntil(Clock::time_point deadline) {
+	auto now = Clock::now();
+
+	if (deadline - now > sleep_margin) {
+		auto target = deadline - sleep_margin;
+		std::this_thread::sleep_until(target);
+
+		auto overshoot = Clock::now() - target;
+		if (overshoot > sleep_margin) {
+			sleep_margin = overshoot;
+		} else {
+			sleep_margin -= (sleep_margin - overshoot) / 16;
+		}
+
+		sleep_margin = std::clamp(sleep_margin, min_sleep_margin, max_sleep_margin);
+	}
+
+	while (Clock::now() < deadline) {
+		std::this_thread::yield();
+	}
+}
+
+void waitForFence(GLsync& fence) {
+	if (fence == nullptr) {
+		return;
+	}
+
+	GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+	while (glClientWaitSync(fence, flags, 1'000'000) == GL_TIMEOUT_EXPIRED) {
+		flags = 0;
+	}
+
+	glDeleteSync(fence);
+	fence = nullptr;
+}
+
+} // namespace
+
+void setup() {
+	frame_interval = interval(frame_cap);
+	simulation_step = interval(simulation_rate);
+	accumulator = {};
+	sleep_margin = std::chrono::milliseconds(1);
+	last_frame_time = {};
+	last_frame_start = Clock::now();
+	next_deadline = last_frame_start;
+
+	simulation_steps = 0;
+	frame_index = 0;
+
+	fences.fill(nullptr);
+	completed_frames = 0;
+}
+
+void shutdown() {
+	for (auto& fence : fences) {
+		if (fence != nullptr) {
+			glDeleteSync(fence);
+			fence = nullptr;
+		}
+	}
+}
+
+uint32_t beginFrame() {
+	if (present_mode == PresentMode::capped) {
+		waitUntil(next_deadline);
+
+		// Falling more than a frame behind restarts the schedule instead of
+		// rushing out a burst of frames
+		next_deadline = std::max(next_deadline + frame_interval, Clock::now());
+	}
+
+	auto now = Clock::now();
+	last_frame_time = now - last_frame_start;
+	last_frame_start = now;
+
+	accumulator += std::min(last_frame_time, max_steps_per_frame * simulation_step);
+
+	uint32_t steps = accumulator / simulation_step;
+	accumulator -= steps * simulation_step;
+	simulation_steps += steps;
+
+	return steps;
+}
+
+void throttle() {
+	uint32_t queued = queued_frames.load(std::memory_order_relaxed);
+
+	if (queued != 0 && frame_index >= queued) {
+		profiler::Scope scope("latency");
+		waitForFence(fences[(frame_index - queued) % max_queued_frames]);
+	}
+}
+
+void fence() {
+	auto& fence = fences[frame_index % max_queued_frames];
+	if (fence != nullptr) {
+		glDeleteSync(fence);
+	}
+
+	fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	++frame_index;
+}
+
+uint64_t fencedFrames() {
+	return frame_index;
+}
+
+// The GPU finishes frames in order, so the newest signaled fence vouches for
+// every frame before it, including those whose fences were already recycled.
+// A missing fence was deleted after being waited on.
+uint64_t completedFrames() {
+	uint64_t oldest = std::max<uint64_t>(completed_frames,
+	                                     frame_index > max_queued_frames
+	                                     ? frame_index - max_queued_frames : 0);
+
+	for (uint64_t frame = frame_index; frame > oldest; --frame) {
+		GLsync fence = fences[(frame - 1) % max_queued_frames];
+
+		if (fence == nullptr || glClientWaitSync(fence, 0, 0) != GL_TIMEOUT_EXPIRED) {
+			completed_frames = frame;
+			break;
+		}
+	}
+
+	return completed_frames;
+}
+
+void setPresentMode(PresentMode mode) {
+	present_mode = mode;
+	next_deadline = Clock::now();
+}
+
+PresentMode presentMode() {
+	return present_mode;
+}
+
+void setFrameCap(double rate) {
+	assert(rate > 0.0);
+	frame_cap = rate;
+	frame_interval = interval(rate);
+}
+
+double frameCap() {
+	return frame_cap;
+}
+
+void setQueuedFrames(uint32_t count) {
+	assert(count <= max_queued_frames);
+	queued_frames = count;
+}
+
+uint32_t queuedFrames() {
+	return queued_frames;
+}
+
+void setSimulationRate(double rate) {
+	assert(rate > 0.0);
+	simulation_rate = rate;
+	simulation_step = interval(rate);
+}
+
+float step() {
+	return 1.0 / simulation_rate;
+}
+
+double time() {
+	return simulation_steps * Seconds(simulation_step).count();
+}
+
+float alpha() {
+	return float(accumulator.count()) / float(simulation_step.count());
+}
+
+double frameTime() {
+	return Seconds(last_frame_time).count();
+}
+
+} // namespace glint::frame
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+
+namespace glint::frame {
+
+enum class PresentMode {
+	vsync,
+	uncapped,
+	capped,
+};
+
+constexpr uint32_t max_queued_frames = 4;
+
+void setup();
+void shutdown();
+
+// Waits for the frame cap, then advances the clock. Returns the number of
+// fixed simulation steps to run this frame.
+uint32_t beginFrame();
+
+// Latency limiting, on the thread that owns the GL context. throttle() waits
+// until fewer than queuedFrames() frames are in flight, fence() marks the end
+// of one once its commands have been issued.
+void throttle();
+void fence();
+
+// Frames fenced so far and how many of them the GPU has finished, both on
+// the thread that owns the context
+uint64_t fencedFrames();
+uint64_t completedFrames();
+
+// The window's swap interval is left to the caller; it should be 1 for
+// PresentMode::vsync and 0 otherwise
+void setPresentMode(PresentMode mode);
+PresentMode presentMode();
+
+void setFrameCap(double rate);
+double frameCap();
+
+// Frames the CPU may run ahead of the GPU, 0 disables the limit
+void setQueuedFrames(uint32_t count);
+uint32_t queuedFrames();
+
+void setSimulationRate(double rate);
+
+// Seconds per simulation step
+float step();
+
+// Simulation time at the end of the last step
+double time();
+
+// How far rendering lies between the last two simulation steps, in [0, 1)
+float alpha();
+
+// Seconds between the last two beginFrame calls
+double frameTime();
+
+} // namespace glint::frame
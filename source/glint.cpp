@@ -1,4 +1,6 @@
 #include <cstdint>
+#include <cmath>
+#include <atomic>
 #include <iostream>
 #include <array>
 #include <vector>
@@ -13,6 +15,13 @@
 #include <lodepng.h>
 
 #include "input.hpp"
+#include "frame.hpp"
+#include "jobs.hpp"
+#include "profiler.hpp"
+#include "render_thread.hpp"
+#include "scene.hpp"
+#include "scene_bvh.hpp"
+#include "scene_occlusion.hpp"
 #include "graphics.hpp"
 #include "graphics_gl.hpp"
 #include "graphics_utils.hpp"
@@ -23,8 +32,16 @@ namespace {
 constexpr int32_t window_default_width = 1280;
 constexpr int32_t window_default_height = 720;
 
+// Speeds are per second, damping is per 1/60 of a second
+constexpr float camera_turn_speed = 3.0f;
+constexpr float camera_move_speed = 6.0f;
+constexpr float camera_damping = 0.8f;
+
 GLFWwindow* window;
 
+// Swap interval wanted by the main thread, applied by the render thread
+std::atomic<int> swap_interval = 1;
+
 } // namespace
 
 int main() try {
@@ -61,6 +78,9 @@ int main() try {
 	graphics::gl::setup(window_default_width, window_default_height);
 	graphics::setup();
 	graphics::utils::setup();
+	profiler::setup();
+	frame::setup();
+	jobs::setup();
 
 	graphics::Camera camera{
 		.viewport = glm::vec2(window_default_width, window_default_height),
@@ -68,31 +88,41 @@ int main() try {
 		.position = glm::vec3{0.0f, 1.0f, 2.0f},
 	};
 
-	auto* texture_sampler = new graphics::gl::Sampler({
+	auto texture_sampler = graphics::create<graphics::gl::Sampler>(graphics::gl::Sampler::Descriptor{
 		.min_filter = GL_LINEAR_MIPMAP_LINEAR,
 		.anisotropy = 16.0f,
 	});
 
-	auto* floor_texture = []() -> graphics::gl::Texture* {
+	auto floor_texture = []() {
 		uint32_t texture_width, texture_height;
 		std::vector<uint8_t> texture_data;
 		lodepng::decode(texture_data, texture_width, texture_height, "./assets/floor.png");
-		return new graphics::gl::Texture(GL_RGBA8,
-		                                 texture_width, texture_height,
-		                                 texture_data.data());
+		return graphics::create<graphics::gl::Texture>(GL_RGBA8,
+		                                               texture_width, texture_height,
+		                                               texture_data.data());
 	}();
 
-	auto* cube_texture = []() -> graphics::gl::Texture* {
+	auto cube_texture = []() {
 		uint32_t texture_width, texture_height;
 		std::vector<uint8_t> texture_data;
 		lodepng::decode(texture_data, texture_width, texture_height, "./assets/maxwell-nowhiskers.png");
-		return new graphics::gl::Texture(GL_RGBA8,
-		                                 texture_width, texture_height,
-		                                 texture_data.data());
+		return graphics::create<graphics::gl::Texture>(GL_RGBA8,
+		                                               texture_width, texture_height,
+		                                               texture_data.data());
 	}();
 
-	auto* cube_mesh = new graphics::Mesh(graphics::Mesh::makeCube());
-	auto* plane_mesh = new graphics::Mesh(graphics::Mesh::makePlane({0.0f, 1.0f, 0.0f}));
+	// Mesh uploads, executed in place before the render thread takes the context
+	graphics::CommandList uploads;
+
+	auto cube_mesh = graphics::createFrom<graphics::Mesh>([&]() {
+		return graphics::Mesh::makeCube(uploads);
+	});
+	graphics::get(cube_mesh).setOccluder(scene::unit_cube_positions, scene::unit_cube_indices);
+	auto plane_mesh = graphics::createFrom<graphics::Mesh>([&]() {
+		return graphics::Mesh::makePlane(uploads, {0.0f, 1.0f, 0.0f});
+	});
+
+	uploads.execute();
 
 	graphics::Material cube_material{
 		.render_mode = graphics::RenderMode::textured_lit,
@@ -109,86 +139,227 @@ int main() try {
 		.albedo_texture = floor_texture,
 	};
 
+	const graphics::MaterialSlot cube_slot = graphics::registerMaterial(cube_material);
+	const graphics::MaterialSlot floor_slot = graphics::registerMaterial(floor_material);
+
+	scene::Graph scene;
+
+	// Models are listed in node order, so node i drives models[i]
+	scene::Node cube_node = scene.add(scene::no_node, {0.0f, 1.0f, 0.0f});
+	scene::Node floor_node = scene.add(scene::no_node, {}, glm::quat(1.0f, 0.0f, 0.0f, 0.0f),
+	                                   glm::vec3(10.0f));
+
+	scene.update();
+
 	std::vector<graphics::Model> models{
 		{
-			.mesh = *cube_mesh,
-			.material = cube_material,
-			.transform = glm::mat4(1.0f),
+			.mesh = cube_mesh,
+			.material = &cube_material,
+			.instance = graphics::createInstance(scene.world(cube_node), cube_slot),
 		},
 		{
-			.mesh = *plane_mesh,
-			.material = floor_material,
-			.transform = glm::scale(glm::mat4(1.0f), {10.0f, 10.0f, 10.0f}),
+			.mesh = plane_mesh,
+			.material = &floor_material,
+			.instance = graphics::createInstance(scene.world(floor_node), floor_slot),
 		},
 	};
 
+	// Culling and picking go through the BVH, refitted as models move
+	scene::Bvh bvh;
+	std::vector<scene::Box> model_boxes;
+
+	for (scene::Node node : scene.changed()) {
+		const auto& bounds = graphics::get(models[node].mesh).bounds();
+		model_boxes.push_back(scene::Box::transformed(bounds.center, bounds.extents,
+		                                              scene.world(node)));
+	}
+
+	bvh.build(model_boxes);
+
 	std::vector<graphics::Light> lights{
 		{{}, 2.0f, {1.0f, 0.3f, 0.3f}},
 		{{}, 2.0f, {0.3f, 1.0f, 0.3f}},
 		{{}, 2.0f, {0.3f, 0.3f, 1.0f}},
 	};
 
+	// Camera state after the last two simulation steps, rendering
+	// interpolates between them
+	struct CameraState {
+		glm::vec3 position;
+		glm::vec3 rotation;
+		glm::vec3 forward_speed{};
+		glm::vec3 right_speed{};
+		glm::vec3 up_speed{};
+	};
+
+	CameraState camera_state{.position = camera.position, .rotation = camera.rotation};
+	CameraState previous_camera_state = camera_state;
+
+	// From here on the render thread owns the context
+	glfwMakeContextCurrent(nullptr);
+
+	render_thread::setup(
+		[](bool current) {
+			glfwMakeContextCurrent(current ? window : nullptr);
+		},
+		[]() {
+			static int current_swap_interval = 1;
+
+			int interval = swap_interval.load(std::memory_order_relaxed);
+			if (interval != current_swap_interval) {
+				glfwSwapInterval(interval);
+				current_swap_interval = interval;
+			}
+
+			glfwSwapBuffers(window);
+		});
+
 	while (!glfwWindowShouldClose(window)) {
+		uint32_t steps = frame::beginFrame();
+
 		input::cache();
 		glfwPollEvents();
 
-		static glm::vec3 camera_forward_speed{};
-		static glm::vec3 camera_right_speed{};
-		static glm::vec3 camera_up_speed{};
-
-		if (input::keyboard::isKeyDown(input::keyboard::Key::up)) {
-			camera.rotation.x += 0.05f;
+		if (input::keyboard::isKeyPressed(input::keyboard::Key::f1)) {
+			graphics::setRenderPath(graphics::renderPath() == graphics::RenderPath::forward
+			                        ? graphics::RenderPath::deferred
+			                        : graphics::RenderPath::forward);
 		}
 
-		if (input::keyboard::isKeyDown(input::keyboard::Key::down)) {
-			camera.rotation.x -= 0.05f;
+		if (input::keyboard::isKeyPressed(input::keyboard::Key::f3)) {
+			switch (frame::presentMode()) {
+				case frame::PresentMode::vsync:
+					frame::setPresentMode(frame::PresentMode::uncapped);
+					std::cout << "Present mode: uncapped\n";
+					break;
+
+				case frame::PresentMode::uncapped:
+					frame::setPresentMode(frame::PresentMode::capped);
+					std::cout << "Present mode: capped at " << frame::frameCap() << " Hz\n";
+					break;
+
+				case frame::PresentMode::capped:
+					frame::setPresentMode(frame::PresentMode::vsync);
+					std::cout << "Present mode: vsync\n";
+					break;
+			}
+
+			swap_interval = frame::presentMode() == frame::PresentMode::vsync ? 1 : 0;
 		}
 
-		if (input::keyboard::isKeyDown(input::keyboard::Key::right)) {
-			camera.rotation.y -= 0.05f;
+		if (input::keyboard::isKeyPressed(input::keyboard::Key::f4)) {
+			graphics::setClusterCulling(!graphics::clusterCulling());
+			std::cout << "Cluster culling: " << (graphics::clusterCulling() ? "on" : "off") << '\n';
 		}
 
-		if (input::keyboard::isKeyDown(input::keyboard::Key::left)) {
-			camera.rotation.y += 0.05f;
+		if (input::keyboard::isKeyPressed(input::keyboard::Key::f5)) {
+			graphics::setMemoryOverlay(!graphics::memoryOverlay());
 		}
 
-		camera.rotation.x -= input::mouse::cursorDelta().y * 0.005f;
-		camera.rotation.x = glm::clamp(camera.rotation.x,
-		                               -glm::pi<float>() / 2.0f,
-		                               glm::pi<float>() / 2.0f);
-
-		camera.rotation.y -= input::mouse::cursorDelta().x * 0.005f;
-		camera.rotation.y = glm::mod(camera.rotation.y, 2.0f * glm::pi<float>());
-
-		glm::mat3 rotation = mat3_cast(camera.calculateOrientation());
-		glm::vec3 forward = glm::normalize(rotation * glm::vec3(0.0f, 0.0f, -1.0f));
-		glm::vec3 up(0.0f, 1.0f, 0.0f);
-		glm::vec3 right = glm::normalize(glm::cross(forward, up));
+		if (input::keyboard::isKeyPressed(input::keyboard::Key::f6)) {
+			const bool atmosphere = graphics::skyMode() == graphics::SkyMode::gradient;
+			graphics::setSkyMode(atmosphere ? graphics::SkyMode::atmosphere
+			                                : graphics::SkyMode::gradient);
+			std::cout << "Sky: " << (atmosphere ? "atmosphere" : "gradient") << '\n';
+		}
 
-		if (input::keyboard::isKeyDown(input::keyboard::Key::w)) {
-			camera_forward_speed = forward * 0.1f;
-		} else if (input::keyboard::isKeyDown(input::keyboard::Key::s)) {
-			camera_forward_speed = forward * -0.1f;
+		if (input::keyboard::isKeyPressed(input::keyboard::Key::f7)) {
+			graphics::setOcclusionCulling(!graphics::occlusionCulling());
+			std::cout << "Occlusion culling: " << (graphics::occlusionCulling() ? "on" : "off")
+			          << '\n';
 		}
 
-		if (input::keyboard::isKeyDown(input::keyboard::Key::a)) {
-			camera_right_speed = right * -0.1f;
-		} else if (input::keyboard::isKeyDown(input::keyboard::Key::d)) {
-			camera_right_speed = right * 0.1f;
+		// Holds the GPU to a 60 Hz frame
+		if (input::keyboard::isKeyPressed(input::keyboard::Key::f8)) {
+			const bool dynamic = graphics::dynamicResolution().target_gpu_time == 0.0f;
+			graphics::setDynamicResolution({.target_gpu_time = dynamic ? 1000.0f / 60.0f : 0.0f});
+			graphics::setResolutionScale(1.0f);
+			std::cout << "Dynamic resolution: " << (dynamic ? "on" : "off") << '\n';
 		}
 
-		if (input::keyboard::isKeyDown(input::keyboard::Key::q)) {
-			camera_up_speed = up * 0.1f;
-		} else if (input::keyboard::isKeyDown(input::keyboard::Key::z)) {
-			camera_up_speed = up * -0.1f;
+		// Mouse deltas are per frame, so they bypass the simulation and shift
+		// both states to avoid being interpolated
+		glm::vec3 look{-input::mouse::cursorDelta().y * 0.005f,
+		               -input::mouse::cursorDelta().x * 0.005f,
+		               0.0f};
+
+		camera_state.rotation += look;
+		previous_camera_state.rotation += look;
+
+		const float step = frame::step();
+
+		for (uint32_t i = 0; i < steps; ++i) {
+			previous_camera_state = camera_state;
+
+			auto& state = camera_state;
+
+			if (input::keyboard::isKeyDown(input::keyboard::Key::up)) {
+				state.rotation.x += camera_turn_speed * step;
+			}
+
+			if (input::keyboard::isKeyDown(input::keyboard::Key::down)) {
+				state.rotation.x -= camera_turn_speed * step;
+			}
+
+			if (input::keyboard::isKeyDown(input::keyboard::Key::right)) {
+				state.rotation.y -= camera_turn_speed * step;
+			}
+
+			if (input::keyboard::isKeyDown(input::keyboard::Key::left)) {
+				state.rotation.y += camera_turn_speed * step;
+			}
+
+			state.rotation.x = glm::clamp(state.rotation.x,
+			                              -glm::pi<float>() / 2.0f,
+			                              glm::pi<float>() / 2.0f);
+
+			// Wrapping must not make the interpolation spin the long way round
+			float wrapped = glm::mod(state.rotation.y, 2.0f * glm::pi<float>());
+			previous_camera_state.rotation.y += wrapped - state.rotation.y;
+			state.rotation.y = wrapped;
+
+			graphics::Camera oriented{.viewport = camera.viewport, .rotation = state.rotation};
+			glm::mat3 rotation = mat3_cast(oriented.calculateOrientation());
+			glm::vec3 forward = glm::normalize(rotation * glm::vec3(0.0f, 0.0f, -1.0f));
+			glm::vec3 up(0.0f, 1.0f, 0.0f);
+			glm::vec3 right = glm::normalize(glm::cross(forward, up));
+
+			if (input::keyboard::isKeyDown(input::keyboard::Key::w)) {
+				state.forward_speed = forward * camera_move_speed;
+			} else if (input::keyboard::isKeyDown(input::keyboard::Key::s)) {
+				state.forward_speed = forward * -camera_move_speed;
+			}
+
+			if (input::keyboard::isKeyDown(input::keyboard::Key::a)) {
+				state.right_speed = right * -camera_move_speed;
+			} else if (input::keyboard::isKeyDown(input::keyboard::Key::d)) {
+				state.right_speed = right * camera_move_speed;
+			}
+
+			if (input::keyboard::isKeyDown(input::keyboard::Key::q)) {
+				state.up_speed = up * camera_move_speed;
+			} else if (input::keyboard::isKeyDown(input::keyboard::Key::z)) {
+				state.up_speed = up * -camera_move_speed;
+			}
+
+			state.position += (state.forward_speed + state.right_speed + state.up_speed) * step;
+
+			float damping = std::pow(camera_damping, step * 60.0f);
+			state.forward_speed *= damping;
+			state.right_speed *= damping;
+			state.up_speed *= damping;
 		}
 
-		camera.position += camera_forward_speed + camera_right_speed + camera_up_speed;
-		camera_forward_speed *= 0.8f;
-		camera_right_speed *= 0.8f;
-		camera_up_speed *= 0.8f;
+		const float alpha = frame::alpha();
 
-		float t = float(glfwGetTime());
+		camera.position = glm::mix(previous_camera_state.position, camera_state.position, alpha);
+		camera.rotation = glm::mix(previous_camera_state.rotation, camera_state.rotation, alpha);
+		camera.rotation.x = glm::clamp(camera.rotation.x,
+		                               -glm::pi<float>() / 2.0f,
+		                               glm::pi<float>() / 2.0f);
+
+		// Animations are functions of time, so interpolating them is exact
+		float t = float(frame::time() - (1.0f - alpha) * step);
 
 		float theta = 2.0f * glm::pi<float>() / lights.size();
 		for (size_t i = 0; i < lights.size(); ++i) {
@@ -196,21 +367,52 @@ int main() try {
 			lights[i].position = {2.0f * glm::cos(angle), 1.5f, 2.0f * glm::sin(angle)};
 		}
 
-		models[0].transform = glm::rotate(glm::translate(glm::mat4(1.0f), {0.0f, 1.0f, 0.0f}),
-		                                  t, glm::normalize(glm::vec3{glm::cos(t), glm::sin(t),
-		                                                              glm::cos(t) * glm::sin(t)}));
+		scene.setRotation(cube_node, glm::angleAxis(t, glm::normalize(glm::vec3{
+			glm::cos(t), glm::sin(t), glm::cos(t) * glm::sin(t)})));
+
+		scene.update();
+		model_boxes.clear();
+		for (scene::Node node : scene.changed()) {
+			const auto& bounds = graphics::get(models[node].mesh).bounds();
+			graphics::setInstanceTransform(models[node].instance, scene.world(node));
+			model_boxes.push_back(scene::Box::transformed(bounds.center, bounds.extents,
+			                                              scene.world(node)));
+		}
+
+		bvh.refit(scene.changed(), model_boxes);
 
-		graphics::render(models, camera, lights);
+		if (input::keyboard::isKeyPressed(input::keyboard::Key::f2)) {
+			render_thread::flush();
 
-		glfwSwapBuffers(window);
+			if (profiler::writeChromeTrace("glint_trace.json")) {
+				std::cout << "Trace written to glint_trace.json\n";
+			}
+
+			for (const auto& name : profiler::scopes()) {
+				auto stats = profiler::statistics(name);
+				std::cout << name
+				          << ": cpu " << stats.cpu_average << " ms (p95 " << stats.cpu_p95 << ")"
+				          << ", gpu " << stats.gpu_average << " ms (p95 " << stats.gpu_p95 << ")\n";
+			}
+		}
+
+		graphics::render(render_thread::beginFrame(), models, camera, lights, &bvh);
+		render_thread::endFrame();
 	}
 
-	delete plane_mesh;
-	delete cube_mesh;
+	render_thread::shutdown();
+	glfwMakeContextCurrent(window);
+
+	graphics::destroy(plane_mesh);
+	graphics::destroy(cube_mesh);
 
-	delete floor_texture;
-	delete texture_sampler;
+	graphics::destroy(cube_texture);
+	graphics::destroy(floor_texture);
+	graphics::destroy(texture_sampler);
 
+	jobs::shutdown();
+	frame::shutdown();
+	profiler::shutdown();
 	graphics::utils::shutdown();
 	graphics::shutdown();
 	graphics::gl::shutdown();
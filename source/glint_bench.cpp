@@ -0,0 +1,1027 @@
+#include <cstdint>
+#include <cstdlib>
+#include <cmath>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <string_view>
+#include <vector>
+#include <algorithm>
+#include <numeric>
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <glad/gles2.h>
+
+#include <glm/ext/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include "animation.hpp"
+#include "graphics.hpp"
+#include "graphics_gl.hpp"
+#include "graphics_particles.hpp"
+#include "graphics_pointcloud.hpp"
+#include "graphics_skinning.hpp"
+#include "graphics_utils.hpp"
+#include "frame.hpp"
+#include "jobs.hpp"
+#include "profiler.hpp"
+#include "render_thread.hpp"
+#include "scene_bvh.hpp"
+#include "scene_occlusion.hpp"
+using namespace glint;
+
+namespace {
+
+struct Options {
+	uint32_t width = 1280;
+	uint32_t height = 720;
+	uint32_t cubes = 1000;
+	uint32_t lights = 8;
+	uint32_t textures = 4;
+	uint32_t frames = 500;
+	uint32_t warmup = 50;
+	uint32_t seed = 1;
+	graphics::RenderPath render_path = graphics::RenderPath::forward;
+	frame::PresentMode present_mode = frame::PresentMode::uncapped;
+	double frame_cap = 60.0;
+	uint32_t queued_frames = 2;
+	bool threaded = false;
+	bool bvh = false;
+	bool clusters = false;
+	bool atmosphere = false;
+	bool occlusion = false;
+	bool spheres = false;
+	uint32_t lods = 1;
+	uint32_t jobs = 0;
+	uint32_t points = 0;
+	uint32_t point_budget = 1 << 22;
+	uint32_t crowd = 0;
+	uint32_t particles = 0;
+	bool additive_particles = false;
+	uint32_t batch_points = 0;
+	float resolution_scale = 1.0f;
+	float target_gpu_time = 0.0f;
+	bool sharpen = false;
+	const char* json_path = nullptr;
+};
+
+struct Distribution {
+	double average = 0.0;
+	double minimum = 0.0;
+	double p50 = 0.0;
+	double p95 = 0.0;
+	double p99 = 0.0;
+	double maximum = 0.0;
+};
+
+EGLDisplay display = EGL_NO_DISPLAY;
+EGLSurface surface = EGL_NO_SURFACE;
+EGLContext context = EGL_NO_CONTEXT;
+
+bool parseOptions(int argc, char** argv, Options& options) {
+	for (int i = 1; i < argc; ++i) {
+		std::string_view arg = argv[i];
+
+		if (arg == "--deferred") {
+			options.render_path = graphics::RenderPath::deferred;
+			continue;
+		}
+
+		if (arg == "--threaded") {
+			options.threaded = true;
+			continue;
+		}
+
+		if (arg == "--bvh") {
+			options.bvh = true;
+			continue;
+		}
+
+		if (arg == "--clusters") {
+			options.clusters = true;
+			continue;
+		}
+
+		if (arg == "--atmosphere") {
+			options.atmosphere = true;
+			continue;
+		}
+
+		if (arg == "--occlusion") {
+			options.occlusion = true;
+			continue;
+		}
+
+		if (arg == "--spheres") {
+			options.spheres = true;
+			continue;
+		}
+
+		if (arg == "--additive-particles") {
+			options.additive_particles = true;
+			continue;
+		}
+
+		if (arg == "--sharpen") {
+			options.sharpen = true;
+			continue;
+		}
+
+		if (i + 1 >= argc) {
+			std::cerr << "Missing value for " << arg << '\n';
+			return false;
+		}
+
+		const char* value = argv[++i];
+		uint32_t number = std::strtoul(value, nullptr, 10);
+
+		if (arg == "--width") {
+			options.width = number;
+		} else if (arg == "--height") {
+			options.height = number;
+		} else if (arg == "--cubes") {
+			options.cubes = number;
+		} else if (arg == "--lights") {
+			options.lights = number;
+		} else if (arg == "--textures") {
+			options.textures = number;
+		} else if (arg == "--frames") {
+			options.frames = number;
+		} else if (arg == "--warmup") {
+			options.warmup = number;
+		} else if (arg == "--seed") {
+			options.seed = number;
+		} else if (arg == "--present") {
+			std::string_view mode = value;
+			if (mode == "vsync") {
+				options.present_mode = frame::PresentMode::vsync;
+			} else if (mode == "uncapped") {
+				options.present_mode = frame::PresentMode::uncapped;
+			} else if (mode == "capped") {
+				options.present_mode = frame::PresentMode::capped;
+			} else {
+				std::cerr << "Unknown present mode " << mode << '\n';
+				return false;
+			}
+		} else if (arg == "--cap") {
+			options.frame_cap = std::strtod(value, nullptr);
+		} else if (arg == "--queued") {
+			options.queued_frames = number;
+		} else if (arg == "--lods") {
+			options.lods = number;
+		} else if (arg == "--jobs") {
+			options.jobs = number;
+		} else if (arg == "--points") {
+			options.points = number;
+		} else if (arg == "--point-budget") {
+			options.point_budget = number;
+		} else if (arg == "--crowd") {
+			options.crowd = number;
+		} else if (arg == "--particles") {
+			options.particles = number;
+		} else if (arg == "--batch-points") {
+			options.batch_points = number;
+		} else if (arg == "--resolution-scale") {
+			options.resolution_scale = std::strtof(value, nullptr);
+		} else if (arg == "--target-gpu-ms") {
+			options.target_gpu_time = std::strtof(value, nullptr);
+		} else if (arg == "--json") {
+			options.json_path = value;
+		} else {
+			std::cerr << "Unknown option " << arg << '\n';
+			return false;
+		}
+	}
+
+	return options.width != 0 && options.height != 0 && options.frames != 0 &&
+	       options.frame_cap > 0.0 && options.queued_frames <= frame::max_queued_frames &&
+	       options.lods != 0 && options.resolution_scale > 0.0f &&
+	       options.resolution_scale <= 1.0f && options.target_gpu_time >= 0.0f;
+}
+
+// Prefers Mesa's surfaceless platform so no display server is needed. The
+// pbuffer gives the renderer a default framebuffer to draw into.
+bool createContext(uint32_t width, uint32_t height) {
+	auto get_platform_display = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(
+		eglGetProcAddress("eglGetPlatformDisplayEXT"));
+
+	if (get_platform_display != nullptr) {
+		display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA,
+		                               EGL_DEFAULT_DISPLAY, nullptr);
+	}
+
+	if (display == EGL_NO_DISPLAY) {
+		display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+	}
+
+	if (display == EGL_NO_DISPLAY || !eglInitialize(display, nullptr, nullptr)) {
+		return false;
+	}
+
+	const EGLint config_attributes[] = {
+		EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_ES3_BIT,
+		EGL_RED_SIZE, 8,
+		EGL_GREEN_SIZE, 8,
+		EGL_BLUE_SIZE, 8,
+		EGL_ALPHA_SIZE, 8,
+		EGL_DEPTH_SIZE, 24,
+		EGL_STENCIL_SIZE, 8,
+		EGL_NONE,
+	};
+
+	EGLConfig config;
+	EGLint config_count = 0;
+	if (!eglChooseConfig(display, config_attributes, &config, 1, &config_count) ||
+	    config_count == 0) {
+		return false;
+	}
+
+	const EGLint surface_attributes[] = {
+		EGL_WIDTH, EGLint(width),
+		EGL_HEIGHT, EGLint(height),
+		EGL_NONE,
+	};
+
+	surface = eglCreatePbufferSurface(display, config, surface_attributes);
+	if (surface == EGL_NO_SURFACE) {
+		return false;
+	}
+
+	eglBindAPI(EGL_OPENGL_ES_API);
+
+	const EGLint context_attributes[] = {
+		EGL_CONTEXT_MAJOR_VERSION, 3,
+		EGL_CONTEXT_MINOR_VERSION, 1,
+		EGL_NONE,
+	};
+
+	context = eglCreateContext(display, config, EGL_NO_CONTEXT, context_attributes);
+	if (context == EGL_NO_CONTEXT) {
+		return false;
+	}
+
+	return eglMakeCurrent(display, surface, surface, context);
+}
+
+void destroyContext() {
+	if (display == EGL_NO_DISPLAY) {
+		return;
+	}
+
+	eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+
+	if (context != EGL_NO_CONTEXT) {
+		eglDestroyContext(display, context);
+	}
+
+	if (surface != EGL_NO_SURFACE) {
+		eglDestroySurface(display, surface);
+	}
+
+	eglTerminate(display);
+}
+
+std::vector<uint8_t> makeCheckerboard(uint32_t size, uint32_t cells, glm::vec3 color) {
+	std::vector<uint8_t> pixels(size * size * 4);
+
+	for (uint32_t y = 0; y < size; ++y) {
+		for (uint32_t x = 0; x < size; ++x) {
+			bool odd = ((x * cells / size) + (y * cells / size)) & 1;
+			glm::vec3 c = odd ? color : color * 0.25f;
+
+			uint8_t* pixel = &pixels[(y * size + x) * 4];
+			pixel[0] = uint8_t(c.x * 255.0f);
+			pixel[1] = uint8_t(c.y * 255.0f);
+			pixel[2] = uint8_t(c.z * 255.0f);
+			pixel[3] = 255;
+		}
+	}
+
+	return pixels;
+}
+
+constexpr uint32_t worm_joints = 8;
+constexpr uint32_t worm_rings = 32;
+constexpr uint32_t worm_sides = 12;
+constexpr float worm_segment = 0.25f;
+constexpr float worm_radius = 0.15f;
+
+// An open tube standing on the origin with a chain of joints up its axis,
+// each vertex blended between the two joints nearest to it
+std::unique_ptr<graphics::SkinnedMesh> makeWorm(animation::Skeleton& skeleton) {
+	skeleton = {};
+	for (uint32_t j = 0; j < worm_joints; ++j) {
+		skeleton.parents.push_back(j == 0 ? animation::no_joint : j - 1);
+		skeleton.inverse_binds.push_back({{
+			{1.0f, 0.0f, 0.0f, 0.0f},
+			{0.0f, 1.0f, 0.0f, -float(j) * worm_segment},
+			{0.0f, 0.0f, 1.0f, 0.0f},
+		}});
+	}
+
+	const float height = worm_joints * worm_segment;
+
+	std::vector<graphics::SkinnedVertex> vertices;
+	for (uint32_t ring = 0; ring <= worm_rings; ++ring) {
+		const float y = height * ring / worm_rings;
+		const float u = glm::clamp(y / worm_segment - 0.5f, 0.0f, float(worm_joints - 1));
+		const uint32_t joint = std::min(uint32_t(u), worm_joints - 2);
+		const uint16_t weight = uint16_t(std::lround((u - joint) * 65535.0f));
+
+		for (uint32_t side = 0; side <= worm_sides; ++side) {
+			const float angle = 2.0f * glm::pi<float>() * side / worm_sides;
+			const glm::vec3 normal{glm::cos(angle), 0.0f, glm::sin(angle)};
+
+			vertices.push_back({
+				.position = normal * worm_radius + glm::vec3(0.0f, y, 0.0f),
+				.normal = normal,
+				.uv = {float(side) / worm_sides, float(ring) / worm_rings},
+				.joints = {uint8_t(joint), uint8_t(joint + 1), 0, 0},
+				.weights = {uint16_t(65535 - weight), weight, 0, 0},
+			});
+		}
+	}
+
+	std::vector<uint32_t> indices;
+	for (uint32_t ring = 0; ring < worm_rings; ++ring) {
+		for (uint32_t side = 0; side < worm_sides; ++side) {
+			const uint32_t a = ring * (worm_sides + 1) + side;
+			const uint32_t b = a + worm_sides + 1;
+			indices.insert(indices.end(), {a, b, a + 1, a + 1, b, b + 1});
+		}
+	}
+
+	// Bent as far as the clip goes, it still stays within its length of the base
+	const float reach = height + worm_radius;
+	return std::make_unique<graphics::SkinnedMesh>(vertices, indices, graphics::Bounds{
+		glm::vec3(0.0f), glm::vec3(reach),
+	});
+}
+
+// Every joint swaying a little behind the one below it, looping in two seconds
+animation::Clip makeWormClip() {
+	constexpr uint32_t key_count = 32;
+	animation::Clip clip(worm_joints, key_count, key_count / 2.0f);
+
+	for (uint32_t key = 0; key < key_count; ++key) {
+		for (uint32_t j = 0; j < worm_joints; ++j) {
+			const float phase = 2.0f * glm::pi<float>() * key / key_count - 0.6f * j;
+			const glm::quat rotation =
+				glm::angleAxis(0.3f * glm::sin(phase), glm::vec3(0.0f, 0.0f, 1.0f)) *
+				glm::angleAxis(0.15f * glm::cos(phase), glm::vec3(1.0f, 0.0f, 0.0f));
+
+			clip.setKey(key, j, {0.0f, j == 0 ? 0.0f : worm_segment, 0.0f}, rotation);
+		}
+	}
+
+	return clip;
+}
+
+Distribution distribution(std::vector<double> samples) {
+	if (samples.empty()) {
+		return {};
+	}
+
+	std::sort(samples.begin(), samples.end());
+
+	auto percentile = [&](size_t p) { return samples[(samples.size() - 1) * p / 100]; };
+
+	return {
+		.average = std::accumulate(samples.begin(), samples.end(), 0.0) / samples.size(),
+		.minimum = samples.front(),
+		.p50 = percentile(50),
+		.p95 = percentile(95),
+		.p99 = percentile(99),
+		.maximum = samples.back(),
+	};
+}
+
+void writeDistribution(std::ostream& out, const Distribution& d) {
+	out << "{\"average\":" << d.average
+	    << ",\"min\":" << d.minimum
+	    << ",\"p50\":" << d.p50
+	    << ",\"p95\":" << d.p95
+	    << ",\"p99\":" << d.p99
+	    << ",\"max\":" << d.maximum << '}';
+}
+
+} // namespace
+
+int main(int argc, char** argv) try {
+	Options options;
+	if (!parseOptions(argc, argv, options)) {
+		std::cerr << "Usage: glint_bench [--width N] [--height N] [--cubes N] [--lights N]"
+		             " [--textures N] [--frames N] [--warmup N] [--seed N] [--deferred]"
+		             " [--present vsync|uncapped|capped] [--cap HZ] [--queued N] [--threaded]"
+		             " [--jobs N] [--bvh] [--clusters] [--atmosphere] [--occlusion] [--spheres]"
+		             " [--lods N] [--points N] [--point-budget N] [--crowd N]"
+		             " [--particles N] [--additive-particles] [--batch-points N]"
+		             " [--resolution-scale S]"
+		             " [--target-gpu-ms MS] [--sharpen] [--json PATH]\n";
+		return 1;
+	}
+
+	if (!createContext(options.width, options.height)) {
+		std::cerr << "Failed to create EGL context\n";
+		destroyContext();
+		return 1;
+	}
+
+	if (!gladLoadGLES2(reinterpret_cast<GLADloadfunc>(eglGetProcAddress))) {
+		std::cerr << "Failed to load GLES 3.1 functions\n";
+		destroyContext();
+		return 1;
+	}
+
+	graphics::gl::setup(options.width, options.height);
+	graphics::setup();
+	graphics::utils::setup();
+	profiler::setup();
+	frame::setup();
+	jobs::setup(options.jobs);
+
+	graphics::setRenderPath(options.render_path);
+	graphics::setClusterCulling(options.clusters);
+	graphics::setOcclusionCulling(options.occlusion);
+	graphics::setSkyMode(options.atmosphere ? graphics::SkyMode::atmosphere
+	                                        : graphics::SkyMode::gradient);
+	graphics::setResolutionScale(options.resolution_scale);
+	graphics::setDynamicResolution({
+		.target_gpu_time = options.target_gpu_time,
+		.minimum_scale = std::min(0.5f, options.resolution_scale),
+	});
+	graphics::setUpscaleFilter(options.sharpen ? graphics::UpscaleFilter::sharpened
+	                                           : graphics::UpscaleFilter::bilinear);
+
+	frame::setPresentMode(options.present_mode);
+	frame::setFrameCap(options.frame_cap);
+	frame::setQueuedFrames(options.queued_frames);
+	eglSwapInterval(display, options.present_mode == frame::PresentMode::vsync ? 1 : 0);
+
+	std::mt19937 random(options.seed);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+	auto sampler = graphics::create<graphics::gl::Sampler>(graphics::gl::Sampler::Descriptor{
+		.min_filter = GL_LINEAR_MIPMAP_LINEAR,
+	});
+
+	std::vector<graphics::TextureHandle> textures;
+	for (uint32_t i = 0; i < options.textures; ++i) {
+		auto pixels = makeCheckerboard(256, 2 << (i % 4),
+		                               {unit(random), unit(random), unit(random)});
+		textures.push_back(graphics::create<graphics::gl::Texture>(GL_RGBA8, 256, 256,
+		                                                           pixels.data()));
+	}
+
+	// Mesh uploads, executed in place once the scene is built
+	graphics::CommandList uploads;
+
+	auto cube_mesh = graphics::createFrom<graphics::Mesh>([&]() {
+		return options.spheres ? graphics::Mesh::makeSphere(uploads, 64, 32, options.lods)
+		                       : graphics::Mesh::makeCube(uploads);
+	});
+	auto plane_mesh = graphics::createFrom<graphics::Mesh>([&]() {
+		return graphics::Mesh::makePlane(uploads, {0.0f, 1.0f, 0.0f});
+	});
+
+	// Cubes fill their bounds and so are their own proxies, spheres do not
+	if (!options.spheres) {
+		graphics::get(cube_mesh).setOccluder(scene::unit_cube_positions, scene::unit_cube_indices);
+	}
+
+	// Models reference materials, so the vector must not reallocate
+	std::vector<graphics::Material> materials;
+	materials.reserve(options.textures + 1);
+
+	materials.push_back({
+		.render_mode = graphics::RenderMode::untextured_lit,
+		.albedo_color = glm::vec3(0.8f),
+		.specular_color = glm::vec3(1.0f),
+		.shininess = 16.0f,
+	});
+
+	for (auto texture : textures) {
+		materials.push_back({
+			.render_mode = graphics::RenderMode::textured_lit,
+			.specular_color = glm::vec3(0.5f),
+			.shininess = 32.0f,
+			.texture_sampler = sampler,
+			.albedo_texture = texture,
+		});
+	}
+
+	std::vector<graphics::MaterialSlot> material_slots;
+	for (const auto& material : materials) {
+		material_slots.push_back(graphics::registerMaterial(material));
+	}
+
+	const float extent = 2.0f * std::cbrt(float(options.cubes));
+
+	std::vector<graphics::Model> models;
+	models.reserve(options.cubes + options.crowd + 1);
+
+	models.push_back({
+		.mesh = plane_mesh,
+		.material = &materials[0],
+		.instance = graphics::createInstance(glm::scale(glm::mat4(1.0f), glm::vec3(4.0f * extent)),
+		                                     material_slots[0]),
+	});
+
+	for (uint32_t i = 0; i < options.cubes; ++i) {
+		glm::vec3 position{
+			(unit(random) - 0.5f) * 2.0f * extent,
+			0.5f + unit(random) * extent * 0.5f,
+			(unit(random) - 0.5f) * 2.0f * extent,
+		};
+
+		glm::vec3 axis = glm::normalize(glm::vec3(unit(random), unit(random), unit(random)) + 0.1f);
+
+		const uint32_t m = textures.empty() ? 0 : 1 + i % textures.size();
+		glm::mat4 transform = glm::rotate(glm::translate(glm::mat4(1.0f), position),
+		                                  unit(random) * glm::pi<float>(), axis);
+
+		models.push_back({
+			.mesh = cube_mesh,
+			.material = &materials[m],
+			.instance = graphics::createInstance(transform, material_slots[m]),
+		});
+	}
+
+	// Worms on a grid in the middle of the scene, each a step apart in the clip
+	animation::Skeleton worm_skeleton;
+	std::unique_ptr<graphics::SkinnedMesh> worm_mesh;
+	animation::Clip worm_clip = makeWormClip();
+
+	std::vector<graphics::SkinnedModel> crowd;
+	std::vector<animation::Player> players;
+	std::vector<animation::JointMatrix> palettes(options.crowd * worm_joints);
+
+	if (options.crowd != 0) {
+		worm_mesh = makeWorm(worm_skeleton);
+
+		const uint32_t side = uint32_t(std::ceil(std::sqrt(float(options.crowd))));
+		const float spacing = 1.0f;
+
+		for (uint32_t i = 0; i < options.crowd; ++i) {
+			const glm::vec3 position{(float(i % side) - side * 0.5f) * spacing, 0.0f,
+			                         (float(i / side) - side * 0.5f) * spacing};
+
+			const uint32_t m = textures.empty() ? 0 : 1 + i % textures.size();
+			const auto target = worm_mesh->createTarget(uploads);
+
+			models.push_back({
+				.mesh = target,
+				.material = &materials[m],
+				.instance = graphics::createInstance(glm::translate(glm::mat4(1.0f), position),
+				                                     material_slots[m]),
+			});
+
+			crowd.push_back({worm_mesh.get(), target, i * worm_joints});
+			players.push_back({&worm_clip, 0.0f});
+		}
+	}
+
+	uploads.execute();
+
+	// The scene is static, so the tree is built once
+	scene::Bvh bvh;
+	if (options.bvh) {
+		std::vector<scene::Box> boxes;
+		for (const auto& model : models) {
+			const auto& bounds = graphics::get(model.mesh).bounds();
+			boxes.push_back(scene::Box::transformed(bounds.center, bounds.extents,
+			                                        graphics::instanceTransform(model.instance)));
+		}
+
+		bvh.build(boxes);
+	}
+
+	const scene::Bvh* culling = options.bvh ? &bvh : nullptr;
+
+	// Rolling terrain over the scene, written out and mapped back like a scan
+	const auto point_cloud_path = std::filesystem::temp_directory_path() / "glint_bench.glpc";
+	std::unique_ptr<graphics::PointCloud> point_cloud;
+
+	if (options.points != 0) {
+		std::vector<graphics::CloudPoint> points(options.points);
+		for (auto& point : points) {
+			const float x = (unit(random) - 0.5f) * 2.0f * extent;
+			const float z = (unit(random) - 0.5f) * 2.0f * extent;
+			const float height = 0.5f + 0.5f * glm::sin(x * 0.7f) * glm::cos(z * 0.5f);
+
+			point.position = {x, 1.0f + height * extent * 0.25f, z};
+			point.color = uint32_t(255.0f * height) | uint32_t(160) << 8 |
+			              uint32_t(255.0f * (1.0f - height)) << 16 | 0xFF00'0000u;
+		}
+
+		graphics::writePointCloud(points, point_cloud_path.string());
+
+		point_cloud = std::make_unique<graphics::PointCloud>(point_cloud_path.string(),
+		                                                     options.point_budget * 2);
+		graphics::setPointCloud(point_cloud.get());
+		graphics::setPointBudget(options.point_budget);
+	}
+
+	// A fountain over the middle of the scene, emitting as fast as the
+	// capacity allows for the particles' lifetime
+	std::unique_ptr<graphics::ParticleSystem> particles;
+
+	if (options.particles != 0) {
+		particles = std::make_unique<graphics::ParticleSystem>(options.particles);
+
+		auto& emitter = particles->emitter();
+		emitter.position = {0.0f, extent * 0.5f, 0.0f};
+		emitter.radius = 0.2f;
+		emitter.velocity = {0.0f, extent * 0.6f, 0.0f};
+		emitter.spread = extent * 0.3f;
+		emitter.lifetime = 3.0f;
+		emitter.rate = options.particles / emitter.lifetime;
+		emitter.size = 0.04f;
+		emitter.start_color = {1.0f, 0.8f, 0.3f, 0.8f};
+		emitter.end_color = {0.8f, 0.2f, 0.1f, 0.0f};
+		emitter.sorted = !options.additive_particles;
+
+		graphics::setParticleSystem(particles.get());
+	}
+
+	// Markers drawn over the frame through a point batch sized for a sixteenth
+	// of them. The count ramps up over the first frames, so every buffer in
+	// the ring is outgrown while commands are being recorded.
+	std::unique_ptr<graphics::utils::PointBatch> batch;
+	std::vector<graphics::utils::Point> batch_points;
+
+	if (options.batch_points != 0) {
+		batch = std::make_unique<graphics::utils::PointBatch>(
+			std::max(options.batch_points / 16, 1u));
+
+		for (uint32_t i = 0; i < options.batch_points; ++i) {
+			batch_points.emplace_back(
+				glm::vec3((unit(random) - 0.5f) * 2.0f * extent, 0.5f + unit(random) * extent,
+				          (unit(random) - 0.5f) * 2.0f * extent),
+				4.0f, glm::vec4(unit(random), unit(random), 1.0f, 0.8f));
+		}
+	}
+
+	std::vector<graphics::Light> lights;
+	for (uint32_t i = 0; i < options.lights; ++i) {
+		lights.push_back({
+			{(unit(random) - 0.5f) * 2.0f * extent, 2.0f, (unit(random) - 0.5f) * 2.0f * extent},
+			extent * 0.5f,
+			{unit(random), unit(random), unit(random)},
+		});
+	}
+
+	graphics::Camera camera{
+		.viewport = glm::vec2(options.width, options.height),
+	};
+
+	std::vector<double> cpu_frame_times;
+	cpu_frame_times.reserve(options.frames);
+
+	double animation_ms = 0.0;
+
+	using Clock = std::chrono::steady_clock;
+	Clock::time_point start;
+
+	// Recorded and executed in place unless the render thread takes over
+	graphics::CommandList* commands = nullptr;
+
+	if (options.threaded) {
+		eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+
+		render_thread::setup(
+			[](bool current) {
+				if (current) {
+					eglMakeCurrent(display, surface, surface, context);
+				} else {
+					eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+				}
+			},
+			[]() {
+				eglSwapBuffers(display, surface);
+			});
+	} else {
+		commands = new graphics::CommandList;
+	}
+
+	for (uint32_t frame = 0; frame < options.warmup + options.frames; ++frame) {
+		if (frame == options.warmup) {
+			if (options.threaded) {
+				render_thread::flush();
+			} else {
+				glFinish();
+			}
+
+			profiler::reset();
+			graphics::gl::resetStatistics();
+			start = Clock::now();
+		}
+
+		// Scripted orbit, a function of the frame number only
+		float t = float(frame) / float(options.warmup + options.frames) * 2.0f * glm::pi<float>();
+		camera.position = {extent * 1.5f * glm::sin(t), extent * 0.5f, extent * 1.5f * glm::cos(t)};
+		camera.rotation = {-0.3f, t, 0.0f};
+
+		auto frame_start = Clock::now();
+
+		// Sampled on the job workers, skinned on the GPU ahead of the frame's passes
+		auto animate = [&](graphics::CommandList& frame_commands) {
+			if (crowd.empty()) {
+				return;
+			}
+
+			for (uint32_t i = 0; i < players.size(); ++i) {
+				players[i].time = float(frame) / 60.0f + 0.37f * i;
+			}
+
+			auto animation_start = Clock::now();
+			animation::sample(worm_skeleton, players, palettes);
+
+			if (frame >= options.warmup) {
+				using Milliseconds = std::chrono::duration<double, std::milli>;
+				animation_ms += Milliseconds(Clock::now() - animation_start).count();
+			}
+
+			graphics::skin(frame_commands, crowd, palettes);
+		};
+
+		if (particles != nullptr) {
+			particles->advance(1.0f / 60.0f);
+		}
+
+		graphics::Overlay overlay;
+		if (batch != nullptr) {
+			const size_t count = batch_points.size() * std::min(frame + 1, 8u) / 8;
+			batch->append(std::span(batch_points).first(count));
+
+			overlay = [&](graphics::CommandList& frame_commands) {
+				batch->draw(frame_commands, camera.calculatePerspective());
+			};
+		}
+
+		frame::beginFrame();
+
+		if (options.threaded) {
+			auto& frame_commands = render_thread::beginFrame();
+			animate(frame_commands);
+			graphics::render(frame_commands, models, camera, lights, culling, overlay);
+			render_thread::endFrame();
+		} else {
+			profiler::beginFrame();
+			frame::throttle();
+
+			animate(*commands);
+			graphics::render(*commands, models, camera, lights, culling, overlay);
+			commands->execute();
+			commands->clear();
+
+			frame::fence();
+			profiler::endFrame();
+
+			eglSwapBuffers(display, surface);
+		}
+
+		auto frame_end = Clock::now();
+
+		if (frame >= options.warmup) {
+			cpu_frame_times.push_back(std::chrono::duration<double, std::milli>(frame_end - frame_start).count());
+		}
+	}
+
+	if (options.threaded) {
+		render_thread::shutdown();
+		eglMakeCurrent(display, surface, surface, context);
+	}
+
+	delete commands;
+
+	glFinish();
+	double total_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+	const Distribution cpu = distribution(cpu_frame_times);
+	const profiler::Statistics gpu = profiler::statistics("frame");
+	const double frames = options.frames;
+	const graphics::gl::Statistics& totals = graphics::gl::statistics();
+	const graphics::gl::MemoryUsage memory = graphics::gl::memoryUsage();
+
+	auto kib = [&](graphics::gl::MemoryCategory category) {
+		return memory.bytes[static_cast<size_t>(category)] >> 10;
+	};
+
+	const char* renderer = reinterpret_cast<const char*>(glGetString(GL_RENDERER));
+	const char* path = options.render_path == graphics::RenderPath::forward ? "forward" : "deferred";
+	const char* present = options.present_mode == frame::PresentMode::vsync ? "vsync"
+	                    : options.present_mode == frame::PresentMode::uncapped ? "uncapped"
+	                    : "capped";
+
+	std::cout << "Renderer:       " << renderer << '\n'
+	          << "Scene:          " << options.cubes << (options.spheres ? " spheres, " : " cubes, ")
+	          << options.lights << " lights, " << options.textures << " textures, " << path
+	          << (options.bvh ? ", bvh culling" : "")
+	          << (options.clusters ? ", cluster culling" : "")
+	          << (options.atmosphere ? ", atmosphere" : "")
+	          << (options.occlusion ? ", occlusion culling" : "") << ", "
+	          << graphics::get(cube_mesh).lods().size() << " lods\n"
+	          << "Present:        " << present << ", cap " << options.frame_cap << " Hz, "
+	          << options.queued_frames << " queued frames"
+	          << (options.threaded ? ", render thread" : "") << ", "
+	          << jobs::workerCount() << " job workers\n"
+	          << "Frames:         " << options.frames << " at " << options.width << 'x' << options.height
+	          << " (" << total_ms / frames << " ms/frame wall)\n"
+	          << "CPU frame (ms): avg " << cpu.average << ", p50 " << cpu.p50
+	          << ", p95 " << cpu.p95 << ", p99 " << cpu.p99 << ", max " << cpu.maximum << '\n';
+
+	if (profiler::gpuTimingAvailable()) {
+		std::cout << "GPU frame (ms): avg " << gpu.gpu_average << ", p50 " << gpu.gpu_p50
+		          << ", p95 " << gpu.gpu_p95 << ", p99 " << gpu.gpu_p99
+		          << " (last " << gpu.gpu_samples << " frames)\n";
+	} else {
+		std::cout << "GPU frame (ms): unavailable\n";
+	}
+
+	std::cout << "Per frame:      " << totals.draws / frames << " draws, "
+	          << totals.dispatches / frames << " dispatches, "
+	          << totals.vertices / frames << " vertices, "
+	          << totals.pipeline_changes / frames << " pipeline changes, "
+	          << totals.buffer_bindings / frames << " buffer bindings, "
+	          << totals.texture_bindings / frames << " texture bindings, "
+	          << totals.bytes_uploaded / frames << " bytes uploaded\n";
+
+	if (point_cloud != nullptr) {
+		const auto statistics = point_cloud->statistics();
+		std::cout << "Points:         " << point_cloud->pointCount() << " in "
+		          << statistics.nodes << " nodes, " << statistics.visible_points << " drawn from "
+		          << statistics.visible_nodes << " nodes, " << statistics.resident_nodes
+		          << " resident, " << statistics.pending_nodes << " pending\n";
+	}
+
+	if (!crowd.empty()) {
+		std::cout << "Animation:      " << options.crowd << " characters, " << worm_joints
+		          << " joints, " << worm_mesh->vertexCount() << " vertices each, "
+		          << animation_ms / frames << " ms/frame sampling\n";
+	}
+
+	if (particles != nullptr) {
+		std::cout << "Particles:      " << particles->capacity() << " capacity, "
+		          << particles->emitted() << " emitted (last frame), "
+		          << (options.additive_particles ? "additive" : "sorted") << '\n';
+	}
+
+	if (options.occlusion) {
+		const auto usage = graphics::occlusionUsage();
+		std::cout << "Occlusion:      " << usage.occluded_models << " models occluded by "
+		          << usage.occluders << " occluders, " << usage.triangles
+		          << " triangles drawn (last frame)\n";
+	}
+
+	if (options.resolution_scale < 1.0f || options.target_gpu_time > 0.0f) {
+		std::cout << "Resolution:     " << graphics::resolutionScale() << " scale (last frame), ";
+		if (options.target_gpu_time > 0.0f) {
+			std::cout << "dynamic to " << options.target_gpu_time << " ms, ";
+		}
+		std::cout << (options.sharpen ? "sharpened" : "bilinear") << " upscale\n";
+	}
+
+	const auto graph = graphics::renderGraphStatistics();
+	std::cout << "Render graph:   " << graph.passes << " passes, " << graph.culled_passes
+	          << " culled, " << graph.barriers << " barriers, " << graph.transient_textures
+	          << " transient textures on " << graph.physical_textures << ", "
+	          << (graph.transient_bytes >> 10) << " KiB on " << (graph.physical_bytes >> 10)
+	          << " KiB (last frame)\n";
+
+	std::cout << "GPU memory:     " << (memory.total() >> 10) << " KiB: "
+	          << kib(graphics::gl::MemoryCategory::mesh) << " mesh, "
+	          << kib(graphics::gl::MemoryCategory::texture) << " texture, "
+	          << kib(graphics::gl::MemoryCategory::render_target) << " render target, "
+	          << kib(graphics::gl::MemoryCategory::uniform) << " uniform, "
+	          << kib(graphics::gl::MemoryCategory::scene) << " scene, "
+	          << kib(graphics::gl::MemoryCategory::streaming) << " streaming\n";
+
+	for (const auto& name : profiler::scopes()) {
+		auto stats = profiler::statistics(name);
+		std::cout << "  " << name << ": cpu " << stats.cpu_average << " ms, gpu "
+		          << stats.gpu_average << " ms\n";
+	}
+
+	if (options.json_path != nullptr) {
+		std::ofstream json(options.json_path);
+
+		json << "{\"renderer\":\"" << renderer << "\""
+		     << ",\"scene\":{\"cubes\":" << options.cubes
+		     << ",\"lights\":" << options.lights
+		     << ",\"textures\":" << options.textures
+		     << ",\"render_path\":\"" << path << '"'
+		     << ",\"bvh\":" << (options.bvh ? "true" : "false")
+		     << ",\"clusters\":" << (options.clusters ? "true" : "false")
+		     << ",\"atmosphere\":" << (options.atmosphere ? "true" : "false")
+		     << ",\"occlusion\":" << (options.occlusion ? "true" : "false")
+		     << ",\"occluded_models\":" << graphics::occlusionUsage().occluded_models
+		     << ",\"crowd\":" << options.crowd
+		     << ",\"animation_ms\":" << animation_ms / frames
+		     << ",\"resolution_scale\":" << graphics::resolutionScale()
+		     << ",\"target_gpu_ms\":" << options.target_gpu_time
+		     << ",\"particles\":" << options.particles
+		     << ",\"particle_blend\":\"" << (options.additive_particles ? "additive" : "sorted")
+		     << '"'
+		     << ",\"mesh\":\"" << (options.spheres ? "sphere" : "cube") << '"'
+		     << ",\"lods\":" << graphics::get(cube_mesh).lods().size()
+		     << ",\"points\":" << (point_cloud ? point_cloud->pointCount() : 0)
+		     << ",\"drawn_points\":"
+		     << (point_cloud ? point_cloud->statistics().visible_points : 0) << '}'
+		     << ",\"present\":{\"mode\":\"" << present << '"'
+		     << ",\"cap\":" << options.frame_cap
+		     << ",\"queued_frames\":" << options.queued_frames
+		     << ",\"threaded\":" << (options.threaded ? "true" : "false")
+		     << ",\"job_workers\":" << jobs::workerCount() << '}'
+		     << ",\"width\":" << options.width
+		     << ",\"height\":" << options.height
+		     << ",\"frames\":" << options.frames
+		     << ",\"wall_ms_per_frame\":" << total_ms / frames
+		     << ",\"cpu_frame_ms\":";
+		writeDistribution(json, cpu);
+
+		json << ",\"gpu_frame_ms\":";
+		if (profiler::gpuTimingAvailable()) {
+			json << "{\"average\":" << gpu.gpu_average
+			     << ",\"p50\":" << gpu.gpu_p50
+			     << ",\"p95\":" << gpu.gpu_p95
+			     << ",\"p99\":" << gpu.gpu_p99 << '}';
+		} else {
+			json << "null";
+		}
+
+		json << ",\"per_frame\":{\"draws\":" << totals.draws / frames
+		     << ",\"dispatches\":" << totals.dispatches / frames
+		     << ",\"vertices\":" << totals.vertices / frames
+		     << ",\"pipeline_changes\":" << totals.pipeline_changes / frames
+		     << ",\"buffer_bindings\":" << totals.buffer_bindings / frames
+		     << ",\"texture_bindings\":" << totals.texture_bindings / frames
+		     << ",\"passes\":" << totals.passes / frames
+		     << ",\"bytes_uploaded\":" << totals.bytes_uploaded / frames << "}"
+		     << ",\"gpu_memory_kib\":{\"mesh\":" << kib(graphics::gl::MemoryCategory::mesh)
+		     << ",\"texture\":" << kib(graphics::gl::MemoryCategory::texture)
+		     << ",\"render_target\":" << kib(graphics::gl::MemoryCategory::render_target)
+		     << ",\"uniform\":" << kib(graphics::gl::MemoryCategory::uniform)
+		     << ",\"scene\":" << kib(graphics::gl::MemoryCategory::scene)
+		     << ",\"streaming\":" << kib(graphics::gl::MemoryCategory::streaming)
+		     << ",\"total\":" << (memory.total() >> 10) << '}'
+		     << ",\"scopes\":{";
+
+		bool first = true;
+		for (const auto& name : profiler::scopes()) {
+			auto stats = profiler::statistics(name);
+			json << (first ? "" : ",") << '"' << name << "\":{\"cpu_ms\":" << stats.cpu_average
+			     << ",\"gpu_ms\":" << stats.gpu_average << '}';
+			first = false;
+		}
+
+		json << "}}\n";
+	}
+
+	graphics::setParticleSystem(nullptr);
+	particles.reset();
+
+	batch.reset();
+
+	graphics::setPointCloud(nullptr);
+	point_cloud.reset();
+
+	if (options.points != 0) {
+		std::filesystem::remove(point_cloud_path);
+	}
+
+	for (const auto& model : crowd) {
+		graphics::destroy(model.target);
+	}
+
+	worm_mesh.reset();
+
+	graphics::destroy(plane_mesh);
+	graphics::destroy(cube_mesh);
+
+	for (auto texture : textures) {
+		graphics::destroy(texture);
+	}
+
+	graphics::destroy(sampler);
+
+	jobs::shutdown();
+	frame::shutdown();
+	profiler::shutdown();
+	graphics::utils::shutdown();
+	graphics::shutdown();
+	graphics::gl::shutdown();
+
+	destroyContext();
+
+	return 0;
+} catch (const std::runtime_error& e) {
+	std::cerr << e.what() << '\n';
+	destroyContext();
+	return 1;
+}
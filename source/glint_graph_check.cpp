@@ -0,0 +1,120 @@
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string_view>
+#include <algorithm>
+
+#include "graphics_commands.hpp"
+#include "graphics_graph.hpp"
+using namespace glint;
+
+namespace {
+
+struct Options {
+	uint32_t width = 1280;
+	uint32_t height = 720;
+};
+
+bool parseOptions(int argc, char** argv, Options& options) {
+	for (int i = 1; i < argc; ++i) {
+		std::string_view arg = argv[i];
+
+		if (i + 1 >= argc) {
+			std::cerr << "Missing value for " << arg << '\n';
+			return false;
+		}
+
+		uint32_t number = std::strtoul(argv[++i], nullptr, 10);
+
+		if (arg == "--width") {
+			options.width = number;
+		} else if (arg == "--height") {
+			options.height = number;
+		} else {
+			std::cerr << "Unknown option " << arg << '\n';
+			return false;
+		}
+	}
+
+	return options.width != 0 && options.height != 0;
+}
+
+// A bloom chain whose lifetimes, unlike the frame's, do not all overlap, so
+// the graph has textures to share. The horizontal blur writes as an image,
+// so the bloom target placed on its texture after it must wait for that
+// write, which is the second barrier.
+graphics::GraphStatistics recordBloomChain(uint32_t width, uint32_t height) {
+	using graphics::GraphAccess;
+
+	graphics::RenderGraph graph;
+	const auto nothing = [](graphics::CommandList&) {};
+
+	const graphics::GraphTextureDescriptor full{GL_RGBA8, width, height};
+	const graphics::GraphTextureDescriptor half{GL_RGBA8, std::max(width / 2, 1u),
+	                                            std::max(height / 2, 1u)};
+
+	const auto scene = graph.createTexture(full);
+	const auto downsampled = graph.createTexture(half);
+	const auto horizontal = graph.createTexture(half);
+	const auto blurred = graph.createTexture(half);
+	const auto bloom = graph.createTexture(half);
+	const auto composite = graph.createTexture(full);
+
+	graph.addPass("scene", nothing);
+	graph.write(scene, GraphAccess::attachment);
+
+	graph.addPass("downsample", nothing);
+	graph.read(scene, GraphAccess::sampled);
+	graph.write(downsampled, GraphAccess::attachment);
+
+	graph.addPass("blur horizontal", nothing);
+	graph.read(downsampled, GraphAccess::sampled);
+	graph.write(horizontal, GraphAccess::image);
+
+	graph.addPass("blur vertical", nothing);
+	graph.read(horizontal, GraphAccess::sampled);
+	graph.write(blurred, GraphAccess::attachment);
+
+	graph.addPass("bloom", nothing);
+	graph.read(blurred, GraphAccess::sampled);
+	graph.write(bloom, GraphAccess::attachment);
+
+	graph.addPass("composite", nothing);
+	graph.read(scene, GraphAccess::sampled);
+	graph.read(bloom, GraphAccess::sampled);
+	graph.write(composite, GraphAccess::attachment);
+	graph.keep();
+
+	graphics::CommandList commands;
+	graph.execute(commands);
+
+	return graph.statistics();
+}
+
+} // namespace
+
+// Records render graphs without any GL context. Placement and barriers are
+// settled while recording and the commands never run, so no texture is ever
+// created. The run fails if the graph shares or orders textures other than
+// the layout calls for.
+int main(int argc, char** argv) {
+	Options options;
+	if (!parseOptions(argc, argv, options)) {
+		std::cerr << "Usage: glint_graph_check [--width N] [--height N]\n";
+		return 1;
+	}
+
+	// Six textures on four. Of the two barriers, the second is only there
+	// because the horizontal blur's write carries over to the bloom target.
+	const auto bloom = recordBloomChain(options.width, options.height);
+	const bool aliased = bloom.transient_textures == 6 && bloom.physical_textures == 4 &&
+	                     bloom.barriers == 2;
+
+	std::cout << "Bloom chain:    " << bloom.transient_textures << " transient textures on "
+	          << bloom.physical_textures << ", " << (bloom.transient_bytes >> 10)
+	          << " KiB on " << (bloom.physical_bytes >> 10) << " KiB, saving "
+	          << ((bloom.transient_bytes - bloom.physical_bytes) >> 10) << " KiB, "
+	          << bloom.barriers << " barriers" << (aliased ? "" : " (unexpected)") << '\n';
+
+	return aliased ? 0 : 1;
+}
@@ -0,0 +1,349 @@
+#include <cstdint>
+#include <cstdlib>
+#include <cmath>
+#include <chrono>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string_view>
+#include <vector>
+#include <algorithm>
+
+#include <glm/ext/matrix_transform.hpp>
+#include <glm/ext/matrix_clip_space.hpp>
+#include <glm/ext/scalar_constants.hpp>
+#include <glm/ext/vector_double2.hpp>
+#include <glm/ext/vector_double3.hpp>
+#include <glm/ext/vector_double4.hpp>
+#include <glm/geometric.hpp>
+
+#include "jobs.hpp"
+#include "scene_bvh.hpp"
+#include "scene_occlusion.hpp"
+using namespace glint;
+
+namespace {
+
+struct Options {
+	uint32_t width = 320;
+	uint32_t height = 180;
+	uint32_t buildings = 400;
+	uint32_t boxes = 10000;
+	uint32_t frames = 200;
+	uint32_t warmup = 20;
+	uint32_t seed = 1;
+	uint32_t jobs = 0;
+};
+
+bool parseOptions(int argc, char** argv, Options& options) {
+	for (int i = 1; i < argc; ++i) {
+		std::string_view arg = argv[i];
+
+		if (i + 1 >= argc) {
+			std::cerr << "Missing value for " << arg << '\n';
+			return false;
+		}
+
+		uint32_t number = std::strtoul(argv[++i], nullptr, 10);
+
+		if (arg == "--width") {
+			options.width = number;
+		} else if (arg == "--height") {
+			options.height = number;
+		} else if (arg == "--buildings") {
+			options.buildings = number;
+		} else if (arg == "--boxes") {
+			options.boxes = number;
+		} else if (arg == "--frames") {
+			options.frames = number;
+		} else if (arg == "--warmup") {
+			options.warmup = number;
+		} else if (arg == "--seed") {
+			options.seed = number;
+		} else if (arg == "--jobs") {
+			options.jobs = number;
+		} else {
+			std::cerr << "Unknown option " << arg << '\n';
+			return false;
+		}
+	}
+
+	return options.width != 0 && options.height != 0 && options.frames != 0;
+}
+
+// Matches the buffer's near clip, so boxes reaching behind it count as visible
+constexpr float minimum_w = 1e-4f;
+
+// Boxes only count as wrongly occluded when clearly in front of the reference
+constexpr float depth_tolerance = 1e-3f;
+
+// Nearest 1/w at every pixel centre, from the front faces of every occluder
+// clipped to the near plane, one triangle and pixel at a time. Doubles, and
+// clipping each edge from the same end, keep it watertight even around the
+// huge coordinates of vertices right next to the eye.
+void rasterizeReference(const glm::mat4& view_projection, const std::vector<glm::mat4>& occluders,
+                        uint32_t width, uint32_t height, std::vector<float>& depths) {
+	depths.assign(size_t(width) * height, 0.0f);
+
+	for (const glm::mat4& transform : occluders) {
+		const glm::mat4 matrix = view_projection * transform;
+
+		glm::dvec4 clip[std::size(scene::unit_cube_positions)];
+		for (size_t i = 0; i < std::size(clip); ++i) {
+			clip[i] = glm::dvec4(matrix * glm::vec4(scene::unit_cube_positions[i], 1.0f));
+		}
+
+		for (size_t i = 0; i < std::size(scene::unit_cube_indices); i += 3) {
+			glm::dvec3 screen[4];
+			uint32_t count = 0;
+
+			for (uint32_t j = 0; j < 3; ++j) {
+				const uint32_t from = scene::unit_cube_indices[i + j];
+				const uint32_t to = scene::unit_cube_indices[i + (j + 1) % 3];
+
+				glm::dvec4 vertices[2];
+				uint32_t vertex_count = 0;
+
+				if (clip[from].w >= minimum_w) {
+					vertices[vertex_count++] = clip[from];
+				}
+
+				if ((clip[from].w >= minimum_w) != (clip[to].w >= minimum_w)) {
+					const glm::dvec4& first = clip[std::min(from, to)];
+					const glm::dvec4& second = clip[std::max(from, to)];
+					vertices[vertex_count++] = first + (second - first) *
+					                           ((first.w - minimum_w) / (first.w - second.w));
+				}
+
+				for (uint32_t k = 0; k < vertex_count; ++k) {
+					const glm::dvec4& v = vertices[k];
+					screen[count++] = {(v.x / v.w * 0.5 + 0.5) * width,
+					                   (0.5 - v.y / v.w * 0.5) * height,
+					                   1.0 / v.w};
+				}
+			}
+
+			for (uint32_t j = 2; j < count; ++j) {
+				const glm::dvec3& a = screen[0];
+				const glm::dvec3& b = screen[j - 1];
+				const glm::dvec3& c = screen[j];
+
+				// Front faces turn clockwise once y points down
+				const double area = (b.x - a.x) * (c.y - a.y) - (c.x - a.x) * (b.y - a.y);
+				if (!(area < 0.0)) {
+					continue;
+				}
+
+				// Clamped before converting, vertices next to the eye land far out
+				const double max_x = width - 1;
+				const double max_y = height - 1;
+				const uint32_t left = uint32_t(std::clamp(std::min({a.x, b.x, c.x}), 0.0, max_x));
+				const uint32_t top = uint32_t(std::clamp(std::min({a.y, b.y, c.y}), 0.0, max_y));
+				const uint32_t right = uint32_t(std::clamp(std::max({a.x, b.x, c.x}), 0.0, max_x));
+				const uint32_t bottom = uint32_t(std::clamp(std::max({a.y, b.y, c.y}), 0.0, max_y));
+
+				for (uint32_t y = top; y <= bottom; ++y) {
+					for (uint32_t x = left; x <= right; ++x) {
+						const glm::dvec2 p(x + 0.5, y + 0.5);
+						const double wa = (c.x - b.x) * (p.y - b.y) - (p.x - b.x) * (c.y - b.y);
+						const double wb = (a.x - c.x) * (p.y - c.y) - (p.x - c.x) * (a.y - c.y);
+						const double wc = (b.x - a.x) * (p.y - a.y) - (p.x - a.x) * (b.y - a.y);
+
+						if (wa > 0.0 || wb > 0.0 || wc > 0.0) {
+							continue;
+						}
+
+						float& depth = depths[size_t(y) * width + x];
+						depth = std::max(depth, float((wa * a.z + wb * b.z + wc * c.z) / area));
+					}
+				}
+			}
+		}
+	}
+}
+
+// Whether any pixel the box may cover holds something farther than its
+// nearest corner, looked at the same way the buffer does
+bool visibleInReference(const glm::mat4& view_projection, const scene::Box& box,
+                        uint32_t width, uint32_t height, const std::vector<float>& depths) {
+	float left = std::numeric_limits<float>::max();
+	float top = std::numeric_limits<float>::max();
+	float right = std::numeric_limits<float>::lowest();
+	float bottom = std::numeric_limits<float>::lowest();
+	float nearest = 0.0f;
+
+	for (uint32_t corner = 0; corner < 8; ++corner) {
+		const glm::vec4 clip = view_projection * glm::vec4(
+			corner & 1 ? box.maximum.x : box.minimum.x, corner & 2 ? box.maximum.y : box.minimum.y,
+			corner & 4 ? box.maximum.z : box.minimum.z, 1.0f);
+
+		if (clip.w <= minimum_w) {
+			return true;
+		}
+
+		const float x = (clip.x / clip.w * 0.5f + 0.5f) * float(width);
+		const float y = (0.5f - clip.y / clip.w * 0.5f) * float(height);
+
+		left = std::min(left, x);
+		right = std::max(right, x);
+		top = std::min(top, y);
+		bottom = std::max(bottom, y);
+		nearest = std::max(nearest, 1.0f / clip.w);
+	}
+
+	if (right < 0.0f || bottom < 0.0f || left >= float(width) || top >= float(height)) {
+		return false;
+	}
+
+	const uint32_t last_x = std::min(uint32_t(right), width - 1);
+	const uint32_t last_y = std::min(uint32_t(bottom), height - 1);
+
+	for (uint32_t y = uint32_t(std::max(top, 0.0f)); y <= last_y; ++y) {
+		for (uint32_t x = uint32_t(std::max(left, 0.0f)); x <= last_x; ++x) {
+			if (depths[size_t(y) * width + x] < nearest * (1.0f - depth_tolerance)) {
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+} // namespace
+
+// Rasterizes a city of box buildings seen from street level and tests small
+// boxes scattered between them, without any GL context. Every frame is also
+// rasterized by brute force, and the run fails if the buffer calls a box
+// occluded that the reference shows in front of the buildings.
+int main(int argc, char** argv) {
+	Options options;
+	if (!parseOptions(argc, argv, options)) {
+		std::cerr << "Usage: glint_occlusion_bench [--width N] [--height N] [--buildings N]"
+		             " [--boxes N] [--frames N] [--warmup N] [--seed N] [--jobs N]\n";
+		return 1;
+	}
+
+	jobs::setup(options.jobs);
+
+	std::mt19937 random(options.seed);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+	const uint32_t side = uint32_t(std::ceil(std::sqrt(float(options.buildings))));
+	const float spacing = 4.0f;
+	const float extent = side * spacing * 0.5f;
+
+	std::vector<glm::mat4> buildings;
+	for (uint32_t i = 0; i < options.buildings; ++i) {
+		glm::vec3 size{1.5f + unit(random) * 2.0f, 2.0f + unit(random) * 8.0f,
+		               1.5f + unit(random) * 2.0f};
+		glm::vec3 position{(i % side) * spacing - extent, size.y * 0.5f,
+		                   (i / side) * spacing - extent};
+
+		buildings.push_back(glm::scale(glm::translate(glm::mat4(1.0f), position), size));
+	}
+
+	std::vector<scene::Box> boxes;
+	for (uint32_t i = 0; i < options.boxes; ++i) {
+		glm::vec3 position{(unit(random) - 0.5f) * 2.0f * extent, unit(random) * 2.0f,
+		                   (unit(random) - 0.5f) * 2.0f * extent};
+		boxes.push_back({position - 0.25f, position + 0.25f});
+	}
+
+	scene::OcclusionBuffer buffer(options.width, options.height);
+
+	const glm::mat4 projection = glm::perspective(glm::radians(70.0f),
+	                                              float(options.width) / float(options.height),
+	                                              0.1f, 1000.0f);
+
+	using Clock = std::chrono::steady_clock;
+	double rasterize_ms = 0.0;
+	double test_ms = 0.0;
+	uint64_t triangles = 0;
+	uint64_t submitted = 0;
+	uint64_t visible = 0;
+	uint64_t false_occluded = 0;
+	uint64_t missed = 0;
+	std::vector<float> reference;
+
+	for (uint32_t frame = 0; frame < options.warmup + options.frames; ++frame) {
+		// Scripted walk around the middle of the city, a function of the frame only
+		float t = float(frame) / float(options.warmup + options.frames) * 2.0f * glm::pi<float>();
+		glm::vec3 eye{spacing * 0.5f + glm::sin(t), 1.7f, spacing * 0.5f + glm::cos(t)};
+		glm::vec3 target = eye + glm::vec3(glm::sin(t * 2.0f), 0.0f, glm::cos(t * 2.0f));
+		const glm::mat4 view = glm::lookAt(eye, target, glm::vec3(0.0f, 1.0f, 0.0f));
+
+		// Nearest first, the way the renderer hands them over
+		std::vector<uint32_t> order(buildings.size());
+		for (uint32_t i = 0; i < order.size(); ++i) {
+			order[i] = i;
+		}
+
+		std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+			return glm::length(glm::vec3(buildings[a][3]) - eye) <
+			       glm::length(glm::vec3(buildings[b][3]) - eye);
+		});
+
+		auto rasterize_start = Clock::now();
+
+		buffer.clear(projection * view);
+
+		for (uint32_t building : order) {
+			buffer.addOccluder(scene::unit_cube_positions, scene::unit_cube_indices,
+			                   buildings[building]);
+		}
+
+		buffer.rasterize();
+
+		auto test_start = Clock::now();
+
+		uint32_t frame_visible = 0;
+		for (const auto& box : boxes) {
+			frame_visible += buffer.visible(box);
+		}
+
+		auto test_end = Clock::now();
+
+		rasterizeReference(projection * view, buildings, options.width, options.height,
+		                   reference);
+
+		for (const auto& box : boxes) {
+			const bool expected = visibleInReference(projection * view, box, options.width,
+			                                         options.height, reference);
+			const bool result = buffer.visible(box);
+
+			false_occluded += expected && !result;
+			missed += !expected && result;
+		}
+
+		if (frame >= options.warmup) {
+			using Milliseconds = std::chrono::duration<double, std::milli>;
+			rasterize_ms += Milliseconds(test_start - rasterize_start).count();
+			test_ms += Milliseconds(test_end - test_start).count();
+			triangles += buffer.statistics().triangles;
+			submitted += std::size(scene::unit_cube_indices) / 3 * buildings.size();
+			visible += frame_visible;
+		}
+	}
+
+	const double frames = options.frames;
+
+	std::cout << "Buffer:         " << options.width << 'x' << options.height << ", "
+	          << jobs::workerCount() << " job workers\n"
+	          << "Scene:          " << options.buildings << " buildings, "
+	          << options.boxes << " boxes\n"
+	          << "Rasterize:      " << rasterize_ms / frames << " ms/frame, "
+	          << submitted / frames << " triangles submitted, "
+	          << triangles / frames << " set up\n"
+	          << "Throughput:     " << submitted / (rasterize_ms * 1e3)
+	          << " M submitted triangles/s, " << triangles / (rasterize_ms * 1e3)
+	          << " M drawn triangles/s\n"
+	          << "Tests:          " << test_ms / frames << " ms/frame, "
+	          << options.boxes * frames / (test_ms * 1e3) << " M boxes/s, "
+	          << 100.0 * (1.0 - visible / (options.boxes * frames)) << "% occluded\n"
+	          << "Reference:      " << false_occluded << " boxes wrongly occluded, "
+	          << 100.0 * missed / (double(options.boxes) * (options.warmup + options.frames))
+	          << "% left visible though hidden\n";
+
+	jobs::shutdown();
+	return false_occluded == 0 ? 0 : 1;
+}
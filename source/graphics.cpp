@@ -1,6 +1,26 @@
 #include "graphics.hpp"
 
+#include <cmath>
+#include <array>
+#include <bit>
+#include <limits>
+#include <vector>
+#include <algorithm>
+
 #include "graphics_gl.hpp"
+#include "graphics_atmosphere.hpp"
+#include "graphics_geometry.hpp"
+#include "graphics_graph.hpp"
+#include "graphics_meshlets.hpp"
+#include "graphics_particles.hpp"
+#include "graphics_pointcloud.hpp"
+#include "graphics_resources.hpp"
+#include "graphics_simplify.hpp"
+#include "graphics_skinning.hpp"
+#include "jobs.hpp"
+#include "profiler.hpp"
+#include "scene_bvh.hpp"
+#include "scene_occlusion.hpp"
 
 #define GLSL_STD140_ALIGN alignas(16)
 
@@ -13,6 +33,73 @@ namespace {
 constexpr size_t max_light_count = 16;
 constexpr size_t shadow_map_size = 1024;
 
+// The shadow map looks from here at the origin, so it is also where the sky
+// puts the sun
+const glm::vec3 sun_position(4.0f, 4.0f, 4.0f);
+constexpr glm::uvec2 sky_lut_size(128, 64);
+
+// Models per culling job
+constexpr uint32_t draw_grain = 256;
+
+// Levels of detail are picked so their error stays under this many pixels.
+// A coarser level is only taken once it is well below the limit, so models
+// near a boundary do not flip between levels every frame.
+constexpr float lod_error_pixels = 1.0f;
+constexpr float lod_hysteresis = 0.5f;
+
+// Shadow maps use levels this much coarser than the camera would pick
+constexpr uint32_t shadow_lod_bias = 1;
+
+// Resolution of the CPU occlusion buffer, and how many of the occluders
+// nearest the camera are drawn into it
+constexpr glm::uvec2 occlusion_size(320, 180);
+constexpr uint32_t max_occluders = 256;
+
+// Clustered draws each reserve room for all of their level's indices, draws
+// past any limit are drawn whole. The buffers only grow as far as needed.
+constexpr uint32_t cluster_draw_capacity = 1 << 14;
+constexpr uint32_t cluster_index_capacity = 1 << 23;
+constexpr uint32_t cluster_meshlet_capacity = 1 << 20;
+constexpr uint32_t no_cluster = std::numeric_limits<uint32_t>::max();
+
+constexpr uint32_t cluster_cull_group_size = 64;
+constexpr uint32_t depth_pyramid_group_size = 8;
+
+// Grown to fit as slots are added
+constexpr uint32_t initial_instance_capacity = 1 << 12;
+constexpr uint32_t initial_material_capacity = 1 << 8;
+
+// Dirty slots this close together are sent as one upload, resending a few
+// clean ones is cheaper than another call
+constexpr uint32_t slot_upload_gap = 16;
+
+constexpr int32_t instance_location = 0;
+constexpr uint32_t instance_binding = 6;
+constexpr uint32_t material_binding = 7;
+
+// Starting sizes of the shared geometry buffers, which double when full
+constexpr uint32_t initial_vertex_capacity = 1 << 16;
+constexpr uint32_t initial_index_capacity = 1 << 18;
+
+// Geometry moved per frame while the shared buffers have holes
+constexpr size_t defragment_bytes = 256 << 10;
+
+constexpr uint32_t no_base_vertex = std::numeric_limits<uint32_t>::max();
+
+// Point clouds are refined until points land about this many pixels apart,
+// streaming in at most so many nodes per frame
+constexpr float point_spacing_pixels = 1.0f;
+constexpr uint32_t point_loads_per_frame = 64;
+constexpr uint32_t point_resolve_group_size = 8;
+constexpr int32_t point_pass_location = 0;
+
+// Dynamic resolution moves in steps of this much scale, waiting out the
+// frames between a change and its first measurement. Frames within the
+// tolerance over the target do not step down.
+constexpr float resolution_scale_step = 1.0f / 16.0f;
+constexpr uint32_t resolution_settle_frames = 8;
+constexpr float resolution_tolerance = 0.05f;
+
 struct CameraUniforms {
 	glm::mat4 view_projection;
 	glm::mat4 shadow_matrix;
@@ -22,42 +109,1210 @@ struct CameraUniforms {
 	GLSL_STD140_ALIGN Light lights[max_light_count];
 };
 
-struct ModelUniforms {
+// Laid out as std430 for the shaders
+struct InstanceData {
 	glm::mat4 transform;
-	GLSL_STD140_ALIGN glm::vec3 albedo_color;
-	GLSL_STD140_ALIGN glm::vec3 specular_color;
+	MaterialSlot material;
+	uint32_t padding[3];
+};
+
+// Laid out as std430 for the shaders, with the normalisation baked in
+struct MaterialData {
+	glm::vec3 albedo_color;
 	float shininess;
+	glm::vec3 specular_color;
 	float emissiveness;
 };
 
 struct SkyUniforms {
 	glm::mat4 view;
 	glm::vec2 viewport;
+	glm::vec2 sun_azimuth;
+};
+
+// Bar fractions where each memory category ends, with the budget marker
+struct MemoryOverlayUniforms {
+	glm::vec4 rect;
+	glm::vec4 ends[2];
+	float budget;
+	float marker_width;
 };
 
 struct ShadowMapUniforms {
 	glm::mat4 view_projection;
 };
 
+struct PointUniforms {
+	glm::mat4 view_projection;
+	glm::uvec2 size;
+	uint32_t color_offset;
+};
+
+struct UpscaleUniforms {
+	glm::vec2 one_over_viewport;
+};
+
+struct DeferredUniforms {
+	glm::mat4 inverse_view_projection;
+	glm::vec2 one_over_viewport;
+};
+
+struct ClusterCullUniforms {
+	glm::vec4 planes[6];
+	glm::mat4 occlusion_view_projection;
+	GLSL_STD140_ALIGN glm::vec3 view_position;
+	uint32_t pyramid_levels;
+	glm::vec2 pyramid_size;
+	uint32_t first_draw;
+	uint32_t pass;
+	uint32_t late_command_offset;
+};
+
+// Cone culling is off for transforms that skew or mirror normals
+struct alignas(16) ClusterDraw {
+	Instance instance;
+	float scale;
+	uint32_t cone_culling;
+	uint32_t meshlet_offset;
+	uint32_t meshlet_count;
+	uint32_t index_offset;
+	uint32_t command;
+	uint32_t retest_offset;
+};
+
+enum ClusterPass : uint32_t {
+	cluster_early,
+	cluster_late,
+};
+
+// Clustered draws of one mesh, culled by a single dispatch
+struct ClusterBatch {
+	const Mesh* mesh;
+	uint32_t first;
+	uint32_t count;
+	uint32_t max_meshlets;
+};
+
+enum DrawView {
+	camera_view,
+	shadow_view,
+	draw_view_count,
+};
+
+// Sorted by key: render mode, albedo texture, coarse depth front to back, then model index
+struct Draw {
+	uint64_t key;
+	const Model* model;
+	const Mesh* mesh;
+	uint32_t level;
+	uint32_t first_index;
+	uint32_t index_count;
+};
+
+// cluster is the draw's indirect command when its meshlets are culled on the GPU
+struct DrawRef {
+	uint64_t key;
+	const Draw* draw;
+	uint32_t cluster = no_cluster;
+};
+
+// Draws written by one job worker, only ever touched from that thread
+// until every job of the frame is done
+struct DrawArena {
+	std::vector<Draw> draws[draw_view_count];
+};
+
+// Where a chunk of models left its draws, in chunk order
+struct DrawChunk {
+	uint32_t worker;
+	uint32_t offset;
+	uint32_t count;
+	uint32_t occluded;
+};
+
+// Of the frame's render graph. Point targets only exist while points are
+// splatted, g-buffer textures only on the deferred path, scene targets only
+// in scaled frames.
+struct FrameResources {
+	GraphTexture shadow_map;
+	GraphTexture scene_color;
+	GraphTexture scene_depth;
+	GraphTexture point_color;
+	GraphTexture point_depth;
+	GraphTexture gbuffer_albedo;
+	GraphTexture gbuffer_normal;
+	GraphTexture gbuffer_specular;
+	GraphTexture gbuffer_depth;
+	GraphTexture depth_pyramid;
+	GraphBuffer cluster_indices;
+	GraphBuffer cluster_commands;
+	GraphBuffer cluster_retests;
+	GraphBuffer point_target;
+};
+
 gl::Pipeline* pipelines[static_cast<size_t>(RenderMode::count)];
 gl::Buffer* camera_uniform_buffer;
-gl::Buffer* model_uniform_buffer;
 
 CameraUniforms camera_uniforms;
 
 gl::Buffer* sky_vertex_buffer;
 gl::Buffer* sky_uniform_buffer;
 gl::Pipeline* sky_pipeline;
+gl::Pipeline* atmosphere_pipeline;
+gl::Texture* sky_lut_texture;
+gl::Sampler* sky_lut_sampler;
+
+SkyMode current_sky_mode = SkyMode::gradient;
+
+bool memory_overlay = false;
+
+gl::Pipeline* memory_overlay_pipeline;
+gl::Buffer* memory_overlay_uniform_buffer;
 
 gl::Pipeline* shadow_map_pipeline;
 gl::Buffer* shadow_map_uniform_buffer;
-gl::Texture* shadow_map_texture;
 gl::Sampler* shadow_map_sampler;
-gl::Framebuffer* shadow_map_framebuffer;
+
+RenderPath current_render_path = RenderPath::forward;
+
+gl::Pipeline* gbuffer_pipelines[static_cast<size_t>(RenderMode::count)];
+gl::Sampler* gbuffer_sampler;
+
+gl::Pipeline* deferred_lighting_pipeline;
+gl::Buffer* deferred_uniform_buffer;
+
+bool cluster_culling = false;
+
+gl::ComputePipeline* cluster_cull_pipeline;
+gl::Buffer* cluster_cull_uniform_buffer;
+GrowableBuffer* cluster_draw_buffer;
+GrowableBuffer* cluster_index_buffer;
+GrowableBuffer* cluster_command_buffer;
+GrowableBuffer* cluster_retest_buffer;
+
+// Draws in list order with their batches, then regrouped by batch for upload
+std::vector<ClusterDraw> listed_cluster_draws;
+std::vector<uint32_t> listed_cluster_batches;
+std::vector<ClusterDraw> cluster_draws;
+std::vector<gl::DrawIndirectCommand> cluster_commands;
+std::vector<ClusterBatch> cluster_batches;
+
+// Farthest depth pyramid of the last deferred frame, for occlusion culling
+// the next one. Only valid while depth_pyramid_ready is set.
+gl::ComputePipeline* depth_pyramid_seed_pipeline;
+gl::ComputePipeline* depth_pyramid_reduce_pipeline;
+gl::Texture* depth_pyramid_texture;
+gl::Sampler* depth_pyramid_sampler;
+
+bool depth_pyramid_ready = false;
+glm::mat4 depth_pyramid_view_projection;
+
+bool occlusion_culling = false;
+
+scene::OcclusionBuffer* occlusion_buffer;
+
+// Distance to the camera and model index of every occluder in view
+std::vector<std::pair<float, uint32_t>> occluder_candidates;
+OcclusionUsage occlusion_usage;
+
+// Points are splatted into per pixel depths and colors in point_target_buffer,
+// then resolved into the textures the composite draws from. Only set while
+// the frame's passes are declared.
+PointCloud* point_cloud = nullptr;
+uint64_t point_budget = 1 << 22;
+bool points_splatted = false;
+
+ParticleSystem* particle_system = nullptr;
+
+gl::ComputePipeline* point_splat_pipeline;
+gl::ComputePipeline* point_resolve_pipeline;
+gl::Pipeline* point_composite_pipeline;
+gl::Buffer* point_uniform_buffer;
+gl::Buffer* point_target_buffer;
+
+// Size of the viewport the g-buffer and point targets are allocated for
+glm::uvec2 target_size;
+
+// Fraction of target_size the scene is drawn at. Scaled frames draw it
+// offscreen and upscale it to the screen in a pass of their own.
+float resolution_scale = 1.0f;
+DynamicResolution dynamic_resolution;
+uint32_t resolution_hold = 0;
+glm::uvec2 scene_size;
+bool scene_scaled = false;
+
+UpscaleFilter upscale_filter = UpscaleFilter::bilinear;
+
+gl::Pipeline* upscale_pipeline;
+gl::Pipeline* sharpened_upscale_pipeline;
+gl::Buffer* upscale_uniform_buffer;
+gl::Sampler* upscale_sampler;
+
+RenderGraph* render_graph;
+
+// Persists across frames, indexed by Instance. Only the slots listed in
+// dirty_instances differ from the GPU copy.
+GrowableBuffer* instance_buffer;
+std::vector<InstanceData> instance_data;
+std::vector<uint8_t> instance_live;
+std::vector<Instance> free_instances;
+std::vector<uint8_t> instance_dirty;
+std::vector<Instance> dirty_instances;
+
+// Likewise, indexed by MaterialSlot, with how many live instances use each
+GrowableBuffer* material_buffer;
+std::vector<MaterialData> material_data;
+std::vector<uint8_t> material_live;
+std::vector<uint32_t> material_users;
+std::vector<MaterialSlot> free_materials;
+std::vector<uint8_t> material_dirty;
+std::vector<MaterialSlot> dirty_materials;
+
+GeometryArena* vertex_arena;
+GeometryArena* index_arena;
+GeometryArena* position_arena;
+
+std::vector<DrawArena> draw_arenas;
+std::vector<DrawChunk> draw_chunks;
+std::vector<DrawRef> draw_lists[draw_view_count];
+std::vector<uint32_t> visible_models[draw_view_count];
+
+// Level each model was drawn with last frame, the start for hysteresis
+std::vector<uint8_t> model_lods;
+
+// Flips floats so they order correctly as unsigned integers
+inline uint32_t sortableDepth(float depth) {
+	uint32_t bits = std::bit_cast<uint32_t>(depth);
+	return (bits & 0x80000000u) ? ~bits : bits | 0x80000000u;
+}
+
+// All draws are opaque, so texture changes cost more than imperfect front to
+// back order. Depth keeps its sign, exponent and three mantissa bits, and
+// texture slots past 16 bits only share a bucket with others.
+inline uint64_t calculateKey(RenderMode mode, TextureHandle texture, float depth,
+                             uint32_t index) {
+	return (uint64_t(mode) << 60) | (uint64_t(texture.slot() & 0xffff) << 44) |
+	       (uint64_t(sortableDepth(depth) >> 20) << 32) | index;
+}
+
+void markDirty(std::vector<uint8_t>& dirty, std::vector<uint32_t>& dirty_slots, uint32_t slot) {
+	if (!dirty[slot]) {
+		dirty[slot] = true;
+		dirty_slots.push_back(slot);
+	}
+}
+
+// A buffer outgrown by its slots is replaced by an empty one, so every slot
+// is uploaded again
+void growSlots(CommandList& commands, GrowableBuffer& buffer, size_t size,
+               std::vector<uint8_t>& dirty, std::vector<uint32_t>& dirty_slots) {
+	if (size <= buffer.size()) {
+		return;
+	}
+
+	buffer.reserve(commands, size);
+
+	for (uint32_t slot = 0; slot < dirty.size(); ++slot) {
+		markDirty(dirty, dirty_slots, slot);
+	}
+}
+
+// Uploads the slots changed since the last frame, in as few ranges as the
+// gaps between them allow
+template<typename T>
+void uploadDirty(CommandList& commands, gl::Buffer& buffer, const std::vector<T>& data,
+                 std::vector<uint8_t>& dirty, std::vector<uint32_t>& dirty_slots) {
+	if (dirty_slots.empty()) {
+		return;
+	}
+
+	std::sort(dirty_slots.begin(), dirty_slots.end());
+
+	uint32_t first = dirty_slots.front();
+	uint32_t last = first;
+
+	auto upload = [&]() {
+		commands.assign(buffer, (last - first + 1) * sizeof(T), &data[first], first * sizeof(T));
+	};
+
+	for (uint32_t slot : dirty_slots) {
+		dirty[slot] = false;
+
+		if (slot > last + slot_upload_gap) {
+			upload();
+			first = slot;
+		}
+
+		last = slot;
+	}
+
+	upload();
+	dirty_slots.clear();
+}
+
+// pixels_per_unit converts model space error to pixels at the model's distance
+uint32_t selectLod(const std::span<const MeshLod> lods, float pixels_per_unit, uint32_t level) {
+	level = std::min<uint32_t>(level, lods.size() - 1);
+
+	while (level > 0 && lods[level].error * pixels_per_unit > lod_error_pixels) {
+		--level;
+	}
+
+	while (level + 1 < lods.size() &&
+	       lods[level + 1].error * pixels_per_unit < lod_error_pixels * lod_hysteresis) {
+		++level;
+	}
+
+	return level;
+}
+
+glm::mat4 calculateShadowMatrix() {
+	glm::mat4 shadow_projection = glm::ortho(-10.0f, 10.0f, -10.0f, 10.0f, 1.0f, 20.0f);
+	glm::mat4 shadow_view = glm::lookAt(sun_position,
+	                                    glm::vec3(0.0f, 0.0f, 0.0f),
+	                                    glm::vec3(0.0f, 1.0f, 0.0f));
+
+	return shadow_projection * shadow_view;
+}
+
+// Draws the occluders in view into the occlusion buffer, nearest first. With
+// a BVH only the models it returned are looked at.
+void rasterizeOccluders(const std::span<const Model> models, const scene::Bvh* bvh,
+                        const std::span<const uint32_t> visible, const scene::Frustum& frustum,
+                        const glm::mat4& view_projection, glm::vec3 eye) {
+	occluder_candidates.clear();
+
+	const uint32_t count = bvh != nullptr ? visible.size() : models.size();
+	for (uint32_t i = 0; i < count; ++i) {
+		const uint32_t index = bvh != nullptr ? visible[i] : i;
+		const auto& model = models[index];
+		const auto& mesh = get(model.mesh);
+
+		if (mesh.occluderIndices().empty()) {
+			continue;
+		}
+
+		const auto& bounds = mesh.bounds();
+		const auto& transform = instance_data[model.instance].transform;
+
+		auto box = scene::Box::transformed(bounds.center, bounds.extents, transform);
+		if (bvh == nullptr && !frustum.intersects(box)) {
+			continue;
+		}
+
+		glm::vec3 center = (box.minimum + box.maximum) * 0.5f;
+		float distance = glm::length(center - eye) - glm::length(box.maximum - center);
+		occluder_candidates.emplace_back(distance, index);
+	}
+
+	std::sort(occluder_candidates.begin(), occluder_candidates.end());
+	occluder_candidates.resize(std::min<size_t>(occluder_candidates.size(), max_occluders));
+
+	occlusion_buffer->clear(view_projection);
+
+	for (const auto& [distance, index] : occluder_candidates) {
+		const auto& mesh = get(models[index].mesh);
+		occlusion_buffer->addOccluder(mesh.occluderPositions(), mesh.occluderIndices(),
+		                              instance_data[models[index].instance].transform);
+	}
+
+	occlusion_buffer->rasterize();
+}
+
+// Culls, packs and keys models in parallel. Every worker appends to its own
+// arena and the chunks are gathered in order, so the lists come out the same
+// however the jobs were scheduled. With a BVH only the models it returns are
+// visited, otherwise every model is tested. Camera draws are then tested
+// against the occlusion buffer when occlusion culling is on.
+void buildDrawLists(const std::span<const Model> models, const scene::Bvh* bvh,
+                    const Camera& camera,
+                    const glm::mat4 (&view_projections)[draw_view_count]) {
+	// Pixels covered by one unit at distance one
+	const float pixel_scale = camera.viewport.y / (2.0f * std::tan(camera.fov * 0.5f));
+
+	model_lods.resize(models.size());
+
+	draw_arenas.resize(jobs::workerCount());
+	for (auto& arena : draw_arenas) {
+		for (auto& draws : arena.draws) {
+			draws.clear();
+		}
+	}
+
+	for (size_t view = 0; view < draw_view_count; ++view) {
+		const glm::mat4& view_projection = view_projections[view];
+		const scene::Frustum frustum = scene::Frustum::fromMatrix(view_projection);
+
+		auto& visible = visible_models[view];
+		visible.clear();
+
+		if (bvh != nullptr) {
+			assert(bvh->size() == models.size());
+			bvh->queryFrustum(frustum, visible);
+		}
+
+		const bool occlusion = occlusion_culling && view == camera_view;
+		if (occlusion) {
+			rasterizeOccluders(models, bvh, visible, frustum, view_projection, camera.position);
+		}
+
+		const uint32_t count = bvh != nullptr ? visible.size() : models.size();
+		draw_chunks.resize((count + draw_grain - 1) / draw_grain);
+
+		jobs::parallelFor(count, draw_grain, [&](uint32_t begin, uint32_t end, uint32_t worker) {
+			auto& draws = draw_arenas[worker].draws[view];
+			auto& chunk = draw_chunks[begin / draw_grain];
+
+			chunk.worker = worker;
+			chunk.offset = draws.size();
+			chunk.occluded = 0;
+
+			for (uint32_t i = begin; i < end; ++i) {
+				const uint32_t index = bvh != nullptr ? visible[i] : i;
+				const auto& model = models[index];
+				const auto& mesh = get(model.mesh);
+				const auto& bounds = mesh.bounds();
+				const auto& transform = instance_data[model.instance].transform;
+
+				auto box = scene::Box::transformed(bounds.center, bounds.extents, transform);
+				if (bvh == nullptr && !frustum.intersects(box)) {
+					continue;
+				}
+
+				if (occlusion && !occlusion_buffer->visible(box)) {
+					++chunk.occluded;
+					continue;
+				}
+
+				glm::vec3 center = (box.minimum + box.maximum) * 0.5f;
+				float depth = view_projection[0][2] * center.x + view_projection[1][2] * center.y +
+				              view_projection[2][2] * center.z + view_projection[3][2];
+
+				// Distance to the nearest point of the bounding sphere, scaled
+				// by the largest axis of the transform
+				const auto lods = mesh.lods();
+				float distance = glm::length(center - camera.position) -
+				                 glm::length(box.maximum - center);
+				float scale = std::max({glm::length(glm::vec3(transform[0])),
+				                        glm::length(glm::vec3(transform[1])),
+				                        glm::length(glm::vec3(transform[2]))});
+				float pixels_per_unit = pixel_scale * scale /
+				                        std::max(distance, Camera::default_near_plane);
+
+				uint32_t level;
+				if (view == camera_view) {
+					level = selectLod(lods, pixels_per_unit, model_lods[index]);
+					model_lods[index] = level;
+				} else {
+					level = std::min<uint32_t>(selectLod(lods, pixels_per_unit, 0) + shadow_lod_bias,
+					                           lods.size() - 1);
+				}
+
+				Draw& draw = draws.emplace_back();
+				draw.model = &model;
+				draw.mesh = &mesh;
+				draw.level = level;
+				draw.first_index = mesh.firstIndex() + lods[level].offset;
+				draw.index_count = lods[level].count;
+
+				const RenderMode mode = view == shadow_view ? RenderMode::untextured_unlit
+				                                            : model.material->render_mode;
+				const TextureHandle texture = mode == RenderMode::textured_lit
+				                              ? model.material->albedo_texture
+				                              : TextureHandle();
+				draw.key = calculateKey(mode, texture, depth, index);
+			}
+
+			chunk.count = draws.size() - chunk.offset;
+		});
+
+		if (view == camera_view) {
+			occlusion_usage = {};
+
+			if (occlusion) {
+				const auto statistics = occlusion_buffer->statistics();
+				occlusion_usage.occluders = statistics.occluders;
+				occlusion_usage.triangles = statistics.triangles;
+
+				for (const auto& chunk : draw_chunks) {
+					occlusion_usage.occluded_models += chunk.occluded;
+				}
+			}
+		}
+
+		auto& list = draw_lists[view];
+		list.clear();
+
+		for (const auto& chunk : draw_chunks) {
+			const auto& draws = draw_arenas[chunk.worker].draws[view];
+			for (uint32_t i = 0; i < chunk.count; ++i) {
+				const Draw& draw = draws[chunk.offset + i];
+				list.push_back({draw.key, &draw});
+			}
+		}
+
+		// Keys end in the model index, so no two compare equal
+		std::sort(list.begin(), list.end(), [](const DrawRef& a, const DrawRef& b) {
+			return a.key < b.key;
+		});
+	}
+}
+
+// Defragmenting alongside streaming keeps room for new meshes without
+// growing the buffers; meshes see their new offsets straight away
+void defragmentGeometry(CommandList& commands) {
+	for (GeometryArena* arena : {vertex_arena, index_arena, position_arena}) {
+		if (arena->fragmented()) {
+			arena->defragment(commands, defragment_bytes / arena->stride());
+		}
+	}
+}
+
+// Hands camera draws to the GPU in list order until the capacities run out,
+// each reserving an index region big enough for its whole level. Deforming
+// meshes are left to draw whole. The buffers grow to what the frame needs,
+// at least one entry each so the graph always has them to import.
+void planClusters(CommandList& commands) {
+	listed_cluster_draws.clear();
+	listed_cluster_batches.clear();
+	cluster_commands.clear();
+	cluster_batches.clear();
+
+	uint32_t index_count = 0;
+	uint32_t meshlet_count = 0;
+
+	for (auto& ref : draw_lists[camera_view]) {
+		const Draw& draw = *ref.draw;
+		const Mesh& mesh = *draw.mesh;
+		if (mesh.deforming()) {
+			continue;
+		}
+
+		const MeshletRange& meshlets = mesh.meshletLods()[draw.level];
+
+		if (cluster_commands.size() == cluster_draw_capacity ||
+		    index_count + draw.index_count > cluster_index_capacity ||
+		    meshlet_count + meshlets.count > cluster_meshlet_capacity) {
+			break;
+		}
+
+		ref.cluster = cluster_commands.size();
+		cluster_commands.push_back({0, 1, index_count, int32_t(mesh.baseVertex())});
+
+		const Instance instance = draw.model->instance;
+		const glm::mat4& transform = instance_data[instance].transform;
+		const glm::vec3 axes[3] = {glm::vec3(transform[0]), glm::vec3(transform[1]),
+		                           glm::vec3(transform[2])};
+		const float lengths[3] = {glm::length(axes[0]), glm::length(axes[1]), glm::length(axes[2])};
+
+		const float scale = std::max({lengths[0], lengths[1], lengths[2]});
+		const bool uniform = std::min({lengths[0], lengths[1], lengths[2]}) > scale * 0.999f &&
+		                     glm::dot(glm::cross(axes[0], axes[1]), axes[2]) > 0.0f;
+
+		listed_cluster_draws.push_back({
+			.instance = instance,
+			.scale = scale,
+			.cone_culling = uniform,
+			.meshlet_offset = meshlets.offset,
+			.meshlet_count = meshlets.count,
+			.index_offset = index_count,
+			.command = ref.cluster,
+			.retest_offset = meshlet_count,
+		});
+
+		index_count += draw.index_count;
+		meshlet_count += meshlets.count;
+
+		// Scenes hold a handful of meshes, so a linear search is enough
+		auto batch = std::find_if(cluster_batches.begin(), cluster_batches.end(),
+		                          [&](const ClusterBatch& batch) { return batch.mesh == &mesh; });
+		if (batch == cluster_batches.end()) {
+			batch = cluster_batches.insert(batch, {&mesh, 0, 0, 0});
+		}
+
+		++batch->count;
+		batch->max_meshlets = std::max(batch->max_meshlets, meshlets.count);
+		listed_cluster_batches.push_back(batch - cluster_batches.begin());
+	}
+
+	const size_t draw_count = std::max<size_t>(listed_cluster_draws.size(), 1);
+	cluster_draw_buffer->reserve(commands, draw_count * sizeof(ClusterDraw));
+	cluster_command_buffer->reserve(commands, 2 * draw_count * sizeof(gl::DrawIndirectCommand));
+	cluster_index_buffer->reserve(commands, std::max(index_count, 1u) * sizeof(uint32_t));
+	cluster_retest_buffer->reserve(commands, std::max(meshlet_count, 1u) * sizeof(uint32_t));
+
+	// Regroup the draws so each batch is contiguous
+	uint32_t first = 0;
+	for (auto& batch : cluster_batches) {
+		batch.first = first;
+		first += batch.count;
+		batch.count = 0;
+	}
+
+	cluster_draws.resize(listed_cluster_draws.size());
+	for (size_t i = 0; i < listed_cluster_draws.size(); ++i) {
+		auto& batch = cluster_batches[listed_cluster_batches[i]];
+		cluster_draws[batch.first + batch.count++] = listed_cluster_draws[i];
+	}
+}
+
+// Early commands, then as many late ones
+void uploadClusters(CommandList& commands) {
+	if (cluster_draws.empty()) {
+		return;
+	}
+
+	commands.assign(cluster_draw_buffer->get(), cluster_draws.size() * sizeof(ClusterDraw),
+	                cluster_draws.data());
+
+	// Late commands start out empty, their first index is set by the GPU
+	const size_t size = cluster_commands.size() * sizeof(gl::DrawIndirectCommand);
+	commands.assign(cluster_command_buffer->get(), size, cluster_commands.data());
+	commands.assign(cluster_command_buffer->get(), size, cluster_commands.data(), size);
+}
+
+// Draws of each mesh are culled together, one thread per meshlet, and every
+// surviving meshlet appends its triangles to its draw's index region. The
+// early pass tests occlusion against last frame's pyramid and leaves what
+// it hid for the late pass, which retests it against this frame's.
+void cullClusters(CommandList& commands, const Camera& camera, ClusterPass pass) {
+	if (cluster_batches.empty()) {
+		return;
+	}
+
+	ClusterCullUniforms uniforms{};
+
+	const scene::Frustum frustum = scene::Frustum::fromMatrix(camera_uniforms.view_projection);
+	for (size_t i = 0; i < 6; ++i) {
+		uniforms.planes[i] = frustum.planes[i] / glm::length(glm::vec3(frustum.planes[i]));
+	}
+
+	uniforms.view_position = camera.position;
+	uniforms.pass = pass;
+	uniforms.late_command_offset = cluster_commands.size();
+
+	// Only the deferred path runs the late pass that brings hidden clusters back
+	const bool occlusion = pass == cluster_late ||
+	                       (depth_pyramid_ready && current_render_path == RenderPath::deferred);
+
+	if (occlusion) {
+		uniforms.occlusion_view_projection = pass == cluster_late
+		                                     ? camera_uniforms.view_projection
+		                                     : depth_pyramid_view_projection;
+		uniforms.pyramid_levels = depth_pyramid_texture->levels();
+		uniforms.pyramid_size = glm::vec2(depth_pyramid_texture->size());
+	}
+
+	commands.setComputePipeline(*cluster_cull_pipeline);
+	commands.setUniformBuffer(*cluster_cull_uniform_buffer, 0);
+	commands.setStorageBuffer(cluster_draw_buffer->get(), 2);
+	commands.setStorageBuffer(cluster_index_buffer->get(), 3);
+	commands.setStorageBuffer(cluster_command_buffer->get(), 4);
+	commands.setStorageBuffer(cluster_retest_buffer->get(), 5);
+	commands.setStorageBuffer(instance_buffer->get(), instance_binding);
+	commands.setTexture(*depth_pyramid_texture, *depth_pyramid_sampler, 0);
+
+	for (const auto& batch : cluster_batches) {
+		uniforms.first_draw = batch.first;
+		commands.assign(*cluster_cull_uniform_buffer, sizeof(ClusterCullUniforms), &uniforms);
+
+		commands.setStorageBuffer(batch.mesh->meshletBuffer(), 0);
+		commands.setStorageBuffer(batch.mesh->meshletDataBuffer(), 1);
+		commands.dispatch((batch.max_meshlets + cluster_cull_group_size - 1) / cluster_cull_group_size,
+		                  batch.count);
+	}
+}
+
+// Reduces the depth buffer to a mip chain of farthest depths
+void buildDepthPyramid(CommandList& commands, const gl::Texture& depth) {
+	const glm::uvec2 size = depth_pyramid_texture->size();
+
+	for (uint32_t level = 0; level < depth_pyramid_texture->levels(); ++level) {
+		const glm::uvec2 level_size(std::max(size.x >> level, 1u), std::max(size.y >> level, 1u));
+
+		if (level == 0) {
+			commands.setComputePipeline(*depth_pyramid_seed_pipeline);
+			commands.setTexture(depth, *gbuffer_sampler, 0);
+		} else {
+			commands.setComputePipeline(*depth_pyramid_reduce_pipeline);
+			commands.setImage(*depth_pyramid_texture, 1, level - 1, GL_READ_ONLY);
+		}
+
+		commands.setImage(*depth_pyramid_texture, 0, level, GL_WRITE_ONLY);
+		commands.dispatch((level_size.x + depth_pyramid_group_size - 1) / depth_pyramid_group_size,
+		                  (level_size.y + depth_pyramid_group_size - 1) / depth_pyramid_group_size);
+		// The graph orders the last level against its readers
+		if (level + 1 < depth_pyramid_texture->levels()) {
+			commands.memoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+		}
+	}
+}
+
+// Nearest depth first, then the color of whichever point reached it, then the
+// resolve, which also clears the depths for the next frame
+void splatPoints(CommandList& commands, const FrameResources& frame) {
+	PointUniforms uniforms{
+		.view_projection = camera_uniforms.view_projection,
+		.size = scene_size,
+		.color_offset = target_size.x * target_size.y,
+	};
+	commands.assign(*point_uniform_buffer, sizeof(PointUniforms), &uniforms);
+
+	commands.setComputePipeline(*point_splat_pipeline);
+	commands.setUniformBuffer(*point_uniform_buffer, 0);
+	commands.setStorageBuffer(point_cloud->buffer(), 0);
+	commands.setStorageBuffer(point_cloud->drawBuffer(), 1);
+	commands.setStorageBuffer(*point_target_buffer, 2);
+
+	for (uint32_t pass = 0; pass < 2; ++pass) {
+		commands.setUniform(point_pass_location, pass);
+		commands.dispatch(point_cloud->draws().size());
+		commands.memoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+	}
+
+	commands.setComputePipeline(*point_resolve_pipeline);
+	commands.setImage(render_graph->texture(frame.point_color), 0, 0, GL_WRITE_ONLY);
+	commands.setImage(render_graph->texture(frame.point_depth), 1, 0, GL_WRITE_ONLY);
+	commands.dispatch((scene_size.x + point_resolve_group_size - 1) / point_resolve_group_size,
+	                  (scene_size.y + point_resolve_group_size - 1) / point_resolve_group_size);
+}
+
+// Depth tested against what the pass has drawn so far
+void compositePoints(CommandList& commands, const FrameResources& frame) {
+	commands.beginScope("point composite");
+
+	commands.setPipeline(*point_composite_pipeline);
+	commands.setVertexBuffer(*sky_vertex_buffer);
+	commands.setTexture(render_graph->texture(frame.point_color), *gbuffer_sampler, 0);
+	commands.setTexture(render_graph->texture(frame.point_depth), *gbuffer_sampler, 1);
+	commands.draw(4);
+
+	commands.endScope();
+}
+
+void renderShadowMap(CommandList& commands, const glm::mat4& shadow_matrix) {
+	commands.beginPass(render_graph->framebuffer());
+
+	ShadowMapUniforms shadow_map_uniforms{
+		.view_projection = shadow_matrix,
+	};
+	commands.assign(*shadow_map_uniform_buffer, sizeof(ShadowMapUniforms), &shadow_map_uniforms);
+
+	commands.setPipeline(*shadow_map_pipeline);
+	commands.setUniformBuffer(*shadow_map_uniform_buffer, 0);
+	commands.setStorageBuffer(instance_buffer->get(), instance_binding);
+	commands.setIndexBuffer(index_arena->buffer(), GL_UNSIGNED_INT);
+
+	const Mesh* mesh = nullptr;
+
+	for (const auto& [key, draw, cluster] : draw_lists[shadow_view]) {
+		commands.setUniform(instance_location, draw->model->instance);
+
+		// Meshes without a position stream feed the same layout at their full stride
+		if (draw->mesh != mesh) {
+			mesh = draw->mesh;
+
+			if (mesh->hasPositionStream()) {
+				commands.setVertexBuffer(position_arena->buffer(),
+				                         uintptr_t(mesh->basePosition()) * sizeof(glm::vec3));
+			} else {
+				commands.setVertexBuffer(vertex_arena->buffer(),
+				                         uintptr_t(mesh->baseVertex()) * sizeof(Vertex), 0,
+				                         sizeof(Vertex));
+			}
+		}
+
+		commands.draw(draw->index_count, draw->first_index);
+	}
+
+	commands.endPass();
+}
+
+void renderSky(CommandList& commands, const Camera& camera) {
+	commands.beginScope("sky");
+
+	SkyUniforms sky_uniforms{
+		.view = glm::mat4(mat3_cast(camera.calculateOrientation())),
+		.viewport = camera.viewport,
+		.sun_azimuth = glm::normalize(glm::vec2(sun_position.x, sun_position.z)),
+	};
+	commands.assign(*sky_uniform_buffer, sizeof(SkyUniforms), &sky_uniforms);
+
+	if (current_sky_mode == SkyMode::atmosphere) {
+		commands.setPipeline(*atmosphere_pipeline);
+		commands.setTexture(*sky_lut_texture, *sky_lut_sampler, 0);
+	} else {
+		commands.setPipeline(*sky_pipeline);
+	}
+
+	commands.setVertexBuffer(*sky_vertex_buffer);
+	commands.setUniformBuffer(*sky_uniform_buffer, 0);
+	commands.draw(4);
+
+	commands.endScope();
+}
+
+// Stacks memory by category on a bar in the top left corner, scaled to the
+// budget or, past it, to the total
+void renderMemoryOverlay(CommandList& commands) {
+	constexpr glm::vec2 origin(8.0f, 8.0f);
+	constexpr glm::vec2 extent(256.0f, 12.0f);
+
+	const auto statistics = memoryStatistics();
+	const size_t total = statistics.usage.total();
+	const float scale = 1.0f / float(std::max({total, statistics.budget, size_t(1)}));
+
+	const glm::vec2 viewport = gl::viewport();
+	const glm::vec2 minimum = origin / viewport * 2.0f - 1.0f;
+	const glm::vec2 maximum = (origin + extent) / viewport * 2.0f - 1.0f;
+
+	MemoryOverlayUniforms uniforms{
+		.rect = {minimum.x, -minimum.y, maximum.x, -maximum.y},
+		.ends = {},
+		.budget = statistics.budget != 0 ? float(statistics.budget) * scale : 2.0f,
+		.marker_width = 1.0f / extent.x,
+	};
+
+	size_t end = 0;
+	for (size_t i = 0; i < static_cast<size_t>(gl::MemoryCategory::count); ++i) {
+		end += statistics.usage.bytes[i];
+		uniforms.ends[i / 4][i % 4] = float(end) * scale;
+	}
+
+	commands.beginScope("memory overlay");
+
+	commands.assign(*memory_overlay_uniform_buffer, sizeof(MemoryOverlayUniforms), &uniforms);
+
+	commands.setPipeline(*memory_overlay_pipeline);
+	commands.setVertexBuffer(*sky_vertex_buffer);
+	commands.setUniformBuffer(*memory_overlay_uniform_buffer, 0);
+	commands.draw(4);
+
+	commands.endScope();
+}
+
+// Draws are sorted by render mode, so the pipeline changes at most once per
+// mode; meshes and textures are only rebound when they change. The late pass
+// only draws the clusters the late cull brought back. The g-buffer pipelines
+// take no shadow map.
+void drawModels(CommandList& commands, const std::span<gl::Pipeline* const> mode_pipelines,
+                const gl::Texture* shadow_map, ClusterPass pass = cluster_early) {
+	commands.setUniformBuffer(*camera_uniform_buffer, 0);
+	commands.setStorageBuffer(instance_buffer->get(), instance_binding);
+	commands.setStorageBuffer(material_buffer->get(), material_binding);
+
+	if (shadow_map != nullptr) {
+		commands.setTexture(*shadow_map, *shadow_map_sampler, 1);
+	}
+
+	const gl::Pipeline* pipeline = nullptr;
+	const gl::Buffer* index_buffer = nullptr;
+	uint32_t base_vertex = no_base_vertex;
+	TextureHandle texture;
+	SamplerHandle sampler;
+
+	for (const auto& [key, draw, cluster] : draw_lists[camera_view]) {
+		if (pass == cluster_late && cluster == no_cluster) {
+			continue;
+		}
+
+		const auto& model = *draw->model;
+		const auto& material = *model.material;
+		const auto& mesh = *draw->mesh;
+
+		const gl::Pipeline* mode_pipeline = mode_pipelines[static_cast<size_t>(material.render_mode)];
+		if (mode_pipeline != pipeline) {
+			pipeline = mode_pipeline;
+			commands.setPipeline(*pipeline);
+
+			// Vertex and index bindings live in the pipeline's vertex array
+			index_buffer = nullptr;
+			base_vertex = no_base_vertex;
+		}
+
+		if (material.render_mode == RenderMode::textured_lit &&
+		    (material.albedo_texture != texture || material.texture_sampler != sampler)) {
+			texture = material.albedo_texture;
+			sampler = material.texture_sampler;
+			commands.setTexture(get(texture), get(sampler), 0);
+		}
+
+		commands.setUniform(instance_location, model.instance);
+
+		// Indirect commands carry their base vertex, direct draws move the binding
+		const uint32_t draw_base_vertex = cluster != no_cluster ? 0 : mesh.baseVertex();
+		if (draw_base_vertex != base_vertex) {
+			base_vertex = draw_base_vertex;
+			commands.setVertexBuffer(vertex_arena->buffer(), uintptr_t(base_vertex) * sizeof(Vertex));
+		}
+
+		const gl::Buffer* indices = cluster != no_cluster ? &cluster_index_buffer->get()
+		                                                  : &index_arena->buffer();
+		if (indices != index_buffer) {
+			index_buffer = indices;
+			commands.setIndexBuffer(*index_buffer, GL_UNSIGNED_INT);
+		}
+
+		if (cluster != no_cluster) {
+			uint32_t command = pass == cluster_late ? cluster + cluster_commands.size() : cluster;
+			commands.drawIndirect(cluster_command_buffer->get(),
+			                      command * sizeof(gl::DrawIndirectCommand));
+		} else {
+			commands.draw(draw->index_count, draw->first_index);
+		}
+	}
+}
+
+// Over the finished frame at full resolution
+void renderOverlays(CommandList& commands, const Overlay& overlay) {
+	if (memory_overlay) {
+		renderMemoryOverlay(commands);
+	}
+
+	if (overlay) {
+		commands.beginScope("overlay");
+		overlay(commands);
+		commands.endScope();
+	}
+}
+
+// Scaled frames draw the scene into the pass's scene targets
+const gl::Framebuffer& sceneFramebuffer() {
+	return scene_scaled ? render_graph->framebuffer() : gl::Framebuffer::main();
+}
+
+void renderForward(CommandList& commands, const Camera& camera, const FrameResources& frame,
+                   const Overlay& overlay) {
+	// Opaques and sky cover the whole color buffer, so nothing needs to be
+	// cleared. The sky goes last so early depth rejects what opaques cover.
+	commands.beginPass(sceneFramebuffer(), {
+		.color = {gl::LoadAction::dont_care},
+	});
+
+	commands.beginScope("opaque");
+	drawModels(commands, pipelines, &render_graph->texture(frame.shadow_map));
+	commands.endScope();
+
+	if (points_splatted) {
+		compositePoints(commands, frame);
+	}
+
+	renderSky(commands, camera);
+
+	if (particle_system != nullptr) {
+		particle_system->draw(commands);
+	}
+
+	if (!scene_scaled) {
+		renderOverlays(commands, overlay);
+	}
+
+	commands.endPass({.depth_stencil = scene_scaled ? gl::StoreAction::store
+	                                                : gl::StoreAction::discard});
+}
+
+// The late pass draws over the early one
+void renderGbuffer(CommandList& commands, ClusterPass pass) {
+	// Lighting skips pixels at the far plane, so only depth needs clearing
+	const gl::LoadAction load = pass == cluster_late ? gl::LoadAction::load
+	                                                 : gl::LoadAction::dont_care;
+
+	commands.beginPass(render_graph->framebuffer(), {
+		.color = {load, load, load},
+		.depth_stencil = pass == cluster_late ? gl::LoadAction::load : gl::LoadAction::clear,
+	});
+
+	drawModels(commands, gbuffer_pipelines, nullptr, pass);
+
+	commands.endPass();
+}
+
+void renderDeferred(CommandList& commands, const Camera& camera, const FrameResources& frame,
+                    const Overlay& overlay) {
+	// Lighting copies the gbuffer depth where it lights, leaving the clear for
+	// the sky
+	commands.beginPass(sceneFramebuffer(), {
+		.color = {gl::LoadAction::dont_care},
+	});
+
+	commands.beginScope("lighting");
+
+	DeferredUniforms deferred_uniforms{
+		.inverse_view_projection = glm::inverse(camera_uniforms.view_projection),
+		.one_over_viewport = 1.0f / glm::vec2(scene_size),
+	};
+	commands.assign(*deferred_uniform_buffer, sizeof(DeferredUniforms), &deferred_uniforms);
+
+	commands.setPipeline(*deferred_lighting_pipeline);
+	commands.setVertexBuffer(*sky_vertex_buffer);
+	commands.setUniformBuffer(*camera_uniform_buffer, 0);
+	commands.setUniformBuffer(*deferred_uniform_buffer, 1);
+	commands.setTexture(render_graph->texture(frame.shadow_map), *shadow_map_sampler, 1);
+	commands.setTexture(render_graph->texture(frame.gbuffer_albedo), *gbuffer_sampler, 2);
+	commands.setTexture(render_graph->texture(frame.gbuffer_normal), *gbuffer_sampler, 3);
+	commands.setTexture(render_graph->texture(frame.gbuffer_specular), *gbuffer_sampler, 4);
+	commands.setTexture(render_graph->texture(frame.gbuffer_depth), *gbuffer_sampler, 5);
+	commands.draw(4);
+
+	commands.endScope();
+
+	if (points_splatted) {
+		compositePoints(commands, frame);
+	}
+
+	renderSky(commands, camera);
+
+	if (particle_system != nullptr) {
+		particle_system->draw(commands);
+	}
+
+	if (!scene_scaled) {
+		renderOverlays(commands, overlay);
+	}
+
+	commands.endPass({.depth_stencil = scene_scaled ? gl::StoreAction::store
+	                                                : gl::StoreAction::discard});
+}
+
+// Stretches the scene over the screen, depth included, and draws the
+// overlays over it
+void renderUpscale(CommandList& commands, const FrameResources& frame, const Overlay& overlay) {
+	commands.beginPass(gl::Framebuffer::main(), {
+		.color = {gl::LoadAction::dont_care},
+		.depth_stencil = gl::LoadAction::dont_care,
+	});
+
+	UpscaleUniforms uniforms{
+		.one_over_viewport = 1.0f / gl::viewport(),
+	};
+	commands.assign(*upscale_uniform_buffer, sizeof(UpscaleUniforms), &uniforms);
+
+	commands.setPipeline(upscale_filter == UpscaleFilter::sharpened ? *sharpened_upscale_pipeline
+	                                                                : *upscale_pipeline);
+	commands.setVertexBuffer(*sky_vertex_buffer);
+	commands.setUniformBuffer(*upscale_uniform_buffer, 0);
+	commands.setTexture(render_graph->texture(frame.scene_color), *upscale_sampler, 0);
+	commands.setTexture(render_graph->texture(frame.scene_depth), *gbuffer_sampler, 1);
+	commands.draw(4);
+
+	renderOverlays(commands, overlay);
+
+	commands.endPass({.depth_stencil = gl::StoreAction::discard});
+}
+
+// GPU time grows with the pixels drawn, so the scale follows the square root
+// of the target over the measured time, rounded down to a step. Measurements
+// trail by several frames, so a change holds until they catch up.
+void updateResolutionScale() {
+	if (dynamic_resolution.target_gpu_time <= 0.0f) {
+		return;
+	}
+
+	if (resolution_hold != 0) {
+		--resolution_hold;
+		return;
+	}
+
+	const double gpu_time = profiler::latestGpuFrameTime();
+	if (gpu_time <= 0.0) {
+		return;
+	}
+
+	const float ratio = dynamic_resolution.target_gpu_time / float(gpu_time);
+	if (ratio < 1.0f && ratio > 1.0f - resolution_tolerance) {
+		return;
+	}
+
+	// Rounding error must not cost a step
+	const float steps = std::floor(resolution_scale * std::sqrt(ratio) / resolution_scale_step +
+	                               0.001f);
+	const float scale = std::clamp(steps * resolution_scale_step,
+	                               dynamic_resolution.minimum_scale, 1.0f);
+
+	if (scale != resolution_scale) {
+		resolution_scale = scale;
+		resolution_hold = resolution_settle_frames;
+	}
+}
+
+// Passes drawing the clusters the cull kept
+void readClusters(RenderGraph& graph, const FrameResources& frame) {
+	if (cluster_culling) {
+		graph.read(frame.cluster_indices, GraphAccess::index);
+		graph.read(frame.cluster_commands, GraphAccess::indirect);
+	}
+}
+
+void declareGbuffer(RenderGraph& graph, const FrameResources& frame, ClusterPass pass) {
+	const GraphTexture attachments[] = {
+		frame.gbuffer_albedo,
+		frame.gbuffer_normal,
+		frame.gbuffer_specular,
+		frame.gbuffer_depth,
+	};
+
+	graph.addPass(pass == cluster_early ? "gbuffer" : "late gbuffer",
+	              [pass](CommandList& commands) { renderGbuffer(commands, pass); });
+
+	for (GraphTexture attachment : attachments) {
+		if (pass == cluster_late) {
+			graph.read(attachment, GraphAccess::attachment);
+		}
+
+		graph.write(attachment, GraphAccess::attachment);
+	}
+
+	readClusters(graph, frame);
+}
+
+void declareDepthPyramid(RenderGraph& graph, const FrameResources& frame) {
+	graph.addPass("depth pyramid", [frame](CommandList& commands) {
+		buildDepthPyramid(commands, render_graph->texture(frame.gbuffer_depth));
+	});
+	graph.read(frame.gbuffer_depth, GraphAccess::sampled);
+	graph.write(frame.depth_pyramid, GraphAccess::image);
+}
+
+void declareClusterCull(RenderGraph& graph, const FrameResources& frame, const Camera& camera,
+                        ClusterPass pass) {
+	graph.addPass(pass == cluster_early ? "clusters" : "late clusters",
+	              [&camera, pass](CommandList& commands) {
+		// Commands the last frame's cull wrote are reset first
+		if (pass == cluster_early) {
+			uploadClusters(commands);
+		}
+
+		cullClusters(commands, camera, pass);
+	});
+
+	// The early pass leaves what it hid for the late one to retest
+	if (pass == cluster_early) {
+		graph.write(frame.cluster_commands, GraphAccess::update);
+		graph.write(frame.cluster_retests, GraphAccess::storage);
+	} else {
+		graph.read(frame.cluster_retests, GraphAccess::storage);
+	}
+
+	graph.read(frame.depth_pyramid, GraphAccess::sampled);
+	graph.write(frame.cluster_indices, GraphAccess::storage);
+	graph.write(frame.cluster_commands, GraphAccess::storage);
+}
 
 } // namespace
 
 void setup() {
+	setupResources();
+
+	vertex_arena = new GeometryArena(GL_ARRAY_BUFFER, sizeof(Vertex), initial_vertex_capacity);
+	index_arena = new GeometryArena(GL_ELEMENT_ARRAY_BUFFER, sizeof(uint32_t),
+	                                initial_index_capacity);
+	position_arena = new GeometryArena(GL_ARRAY_BUFFER, sizeof(glm::vec3),
+	                                   initial_vertex_capacity);
+
+	occlusion_buffer = new scene::OcclusionBuffer(occlusion_size.x, occlusion_size.y);
+
+	render_graph = new RenderGraph();
+
 	const gl::VertexAttribute attributes[] = {
 		{0, GL_FLOAT, 3, false},
 		{1, GL_FLOAT, 3, false},
@@ -104,8 +1359,12 @@ void setup() {
 	camera_uniform_buffer = new gl::Buffer(GL_UNIFORM_BUFFER, GL_DYNAMIC_DRAW,
 	                                       sizeof(CameraUniforms));
 
-	model_uniform_buffer = new gl::Buffer(GL_UNIFORM_BUFFER, GL_DYNAMIC_DRAW,
-	                                      sizeof(ModelUniforms));
+	instance_buffer = new GrowableBuffer(GL_SHADER_STORAGE_BUFFER, GL_DYNAMIC_DRAW,
+	                                     gl::MemoryCategory::scene,
+	                                     initial_instance_capacity * sizeof(InstanceData));
+	material_buffer = new GrowableBuffer(GL_SHADER_STORAGE_BUFFER, GL_DYNAMIC_DRAW,
+	                                     gl::MemoryCategory::scene,
+	                                     initial_material_capacity * sizeof(MaterialData));
 
 	camera_uniforms.ambience = {0.52f, 0.81f, 0.92f};
 
@@ -131,12 +1390,52 @@ void setup() {
 	gl::Shader sky_vertex_shader(GL_VERTEX_SHADER, sky_vertex_shader_code);
 	gl::Shader sky_fragment_shader(GL_FRAGMENT_SHADER, sky_fragment_shader_code);
 
+	const gl::DepthStencilState sky_depth_stencil_state{
+		.depth_write = false,
+		.depth_compare = GL_LEQUAL,
+	};
+
 	sky_pipeline = new gl::Pipeline(
 		gl::PrimitiveState{.mode = GL_TRIANGLE_STRIP, .cull_mode = GL_NONE},
 		sky_vertex_attributes,
 		sky_vertex_shader,
 		sky_fragment_shader,
-		gl::DepthStencilState{.depth_write = false},
+		sky_depth_stencil_state,
+		gl::BlendState{.enable = false});
+
+	gl::Shader atmosphere_fragment_shader(GL_FRAGMENT_SHADER, atmosphere_fragment_shader_code);
+
+	atmosphere_pipeline = new gl::Pipeline(
+		gl::PrimitiveState{.mode = GL_TRIANGLE_STRIP, .cull_mode = GL_NONE},
+		sky_vertex_attributes,
+		sky_vertex_shader,
+		atmosphere_fragment_shader,
+		sky_depth_stencil_state,
+		gl::BlendState{.enable = false});
+
+	const auto sky_lut = computeSkyLut(sun_position, sky_lut_size.x, sky_lut_size.y);
+	sky_lut_texture = new gl::Texture(GL_RGBA8, sky_lut_size.x, sky_lut_size.y, sky_lut.data());
+
+	sky_lut_sampler = new gl::Sampler({
+		.min_filter = GL_LINEAR,
+	});
+
+	/* Memory overlay */
+
+	memory_overlay_uniform_buffer = new gl::Buffer(GL_UNIFORM_BUFFER, GL_DYNAMIC_DRAW,
+	                                               sizeof(MemoryOverlayUniforms));
+
+	gl::Shader memory_overlay_vertex_shader(GL_VERTEX_SHADER,
+	                                        memory_overlay_vertex_shader_code);
+	gl::Shader memory_overlay_fragment_shader(GL_FRAGMENT_SHADER,
+	                                          memory_overlay_fragment_shader_code);
+
+	memory_overlay_pipeline = new gl::Pipeline(
+		gl::PrimitiveState{.mode = GL_TRIANGLE_STRIP, .cull_mode = GL_NONE},
+		sky_vertex_attributes,
+		memory_overlay_vertex_shader,
+		memory_overlay_fragment_shader,
+		gl::DepthStencilState{.depth_write = false, .depth_test = false},
 		gl::BlendState{.enable = false});
 
 	/* Shadow map */
@@ -147,9 +1446,14 @@ void setup() {
 	gl::Shader shadow_map_fragment_shader(GL_FRAGMENT_SHADER,
 	                                      shadow_map_fragment_shader_code);
 
+	// Fed from meshes' position streams
+	const gl::VertexAttribute position_attributes[] = {
+		{0, GL_FLOAT, 3, false},
+	};
+
 	shadow_map_pipeline = new gl::Pipeline(
 		gl::PrimitiveState{.mode = GL_TRIANGLES, .cull_mode = GL_FRONT},
-		attributes,
+		position_attributes,
 		shadow_map_vertex_shader,
 		shadow_map_fragment_shader,
 		solid_depth_stencil_state,
@@ -158,126 +1462,723 @@ void setup() {
 	shadow_map_uniform_buffer = new gl::Buffer(GL_UNIFORM_BUFFER, GL_DYNAMIC_DRAW,
 	                                    sizeof(ShadowMapUniforms));
 
-	shadow_map_texture = new gl::Texture(GL_DEPTH_COMPONENT32F,
-	                                     shadow_map_size, shadow_map_size);
-
 	shadow_map_sampler = new gl::Sampler({
 		.address_mode_u = GL_CLAMP_TO_EDGE,
 		.address_mode_v = GL_CLAMP_TO_EDGE,
 		.compare_func = GL_LEQUAL,
 	});
 
-	shadow_map_framebuffer = new gl::Framebuffer({}, shadow_map_texture);
+	/* Deferred */
+
+	gl::Shader gbuffer_vertex_shader(GL_VERTEX_SHADER, gbuffer_vertex_shader_code);
+
+	gl::Shader gbuffer_untextured_unlit_fragment_shader(GL_FRAGMENT_SHADER, {
+		gbuffer_fragment_shader_code,
+		gbuffer_untextured_unlit_fragment_main_code,
+	});
+
+	gbuffer_pipelines[static_cast<size_t>(RenderMode::untextured_unlit)] = new gl::Pipeline(
+		solid_primitive_state, attributes,
+		gbuffer_vertex_shader, gbuffer_untextured_unlit_fragment_shader,
+		solid_depth_stencil_state, solid_blend_state);
+
+	gl::Shader gbuffer_untextured_lit_fragment_shader(GL_FRAGMENT_SHADER, {
+		gbuffer_fragment_shader_code,
+		gbuffer_untextured_lit_fragment_main_code,
+	});
+
+	gbuffer_pipelines[static_cast<size_t>(RenderMode::untextured_lit)] = new gl::Pipeline(
+		solid_primitive_state, attributes,
+		gbuffer_vertex_shader, gbuffer_untextured_lit_fragment_shader,
+		solid_depth_stencil_state, solid_blend_state);
+
+	gl::Shader gbuffer_textured_lit_fragment_shader(GL_FRAGMENT_SHADER, {
+		gbuffer_fragment_shader_code,
+		gbuffer_textured_lit_fragment_main_code,
+	});
+
+	gbuffer_pipelines[static_cast<size_t>(RenderMode::textured_lit)] = new gl::Pipeline(
+		solid_primitive_state, attributes,
+		gbuffer_vertex_shader, gbuffer_textured_lit_fragment_shader,
+		solid_depth_stencil_state, solid_blend_state);
+
+	target_size = glm::uvec2(gl::viewport());
+
+	gbuffer_sampler = new gl::Sampler({
+		.min_filter = GL_NEAREST,
+		.mag_filter = GL_NEAREST,
+	});
+
+	gl::Shader deferred_lighting_vertex_shader(GL_VERTEX_SHADER,
+	                                           deferred_lighting_vertex_shader_code);
+
+	gl::Shader deferred_lighting_fragment_shader(GL_FRAGMENT_SHADER,
+	                                             deferred_lighting_fragment_shader_code);
+
+	deferred_lighting_pipeline = new gl::Pipeline(
+		gl::PrimitiveState{.mode = GL_TRIANGLE_STRIP, .cull_mode = GL_NONE},
+		sky_vertex_attributes,
+		deferred_lighting_vertex_shader,
+		deferred_lighting_fragment_shader,
+		gl::DepthStencilState{.depth_write = true, .depth_test = false},
+		gl::BlendState{.enable = false});
+
+	deferred_uniform_buffer = new gl::Buffer(GL_UNIFORM_BUFFER, GL_DYNAMIC_DRAW,
+	                                         sizeof(DeferredUniforms));
+
+	/* Clusters */
+
+	gl::Shader cluster_cull_compute_shader(GL_COMPUTE_SHADER, cluster_cull_compute_shader_code);
+	cluster_cull_pipeline = new gl::ComputePipeline(cluster_cull_compute_shader);
+
+	cluster_cull_uniform_buffer = new gl::Buffer(GL_UNIFORM_BUFFER, GL_DYNAMIC_DRAW,
+	                                             sizeof(ClusterCullUniforms));
+
+	// Created by the first frame culling clusters
+	for (GrowableBuffer** buffer : {&cluster_draw_buffer, &cluster_index_buffer,
+	                                &cluster_command_buffer, &cluster_retest_buffer}) {
+		*buffer = new GrowableBuffer(GL_SHADER_STORAGE_BUFFER, GL_DYNAMIC_DRAW,
+		                             gl::MemoryCategory::scene);
+	}
+
+	gl::Shader depth_pyramid_seed_compute_shader(GL_COMPUTE_SHADER,
+	                                             depth_pyramid_seed_compute_shader_code);
+	depth_pyramid_seed_pipeline = new gl::ComputePipeline(depth_pyramid_seed_compute_shader);
+
+	gl::Shader depth_pyramid_reduce_compute_shader(GL_COMPUTE_SHADER,
+	                                               depth_pyramid_reduce_compute_shader_code);
+	depth_pyramid_reduce_pipeline = new gl::ComputePipeline(depth_pyramid_reduce_compute_shader);
+
+	const glm::uvec2 depth_pyramid_size(std::bit_floor(target_size.x),
+	                                    std::bit_floor(target_size.y));
+
+	depth_pyramid_texture = new gl::Texture(GL_R32F, depth_pyramid_size.x, depth_pyramid_size.y,
+	                                        nullptr,
+	                                        std::bit_width(std::max(depth_pyramid_size.x,
+	                                                                depth_pyramid_size.y)));
+
+	depth_pyramid_sampler = new gl::Sampler({
+		.min_filter = GL_NEAREST_MIPMAP_NEAREST,
+		.mag_filter = GL_NEAREST,
+	});
+
+	/* Points */
+
+	gl::Shader point_splat_compute_shader(GL_COMPUTE_SHADER, point_splat_compute_shader_code);
+	point_splat_pipeline = new gl::ComputePipeline(point_splat_compute_shader);
+
+	gl::Shader point_resolve_compute_shader(GL_COMPUTE_SHADER, point_resolve_compute_shader_code);
+	point_resolve_pipeline = new gl::ComputePipeline(point_resolve_compute_shader);
+
+	gl::Shader point_composite_fragment_shader(GL_FRAGMENT_SHADER,
+	                                           point_composite_fragment_shader_code);
+
+	point_composite_pipeline = new gl::Pipeline(
+		gl::PrimitiveState{.mode = GL_TRIANGLE_STRIP, .cull_mode = GL_NONE},
+		sky_vertex_attributes,
+		deferred_lighting_vertex_shader,
+		point_composite_fragment_shader,
+		gl::DepthStencilState{.depth_write = true},
+		gl::BlendState{.enable = false});
+
+	point_uniform_buffer = new gl::Buffer(GL_UNIFORM_BUFFER, GL_DYNAMIC_DRAW,
+	                                      sizeof(PointUniforms));
+
+	// Depths start cleared, the resolve clears them after every frame
+	const std::vector<uint32_t> point_target(2 * target_size.x * target_size.y,
+	                                         std::numeric_limits<uint32_t>::max());
+
+	point_target_buffer = new gl::Buffer(GL_SHADER_STORAGE_BUFFER, GL_DYNAMIC_DRAW,
+	                                     gl::MemoryCategory::render_target,
+	                                     point_target.size() * sizeof(uint32_t),
+	                                     point_target.data());
+
+	/* Upscale */
+
+	const gl::DepthStencilState upscale_depth_stencil_state{
+		.depth_write = true,
+		.depth_test = false,
+	};
+
+	gl::Shader upscale_fragment_shader(GL_FRAGMENT_SHADER, upscale_fragment_shader_code);
+
+	upscale_pipeline = new gl::Pipeline(
+		gl::PrimitiveState{.mode = GL_TRIANGLE_STRIP, .cull_mode = GL_NONE},
+		sky_vertex_attributes,
+		deferred_lighting_vertex_shader,
+		upscale_fragment_shader,
+		upscale_depth_stencil_state,
+		gl::BlendState{.enable = false});
+
+	gl::Shader sharpened_upscale_fragment_shader(GL_FRAGMENT_SHADER,
+	                                             sharpened_upscale_fragment_shader_code);
+
+	sharpened_upscale_pipeline = new gl::Pipeline(
+		gl::PrimitiveState{.mode = GL_TRIANGLE_STRIP, .cull_mode = GL_NONE},
+		sky_vertex_attributes,
+		deferred_lighting_vertex_shader,
+		sharpened_upscale_fragment_shader,
+		upscale_depth_stencil_state,
+		gl::BlendState{.enable = false});
+
+	upscale_uniform_buffer = new gl::Buffer(GL_UNIFORM_BUFFER, GL_DYNAMIC_DRAW,
+	                                        sizeof(UpscaleUniforms));
+
+	upscale_sampler = new gl::Sampler({
+		.min_filter = GL_LINEAR,
+		.mag_filter = GL_LINEAR,
+	});
+
+	setupSkinning();
+	setupParticles();
 }
 
 void shutdown() {
-	delete shadow_map_framebuffer;
+	shutdownParticles();
+	shutdownSkinning();
+
+	delete upscale_sampler;
+	delete upscale_uniform_buffer;
+	delete sharpened_upscale_pipeline;
+	delete upscale_pipeline;
+
+	delete point_target_buffer;
+	delete point_uniform_buffer;
+	delete point_composite_pipeline;
+	delete point_resolve_pipeline;
+	delete point_splat_pipeline;
+
+	delete depth_pyramid_sampler;
+	delete depth_pyramid_texture;
+	delete depth_pyramid_reduce_pipeline;
+	delete depth_pyramid_seed_pipeline;
+
+	delete cluster_retest_buffer;
+	delete cluster_command_buffer;
+	delete cluster_index_buffer;
+	delete cluster_draw_buffer;
+	delete cluster_cull_uniform_buffer;
+	delete cluster_cull_pipeline;
+
+	delete deferred_uniform_buffer;
+	delete deferred_lighting_pipeline;
+
+	delete gbuffer_sampler;
+	delete gbuffer_pipelines[static_cast<size_t>(RenderMode::textured_lit)];
+	delete gbuffer_pipelines[static_cast<size_t>(RenderMode::untextured_lit)];
+	delete gbuffer_pipelines[static_cast<size_t>(RenderMode::untextured_unlit)];
+
 	delete shadow_map_sampler;
-	delete shadow_map_texture;
 	delete shadow_map_uniform_buffer;
 	delete shadow_map_pipeline;
 	
+	delete memory_overlay_pipeline;
+	delete memory_overlay_uniform_buffer;
+
+	delete sky_lut_sampler;
+	delete sky_lut_texture;
+	delete atmosphere_pipeline;
 	delete sky_pipeline;
 	delete sky_uniform_buffer;
 	delete sky_vertex_buffer;
 	
-	delete model_uniform_buffer;
+	delete material_buffer;
+	delete instance_buffer;
 	delete camera_uniform_buffer;
 	delete pipelines[static_cast<size_t>(RenderMode::textured_lit)];
 	delete pipelines[static_cast<size_t>(RenderMode::untextured_lit)];
 	delete pipelines[static_cast<size_t>(RenderMode::untextured_unlit)];
+
+	// Meshes still alive free their ranges as the pools go
+	shutdownResources();
+
+	delete occlusion_buffer;
+	delete render_graph;
+
+	delete position_arena;
+	delete index_arena;
+	delete vertex_arena;
 }
 
-void render(const std::span<const Model> models,
-            const Camera& camera,
-            const std::span<const Light> lights) {
-	const float clear_color[] = {0.0f, 0.0f, 0.0f, 1.0f};
+void setRenderPath(RenderPath path) {
+	current_render_path = path;
+}
 
-	gl::beginPass(*shadow_map_framebuffer, GL_DEPTH_BUFFER_BIT, clear_color);
+RenderPath renderPath() {
+	return current_render_path;
+}
 
-	glm::mat4 shadow_projection = glm::ortho(-10.0f, 10.0f, -10.0f, 10.0f, 1.0f, 20.0f);
-	glm::mat4 shadow_view = glm::lookAt(glm::vec3(4.0f, 4.0f, 4.0f),
-	                                    glm::vec3(0.0f, 0.0f, 0.0f),
-	                                    glm::vec3(0.0f, 1.0f, 0.0f));
+void setClusterCulling(bool enabled) {
+	cluster_culling = enabled;
+}
 
-	ShadowMapUniforms shadow_map_uniforms{
-		.view_projection = shadow_projection * shadow_view,
-	};
-	shadow_map_uniform_buffer->assign(sizeof(ShadowMapUniforms), &shadow_map_uniforms);
+bool clusterCulling() {
+	return cluster_culling;
+}
+
+void setOcclusionCulling(bool enabled) {
+	occlusion_culling = enabled;
+}
+
+bool occlusionCulling() {
+	return occlusion_culling;
+}
+
+OcclusionUsage occlusionUsage() {
+	return occlusion_usage;
+}
+
+GeometryUsage geometryUsage() {
+	return {vertex_arena->statistics(), index_arena->statistics(), position_arena->statistics()};
+}
+
+GraphStatistics renderGraphStatistics() {
+	return render_graph->statistics();
+}
+
+void setPointCloud(PointCloud* cloud) {
+	point_cloud = cloud;
+	points_splatted = false;
+}
+
+PointCloud* pointCloud() {
+	return point_cloud;
+}
+
+void setParticleSystem(ParticleSystem* system) {
+	particle_system = system;
+}
+
+ParticleSystem* particleSystem() {
+	return particle_system;
+}
+
+void setPointBudget(uint64_t points) {
+	point_budget = points;
+}
+
+uint64_t pointBudget() {
+	return point_budget;
+}
+
+void setSkyMode(SkyMode mode) {
+	current_sky_mode = mode;
+}
+
+SkyMode skyMode() {
+	return current_sky_mode;
+}
+
+void setMemoryOverlay(bool enabled) {
+	memory_overlay = enabled;
+}
+
+bool memoryOverlay() {
+	return memory_overlay;
+}
+
+void setResolutionScale(float scale) {
+	assert(scale > 0.0f && scale <= 1.0f);
+	resolution_scale = scale;
+}
+
+float resolutionScale() {
+	return resolution_scale;
+}
+
+void setDynamicResolution(const DynamicResolution& resolution) {
+	assert(resolution.target_gpu_time >= 0.0f);
+	assert(resolution.minimum_scale > 0.0f && resolution.minimum_scale <= 1.0f);
+	dynamic_resolution = resolution;
+	resolution_hold = 0;
+}
 
-	gl::setPipeline(*shadow_map_pipeline);
-	gl::setUniformBuffer(*shadow_map_uniform_buffer, 0);
-	gl::setUniformBuffer(*model_uniform_buffer, 1);
+const DynamicResolution& dynamicResolution() {
+	return dynamic_resolution;
+}
 
-	for (const auto& model : models) {
-		model_uniform_buffer->assign(sizeof(glm::mat4), &model.transform);
+void setUpscaleFilter(UpscaleFilter filter) {
+	upscale_filter = filter;
+}
 
-		gl::setVertexBuffer(model.mesh.vertexBuffer());
-		gl::setIndexBuffer(model.mesh.indexBuffer(), GL_UNSIGNED_INT);
+UpscaleFilter upscaleFilter() {
+	return upscale_filter;
+}
 
-		gl::draw(model.mesh.count());
+MaterialSlot registerMaterial(const Material& material) {
+	MaterialSlot slot;
+
+	if (!free_materials.empty()) {
+		slot = free_materials.back();
+		free_materials.pop_back();
+	} else {
+		slot = material_data.size();
+		material_data.emplace_back();
+		material_live.push_back(false);
+		material_users.push_back(0);
+		material_dirty.push_back(false);
 	}
 
-	gl::endPass();
+	material_live[slot] = true;
+	updateMaterial(slot, material);
 
-	gl::beginPass(gl::Framebuffer::main(),
-	              GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT,
-	              clear_color);
+	return slot;
+}
 
-	SkyUniforms sky_uniforms{
-		.view = glm::mat4(mat3_cast(camera.calculateOrientation())),
-		.viewport = camera.viewport,
-	};
-	sky_uniform_buffer->assign(sizeof(SkyUniforms), &sky_uniforms);
+void unregisterMaterial(MaterialSlot slot) {
+	assert(slot < material_data.size() && material_live[slot]);
+	assert(material_users[slot] == 0);
+
+	material_live[slot] = false;
+	free_materials.push_back(slot);
+}
+
+void updateMaterial(MaterialSlot slot, const Material& material) {
+	assert(slot < material_data.size() && material_live[slot]);
+
+	auto& data = material_data[slot];
+	data.albedo_color = material.albedo_color / glm::pi<float>();
+	data.specular_color = material.specular_color *
+	                      ((material.shininess + 8.0f) / (8.0f * glm::pi<float>()));
+	data.shininess = material.shininess;
+	data.emissiveness = material.emissiveness;
+	markDirty(material_dirty, dirty_materials, slot);
+}
+
+Instance createInstance(const glm::mat4& transform, MaterialSlot material) {
+	Instance instance;
+
+	if (!free_instances.empty()) {
+		instance = free_instances.back();
+		free_instances.pop_back();
+	} else {
+		instance = instance_data.size();
+		instance_data.emplace_back();
+		instance_live.push_back(false);
+		instance_dirty.push_back(false);
+	}
 
-	gl::setPipeline(*sky_pipeline);
-	gl::setVertexBuffer(*sky_vertex_buffer);
-	gl::setUniformBuffer(*sky_uniform_buffer, 0);
-	gl::draw(4);
+	assert(material < material_data.size() && material_live[material]);
+
+	instance_live[instance] = true;
+	instance_data[instance].transform = transform;
+	instance_data[instance].material = material;
+	++material_users[material];
+	markDirty(instance_dirty, dirty_instances, instance);
+
+	return instance;
+}
+
+void destroyInstance(Instance instance) {
+	assert(instance < instance_data.size() && instance_live[instance]);
+
+	instance_live[instance] = false;
+	--material_users[instance_data[instance].material];
+	free_instances.push_back(instance);
+}
+
+void setInstanceTransform(Instance instance, const glm::mat4& transform) {
+	assert(instance < instance_data.size() && instance_live[instance]);
+	instance_data[instance].transform = transform;
+	markDirty(instance_dirty, dirty_instances, instance);
+}
+
+void setInstanceMaterial(Instance instance, MaterialSlot material) {
+	assert(instance < instance_data.size() && instance_live[instance]);
+	assert(material < material_data.size() && material_live[material]);
+
+	--material_users[instance_data[instance].material];
+	++material_users[material];
+	instance_data[instance].material = material;
+	markDirty(instance_dirty, dirty_instances, instance);
+}
+
+const glm::mat4& instanceTransform(Instance instance) {
+	return instance_data[instance].transform;
+}
+
+void render(CommandList& commands,
+            const std::span<const Model> models,
+            const Camera& camera,
+            const std::span<const Light> lights,
+            const scene::Bvh* bvh,
+            const Overlay& overlay) {
+	glm::mat4 shadow_matrix = calculateShadowMatrix();
+
+	updateResolutionScale();
+
+	scene_scaled = resolution_scale < 1.0f || dynamic_resolution.target_gpu_time > 0.0f;
+	scene_size = glm::max(glm::uvec2(glm::vec2(target_size) * resolution_scale + 0.5f),
+	                      glm::uvec2(1));
+
+	defragmentGeometry(commands);
 
 	camera_uniforms.view_projection = camera.calculatePerspective();
-	camera_uniforms.shadow_matrix = shadow_map_uniforms.view_projection;
+
+	buildDrawLists(models, bvh, camera, {camera_uniforms.view_projection, shadow_matrix});
+
+	if (cluster_culling) {
+		planClusters(commands);
+	}
+
+	growSlots(commands, *material_buffer, material_data.size() * sizeof(MaterialData),
+	          material_dirty, dirty_materials);
+	uploadDirty(commands, material_buffer->get(), material_data, material_dirty, dirty_materials);
+	growSlots(commands, *instance_buffer, instance_data.size() * sizeof(InstanceData),
+	          instance_dirty, dirty_instances);
+	uploadDirty(commands, instance_buffer->get(), instance_data, instance_dirty, dirty_instances);
+
+	camera_uniforms.shadow_matrix = shadow_matrix;
 	camera_uniforms.view_position = camera.position;
 	camera_uniforms.light_count = lights.size();
 	std::copy_n(lights.begin(), std::min(lights.size(), max_light_count),
 	            camera_uniforms.lights);
-	camera_uniform_buffer->assign(sizeof(CameraUniforms), &camera_uniforms);
-	
-	for (const auto& model : models) {
-		const auto& material = model.material;
+	commands.assign(*camera_uniform_buffer, sizeof(CameraUniforms), &camera_uniforms);
 
-		gl::setPipeline(*pipelines[static_cast<size_t>(material.render_mode)]);
-		gl::setUniformBuffer(*camera_uniform_buffer, 0);
-		gl::setUniformBuffer(*model_uniform_buffer, 1);
+	// Whether there is anything to splat is only known after streaming
+	if (point_cloud != nullptr) {
+		point_cloud->update(commands, camera, camera_uniforms.view_projection, point_budget,
+		                    point_spacing_pixels, point_loads_per_frame);
+	}
 
-		if (material.render_mode == RenderMode::textured_lit) {
-			assert(material.texture_sampler != nullptr &&
-			       material.albedo_texture != nullptr);
-			gl::setTexture(*material.albedo_texture, *material.texture_sampler, 0);
-		}
+	points_splatted = point_cloud != nullptr && !point_cloud->draws().empty();
+
+	RenderGraph& graph = *render_graph;
+	FrameResources frame{};
+
+	frame.shadow_map = graph.createTexture({GL_DEPTH_COMPONENT32F, shadow_map_size,
+	                                        shadow_map_size});
+	frame.depth_pyramid = graph.importTexture(*depth_pyramid_texture);
+
+	if (scene_scaled) {
+		frame.scene_color = graph.createTexture({GL_RGBA8, scene_size.x, scene_size.y});
+		frame.scene_depth = graph.createTexture({GL_DEPTH_COMPONENT24, scene_size.x,
+		                                         scene_size.y});
+	}
+	if (cluster_culling) {
+		frame.cluster_indices = graph.importBuffer(cluster_index_buffer->get());
+		frame.cluster_commands = graph.importBuffer(cluster_command_buffer->get());
+		frame.cluster_retests = graph.importBuffer(cluster_retest_buffer->get());
+	}
+	frame.point_target = graph.importBuffer(*point_target_buffer);
+
+	graph.addPass("shadow", [shadow_matrix](CommandList& commands) {
+		renderShadowMap(commands, shadow_matrix);
+	});
+	graph.write(frame.shadow_map, GraphAccess::attachment);
+
+	if (cluster_culling) {
+		declareClusterCull(graph, frame, camera, cluster_early);
+	}
+
+	if (points_splatted) {
+		frame.point_color = graph.createTexture({GL_RGBA8, scene_size.x, scene_size.y});
+		frame.point_depth = graph.createTexture({GL_R32F, scene_size.x, scene_size.y});
+
+		graph.addPass("points", [frame](CommandList& commands) { splatPoints(commands, frame); });
+		graph.read(frame.point_target, GraphAccess::storage);
+		graph.write(frame.point_target, GraphAccess::storage);
+		graph.write(frame.point_color, GraphAccess::image);
+		graph.write(frame.point_depth, GraphAccess::image);
+	}
+
+	switch (current_render_path) {
+		case RenderPath::forward:
+			if (particle_system != nullptr) {
+				graph.addPass("particle simulation", [&camera](CommandList& commands) {
+					particle_system->simulate(commands, camera, camera_uniforms.view_projection,
+					                          nullptr);
+				});
+				graph.keep();
+			}
+
+			graph.addPass("scene", [&camera, &overlay, frame](CommandList& commands) {
+				renderForward(commands, camera, frame, overlay);
+			});
+			readClusters(graph, frame);
+			break;
+		case RenderPath::deferred:
+			frame.gbuffer_albedo = graph.createTexture({GL_RGBA8, scene_size.x, scene_size.y});
+			frame.gbuffer_normal = graph.createTexture({GL_RGB10_A2, scene_size.x, scene_size.y});
+			frame.gbuffer_specular = graph.createTexture({GL_RGBA8, scene_size.x, scene_size.y});
+			frame.gbuffer_depth = graph.createTexture({GL_DEPTH_COMPONENT24, scene_size.x,
+			                                           scene_size.y});
+
+			declareGbuffer(graph, frame, cluster_early);
+
+			// Clusters hidden by last frame's depth get a second chance against the
+			// depth drawn so far, then the pyramid is rebuilt for the next frame
+			if (cluster_culling) {
+				declareDepthPyramid(graph, frame);
+				declareClusterCull(graph, frame, camera, cluster_late);
+				declareGbuffer(graph, frame, cluster_late);
+				declareDepthPyramid(graph, frame);
+			}
+
+			// Only here is the scene's depth readable before it is drawn over
+			if (particle_system != nullptr) {
+				graph.addPass("particle simulation", [&camera, frame](CommandList& commands) {
+					const ParticleCollision collision{
+						render_graph->texture(frame.gbuffer_depth),
+						*gbuffer_sampler,
+					};
+					particle_system->simulate(commands, camera, camera_uniforms.view_projection,
+					                          &collision);
+				});
+				graph.read(frame.gbuffer_depth, GraphAccess::sampled);
+				graph.keep();
+			}
+
+			graph.addPass("scene", [&camera, &overlay, frame](CommandList& commands) {
+				renderDeferred(commands, camera, frame, overlay);
+			});
+			graph.read(frame.gbuffer_albedo, GraphAccess::sampled);
+			graph.read(frame.gbuffer_normal, GraphAccess::sampled);
+			graph.read(frame.gbuffer_specular, GraphAccess::sampled);
+			graph.read(frame.gbuffer_depth, GraphAccess::sampled);
+			break;
+	}
+
+	// Both paths draw the scene, to the screen unless the frame is scaled
+	graph.read(frame.shadow_map, GraphAccess::sampled);
+
+	if (points_splatted) {
+		graph.read(frame.point_color, GraphAccess::sampled);
+		graph.read(frame.point_depth, GraphAccess::sampled);
+	}
+
+	if (scene_scaled) {
+		graph.write(frame.scene_color, GraphAccess::attachment);
+		graph.write(frame.scene_depth, GraphAccess::attachment);
+
+		graph.addPass("upscale", [&overlay, frame](CommandList& commands) {
+			renderUpscale(commands, frame, overlay);
+		});
+		graph.read(frame.scene_color, GraphAccess::sampled);
+		graph.read(frame.scene_depth, GraphAccess::sampled);
+	}
+
+	// Whichever pass came last drew to the screen
+	graph.keep();
+	graph.execute(commands);
+
+	// Only the deferred path keeps a depth buffer to build the pyramid from
+	depth_pyramid_ready = cluster_culling && current_render_path == RenderPath::deferred;
+	depth_pyramid_view_projection = camera_uniforms.view_projection;
+
+	enforceMemoryBudget();
+	retireResources(commands);
+}
+
+Mesh::Mesh(CommandList& commands,
+           const std::span<const Vertex> vertices,
+           const std::span<const uint32_t> indices,
+           bool position_stream)
+: Mesh(commands, vertices, indices, std::array{MeshLod{0, uint32_t(indices.size()), 0.0f}},
+       position_stream) {}
+
+Mesh::Mesh(CommandList& commands,
+           const std::span<const Vertex> vertices,
+           const std::span<const uint32_t> indices,
+           const std::span<const MeshLod> lods,
+           bool position_stream)
+: Mesh(commands, vertices, indices, lods, buildMeshlets(vertices, indices, lods),
+       position_stream) {}
+
+Mesh::Mesh(CommandList& commands,
+           const std::span<const Vertex> vertices,
+           const std::span<const uint32_t> indices,
+           const std::span<const MeshLod> lods,
+           const Meshlets& meshlets,
+           bool position_stream)
+: vertex_count_{uint32_t(vertices.size())},
+  index_count_{uint32_t(indices.size())},
+  has_position_stream_{position_stream},
+  count_{lods.front().count},
+  bounds_{calculateBounds(vertices)},
+  lods_(lods.begin(), lods.end()),
+  meshlet_buffer_(GL_SHADER_STORAGE_BUFFER, GL_DYNAMIC_DRAW, gl::MemoryCategory::mesh),
+  meshlet_data_buffer_(GL_SHADER_STORAGE_BUFFER, GL_DYNAMIC_DRAW, gl::MemoryCategory::mesh),
+  meshlet_lods_(meshlets.lods) {
+	const size_t meshlet_size = meshlets.meshlets.size() * sizeof(Meshlet);
+	meshlet_buffer_.reserve(commands, meshlet_size);
+	commands.assign(meshlet_buffer_.get(), meshlet_size, meshlets.meshlets.data());
+
+	const size_t data_size = meshlets.data.size() * sizeof(uint32_t);
+	meshlet_data_buffer_.reserve(commands, data_size);
+	commands.assign(meshlet_data_buffer_.get(), data_size, meshlets.data.data());
+
+	vertex_arena->allocate(commands, vertex_count_, vertices.data(), &base_vertex_);
+	index_arena->allocate(commands, index_count_, indices.data(), &first_index_);
+
+	if (has_position_stream_) {
+		std::vector<glm::vec3> positions(vertices.size());
+		std::transform(vertices.begin(), vertices.end(), positions.begin(),
+		               [](const Vertex& vertex) { return vertex.position; });
+
+		position_arena->allocate(commands, vertex_count_, positions.data(), &base_position_);
+	}
+}
+
+Mesh::~Mesh() {
+	if (has_position_stream_) {
+		position_arena->free(base_position_);
+	}
+
+	index_arena->free(first_index_);
+	vertex_arena->free(base_vertex_);
+}
+
+const gl::Buffer& Mesh::vertexBuffer() const & noexcept {
+	return vertex_arena->buffer();
+}
+
+const gl::Buffer& Mesh::indexBuffer() const & noexcept {
+	return index_arena->buffer();
+}
+
+const gl::Buffer& Mesh::positionBuffer() const & noexcept {
+	assert(has_position_stream_);
+	return position_arena->buffer();
+}
+
+void Mesh::setOccluder(const std::span<const glm::vec3> positions,
+                       const std::span<const uint32_t> indices) {
+	assert(indices.size() % 3 == 0);
 
-		gl::setTexture(*shadow_map_texture, *shadow_map_sampler, 1);
+	occluder_positions_.assign(positions.begin(), positions.end());
+	occluder_indices_.assign(indices.begin(), indices.end());
+}
+
+void Mesh::setDeforming(const Bounds& bounds) {
+	deforming_ = true;
+	bounds_ = bounds;
+}
+
+size_t memoryBytes(const Mesh& mesh) {
+	return size_t(mesh.vertexCount()) * sizeof(Vertex) +
+	       size_t(mesh.indexCount()) * sizeof(uint32_t) +
+	       (mesh.hasPositionStream() ? size_t(mesh.vertexCount()) * sizeof(glm::vec3) : 0) +
+	       mesh.meshletBytes();
+}
+
+Bounds Mesh::calculateBounds(const std::span<const Vertex> vertices) {
+	if (vertices.empty()) {
+		return {glm::vec3(0.0f), glm::vec3(0.0f)};
+	}
 
-		ModelUniforms model_uniforms{
-			.transform = model.transform,
-			.albedo_color = material.albedo_color / glm::pi<float>(),
-			.specular_color = material.specular_color *
-			                  ((material.shininess + 8.0f) / (8.0f * glm::pi<float>())),
-			.shininess = material.shininess,
-			.emissiveness = material.emissiveness,
-		};
-		model_uniform_buffer->assign(sizeof(ModelUniforms), &model_uniforms);
-		
-		gl::setVertexBuffer(model.mesh.vertexBuffer());
-		gl::setIndexBuffer(model.mesh.indexBuffer(), GL_UNSIGNED_INT);
+	glm::vec3 minimum = vertices.front().position;
+	glm::vec3 maximum = minimum;
 
-		gl::draw(model.mesh.count());
+	for (const auto& vertex : vertices) {
+		minimum = glm::min(minimum, vertex.position);
+		maximum = glm::max(maximum, vertex.position);
 	}
 
-	gl::endPass();
+	return {(minimum + maximum) * 0.5f, (maximum - minimum) * 0.5f};
 }
 
-Mesh Mesh::makeCube() {
+Mesh Mesh::makeCube(CommandList& commands) {
 	const Vertex vertices[] = {
 		// Front:
 		{{-0.5f, -0.5f, 0.5f}, {0.0f, 0.0f, 1.0f}, {0.0f, 1.0f}},
@@ -326,11 +2227,12 @@ Mesh Mesh::makeCube() {
 		23, 22, 21,
 	};
 	
-	return Mesh(std::span<const Vertex>(vertices),
+	return Mesh(commands,
+	            std::span<const Vertex>(vertices),
 	            std::span<const uint32_t>(indices));
 }
 
-Mesh Mesh::makePlane(glm::vec3 normal) {
+Mesh Mesh::makePlane(CommandList& commands, glm::vec3 normal) {
 	// TODO Use normal to construct plane
 	const Vertex vertices[] = {
 		{{-0.5f, 0.0f, 0.5f}, normal, {0.0f, 1.0f}},
@@ -341,8 +2243,84 @@ Mesh Mesh::makePlane(glm::vec3 normal) {
 
 	const uint32_t indices[] = {0, 1, 2, 3, 2, 1};
 
-	return Mesh(std::span<const Vertex>(vertices),
+	return Mesh(commands,
+	            std::span<const Vertex>(vertices),
 	            std::span<const uint32_t>(indices));
 }
 
+Mesh Mesh::makeSphere(CommandList& commands, uint32_t segments, uint32_t rings,
+                      uint32_t lod_count) {
+	assert(segments >= 3 && rings >= 2);
+
+	std::vector<Vertex> vertices;
+	vertices.reserve((segments + 1) * (rings + 1));
+
+	// The seam column and the pole rows repeat positions with other UVs
+	for (uint32_t ring = 0; ring <= rings; ++ring) {
+		float v = float(ring) / rings;
+		float phi = v * glm::pi<float>();
+
+		for (uint32_t segment = 0; segment <= segments; ++segment) {
+			float u = float(segment) / segments;
+			float theta = u * 2.0f * glm::pi<float>();
+
+			glm::vec3 normal{glm::sin(phi) * glm::cos(theta),
+			                 glm::cos(phi),
+			                 -glm::sin(phi) * glm::sin(theta)};
+
+			vertices.push_back({normal * 0.5f, normal, {u, v}});
+		}
+	}
+
+	std::vector<uint32_t> indices;
+	indices.reserve(segments * rings * 6);
+
+	for (uint32_t ring = 0; ring < rings; ++ring) {
+		for (uint32_t segment = 0; segment < segments; ++segment) {
+			uint32_t top = ring * (segments + 1) + segment;
+			uint32_t bottom = top + segments + 1;
+
+			// Triangles touching a pole would collapse to lines
+			if (ring != 0) {
+				indices.insert(indices.end(), {top, bottom, top + 1});
+			}
+
+			if (ring != rings - 1) {
+				indices.insert(indices.end(), {top + 1, bottom, bottom + 1});
+			}
+		}
+	}
+
+	return makeWithLods(commands, vertices, indices, lod_count);
+}
+
+Mesh Mesh::makeWithLods(CommandList& commands,
+                        const std::span<const Vertex> vertices,
+                        const std::span<const uint32_t> indices,
+                        uint32_t lod_count) {
+	std::vector<uint32_t> all_indices(indices.begin(), indices.end());
+	std::vector<MeshLod> lods{{0, uint32_t(indices.size()), 0.0f}};
+
+	// Every level is simplified from the full mesh, so errors are absolute
+	while (lods.size() < lod_count) {
+		uint32_t previous_count = lods.back().count;
+
+		float error;
+		auto level = simplify(vertices, indices, previous_count / 2, &error);
+
+		// Locked borders and seams can stop it well short of the target
+		if (level.size() > previous_count * 3 / 4) {
+			break;
+		}
+
+		lods.push_back({uint32_t(all_indices.size()), uint32_t(level.size()), error});
+		all_indices.insert(all_indices.end(), level.begin(), level.end());
+	}
+
+	return Mesh(commands,
+	            std::span<const Vertex>(vertices),
+	            std::span<const uint32_t>(all_indices),
+	            std::span<const MeshLod>(lods));
+}
+
 } // namespace glint::graphics
@@ -1,7 +1,10 @@
 #pragma once
 
 #include <cstdint>
+#include <functional>
 #include <span>
+#include <type_traits>
+#include <vector>
 
 #include <glm/ext/vector_float3.hpp>
 #include <glm/ext/quaternion_float.hpp>
@@ -10,6 +13,14 @@
 #include <glm/ext/matrix_clip_space.hpp>
 
 #include "graphics_gl.hpp"
+#include "graphics_commands.hpp"
+#include "graphics_geometry.hpp"
+#include "graphics_graph.hpp"
+#include "graphics_resources.hpp"
+
+namespace glint::scene {
+class Bvh;
+}
 
 namespace glint::graphics {
 
@@ -20,34 +31,171 @@ enum class RenderMode {
 	count,
 };
 
+enum class RenderPath {
+	forward,
+	deferred,
+};
+
+enum class SkyMode {
+	gradient,
+	atmosphere,
+};
+
+enum class UpscaleFilter {
+	bilinear,
+	// Bilinear, then sharpened less where neighbouring pixels already contrast
+	sharpened,
+};
+
 struct Vertex final {
 	glm::vec3 position;
 	glm::vec3 normal;
 	glm::vec2 uv;
 };
 
+// Axis-aligned box as center and half size
+struct Bounds final {
+	glm::vec3 center;
+	glm::vec3 extents;
+};
+
+// A level of detail, as a range of the mesh's indices. error is roughly how
+// far its surface strays from the full mesh, in model units.
+struct MeshLod final {
+	uint32_t offset;
+	uint32_t count;
+	float error;
+};
+
+// A cluster of at most 64 vertices and 124 triangles, laid out as the
+// culling shader reads it. The cone holds every triangle normal: seen from a
+// point p with dot(center - p, cone_axis) >= cone_cutoff * length(center - p)
+// + radius the whole cluster faces away. A cutoff of one never culls.
+struct Meshlet final {
+	glm::vec3 center;
+	float radius;
+	glm::vec3 cone_axis;
+	float cone_cutoff;
+	uint32_t vertex_offset;
+	uint32_t triangle_offset;
+	uint32_t vertex_count;
+	uint32_t triangle_count;
+};
+
+struct MeshletRange final {
+	uint32_t offset;
+	uint32_t count;
+};
+
+struct Meshlets;
+class PointCloud;
+class ParticleSystem;
+
+// Vertices and indices live in buffers shared by every mesh, from
+// baseVertex() and firstIndex() on, and may be moved between frames to
+// defragment them. Destroy meshes through their pool so their ranges stay
+// valid until the GPU is done with them. A position stream, a packed copy
+// of the positions from basePosition() on, lets depth-only passes fetch 12
+// bytes per vertex instead of 32. Construction records the uploads into
+// commands, so meshes may be created while another thread owns the context,
+// and drawn by whatever is recorded after.
 class Mesh final {
 public:
 	Mesh() = delete;
-	Mesh(const std::span<const Vertex> vertices,
-	     const std::span<const uint32_t> indices)
-	: vertex_buffer_(GL_ARRAY_BUFFER, GL_STATIC_DRAW,
-	                 vertices.size() * sizeof(Vertex), vertices.data()),
-	  index_buffer_(GL_ELEMENT_ARRAY_BUFFER, GL_STATIC_DRAW,
-	                indices.size() * sizeof(uint32_t), indices.data()),
-	  count_{static_cast<uint32_t>(indices.size())} {}
-
-	const gl::Buffer& vertexBuffer() const & noexcept { return vertex_buffer_; }
-	const gl::Buffer& indexBuffer() const & noexcept { return index_buffer_; }
+	Mesh(CommandList& commands,
+	     const std::span<const Vertex> vertices,
+	     const std::span<const uint32_t> indices,
+	     bool position_stream = true);
+
+	// indices holds every level, lods lists them from finest to coarsest
+	Mesh(CommandList& commands,
+	     const std::span<const Vertex> vertices,
+	     const std::span<const uint32_t> indices,
+	     const std::span<const MeshLod> lods,
+	     bool position_stream = true);
+
+	~Mesh();
+
+	Mesh(const Mesh&) = delete;
+	Mesh(Mesh&&) noexcept = delete;
+
+	Mesh& operator=(const Mesh&) = delete;
+	Mesh& operator=(Mesh&&) noexcept = delete;
+
+	const gl::Buffer& vertexBuffer() const & noexcept;
+	const gl::Buffer& indexBuffer() const & noexcept;
+	const gl::Buffer& positionBuffer() const & noexcept;
+	uint32_t baseVertex() const noexcept { return base_vertex_; }
+	uint32_t basePosition() const noexcept { return base_position_; }
+	bool hasPositionStream() const noexcept { return has_position_stream_; }
+	uint32_t firstIndex() const noexcept { return first_index_; }
+	uint32_t vertexCount() const noexcept { return vertex_count_; }
+	uint32_t indexCount() const noexcept { return index_count_; }
 	uint32_t count() const { return count_; }
+	const Bounds& bounds() const noexcept { return bounds_; }
+	std::span<const MeshLod> lods() const noexcept { return lods_; }
+
+	// Meshlets of every level as storage buffers, see graphics_meshlets.hpp
+	const gl::Buffer& meshletBuffer() const & noexcept { return meshlet_buffer_.get(); }
+	const gl::Buffer& meshletDataBuffer() const & noexcept { return meshlet_data_buffer_.get(); }
+	size_t meshletBytes() const noexcept {
+		return meshlet_buffer_.size() + meshlet_data_buffer_.size();
+	}
+	std::span<const MeshletRange> meshletLods() const noexcept { return meshlet_lods_; }
+
+	// Low-poly stand-in drawn into the CPU occlusion buffer in place of the
+	// mesh, so it must not reach outside it. Meshes without one occlude nothing.
+	void setOccluder(const std::span<const glm::vec3> positions,
+	                 const std::span<const uint32_t> indices);
+	std::span<const glm::vec3> occluderPositions() const noexcept { return occluder_positions_; }
+	std::span<const uint32_t> occluderIndices() const noexcept { return occluder_indices_; }
+
+	// For meshes rewritten on the GPU every frame, such as skinning targets.
+	// Their meshlets no longer fit them, so they are always drawn whole, and
+	// bounds replaces the bind pose's to hold every shape they take.
+	void setDeforming(const Bounds& bounds);
+	bool deforming() const noexcept { return deforming_; }
+
+	static Mesh makeCube(CommandList& commands);
+	static Mesh makePlane(CommandList& commands, glm::vec3 normal);
+	static Mesh makeSphere(CommandList& commands, uint32_t segments, uint32_t rings,
+	                       uint32_t lod_count = 1);
 
-	static Mesh makeCube();
-	static Mesh makePlane(glm::vec3 normal);
+	// Adds up to lod_count - 1 simplified levels, each with about half the
+	// triangles of the one before
+	static Mesh makeWithLods(CommandList& commands,
+	                         const std::span<const Vertex> vertices,
+	                         const std::span<const uint32_t> indices,
+	                         uint32_t lod_count = 4);
 
 private:
-	gl::Buffer vertex_buffer_;
-	gl::Buffer index_buffer_;
+	Mesh(CommandList& commands,
+	     const std::span<const Vertex> vertices,
+	     const std::span<const uint32_t> indices,
+	     const std::span<const MeshLod> lods,
+	     const Meshlets& meshlets,
+	     bool position_stream);
+
+	static Bounds calculateBounds(const std::span<const Vertex> vertices);
+
+	uint32_t vertex_count_;
+	uint32_t index_count_;
+	uint32_t base_vertex_;
+	uint32_t first_index_;
+	uint32_t base_position_ = 0;
+	bool has_position_stream_;
 	uint32_t count_;
+	Bounds bounds_;
+	std::vector<MeshLod> lods_;
+
+	GrowableBuffer meshlet_buffer_;
+	GrowableBuffer meshlet_data_buffer_;
+	std::vector<MeshletRange> meshlet_lods_;
+
+	std::vector<glm::vec3> occluder_positions_;
+	std::vector<uint32_t> occluder_indices_;
+
+	bool deforming_ = false;
 };
 
 struct Material final {
@@ -56,16 +204,24 @@ struct Material final {
 	glm::vec3 specular_color = glm::vec3(0.0f);
 	float shininess = 1.0f;
 	float emissiveness = 0.0f;
-	const gl::Sampler* texture_sampler = nullptr;
-	const gl::Texture* albedo_texture = nullptr;
+	SamplerHandle texture_sampler = {};
+	TextureHandle albedo_texture = {};
 };
 
+// Slot of a material's parameters in the scene's material table
+using MaterialSlot = uint32_t;
+
+// Slot of a model's transform and material slot in the scene buffer
+using Instance = uint32_t;
+
 struct Model final {
-	const Mesh& mesh;
-	const Material& material;
-	glm::mat4 transform;
+	MeshHandle mesh;
+	const Material* material;
+	Instance instance;
 };
 
+static_assert(std::is_trivially_copyable_v<Model>);
+
 struct Light final {
 	glm::vec3 position;
 	float size;
@@ -114,8 +270,125 @@ struct Camera final {
 void setup();
 void shutdown();
 
-void render(const std::span<const Model> models,
+void setRenderPath(RenderPath path);
+RenderPath renderPath();
+
+// Splits camera draws into meshlets culled on the GPU by frustum, normal cone
+// and, on the deferred path, last frame's depth, then draws what survives
+// indirectly. Shadows still draw whole levels.
+void setClusterCulling(bool enabled);
+bool clusterCulling();
+
+// Tests camera draws against the occluder meshes nearest the camera, drawn
+// at low resolution on the CPU before the draw lists are built, see
+// scene_occlusion.hpp. Models whose box is hidden behind them are skipped.
+void setOcclusionCulling(bool enabled);
+bool occlusionCulling();
+
+struct OcclusionUsage final {
+	uint32_t occluders = 0;
+	uint32_t triangles = 0;
+	uint32_t occluded_models = 0;
+};
+
+// Of the last frame
+OcclusionUsage occlusionUsage();
+
+// The sky is drawn after opaque geometry, only where nothing else was. The
+// atmosphere is looked up from a table of scattered sunlight baked at setup,
+// one texture fetch per pixel.
+void setSkyMode(SkyMode mode);
+SkyMode skyMode();
+
+// The cloud is splatted by compute passes, at most budget points a frame, and
+// drawn over opaque geometry with depth testing. It is not owned and must
+// outlive the frames drawing it; null, the default, draws none.
+void setPointCloud(PointCloud* cloud);
+PointCloud* pointCloud();
+
+// The system is simulated and drawn over opaque geometry every frame, with
+// its particles bouncing off the scene on the deferred path. It is not owned
+// and must outlive the frames drawing it; null, the default, draws none.
+void setParticleSystem(ParticleSystem* system);
+ParticleSystem* particleSystem();
+
+void setPointBudget(uint64_t points);
+uint64_t pointBudget();
+
+// Shared vertex, index and position buffers every mesh is sub-allocated
+// from, counted in elements. render() moves a bounded amount of geometry per
+// frame while either has holes.
+struct GeometryUsage final {
+	GeometryStatistics vertices;
+	GeometryStatistics indices;
+	GeometryStatistics positions;
+};
+
+GeometryUsage geometryUsage();
+
+// render() declares its passes into a render graph every frame, which culls
+// the ones nothing drawn depends on and aliases their transient targets
+GraphStatistics renderGraphStatistics();
+
+// Draws the estimated GPU memory per category as a bar over the frame, see
+// memoryStatistics()
+void setMemoryOverlay(bool enabled);
+bool memoryOverlay();
+
+// Below a scale of one, or with dynamic resolution, the scene is drawn
+// offscreen at that fraction of the viewport on each axis and upscaled to the
+// screen, and overlays are drawn over the upscaled frame at full resolution.
+void setResolutionScale(float scale);
+// Of the last frame
+float resolutionScale();
+
+// The scale follows the GPU frame time the profiler measures, stepping down
+// when it exceeds the target and back up when there is room for the next
+// step. A target of zero, the default, holds the scale set.
+struct DynamicResolution final {
+	// Milliseconds
+	float target_gpu_time = 0.0f;
+	float minimum_scale = 0.5f;
+};
+
+void setDynamicResolution(const DynamicResolution& resolution);
+const DynamicResolution& dynamicResolution();
+
+void setUpscaleFilter(UpscaleFilter filter);
+UpscaleFilter upscaleFilter();
+
+// Material parameters are registered once into a storage buffer that every
+// instance indexes; render() only uploads the slots changed since the last
+// frame. The parameters are copied, so edits to a material need
+// updateMaterial(). Slots of unregistered materials are reused, so no
+// instance may still refer to one.
+MaterialSlot registerMaterial(const Material& material);
+void unregisterMaterial(MaterialSlot slot);
+void updateMaterial(MaterialSlot slot, const Material& material);
+
+// Instances live in a storage buffer that persists across frames; render()
+// only uploads the ones changed since the last frame. Handles of destroyed
+// instances are reused.
+Instance createInstance(const glm::mat4& transform, MaterialSlot material);
+void destroyInstance(Instance instance);
+
+void setInstanceTransform(Instance instance, const glm::mat4& transform);
+void setInstanceMaterial(Instance instance, MaterialSlot material);
+const glm::mat4& instanceTransform(Instance instance);
+
+// Records the frame into commands, nothing reaches GL until they are executed.
+// Culling and draw packing are spread over the job workers. A BVH built over
+// the models' world boxes, item i being models[i], replaces the linear culling.
+// Resources destroyed before the call are released once the GPU has passed
+// the frame.fence() closing it. overlay records into the pass drawing to the
+// screen, after everything else, such as utils batches.
+using Overlay = std::function<void(CommandList& commands)>;
+
+void render(CommandList& commands,
+            const std::span<const Model> models,
             const Camera& camera,
-            const std::span<const Light> lights);
+            const std::span<const Light> lights,
+            const scene::Bvh* bvh = nullptr,
+            const Overlay& overlay = {});
 
 } // namespace glint::graphics
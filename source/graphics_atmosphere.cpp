@@ -0,0 +1,144 @@
+#include "graphics_atmosphere.hpp"
+
+#include <cassert>
+#include <cmath>
+#include <numbers>
+#include <algorithm>
+
+#include <glm/geometric.hpp>
+#include <glm/exponential.hpp>
+
+namespace glint::graphics {
+
+namespace {
+
+// Earth-like, in meters
+constexpr float planet_radius = 6360e3f;
+constexpr float atmosphere_radius = 6420e3f;
+constexpr float viewer_height = 200.0f;
+
+constexpr float rayleigh_height = 8e3f;
+constexpr float mie_height = 1.2e3f;
+const glm::vec3 rayleigh_scattering(5.8e-6f, 13.5e-6f, 33.1e-6f);
+constexpr float mie_scattering = 21e-6f;
+constexpr float mie_extinction = mie_scattering * 1.1f;
+constexpr float mie_asymmetry = 0.76f;
+
+constexpr float sun_intensity = 20.0f;
+
+constexpr uint32_t view_steps = 32;
+constexpr uint32_t sun_steps = 8;
+
+// Distance along a ray from inside a sphere centered on the origin to where
+// it leaves, or a negative value when it never reaches it going forwards
+float intersectSphere(const glm::vec3& origin, const glm::vec3& direction, float radius) {
+	const float b = glm::dot(origin, direction);
+	const float c = glm::dot(origin, origin) - radius * radius;
+	const float discriminant = b * b - c;
+
+	if (discriminant < 0.0f) {
+		return -1.0f;
+	}
+
+	const float root = std::sqrt(discriminant);
+	return -b - root > 0.0f ? -b - root : -b + root;
+}
+
+glm::vec2 density(const glm::vec3& point) {
+	const float height = std::max(glm::length(point) - planet_radius, 0.0f);
+	return {std::exp(-height / rayleigh_height), std::exp(-height / mie_height)};
+}
+
+glm::vec3 extinction(const glm::vec2& optical_depth) {
+	return glm::exp(-(rayleigh_scattering * optical_depth.x + mie_extinction * optical_depth.y));
+}
+
+glm::vec3 scatter(const glm::vec3& direction, const glm::vec3& sun_direction) {
+	const glm::vec3 origin(0.0f, planet_radius + viewer_height, 0.0f);
+
+	float length = intersectSphere(origin, direction, atmosphere_radius);
+	const float ground = intersectSphere(origin, direction, planet_radius);
+	if (ground > 0.0f) {
+		length = ground;
+	}
+
+	const float step = length / view_steps;
+
+	glm::vec2 view_depth(0.0f);
+	glm::vec3 rayleigh(0.0f);
+	glm::vec3 mie(0.0f);
+
+	for (uint32_t i = 0; i < view_steps; ++i) {
+		const glm::vec3 point = origin + direction * ((float(i) + 0.5f) * step);
+		const glm::vec2 local = density(point) * step;
+		view_depth += local;
+
+		// Points in the planet's shadow see no sun
+		if (intersectSphere(point, sun_direction, planet_radius) > 0.0f) {
+			continue;
+		}
+
+		const float sun_step = intersectSphere(point, sun_direction, atmosphere_radius) / sun_steps;
+
+		glm::vec2 sun_depth(0.0f);
+		for (uint32_t j = 0; j < sun_steps; ++j) {
+			sun_depth += density(point + sun_direction * ((float(j) + 0.5f) * sun_step)) * sun_step;
+		}
+
+		const glm::vec3 transmittance = extinction(view_depth + sun_depth);
+		rayleigh += transmittance * local.x;
+		mie += transmittance * local.y;
+	}
+
+	const float mu = glm::dot(direction, sun_direction);
+	const float rayleigh_phase = 3.0f / (16.0f * std::numbers::pi_v<float>) * (1.0f + mu * mu);
+
+	const float g = mie_asymmetry;
+	const float mie_phase = 3.0f / (8.0f * std::numbers::pi_v<float>) *
+	                        ((1.0f - g * g) * (1.0f + mu * mu)) /
+	                        ((2.0f + g * g) * std::pow(1.0f + g * g - 2.0f * g * mu, 1.5f));
+
+	return sun_intensity * (rayleigh * rayleigh_scattering * rayleigh_phase +
+	                        mie * mie_scattering * mie_phase);
+}
+
+} // namespace
+
+std::vector<uint8_t> computeSkyLut(const glm::vec3& sun_direction,
+                                   uint32_t width, uint32_t height) {
+	assert(width != 0 && height != 0);
+
+	constexpr float half_pi = std::numbers::pi_v<float> * 0.5f;
+
+	const glm::vec3 sun = glm::normalize(sun_direction);
+	const float sun_elevation = std::asin(std::clamp(sun.y, -1.0f, 1.0f));
+	const glm::vec3 towards_sun(std::cos(sun_elevation), std::sin(sun_elevation), 0.0f);
+
+	std::vector<uint8_t> texels(size_t(width) * height * 4);
+
+	for (uint32_t y = 0; y < height; ++y) {
+		const float v = (float(y) + 0.5f) / float(height) * 2.0f - 1.0f;
+		const float elevation = v * std::abs(v) * half_pi;
+
+		for (uint32_t x = 0; x < width; ++x) {
+			const float azimuth = (float(x) + 0.5f) / float(width) * std::numbers::pi_v<float>;
+
+			const glm::vec3 direction(std::cos(elevation) * std::cos(azimuth),
+			                          std::sin(elevation),
+			                          std::cos(elevation) * std::sin(azimuth));
+
+			const glm::vec3 color = glm::pow(1.0f - glm::exp(-scatter(direction, towards_sun)),
+			                                 glm::vec3(1.0f / 2.2f));
+
+			uint8_t* texel = &texels[(size_t(y) * width + x) * 4];
+			for (int c = 0; c < 3; ++c) {
+				texel[c] = uint8_t(std::clamp(color[c], 0.0f, 1.0f) * 255.0f + 0.5f);
+			}
+			texel[3] = 255;
+		}
+	}
+
+	return texels;
+}
+
+} // namespace glint::graphics
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/vec3.hpp>
+
+namespace glint::graphics {
+
+// Single scattering of sunlight, Rayleigh and Mie, seen from just above the
+// ground, tonemapped into RGBA8 texels. Columns run from looking towards the
+// sun to looking away from it, rows from straight down to straight up with
+// elevation growing with the square of the distance from the middle row, so
+// the horizon gets most of them. sun_direction points towards the sun.
+std::vector<uint8_t> computeSkyLut(const glm::vec3& sun_direction,
+                                   uint32_t width, uint32_t height);
+
+} // namespace glint::graphics
@@ -0,0 +1,420 @@
+#include "graphics_commands.hpp"
+
+#include <cassert>
+#include <cstring>
+#include <new>
+#include <type_traits>
+
+#include "profiler.hpp"
+
+namespace glint::graphics {
+
+namespace {
+
+enum class CommandType : uint32_t {
+	begin_pass,
+	end_pass,
+	set_pipeline,
+	set_vertex_buffer,
+	set_index_buffer,
+	set_uniform_buffer,
+	set_storage_buffer,
+	set_texture,
+	set_image,
+	set_uniform,
+	assign,
+	copy,
+	draw,
+	draw_instanced,
+	draw_indirect,
+	set_compute_pipeline,
+	dispatch,
+	dispatch_indirect,
+	memory_barrier,
+	call,
+	begin_scope,
+	end_scope,
+};
+
+// Every record starts with a header and is padded so the next one stays aligned
+struct alignas(16) CommandHeader {
+	CommandType type;
+	uint32_t size;
+};
+
+struct BeginPassCommand {
+	const gl::Framebuffer* framebuffer;
+	gl::LoadActions actions;
+};
+
+struct EndPassCommand {
+	gl::StoreActions actions;
+};
+
+struct SetPipelineCommand {
+	const gl::Pipeline* pipeline;
+};
+
+struct SetBufferCommand {
+	const gl::Buffer* buffer;
+	uint32_t binding;
+	GLenum index_type;
+	uintptr_t offset;
+	GLsizei stride;
+};
+
+struct SetTextureCommand {
+	const gl::Texture* texture;
+	const gl::Sampler* sampler;
+	uint32_t binding;
+};
+
+struct SetImageCommand {
+	const gl::Texture* texture;
+	uint32_t binding;
+	uint32_t level;
+	GLenum access;
+};
+
+struct SetUniformCommand {
+	int32_t location;
+	uint32_t value;
+};
+
+// Followed by size bytes of data
+struct AssignCommand {
+	gl::Buffer* buffer;
+	size_t size;
+	uintptr_t offset;
+};
+
+struct CopyCommand {
+	gl::Buffer* buffer;
+	const gl::Buffer* source;
+	size_t size;
+	uintptr_t source_offset;
+	uintptr_t offset;
+};
+
+struct DrawCommand {
+	uint32_t instances;
+	uint32_t count;
+	uint32_t offset;
+};
+
+// Draws and dispatches alike
+struct IndirectCommand {
+	const gl::Buffer* commands;
+	uintptr_t offset;
+};
+
+struct SetComputePipelineCommand {
+	const gl::ComputePipeline* pipeline;
+};
+
+struct DispatchCommand {
+	uint32_t x;
+	uint32_t y;
+	uint32_t z;
+};
+
+struct MemoryBarrierCommand {
+	GLbitfield barriers;
+};
+
+struct CallCommand {
+	void (*function)(uint64_t);
+	uint64_t argument;
+};
+
+struct ScopeCommand {
+	const char* name;
+};
+
+template<typename T>
+T& record(std::vector<std::byte>& arena, CommandType type, size_t payload = 0) {
+	static_assert(std::is_trivially_copyable_v<T> && std::is_trivially_destructible_v<T>);
+	static_assert(alignof(T) <= alignof(CommandHeader));
+
+	size_t size = sizeof(CommandHeader) + sizeof(T) + payload;
+	size = (size + alignof(CommandHeader) - 1) & ~(alignof(CommandHeader) - 1);
+
+	size_t offset = arena.size();
+	arena.resize(offset + size);
+
+	std::byte* bytes = arena.data() + offset;
+	new (bytes) CommandHeader{type, static_cast<uint32_t>(size)};
+
+	return *new (bytes + sizeof(CommandHeader)) T{};
+}
+
+template<typename T>
+const T& payload(const std::byte* header) {
+	return *std::launder(reinterpret_cast<const T*>(header + sizeof(CommandHeader)));
+}
+
+} // namespace
+
+void CommandList::beginPass(const gl::Framebuffer& framebuffer, const gl::LoadActions& actions) {
+	auto& command = record<BeginPassCommand>(arena_, CommandType::begin_pass);
+	command.framebuffer = &framebuffer;
+	command.actions = actions;
+}
+
+void CommandList::endPass(const gl::StoreActions& actions) {
+	auto& command = record<EndPassCommand>(arena_, CommandType::end_pass);
+	command.actions = actions;
+}
+
+void CommandList::setPipeline(const gl::Pipeline& pipeline) {
+	auto& command = record<SetPipelineCommand>(arena_, CommandType::set_pipeline);
+	command.pipeline = &pipeline;
+}
+
+void CommandList::setVertexBuffer(const gl::Buffer& buffer, uintptr_t offset, uint32_t binding,
+                                  GLsizei stride) {
+	auto& command = record<SetBufferCommand>(arena_, CommandType::set_vertex_buffer);
+	command.buffer = &buffer;
+	command.offset = offset;
+	command.binding = binding;
+	command.stride = stride;
+}
+
+void CommandList::setIndexBuffer(const gl::Buffer& buffer, GLenum index_type) {
+	auto& command = record<SetBufferCommand>(arena_, CommandType::set_index_buffer);
+	command.buffer = &buffer;
+	command.index_type = index_type;
+}
+
+void CommandList::setUniformBuffer(const gl::Buffer& buffer, uint32_t binding) {
+	auto& command = record<SetBufferCommand>(arena_, CommandType::set_uniform_buffer);
+	command.buffer = &buffer;
+	command.binding = binding;
+}
+
+void CommandList::setStorageBuffer(const gl::Buffer& buffer, uint32_t binding) {
+	auto& command = record<SetBufferCommand>(arena_, CommandType::set_storage_buffer);
+	command.buffer = &buffer;
+	command.binding = binding;
+}
+
+void CommandList::setTexture(const gl::Texture& texture, const gl::Sampler& sampler,
+                             uint32_t binding) {
+	auto& command = record<SetTextureCommand>(arena_, CommandType::set_texture);
+	command.texture = &texture;
+	command.sampler = &sampler;
+	command.binding = binding;
+}
+
+void CommandList::setImage(const gl::Texture& texture, uint32_t binding, uint32_t level,
+                           GLenum access) {
+	auto& command = record<SetImageCommand>(arena_, CommandType::set_image);
+	command.texture = &texture;
+	command.binding = binding;
+	command.level = level;
+	command.access = access;
+}
+
+void CommandList::setUniform(int32_t location, uint32_t value) {
+	auto& command = record<SetUniformCommand>(arena_, CommandType::set_uniform);
+	command.location = location;
+	command.value = value;
+}
+
+void CommandList::assign(gl::Buffer& buffer, size_t size, const void* data, uintptr_t offset) {
+	assert(data != nullptr);
+
+	auto& command = record<AssignCommand>(arena_, CommandType::assign, size);
+	command.buffer = &buffer;
+	command.size = size;
+	command.offset = offset;
+
+	std::memcpy(&command + 1, data, size);
+}
+
+void CommandList::copy(gl::Buffer& buffer, const gl::Buffer& source, size_t size,
+                       uintptr_t source_offset, uintptr_t offset) {
+	auto& command = record<CopyCommand>(arena_, CommandType::copy);
+	command.buffer = &buffer;
+	command.source = &source;
+	command.size = size;
+	command.source_offset = source_offset;
+	command.offset = offset;
+}
+
+void CommandList::draw(uint32_t count, uint32_t offset) {
+	auto& command = record<DrawCommand>(arena_, CommandType::draw);
+	command.count = count;
+	command.offset = offset;
+}
+
+void CommandList::drawInstanced(uint32_t instances, uint32_t count, uint32_t offset) {
+	auto& command = record<DrawCommand>(arena_, CommandType::draw_instanced);
+	command.instances = instances;
+	command.count = count;
+	command.offset = offset;
+}
+
+void CommandList::drawIndirect(const gl::Buffer& commands, uintptr_t offset) {
+	auto& command = record<IndirectCommand>(arena_, CommandType::draw_indirect);
+	command.commands = &commands;
+	command.offset = offset;
+}
+
+void CommandList::setComputePipeline(const gl::ComputePipeline& pipeline) {
+	auto& command = record<SetComputePipelineCommand>(arena_, CommandType::set_compute_pipeline);
+	command.pipeline = &pipeline;
+}
+
+void CommandList::dispatch(uint32_t x, uint32_t y, uint32_t z) {
+	auto& command = record<DispatchCommand>(arena_, CommandType::dispatch);
+	command.x = x;
+	command.y = y;
+	command.z = z;
+}
+
+void CommandList::dispatchIndirect(const gl::Buffer& commands, uintptr_t offset) {
+	auto& command = record<IndirectCommand>(arena_, CommandType::dispatch_indirect);
+	command.commands = &commands;
+	command.offset = offset;
+}
+
+void CommandList::memoryBarrier(GLbitfield barriers) {
+	auto& command = record<MemoryBarrierCommand>(arena_, CommandType::memory_barrier);
+	command.barriers = barriers;
+}
+
+void CommandList::call(void (*function)(uint64_t), uint64_t argument) {
+	auto& command = record<CallCommand>(arena_, CommandType::call);
+	command.function = function;
+	command.argument = argument;
+}
+
+void CommandList::beginScope(const char* name) {
+	auto& command = record<ScopeCommand>(arena_, CommandType::begin_scope);
+	command.name = name;
+}
+
+void CommandList::endScope() {
+	record<ScopeCommand>(arena_, CommandType::end_scope);
+}
+
+void CommandList::execute() const {
+	const std::byte* bytes = arena_.data();
+	const std::byte* end = bytes + arena_.size();
+
+	while (bytes != end) {
+		const auto& header = *std::launder(reinterpret_cast<const CommandHeader*>(bytes));
+
+		switch (header.type) {
+			case CommandType::begin_pass: {
+				const auto& command = payload<BeginPassCommand>(bytes);
+				gl::beginPass(*command.framebuffer, command.actions);
+			} break;
+
+			case CommandType::end_pass:
+				gl::endPass(payload<EndPassCommand>(bytes).actions);
+				break;
+
+			case CommandType::set_pipeline:
+				gl::setPipeline(*payload<SetPipelineCommand>(bytes).pipeline);
+				break;
+
+			case CommandType::set_vertex_buffer: {
+				const auto& command = payload<SetBufferCommand>(bytes);
+				gl::setVertexBuffer(*command.buffer, command.offset, command.binding, command.stride);
+			} break;
+
+			case CommandType::set_index_buffer: {
+				const auto& command = payload<SetBufferCommand>(bytes);
+				gl::setIndexBuffer(*command.buffer, command.index_type);
+			} break;
+
+			case CommandType::set_uniform_buffer: {
+				const auto& command = payload<SetBufferCommand>(bytes);
+				gl::setUniformBuffer(*command.buffer, command.binding);
+			} break;
+
+			case CommandType::set_storage_buffer: {
+				const auto& command = payload<SetBufferCommand>(bytes);
+				gl::setStorageBuffer(*command.buffer, command.binding);
+			} break;
+
+			case CommandType::set_texture: {
+				const auto& command = payload<SetTextureCommand>(bytes);
+				gl::setTexture(*command.texture, *command.sampler, command.binding);
+			} break;
+
+			case CommandType::set_image: {
+				const auto& command = payload<SetImageCommand>(bytes);
+				gl::setImage(*command.texture, command.binding, command.level, command.access);
+			} break;
+
+			case CommandType::set_uniform: {
+				const auto& command = payload<SetUniformCommand>(bytes);
+				gl::setUniform(command.location, command.value);
+			} break;
+
+			case CommandType::assign: {
+				const auto& command = payload<AssignCommand>(bytes);
+				command.buffer->assign(command.size, &command + 1, command.offset);
+			} break;
+
+			case CommandType::copy: {
+				const auto& command = payload<CopyCommand>(bytes);
+				command.buffer->copy(*command.source, command.size, command.source_offset,
+				                     command.offset);
+			} break;
+
+			case CommandType::draw: {
+				const auto& command = payload<DrawCommand>(bytes);
+				gl::draw(command.count, command.offset);
+			} break;
+
+			case CommandType::draw_instanced: {
+				const auto& command = payload<DrawCommand>(bytes);
+				gl::drawInstanced(command.instances, command.count, command.offset);
+			} break;
+
+			case CommandType::draw_indirect: {
+				const auto& command = payload<IndirectCommand>(bytes);
+				gl::drawIndirect(*command.commands, command.offset);
+			} break;
+
+			case CommandType::set_compute_pipeline:
+				gl::setComputePipeline(*payload<SetComputePipelineCommand>(bytes).pipeline);
+				break;
+
+			case CommandType::dispatch: {
+				const auto& command = payload<DispatchCommand>(bytes);
+				gl::dispatch(command.x, command.y, command.z);
+			} break;
+
+			case CommandType::dispatch_indirect: {
+				const auto& command = payload<IndirectCommand>(bytes);
+				gl::dispatchIndirect(*command.commands, command.offset);
+			} break;
+
+			case CommandType::memory_barrier:
+				gl::memoryBarrier(payload<MemoryBarrierCommand>(bytes).barriers);
+				break;
+
+			case CommandType::call: {
+				const auto& command = payload<CallCommand>(bytes);
+				command.function(command.argument);
+			} break;
+
+			case CommandType::begin_scope:
+				profiler::begin(payload<ScopeCommand>(bytes).name);
+				break;
+
+			case CommandType::end_scope:
+				profiler::end();
+				break;
+		}
+
+		bytes += header.size;
+	}
+}
+
+} // namespace glint::graphics
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+#include "graphics_gl.hpp"
+
+namespace glint::graphics {
+
+// Records gl calls as plain records in a linear arena, to be replayed by
+// whichever thread owns the context. Objects are referenced, not copied,
+// so they must outlive execution; data passed to assign() is copied.
+class CommandList final {
+public:
+	CommandList() = default;
+	~CommandList() = default;
+
+	CommandList(const CommandList&) = delete;
+	CommandList(CommandList&&) noexcept = delete;
+
+	CommandList& operator=(const CommandList&) = delete;
+	CommandList& operator=(CommandList&&) noexcept = delete;
+
+	void beginPass(const gl::Framebuffer& framebuffer, const gl::LoadActions& actions = {});
+	void endPass(const gl::StoreActions& actions = {});
+
+	void setPipeline(const gl::Pipeline&);
+	void setVertexBuffer(const gl::Buffer&, uintptr_t offset = 0, uint32_t binding = 0,
+	                     GLsizei stride = 0);
+	void setIndexBuffer(const gl::Buffer&, GLenum index_type);
+	void setUniformBuffer(const gl::Buffer&, uint32_t binding);
+	void setStorageBuffer(const gl::Buffer&, uint32_t binding);
+	void setTexture(const gl::Texture&, const gl::Sampler&, uint32_t binding);
+	void setImage(const gl::Texture&, uint32_t binding, uint32_t level, GLenum access);
+	void setUniform(int32_t location, uint32_t value);
+
+	void assign(gl::Buffer& buffer, size_t size, const void* data, uintptr_t offset = 0);
+	void copy(gl::Buffer& buffer, const gl::Buffer& source, size_t size,
+	          uintptr_t source_offset, uintptr_t offset);
+
+	void draw(uint32_t count, uint32_t offset = 0);
+	void drawInstanced(uint32_t instances, uint32_t count, uint32_t offset = 0);
+	void drawIndirect(const gl::Buffer& commands, uintptr_t offset = 0);
+
+	void setComputePipeline(const gl::ComputePipeline&);
+	void dispatch(uint32_t x, uint32_t y = 1, uint32_t z = 1);
+	void dispatchIndirect(const gl::Buffer& commands, uintptr_t offset = 0);
+	void memoryBarrier(GLbitfield barriers);
+
+	// Runs function on the executing thread, in order with the gl calls
+	void call(void (*function)(uint64_t), uint64_t argument);
+
+	// Profiler scopes, timed while the list executes
+	void beginScope(const char* name);
+	void endScope();
+
+	void execute() const;
+	void clear() noexcept { arena_.clear(); }
+
+	bool empty() const noexcept { return arena_.empty(); }
+	size_t size() const noexcept { return arena_.size(); }
+
+private:
+	std::vector<std::byte> arena_;
+};
+
+} // namespace glint::graphics
@@ -0,0 +1,200 @@
+#include "graphics_geometry.hpp"
+
+#include <cassert>
+#include <algorithm>
+
+#include "graphics_commands.hpp"
+#include "graphics_resources.hpp"
+
+namespace glint::graphics {
+
+GeometryArena::GeometryArena(GLenum type, uint32_t stride, uint32_t capacity)
+: stride_{stride},
+  capacity_{capacity},
+  buffer_(type, GL_DYNAMIC_DRAW, gl::MemoryCategory::mesh, size_t(capacity) * stride) {
+	assert(stride != 0 && capacity != 0);
+	insertFree(0, capacity);
+}
+
+// Retired ranges must have been released already
+GeometryArena::~GeometryArena() = default;
+
+void GeometryArena::allocate(CommandList& commands, uint32_t count, const void* data,
+                             uint32_t* offset) {
+	assert(count != 0 && data != nullptr && offset != nullptr);
+
+	std::lock_guard lock(mutex_);
+
+	uint32_t first = take(count);
+	if (first == no_offset) {
+		grow(commands, count);
+		first = take(count);
+	}
+
+	ranges_.emplace(first, Range{count, offset});
+	used_ += count;
+	*offset = first;
+
+	commands.assign(buffer_.get(), size_t(count) * stride_, data, uintptr_t(first) * stride_);
+}
+
+void GeometryArena::free(uint32_t offset) {
+	std::lock_guard lock(mutex_);
+	release(offset);
+}
+
+uint32_t GeometryArena::defragment(CommandList& commands, uint32_t max_elements) {
+	std::lock_guard lock(mutex_);
+
+	uint32_t moved = 0;
+	uint32_t cursor = capacity_;
+
+	while (moved < max_elements && !free_.empty()) {
+		auto range = ranges_.lower_bound(cursor);
+		if (range == ranges_.begin()) {
+			break;
+		}
+
+		--range;
+		cursor = range->first;
+
+		// Nothing below the first free block can move any lower
+		if (cursor < free_.begin()->first) {
+			break;
+		}
+
+		auto [count, owner] = range->second;
+		if (owner == nullptr || moved + count > max_elements) {
+			continue;
+		}
+
+		// Lowest block that fits, so ranges pack towards the start
+		auto block = std::find_if(free_.begin(), free_.lower_bound(cursor),
+		                          [&](const auto& entry) { return entry.second >= count; });
+		if (block == free_.lower_bound(cursor)) {
+			continue;
+		}
+
+		const uint32_t destination = block->first;
+		const uint32_t remaining = block->second - count;
+		eraseFree(block);
+
+		if (remaining != 0) {
+			insertFree(destination + count, remaining);
+		}
+
+		commands.copy(buffer_.get(), buffer_.get(), size_t(count) * stride_,
+		              uintptr_t(cursor) * stride_, uintptr_t(destination) * stride_);
+
+		range->second.owner = nullptr;
+		retiring_ += count;
+		detail::retire(&GeometryArena::releaseRange, this, cursor);
+
+		ranges_.emplace(destination, Range{count, owner});
+		used_ += count;
+		*owner = destination;
+
+		moved += count;
+	}
+
+	return moved;
+}
+
+bool GeometryArena::fragmented() const {
+	std::lock_guard lock(mutex_);
+
+	return free_.size() > 1 ||
+	       (free_.size() == 1 && free_.begin()->first + free_.begin()->second != capacity_);
+}
+
+GeometryStatistics GeometryArena::statistics() const {
+	std::lock_guard lock(mutex_);
+
+	return {
+		.capacity = capacity_,
+		.used = used_,
+		.retiring = retiring_,
+		.ranges = uint32_t(ranges_.size()),
+		.free_blocks = uint32_t(free_.size()),
+		.largest_free_block = free_by_size_.empty() ? 0 : free_by_size_.rbegin()->first,
+	};
+}
+
+uint32_t GeometryArena::take(uint32_t count) {
+	auto fit = free_by_size_.lower_bound({count, 0});
+	if (fit == free_by_size_.end()) {
+		return no_offset;
+	}
+
+	const auto [size, offset] = *fit;
+	eraseFree(free_.find(offset));
+
+	if (size > count) {
+		insertFree(offset + count, size - count);
+	}
+
+	return offset;
+}
+
+void GeometryArena::insertFree(uint32_t offset, uint32_t count) {
+	auto next = free_.lower_bound(offset);
+
+	if (next != free_.end() && offset + count == next->first) {
+		count += next->second;
+		eraseFree(next);
+	}
+
+	next = free_.lower_bound(offset);
+	if (next != free_.begin()) {
+		auto previous = std::prev(next);
+		if (previous->first + previous->second == offset) {
+			offset = previous->first;
+			count += previous->second;
+			eraseFree(previous);
+		}
+	}
+
+	free_.emplace(offset, count);
+	free_by_size_.emplace(count, offset);
+}
+
+void GeometryArena::eraseFree(std::map<uint32_t, uint32_t>::iterator block) {
+	free_by_size_.erase({block->second, block->first});
+	free_.erase(block);
+}
+
+void GeometryArena::release(uint32_t offset) {
+	auto range = ranges_.find(offset);
+	assert(range != ranges_.end());
+
+	const uint32_t count = range->second.count;
+	if (range->second.owner == nullptr) {
+		retiring_ -= count;
+	}
+
+	used_ -= count;
+	ranges_.erase(range);
+	insertFree(offset, count);
+}
+
+// The outgrown buffer is retired by reserve(), so it lives on until the
+// copy out of it and the frames in flight that read it are done
+void GeometryArena::grow(CommandList& commands, uint32_t count) {
+	const uint32_t capacity = std::max(capacity_ * 2, capacity_ + count);
+	const gl::Buffer& outgrown = buffer_.get();
+
+	buffer_.reserve(commands, size_t(capacity) * stride_);
+	commands.copy(buffer_.get(), outgrown, size_t(capacity_) * stride_, 0, 0);
+
+	insertFree(capacity_, capacity - capacity_);
+	capacity_ = capacity;
+}
+
+void GeometryArena::releaseRange(void* arena, uint32_t offset) {
+	auto& self = *static_cast<GeometryArena*>(arena);
+
+	std::lock_guard lock(self.mutex_);
+	self.release(offset);
+}
+
+} // namespace glint::graphics
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <set>
+#include <utility>
+
+#include "graphics_gl.hpp"
+#include "graphics_resources.hpp"
+
+namespace glint::graphics {
+
+class CommandList;
+
+// Counts are in elements
+struct GeometryStatistics final {
+	uint32_t capacity = 0;
+	uint32_t used = 0;
+	uint32_t retiring = 0;
+	uint32_t ranges = 0;
+	uint32_t free_blocks = 0;
+	uint32_t largest_free_block = 0;
+};
+
+// Hands out ranges of one shared buffer in elements of a fixed stride, best
+// fit by size, merging freed neighbours by offset. Each range points at
+// where its owner keeps its offset, which defragment() rewrites when it
+// moves the range. Space a range was moved out of, and buffers outgrown,
+// are kept until the GPU has finished the frames that may still read them.
+// Ranges are handed out on the recording thread, and every upload, copy
+// and growth is recorded into the commands given.
+class GeometryArena final {
+public:
+	GeometryArena(GLenum type, uint32_t stride, uint32_t capacity);
+	~GeometryArena();
+
+	GeometryArena(const GeometryArena&) = delete;
+	GeometryArena(GeometryArena&&) noexcept = delete;
+
+	GeometryArena& operator=(const GeometryArena&) = delete;
+	GeometryArena& operator=(GeometryArena&&) noexcept = delete;
+
+	// Records the upload of data, and growing the buffer when nothing fits.
+	// The range may be drawn from by whatever is recorded after.
+	void allocate(CommandList& commands, uint32_t count, const void* data, uint32_t* offset);
+	void free(uint32_t offset);
+
+	// Moves ranges from the end into free space nearer the start until
+	// max_elements have been moved, the copies recorded into commands ahead
+	// of whatever is recorded after. Returns the elements moved.
+	uint32_t defragment(CommandList& commands, uint32_t max_elements);
+
+	// Whether free space is split up or short of the end of the buffer
+	bool fragmented() const;
+
+	const gl::Buffer& buffer() const & noexcept { return buffer_.get(); }
+	uint32_t stride() const noexcept { return stride_; }
+
+	GeometryStatistics statistics() const;
+
+private:
+	static constexpr uint32_t no_offset = UINT32_MAX;
+
+	// owner is null once the range has been moved away and is retiring
+	struct Range {
+		uint32_t count;
+		uint32_t* owner;
+	};
+
+	uint32_t take(uint32_t count);
+	void insertFree(uint32_t offset, uint32_t count);
+	void eraseFree(std::map<uint32_t, uint32_t>::iterator block);
+	void release(uint32_t offset);
+	void grow(CommandList& commands, uint32_t count);
+
+	static void releaseRange(void* arena, uint32_t offset);
+
+	uint32_t stride_;
+	uint32_t capacity_;
+	GrowableBuffer buffer_;
+
+	// Ranges moved away are released on the thread owning the context
+	mutable std::mutex mutex_;
+	std::map<uint32_t, Range> ranges_;
+	std::map<uint32_t, uint32_t> free_;
+	std::set<std::pair<uint32_t, uint32_t>> free_by_size_;
+	uint32_t used_ = 0;
+	uint32_t retiring_ = 0;
+};
+
+} // namespace glint::graphics
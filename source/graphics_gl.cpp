@@ -5,18 +5,31 @@
 #include <stdexcept>
 #include <sstream>
 #include <numeric>
+#include <atomic>
+#include <vector>
 
 namespace glint::graphics::gl {
 
 namespace {
 
 GLenum current_primitive_mode;
-GLintptr current_vertex_stride;
+GLintptr current_vertex_strides[max_vertex_bindings];
 GLenum current_index_type;
+bool current_depth_write;
 
 uint32_t current_viewport_width;
 uint32_t current_viewport_height;
 
+GLuint current_framebuffer;
+size_t current_color_attachment_count;
+GLenum current_depth_stencil_attachment;
+
+Statistics current_statistics;
+
+// Objects may be deleted on the render thread while another reads the totals
+std::atomic<size_t> allocated_bytes[static_cast<size_t>(MemoryCategory::count)];
+std::atomic<uint32_t> allocation_count[static_cast<size_t>(MemoryCategory::count)];
+
 void GLAPIENTRY glDebugCallback(GLenum /*source*/, GLenum type,
                                 GLuint /*id*/, GLenum /*severity*/,
                                 GLsizei /*length*/, const GLchar* message,
@@ -69,6 +82,45 @@ inline GLenum typeFromInternalFormat(GLenum format) {
 	return 0;
 }
 
+inline size_t pixelSizeFromInternalFormat(GLenum format) {
+	switch (format) {
+		case GL_R8: return 1;
+		case GL_RG8: return 2;
+		case GL_RGB8: return 3;
+		case GL_RGBA8: return 4;
+		case GL_RGB10_A2: return 4;
+		case GL_R32F: return 4;
+		case GL_R32UI: return 4;
+		case GL_DEPTH_COMPONENT16: return 2;
+		// Drivers pad 24 bit depth to 32
+		case GL_DEPTH_COMPONENT24: return 4;
+		case GL_DEPTH_COMPONENT32F: return 4;
+		case GL_DEPTH24_STENCIL8: return 4;
+		case GL_DEPTH32F_STENCIL8: return 8;
+	}
+
+	return 0;
+}
+
+inline uint32_t resolveLevels(uint32_t width, uint32_t height, uint32_t levels) {
+	const bool is_power_of_two = width == height && (width & (width - 1)) == 0;
+	return levels != 0 ? levels : is_power_of_two ? std::bit_width(width) : 1;
+}
+
+inline MemoryCategory categoryFromBuffer(GLenum type) {
+	return type == GL_UNIFORM_BUFFER ? MemoryCategory::uniform : MemoryCategory::mesh;
+}
+
+inline void trackAllocation(MemoryCategory category, size_t bytes) {
+	allocated_bytes[static_cast<size_t>(category)] += bytes;
+	++allocation_count[static_cast<size_t>(category)];
+}
+
+inline void trackRelease(MemoryCategory category, size_t bytes) {
+	allocated_bytes[static_cast<size_t>(category)] -= bytes;
+	--allocation_count[static_cast<size_t>(category)];
+}
+
 inline GLenum depthStencilAttachmentTypeFromFormat(GLenum format) {
 	switch (format) {
 		case GL_DEPTH_COMPONENT16:
@@ -84,10 +136,40 @@ inline GLenum depthStencilAttachmentTypeFromFormat(GLenum format) {
 	return 0;
 }
 
+// Default framebuffer takes GL_COLOR/GL_DEPTH/GL_STENCIL instead of
+// attachment points when invalidating
+inline GLsizei invalidationAttachments(const bool color[], bool depth_stencil,
+                                       GLenum attachments[]) {
+	GLsizei count = 0;
+
+	for (size_t i = 0; i < current_color_attachment_count; ++i) {
+		if (color[i]) {
+			attachments[count++] = current_framebuffer != 0 ? GL_COLOR_ATTACHMENT0 + i : GL_COLOR;
+		}
+	}
+
+	if (!depth_stencil || current_depth_stencil_attachment == GL_NONE) {
+		return count;
+	}
+
+	if (current_framebuffer != 0) {
+		attachments[count++] = current_depth_stencil_attachment;
+	} else {
+		attachments[count++] = GL_DEPTH;
+		attachments[count++] = GL_STENCIL;
+	}
+
+	return count;
+}
+
 } // namespace
 
 Buffer::Buffer(GLenum type, GLenum usage, size_t size, const void* data)
-: type_{type}, usage_{usage}, size_{size} {
+: Buffer(type, usage, categoryFromBuffer(type), size, data) {}
+
+Buffer::Buffer(GLenum type, GLenum usage, MemoryCategory category, size_t size,
+               const void* data)
+: type_{type}, usage_{usage}, size_{size}, category_{category} {
 	assert(type == GL_ARRAY_BUFFER ||
 	       type == GL_ELEMENT_ARRAY_BUFFER ||
 	       type == GL_UNIFORM_BUFFER ||
@@ -102,10 +184,18 @@ Buffer::Buffer(GLenum type, GLenum usage, size_t size, const void* data)
 	glBufferData(type, size, data, usage);
 
 	glBindBuffer(type, 0);
+
+	if (data != nullptr) {
+		current_statistics.bytes_uploaded += size;
+	}
+
+	trackAllocation(category_, size_);
 }
 
 Buffer::~Buffer() {
 	glDeleteBuffers(1, &handle_);
+
+	trackRelease(category_, size_);
 }
 
 void Buffer::assign(size_t size, const void* data, uintptr_t offset) {
@@ -114,15 +204,36 @@ void Buffer::assign(size_t size, const void* data, uintptr_t offset) {
 	glBindBuffer(type_, handle_);
 	glBufferSubData(type_, offset, size, data);
 	glBindBuffer(type_, 0);
+
+	current_statistics.bytes_uploaded += size;
 }
 
-Shader::Shader(GLenum type, const std::string_view source) {
+void Buffer::copy(const Buffer& source, size_t size, uintptr_t source_offset, uintptr_t offset) {
+	assert(size != 0 && source_offset + size <= source.size_ && offset + size <= size_);
+	assert(&source != this || source_offset + size <= offset || offset + size <= source_offset);
+
+	glBindBuffer(GL_COPY_READ_BUFFER, source.handle_);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, handle_);
+	glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, source_offset, offset, size);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+}
+
+Shader::Shader(GLenum type, const std::string_view source)
+: Shader(type, {source}) {}
+
+Shader::Shader(GLenum type, std::initializer_list<std::string_view> sources)
+: type_{type} {
 	handle_ = glCreateShader(type);
 
-	const char* cstr = source.data();
-	const GLint length = source.length();
+	std::vector<const char*> strings;
+	std::vector<GLint> lengths;
+	for (const std::string_view source : sources) {
+		strings.push_back(source.data());
+		lengths.push_back(source.length());
+	}
 
-	glShaderSource(handle_, 1, &cstr, &length);
+	glShaderSource(handle_, strings.size(), strings.data(), lengths.data());
 	glCompileShader(handle_);
 
 	GLint success = 0;
@@ -142,6 +253,9 @@ Shader::Shader(GLenum type, const std::string_view source) {
 			case GL_FRAGMENT_SHADER:
 				ss << "Fragment";
 				break;
+			case GL_COMPUTE_SHADER:
+				ss << "Compute";
+				break;
 			default:
 				ss << "Unknown";
 		}
@@ -155,25 +269,50 @@ Shader::~Shader() {
 	glDeleteShader(handle_);
 }
 
-Texture::Texture(GLenum format, uint32_t width, uint32_t height, const void* data)
+size_t textureBytes(GLenum format, uint32_t width, uint32_t height, uint32_t levels) {
+	const size_t pixel_size = pixelSizeFromInternalFormat(format);
+	assert(pixel_size != 0);
+
+	levels = resolveLevels(width, height, levels);
+
+	size_t bytes = 0;
+	for (uint32_t level = 0; level < levels; ++level) {
+		bytes += size_t(std::max(width >> level, 1u)) * std::max(height >> level, 1u) *
+		         pixel_size;
+	}
+
+	return bytes;
+}
+
+Texture::Texture(GLenum format, uint32_t width, uint32_t height, const void* data,
+                 uint32_t levels)
 : format_{format}, size_{width, height}, type_{GL_TEXTURE_2D} {
 	assert(width != 0 && height != 0);
+	assert(levels <= std::bit_width(std::max(width, height)));
 	
 	glGenTextures(1, &handle_);
 	glBindTexture(GL_TEXTURE_2D, handle_);
 
-	bool is_power_of_two = width == height && (width & (width - 1)) == 0;
+	levels = resolveLevels(width, height, levels);
 
-	GLsizei levels = is_power_of_two ? std::bit_width(width) : 1;
+	levels_ = levels;
 	glTexStorage2D(GL_TEXTURE_2D, levels, format, width, height);
 
+	bytes_ = textureBytes(format, width, height, levels);
+
+	category_ = data != nullptr ? MemoryCategory::texture : MemoryCategory::render_target;
+	trackAllocation(category_, bytes_);
+
 	if (data != nullptr) {
 		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height,
 		                formatFromInternalFormat(format),
 		                typeFromInternalFormat(format),
 		                data);
 
-		if (is_power_of_two) {
+		current_statistics.bytes_uploaded += size_t(width) * height *
+		                                     pixelSizeFromInternalFormat(format);
+
+		if (levels > 1) {
 			glGenerateMipmap(GL_TEXTURE_2D);
 		}
 	}
@@ -183,6 +322,8 @@ Texture::Texture(GLenum format, uint32_t width, uint32_t height, const void* dat
 
 Texture::~Texture() {
 	glDeleteTextures(1, &handle_);
+
+	trackRelease(category_, bytes_);
 }
 
 Sampler::Sampler(const Descriptor& descriptor) {
@@ -220,11 +361,14 @@ Pipeline::Pipeline(const PrimitiveState& primitive,
 	glBindVertexArray(vertex_array_);
 
 	for (const auto& attrib : layout) {
-		vertex_stride_ += attrib.components * sizeFromType(attrib.type);
+		assert(attrib.binding < max_vertex_bindings);
+		vertex_strides_[attrib.binding] += attrib.components * sizeFromType(attrib.type);
 	}
 
-	GLuint offset = 0;
+	GLuint offsets[max_vertex_bindings] = {};
 	for (const auto& attrib : layout) {
+		GLuint& offset = offsets[attrib.binding];
+
 		glEnableVertexAttribArray(attrib.index);
 		if (attrib.type == GL_FLOAT ||
 		    attrib.type == GL_HALF_FLOAT ||
@@ -234,7 +378,7 @@ Pipeline::Pipeline(const PrimitiveState& primitive,
 		} else {
 			glVertexAttribIFormat(attrib.index, attrib.components, attrib.type, offset);
 		}
-		glVertexAttribBinding(attrib.index, 0);
+		glVertexAttribBinding(attrib.index, attrib.binding);
 
 		offset += attrib.components * sizeFromType(attrib.type);
 	}
@@ -270,6 +414,35 @@ Pipeline::~Pipeline() {
 	glDeleteVertexArrays(1, &vertex_array_);
 }
 
+ComputePipeline::ComputePipeline(const Shader& compute_shader) {
+	assert(compute_shader.type() == GL_COMPUTE_SHADER);
+
+	program_ = glCreateProgram();
+
+	glAttachShader(program_, compute_shader.handle());
+	glLinkProgram(program_);
+
+	GLint link_success;
+	glGetProgramiv(program_, GL_LINK_STATUS, &link_success);
+	if (!link_success) {
+		GLint log_length;
+		glGetProgramiv(program_, GL_INFO_LOG_LENGTH, &log_length);
+
+		char* log = static_cast<char*>(alloca(log_length));
+		glGetProgramInfoLog(program_, log_length, nullptr, log);
+
+		std::stringstream ss;
+		ss << "Compute program linking error:\n" << log << '\n';
+		throw std::runtime_error(ss.str());
+	}
+
+	glDetachShader(program_, compute_shader.handle());
+}
+
+ComputePipeline::~ComputePipeline() {
+	glDeleteProgram(program_);
+}
+
 Framebuffer::Framebuffer(const std::span<gl::Texture*> color_attachments,
                          gl::Texture* depth_stencil_attachment) {
 	glGenFramebuffers(1, &handle_);
@@ -310,11 +483,23 @@ Framebuffer::Framebuffer(const std::span<gl::Texture*> color_attachments,
 		size_ = depth_stencil_attachment->size();
 	}
 
+	color_attachment_count_ = color_attachments.size();
+	depth_stencil_attachment_ = depth_stencil_attachment != nullptr
+	                            ? depthStencilAttachmentTypeFromFormat(depth_stencil_attachment->format())
+	                            : GL_NONE;
+
 	glBindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
 Framebuffer::~Framebuffer() {
-	glDeleteFramebuffers(1, &handle_);
+	if (handle_ != 0) {
+		glDeleteFramebuffers(1, &handle_);
+	}
+}
+
+const Framebuffer& Framebuffer::main() {
+	static const Framebuffer framebuffer;
+	return framebuffer;
 }
 
 void setup(uint32_t width, uint32_t height) {
@@ -323,6 +508,8 @@ void setup(uint32_t width, uint32_t height) {
 
 	current_viewport_width = width;
 	current_viewport_height = height;
+
+	current_depth_write = true;
 }
 
 void shutdown() {}
@@ -331,12 +518,7 @@ glm::vec2 viewport() {
 	return {current_viewport_width, current_viewport_height};
 }
 
-void beginPass(const Framebuffer& framebuffer,
-               GLbitfield clear_mask,
-               const float clear_color[], float clear_depth) {
-	glClearColor(clear_color[0], clear_color[1], clear_color[2], clear_color[3]);
-	glClearDepthf(clear_depth);
-
+void beginPass(const Framebuffer& framebuffer, const LoadActions& actions) {
 	const auto& size = framebuffer.size();
 
 	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer.framebuffer());
@@ -347,11 +529,69 @@ void beginPass(const Framebuffer& framebuffer,
 		glViewport(0, 0, current_viewport_width, current_viewport_height);
 	}
 
-	glClear(clear_mask);
+	++current_statistics.passes;
+
+	current_framebuffer = framebuffer.framebuffer();
+	current_color_attachment_count = framebuffer.colorAttachmentCount();
+	current_depth_stencil_attachment = framebuffer.depthStencilAttachment();
+
+	assert(current_color_attachment_count <= max_color_attachments);
+
+	bool invalidate_color[max_color_attachments] = {};
+	for (size_t i = 0; i < current_color_attachment_count; ++i) {
+		switch (actions.color[i]) {
+			case LoadAction::clear:
+				glClearBufferfv(GL_COLOR, i, &actions.clear_color.x);
+				break;
+			case LoadAction::dont_care:
+				invalidate_color[i] = true;
+				break;
+			case LoadAction::load:
+				break;
+		}
+	}
+
+	if (current_depth_stencil_attachment != GL_NONE &&
+	    actions.depth_stencil == LoadAction::clear) {
+		// Clears obey the depth mask of the pipeline still bound
+		if (!current_depth_write) {
+			glDepthMask(GL_TRUE);
+		}
+
+		if (current_depth_stencil_attachment == GL_DEPTH_ATTACHMENT) {
+			glClearBufferfv(GL_DEPTH, 0, &actions.clear_depth);
+		} else {
+			glClearBufferfi(GL_DEPTH_STENCIL, 0,
+			                actions.clear_depth, actions.clear_stencil);
+		}
+
+		if (!current_depth_write) {
+			glDepthMask(GL_FALSE);
+		}
+	}
+
+	GLenum attachments[max_color_attachments + 2];
+	GLsizei count = invalidationAttachments(invalidate_color,
+	                                        actions.depth_stencil == LoadAction::dont_care,
+	                                        attachments);
+	if (count != 0) {
+		glInvalidateFramebuffer(GL_FRAMEBUFFER, count, attachments);
+	}
 }
 
-void endPass() {
-	// TODO Framebuffer invalidation
+void endPass(const StoreActions& actions) {
+	bool invalidate_color[max_color_attachments] = {};
+	for (size_t i = 0; i < current_color_attachment_count; ++i) {
+		invalidate_color[i] = actions.color[i] == StoreAction::discard;
+	}
+
+	GLenum attachments[max_color_attachments + 2];
+	GLsizei count = invalidationAttachments(invalidate_color,
+	                                        actions.depth_stencil == StoreAction::discard,
+	                                        attachments);
+	if (count != 0) {
+		glInvalidateFramebuffer(GL_FRAMEBUFFER, count, attachments);
+	}
 }
 
 void setPipeline(const Pipeline& pipeline) {
@@ -359,8 +599,12 @@ void setPipeline(const Pipeline& pipeline) {
 	const auto& depth_stencil = pipeline.depthStencilState();
 	const auto& blend = pipeline.blendState();
 	
+	++current_statistics.pipeline_changes;
+
 	current_primitive_mode = primitive.mode;
-	current_vertex_stride = pipeline.vertexStride();
+	for (uint32_t binding = 0; binding < max_vertex_bindings; ++binding) {
+		current_vertex_strides[binding] = pipeline.vertexStride(binding);
+	}
 	current_index_type = GL_NONE;
 
 	if (primitive.cull_mode != GL_NONE) {
@@ -371,13 +615,17 @@ void setPipeline(const Pipeline& pipeline) {
 		glDisable(GL_CULL_FACE);
 	}
 
-	if (depth_stencil.depth_write) {
+	// Writing needs the test enabled, so writing alone always passes it
+	if (depth_stencil.depth_test || depth_stencil.depth_write) {
 		glEnable(GL_DEPTH_TEST);
-		glDepthFunc(depth_stencil.depth_compare);
+		glDepthFunc(depth_stencil.depth_test ? depth_stencil.depth_compare : GL_ALWAYS);
 	} else {
 		glDisable(GL_DEPTH_TEST);
 	}
 
+	glDepthMask(depth_stencil.depth_write);
+	current_depth_write = depth_stencil.depth_write;
+
 	if (blend.enable) {
 		glEnable(GL_BLEND);
 		glBlendFuncSeparate(blend.color_src_factor, blend.color_dst_factor,
@@ -391,36 +639,58 @@ void setPipeline(const Pipeline& pipeline) {
 	glBindVertexArray(pipeline.vertexArray());
 }
 
-void setVertexBuffer(const Buffer& buffer) {
-	assert(buffer.type() == GL_ARRAY_BUFFER);
-	glBindVertexBuffer(0, buffer.handle(), 0, current_vertex_stride);
+void setVertexBuffer(const Buffer& buffer, uintptr_t offset, uint32_t binding, GLsizei stride) {
+	assert(buffer.type() == GL_ARRAY_BUFFER && binding < max_vertex_bindings);
+	glBindVertexBuffer(binding, buffer.handle(), offset,
+	                   stride != 0 ? stride : current_vertex_strides[binding]);
+	++current_statistics.buffer_bindings;
 }
 
 void setIndexBuffer(const Buffer& buffer, GLenum index_type) {
-	assert(buffer.type() == GL_ELEMENT_ARRAY_BUFFER);
+	// Storage buffers are allowed for indices written by compute shaders
+	assert(buffer.type() == GL_ELEMENT_ARRAY_BUFFER ||
+	       buffer.type() == GL_SHADER_STORAGE_BUFFER);
 	assert(index_type == GL_UNSIGNED_SHORT || index_type == GL_UNSIGNED_INT);
 
 	current_index_type = index_type;
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer.handle());
+	++current_statistics.buffer_bindings;
 }
 
 void setUniformBuffer(const Buffer& buffer, uint32_t binding) {
 	assert(buffer.type() == GL_UNIFORM_BUFFER);
 	glBindBufferBase(GL_UNIFORM_BUFFER, binding, buffer.handle());
+	++current_statistics.buffer_bindings;
 }
 
 void setStorageBuffer(const Buffer& buffer, uint32_t binding) {
-	assert(buffer.type() == GL_SHADER_STORAGE_BUFFER);
+	// Vertex buffers are allowed for vertices written by compute shaders
+	assert(buffer.type() == GL_SHADER_STORAGE_BUFFER || buffer.type() == GL_ARRAY_BUFFER);
 	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding, buffer.handle());
+	++current_statistics.buffer_bindings;
 }
 
 void setTexture(const Texture& texture, const Sampler& sampler, uint32_t binding) {
 	glActiveTexture(GL_TEXTURE0 + binding);
 	glBindSampler(binding, sampler.handle());
 	glBindTexture(texture.type(), texture.handle());
+	++current_statistics.texture_bindings;
+}
+
+void setImage(const Texture& texture, uint32_t binding, uint32_t level, GLenum access) {
+	assert(level < texture.levels());
+	glBindImageTexture(binding, texture.handle(), level, GL_FALSE, 0, access, texture.format());
+	++current_statistics.texture_bindings;
+}
+
+void setUniform(int32_t location, uint32_t value) {
+	glUniform1ui(location, value);
 }
 
 void draw(uint32_t count, uint32_t offset) {
+	++current_statistics.draws;
+	current_statistics.vertices += count;
+
 	if (current_index_type != GL_NONE) {
 		glDrawElements(current_primitive_mode, count, current_index_type,
 		               reinterpret_cast<const void*>(offset * sizeFromType(current_index_type)));
@@ -430,6 +700,9 @@ void draw(uint32_t count, uint32_t offset) {
 }
 
 void drawInstanced(uint32_t instances, uint32_t count, uint32_t offset) {
+	++current_statistics.draws;
+	current_statistics.vertices += uint64_t(instances) * count;
+
 	if (current_index_type != GL_NONE) {
 		glDrawElementsInstanced(current_primitive_mode, count, current_index_type,
 		                        reinterpret_cast<const void*>(offset * sizeFromType(current_index_type)),
@@ -439,4 +712,61 @@ void drawInstanced(uint32_t instances, uint32_t count, uint32_t offset) {
 	}
 }
 
+void drawIndirect(const Buffer& commands, uintptr_t offset) {
+	assert(offset % alignof(DrawIndirectCommand) == 0);
+
+	// The vertex count is only known to the GPU
+	++current_statistics.draws;
+
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commands.handle());
+
+	if (current_index_type != GL_NONE) {
+		glDrawElementsIndirect(current_primitive_mode, current_index_type,
+		                       reinterpret_cast<const void*>(offset));
+	} else {
+		glDrawArraysIndirect(current_primitive_mode, reinterpret_cast<const void*>(offset));
+	}
+}
+
+void setComputePipeline(const ComputePipeline& pipeline) {
+	++current_statistics.pipeline_changes;
+	glUseProgram(pipeline.program());
+}
+
+void dispatch(uint32_t x, uint32_t y, uint32_t z) {
+	++current_statistics.dispatches;
+	glDispatchCompute(x, y, z);
+}
+
+void dispatchIndirect(const Buffer& commands, uintptr_t offset) {
+	assert(offset % alignof(DispatchIndirectCommand) == 0);
+
+	++current_statistics.dispatches;
+
+	glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, commands.handle());
+	glDispatchComputeIndirect(offset);
+}
+
+void memoryBarrier(GLbitfield barriers) {
+	glMemoryBarrier(barriers);
+}
+
+const Statistics& statistics() {
+	return current_statistics;
+}
+
+void resetStatistics() {
+	current_statistics = {};
+}
+
+MemoryUsage memoryUsage() {
+	MemoryUsage usage;
+	for (size_t i = 0; i < static_cast<size_t>(MemoryCategory::count); ++i) {
+		usage.bytes[i] = allocated_bytes[i];
+		usage.allocations[i] = allocation_count[i];
+	}
+
+	return usage;
+}
+
 } // namespace glint::graphics::gl
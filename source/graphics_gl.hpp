@@ -3,21 +3,29 @@
 #include <cstdint>
 #include <cstddef>
 #include <string_view>
+#include <initializer_list>
 #include <span>
 #include <algorithm>
 
 #include <glad/gles2.h>
 
 #include <glm/ext/vector_float2.hpp>
+#include <glm/ext/vector_float4.hpp>
 #include <glm/ext/vector_uint2.hpp>
 
 namespace glint::graphics::gl {
 
+constexpr size_t max_color_attachments = 4;
+constexpr size_t max_vertex_bindings = 4;
+
+// Attributes of one binding are packed in layout order, each binding
+// reading its own buffer with its own stride
 struct VertexAttribute {
 	GLuint index;
 	GLenum type;
 	GLint components;
 	bool normalized;
+	GLuint binding = 0;
 };
 
 using VertexLayout = std::span<const VertexAttribute>;
@@ -28,8 +36,11 @@ struct PrimitiveState {
 	GLenum front_face = GL_CCW;
 };
 
+// Testing and writing are separate, so a pass can test against depth it
+// leaves untouched, or write depth without testing it
 struct DepthStencilState {
 	bool depth_write;
+	bool depth_test = true;
 	GLenum depth_compare = GL_LESS;
 	// TODO: Depth bias
 	// TODO: Stencil configuration
@@ -45,10 +56,103 @@ struct BlendState {
 	GLenum alpha_operation = GL_FUNC_ADD;
 };
 
+enum class LoadAction {
+	clear,
+	load,
+	dont_care,
+};
+
+enum class StoreAction {
+	store,
+	discard,
+};
+
+struct LoadActions {
+	LoadAction color[max_color_attachments] = {};
+	LoadAction depth_stencil = LoadAction::clear;
+	glm::vec4 clear_color = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+	float clear_depth = 1.0f;
+	GLint clear_stencil = 0;
+};
+
+struct StoreActions {
+	StoreAction color[max_color_attachments] = {};
+	StoreAction depth_stencil = StoreAction::store;
+};
+
+// Layout glDrawElementsIndirect reads, usually written by a compute shader
+struct DrawIndirectCommand {
+	uint32_t count;
+	uint32_t instance_count;
+	uint32_t first_index;
+	int32_t base_vertex;
+	uint32_t reserved = 0;
+};
+
+// Layout glDrawArraysIndirect reads
+struct DrawArraysIndirectCommand {
+	uint32_t count;
+	uint32_t instance_count;
+	uint32_t first;
+	uint32_t reserved = 0;
+};
+
+// Layout glDispatchComputeIndirect reads
+struct DispatchIndirectCommand {
+	uint32_t x;
+	uint32_t y;
+	uint32_t z;
+};
+
+// Counters accumulate until resetStatistics() is called
+struct Statistics {
+	uint64_t passes = 0;
+	uint64_t draws = 0;
+	uint64_t dispatches = 0;
+	uint64_t vertices = 0;
+	uint64_t pipeline_changes = 0;
+	uint64_t buffer_bindings = 0;
+	uint64_t texture_bindings = 0;
+	uint64_t bytes_uploaded = 0;
+};
+
+// Buffers created without a category count as uniform memory when they are
+// uniform buffers and as mesh memory otherwise, so anything else names its
+// own. Scene memory holds per instance and per draw data the GPU reads or
+// writes every frame, streaming memory data re-uploaded as it is drawn.
+// Textures created without data are render targets.
+enum class MemoryCategory {
+	mesh,
+	texture,
+	render_target,
+	uniform,
+	scene,
+	streaming,
+	count,
+};
+
+// Estimated from sizes, formats and mip levels, so driver padding and
+// alignment come on top. Objects are counted until they are deleted.
+struct MemoryUsage {
+	size_t bytes[static_cast<size_t>(MemoryCategory::count)] = {};
+	uint32_t allocations[static_cast<size_t>(MemoryCategory::count)] = {};
+
+	size_t total() const noexcept {
+		size_t sum = 0;
+		for (size_t category_bytes : bytes) {
+			sum += category_bytes;
+		}
+
+		return sum;
+	}
+};
+
 class Buffer final {
 public:
 	Buffer(GLenum type, GLenum usage, size_t size,
 	       const void* data = nullptr);
+	Buffer(GLenum type, GLenum usage, MemoryCategory category, size_t size,
+	       const void* data = nullptr);
 	~Buffer();
 
 	Buffer(const Buffer&) = delete;
@@ -59,13 +163,19 @@ public:
 
 	void assign(size_t size, const void* data, uintptr_t offset = 0);
 
+	// Ranges within one buffer must not overlap
+	void copy(const Buffer& source, size_t size, uintptr_t source_offset, uintptr_t offset);
+
 	GLenum type() const noexcept { return type_; }
+	size_t size() const noexcept { return size_; }
+	MemoryCategory category() const noexcept { return category_; }
 	GLuint handle() const noexcept { return handle_; }
 
 private:
 	GLenum type_;
 	GLenum usage_;
 	size_t size_;
+	MemoryCategory category_;
 
 	GLuint handle_;
 };
@@ -73,6 +183,8 @@ private:
 class Shader final {
 public:
 	Shader(GLenum type, const std::string_view source);
+	// The sources are compiled as if concatenated, so the first one holds #version
+	Shader(GLenum type, std::initializer_list<std::string_view> sources);
 	~Shader();
 
 	Shader(const Shader&) = delete;
@@ -90,10 +202,15 @@ private:
 	GLenum handle_;
 };
 
+// What a texture of these dimensions takes, levels read as Texture does
+size_t textureBytes(GLenum format, uint32_t width, uint32_t height, uint32_t levels);
+
 class Texture final {
 public:
+	// levels of zero gives square power of two sizes a full mip chain and
+	// everything else a single level
 	Texture(GLenum format, uint32_t width, uint32_t height,
-	        const void* data = nullptr);
+	        const void* data = nullptr, uint32_t levels = 0);
 	~Texture();
 
 	Texture(const Texture&) = delete;
@@ -104,6 +221,9 @@ public:
 
 	GLenum format() const noexcept { return format_; }
 	glm::uvec2 size() const noexcept { return size_; }
+	uint32_t levels() const noexcept { return levels_; }
+	size_t bytes() const noexcept { return bytes_; }
+	MemoryCategory category() const noexcept { return category_; }
 
 	GLenum type() const noexcept { return type_; }
 	GLuint handle() const noexcept { return handle_; }
@@ -111,6 +231,9 @@ public:
 private:
 	GLenum format_;
 	glm::uvec2 size_;
+	uint32_t levels_;
+	size_t bytes_;
+	MemoryCategory category_;
 
 	GLenum type_;
 	GLuint handle_;
@@ -165,7 +288,7 @@ public:
 	const PrimitiveState& primitiveState() const & noexcept { return primitive_state_; }
 	const DepthStencilState& depthStencilState() const & noexcept { return depth_stencil_state_; }
 	const BlendState& blendState() const & noexcept { return blend_state_; }
-	GLintptr vertexStride() const noexcept { return vertex_stride_; }
+	GLintptr vertexStride(uint32_t binding = 0) const noexcept { return vertex_strides_[binding]; }
 
 	GLuint vertexArray() const noexcept { return vertex_array_; }
 	GLuint program() const noexcept { return program_; }
@@ -174,12 +297,29 @@ private:
 	const PrimitiveState primitive_state_;
 	const DepthStencilState depth_stencil_state_;
 	const BlendState blend_state_;
-	GLintptr vertex_stride_ = 0;
+	GLintptr vertex_strides_[max_vertex_bindings] = {};
 
 	GLuint vertex_array_;
 	GLuint program_;
 };
 
+class ComputePipeline final {
+public:
+	explicit ComputePipeline(const Shader& compute_shader);
+	~ComputePipeline();
+
+	ComputePipeline(const ComputePipeline&) = delete;
+	ComputePipeline(ComputePipeline&&) noexcept = delete;
+
+	ComputePipeline& operator=(const ComputePipeline&) = delete;
+	ComputePipeline& operator=(ComputePipeline&&) noexcept = delete;
+
+	GLuint program() const noexcept { return program_; }
+
+private:
+	GLuint program_;
+};
+
 class Framebuffer final {
 public:
 	Framebuffer(const std::span<gl::Texture*> color_attachments,
@@ -194,17 +334,24 @@ public:
 
 	GLuint framebuffer() const noexcept { return handle_; }
 	glm::uvec2 size() const noexcept { return size_; }
+	size_t colorAttachmentCount() const noexcept { return color_attachment_count_; }
+	GLenum depthStencilAttachment() const noexcept { return depth_stencil_attachment_; }
 
-	static Framebuffer main() { return {}; }
+	// Outlives every command list recording it
+	static const Framebuffer& main();
 
 private:
 	Framebuffer()
-	: handle_{0} {}
+	: handle_{0},
+	  color_attachment_count_{1},
+	  depth_stencil_attachment_{GL_DEPTH_STENCIL_ATTACHMENT} {}
 
 private:
 	GLuint handle_;
 
 	glm::uvec2 size_;
+	size_t color_attachment_count_;
+	GLenum depth_stencil_attachment_;
 };
 
 void setup(uint32_t width, uint32_t height);
@@ -214,19 +361,41 @@ glm::vec2 viewport();
 void clear(float red, float green, float blue, float alpha);
 void setFramebuffer(const Framebuffer& framebuffer);
 
-void beginPass(const Framebuffer& framebuffer,
-               GLbitfield clear_mask,
-               const float clear_color[4], float clear_depth = 1.0f);
-void endPass();
+void beginPass(const Framebuffer& framebuffer, const LoadActions& actions = {});
+void endPass(const StoreActions& actions = {});
 
 void setPipeline(const Pipeline&);
-void setVertexBuffer(const Buffer&);
+// offset stands in for a base vertex, which GLES 3.1 only has for indirect
+// draws. A stride of zero takes the pipeline's stride for the binding.
+void setVertexBuffer(const Buffer&, uintptr_t offset = 0, uint32_t binding = 0,
+                     GLsizei stride = 0);
 void setIndexBuffer(const Buffer&, GLenum index_type);
 void setUniformBuffer(const Buffer&, uint32_t binding);
 void setStorageBuffer(const Buffer&, uint32_t binding);
 void setTexture(const Texture&, const Sampler&, uint32_t binding);
+void setImage(const Texture&, uint32_t binding, uint32_t level, GLenum access);
+
+// Sets a uint uniform at an explicit location of the current pipeline
+void setUniform(int32_t location, uint32_t value);
 
 void draw(uint32_t count, uint32_t offset = 0);
 void drawInstanced(uint32_t instances, uint32_t count, uint32_t offset = 0);
 
+// Reads a DrawIndirectCommand at offset bytes into the buffer when an index
+// buffer is bound, or a DrawArraysIndirectCommand when none is
+void drawIndirect(const Buffer& commands, uintptr_t offset = 0);
+
+void setComputePipeline(const ComputePipeline&);
+void dispatch(uint32_t x, uint32_t y = 1, uint32_t z = 1);
+
+// Reads a DispatchIndirectCommand at offset bytes into the buffer
+void dispatchIndirect(const Buffer& commands, uintptr_t offset = 0);
+void memoryBarrier(GLbitfield barriers);
+
+const Statistics& statistics();
+void resetStatistics();
+
+// Safe to call from any thread
+MemoryUsage memoryUsage();
+
 } // namespace glint::graphics::gl
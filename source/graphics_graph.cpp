@@ -0,0 +1,513 @@
+#include "graphics_graph.hpp"
+
+#include <cassert>
+#include <algorithm>
+#include <new>
+#include <span>
+#include <utility>
+
+#include "graphics_commands.hpp"
+#include "graphics_resources.hpp"
+
+namespace glint::graphics {
+
+namespace {
+
+constexpr GLbitfield incoherent_write_barriers = GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT |
+                                                 GL_ELEMENT_ARRAY_BARRIER_BIT |
+                                                 GL_UNIFORM_BARRIER_BIT |
+                                                 GL_TEXTURE_FETCH_BARRIER_BIT |
+                                                 GL_SHADER_IMAGE_ACCESS_BARRIER_BIT |
+                                                 GL_COMMAND_BARRIER_BIT |
+                                                 GL_BUFFER_UPDATE_BARRIER_BIT |
+                                                 GL_TEXTURE_UPDATE_BARRIER_BIT |
+                                                 GL_FRAMEBUFFER_BARRIER_BIT |
+                                                 GL_SHADER_STORAGE_BARRIER_BIT;
+
+// Only shader writes bypass the caches GL keeps coherent
+inline bool incoherent(GraphAccess access) {
+	return access == GraphAccess::image || access == GraphAccess::storage;
+}
+
+inline GLbitfield barrierFromAccess(GraphAccess access, bool buffer) {
+	switch (access) {
+		case GraphAccess::attachment: return GL_FRAMEBUFFER_BARRIER_BIT;
+		case GraphAccess::sampled: return GL_TEXTURE_FETCH_BARRIER_BIT;
+		case GraphAccess::image: return GL_SHADER_IMAGE_ACCESS_BARRIER_BIT;
+		case GraphAccess::storage: return GL_SHADER_STORAGE_BARRIER_BIT;
+		case GraphAccess::uniform: return GL_UNIFORM_BARRIER_BIT;
+		case GraphAccess::vertex: return GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT;
+		case GraphAccess::index: return GL_ELEMENT_ARRAY_BARRIER_BIT;
+		case GraphAccess::indirect: return GL_COMMAND_BARRIER_BIT;
+		case GraphAccess::update:
+			return buffer ? GL_BUFFER_UPDATE_BARRIER_BIT : GL_TEXTURE_UPDATE_BARRIER_BIT;
+	}
+
+	return 0;
+}
+
+inline bool isDepthFormat(GLenum format) {
+	switch (format) {
+		case GL_DEPTH_COMPONENT16:
+		case GL_DEPTH_COMPONENT24:
+		case GL_DEPTH_COMPONENT32F:
+		case GL_DEPTH24_STENCIL8:
+		case GL_DEPTH32F_STENCIL8:
+			return true;
+	}
+
+	return false;
+}
+
+// Parks an object in the first free slot, for a retire() to release it by
+template<typename T>
+uint32_t park(std::vector<std::unique_ptr<T>>& slots, std::unique_ptr<T> object) {
+	auto slot = std::find(slots.begin(), slots.end(), nullptr);
+	if (slot == slots.end()) {
+		slots.push_back(std::move(object));
+		return slots.size() - 1;
+	}
+
+	*slot = std::move(object);
+	return slot - slots.begin();
+}
+
+} // namespace
+
+RenderGraph::~RenderGraph() {
+	assert(passes_.empty());
+}
+
+GraphTexture RenderGraph::createTexture(const GraphTextureDescriptor& descriptor) {
+	assert(descriptor.width != 0 && descriptor.height != 0 && descriptor.levels != 0);
+
+	return {addResource({
+		.buffer = false,
+		.imported = false,
+		.descriptor = descriptor,
+		.texture = nullptr,
+		.buffer_object = nullptr,
+	})};
+}
+
+GraphTexture RenderGraph::importTexture(gl::Texture& texture) {
+	const glm::uvec2 size = texture.size();
+
+	return {addResource({
+		.buffer = false,
+		.imported = true,
+		.descriptor = {texture.format(), size.x, size.y, texture.levels()},
+		.texture = &texture,
+		.buffer_object = nullptr,
+	})};
+}
+
+GraphBuffer RenderGraph::importBuffer(gl::Buffer& buffer) {
+	return {addResource({
+		.buffer = true,
+		.imported = true,
+		.descriptor = {},
+		.texture = nullptr,
+		.buffer_object = &buffer,
+	})};
+}
+
+uint32_t RenderGraph::addResource(const Resource& resource) {
+	assert(recording_pass_ == no_pass);
+
+	Resource& added = resources_.emplace_back(resource);
+
+	if (added.imported) {
+		const void* object = added.buffer ? static_cast<const void*>(added.buffer_object)
+		                                  : static_cast<const void*>(added.texture);
+
+		auto unflushed = imported_unflushed_.find(object);
+		if (unflushed != imported_unflushed_.end()) {
+			added.unflushed = unflushed->second;
+		}
+	}
+
+	return resources_.size() - 1;
+}
+
+void RenderGraph::addPass(const char* name, Execute execute) {
+	assert(recording_pass_ == no_pass);
+
+	passes_.push_back({
+		.name = name,
+		.execute = std::move(execute),
+		.first_access = uint32_t(accesses_.size()),
+		.access_count = 0,
+		.kept = false,
+		.live = false,
+		.framebuffer = nullptr,
+	});
+}
+
+void RenderGraph::access(uint32_t resource, GraphAccess access, bool write) {
+	assert(!passes_.empty() && resource < resources_.size());
+	assert(!write || (access != GraphAccess::sampled && access != GraphAccess::uniform &&
+	                  access != GraphAccess::index && access != GraphAccess::indirect &&
+	                  access != GraphAccess::vertex));
+
+	accesses_.push_back({resource, access, write});
+	++passes_.back().access_count;
+}
+
+void RenderGraph::read(GraphTexture texture, GraphAccess access) {
+	assert(!resources_[texture.index].buffer);
+	this->access(texture.index, access, false);
+}
+
+void RenderGraph::write(GraphTexture texture, GraphAccess access) {
+	assert(!resources_[texture.index].buffer);
+	this->access(texture.index, access, true);
+}
+
+void RenderGraph::read(GraphBuffer buffer, GraphAccess access) {
+	assert(resources_[buffer.index].buffer && access != GraphAccess::attachment);
+	this->access(buffer.index, access, false);
+}
+
+void RenderGraph::write(GraphBuffer buffer, GraphAccess access) {
+	assert(resources_[buffer.index].buffer && access != GraphAccess::attachment);
+	this->access(buffer.index, access, true);
+}
+
+void RenderGraph::keep() {
+	assert(!passes_.empty());
+	passes_.back().kept = true;
+}
+
+gl::Texture& RenderGraph::texture(GraphTexture texture) const {
+	assert(recording_pass_ != no_pass);
+
+	const Resource& resource = resources_[texture.index];
+	assert(!resource.buffer && resource.texture != nullptr);
+
+	return *resource.texture;
+}
+
+const GraphTextureDescriptor& RenderGraph::descriptor(GraphTexture texture) const {
+	assert(!resources_[texture.index].buffer);
+	return resources_[texture.index].descriptor;
+}
+
+const gl::Framebuffer& RenderGraph::framebuffer() const {
+	assert(recording_pass_ != no_pass);
+
+	const Pass& pass = passes_[recording_pass_];
+	assert(pass.framebuffer != nullptr);
+
+	return pass.framebuffer->framebuffer.get();
+}
+
+// Walking back from what is kept, a pass lives if a later live pass needs
+// something it writes. Its writes satisfy that need, its reads create one.
+void RenderGraph::cull() {
+	for (uint32_t p = passes_.size(); p-- > 0;) {
+		Pass& pass = passes_[p];
+		const auto accesses = std::span(accesses_).subspan(pass.first_access, pass.access_count);
+
+		pass.live = pass.kept;
+		for (const Access& access : accesses) {
+			const Resource& resource = resources_[access.resource];
+			if (access.write && (resource.imported || resource.needed)) {
+				pass.live = true;
+			}
+		}
+
+		if (!pass.live) {
+			++statistics_.culled_passes;
+			continue;
+		}
+
+		for (const Access& access : accesses) {
+			if (access.write) {
+				resources_[access.resource].needed = false;
+			}
+		}
+
+		for (const Access& access : accesses) {
+			Resource& resource = resources_[access.resource];
+
+			if (!access.write) {
+				resource.needed = true;
+			}
+
+			resource.first_pass = p;
+			if (resource.last_pass == no_pass) {
+				resource.last_pass = p;
+			}
+		}
+	}
+}
+
+// Transient textures in order of first use each take the first physical
+// texture of their description that is free by then. The first one on a
+// physical texture carries on from last frame's unflushed writes to it.
+void RenderGraph::allocate(CommandList& commands) {
+	for (auto& physical : physical_textures_) {
+		physical->used = false;
+	}
+
+	std::vector<uint32_t> transients;
+	for (uint32_t i = 0; i < resources_.size(); ++i) {
+		const Resource& resource = resources_[i];
+		if (!resource.buffer && !resource.imported && resource.first_pass != no_pass) {
+			transients.push_back(i);
+		}
+	}
+
+	std::sort(transients.begin(), transients.end(), [&](uint32_t a, uint32_t b) {
+		return resources_[a].first_pass < resources_[b].first_pass;
+	});
+
+	for (uint32_t index : transients) {
+		Resource& resource = resources_[index];
+
+		auto physical = std::find_if(physical_textures_.begin(), physical_textures_.end(),
+		                             [&](const auto& physical) {
+			return physical->descriptor == resource.descriptor &&
+			       (!physical->used || physical->busy_until < resource.first_pass);
+		});
+
+		if (physical == physical_textures_.end()) {
+			auto created = std::make_unique<PhysicalTexture>();
+			created->descriptor = resource.descriptor;
+			commands.call(&RenderGraph::constructTexture, uint64_t(uintptr_t(created.get())));
+
+			physical_textures_.push_back(std::move(created));
+			physical = physical_textures_.end() - 1;
+		}
+
+		if ((*physical)->used) {
+			resource.previous_alias = (*physical)->last_resource;
+		} else {
+			resource.unflushed = (*physical)->unflushed;
+		}
+
+		(*physical)->used = true;
+		(*physical)->busy_until = resource.last_pass;
+		(*physical)->last_resource = index;
+		resource.texture = &(*physical)->texture.get();
+
+		statistics_.transient_bytes += gl::textureBytes(resource.descriptor.format,
+		                                                resource.descriptor.width,
+		                                                resource.descriptor.height,
+		                                                resource.descriptor.levels);
+	}
+
+	statistics_.transient_textures = transients.size();
+
+	for (auto& physical : physical_framebuffers_) {
+		physical->used = false;
+	}
+
+	for (Pass& pass : passes_) {
+		if (pass.live) {
+			pass.framebuffer = findFramebuffer(pass, commands);
+		}
+	}
+
+	// What this frame did without goes once the frames that used it are done.
+	// Framebuffers over a retired texture are among them.
+	std::lock_guard lock(mutex_);
+
+	std::erase_if(physical_textures_, [&](auto& physical) {
+		if (physical->used) {
+			return false;
+		}
+
+		detail::retire(&RenderGraph::releaseTexture, this,
+		               park(retired_textures_, std::move(physical)));
+		return true;
+	});
+
+	std::erase_if(physical_framebuffers_, [&](auto& physical) {
+		if (physical->used) {
+			return false;
+		}
+
+		detail::retire(&RenderGraph::releaseFramebuffer, this,
+		               park(retired_framebuffers_, std::move(physical)));
+		return true;
+	});
+
+	statistics_.physical_textures = physical_textures_.size();
+
+	for (const auto& physical : physical_textures_) {
+		statistics_.physical_bytes += gl::textureBytes(physical->descriptor.format,
+		                                               physical->descriptor.width,
+		                                               physical->descriptor.height,
+		                                               physical->descriptor.levels);
+	}
+}
+
+RenderGraph::PhysicalFramebuffer* RenderGraph::findFramebuffer(const Pass& pass,
+                                                               CommandList& commands) {
+	gl::Texture* colors[gl::max_color_attachments] = {};
+	gl::Texture* depth = nullptr;
+	uint32_t color_count = 0;
+
+	const auto accesses = std::span(accesses_).subspan(pass.first_access, pass.access_count);
+	for (const Access& access : accesses) {
+		if (access.access != GraphAccess::attachment) {
+			continue;
+		}
+
+		const Resource& resource = resources_[access.resource];
+		gl::Texture* texture = resource.texture;
+
+		if (isDepthFormat(resource.descriptor.format)) {
+			assert(depth == nullptr || depth == texture);
+			depth = texture;
+		} else if (std::find(colors, colors + color_count, texture) == colors + color_count) {
+			assert(color_count < gl::max_color_attachments);
+			colors[color_count++] = texture;
+		}
+	}
+
+	if (color_count == 0 && depth == nullptr) {
+		return nullptr;
+	}
+
+	for (auto& physical : physical_framebuffers_) {
+		if (physical->color_count == color_count && physical->depth == depth &&
+		    std::equal(colors, colors + color_count, physical->colors)) {
+			physical->used = true;
+			return physical.get();
+		}
+	}
+
+	auto created = std::make_unique<PhysicalFramebuffer>();
+	std::copy_n(colors, gl::max_color_attachments, created->colors);
+	created->depth = depth;
+	created->color_count = color_count;
+	created->used = true;
+
+	// Recorded after the textures it attaches
+	commands.call(&RenderGraph::constructFramebuffer, uint64_t(uintptr_t(created.get())));
+
+	physical_framebuffers_.push_back(std::move(created));
+	return physical_framebuffers_.back().get();
+}
+
+// Whatever the pass touches that an earlier image or storage write has not
+// been made visible to
+GLbitfield RenderGraph::barrierFor(const Pass& pass) {
+	GLbitfield barriers = 0;
+
+	const auto accesses = std::span(accesses_).subspan(pass.first_access, pass.access_count);
+	for (const Access& access : accesses) {
+		Resource& resource = resources_[access.resource];
+
+		if (resource.previous_alias != no_resource) {
+			resource.unflushed |= std::exchange(resources_[resource.previous_alias].unflushed, 0);
+			resource.previous_alias = no_resource;
+		}
+
+		barriers |= resource.unflushed & barrierFromAccess(access.access, resource.buffer);
+	}
+
+	// One barrier covers every write before it
+	if (barriers != 0) {
+		for (Resource& resource : resources_) {
+			resource.unflushed &= ~barriers;
+		}
+	}
+
+	for (const Access& access : accesses) {
+		if (access.write && incoherent(access.access)) {
+			resources_[access.resource].unflushed = incoherent_write_barriers;
+		}
+	}
+
+	return barriers;
+}
+
+void RenderGraph::execute(CommandList& commands) {
+	statistics_ = {};
+	statistics_.passes = passes_.size();
+
+	cull();
+	allocate(commands);
+
+	for (uint32_t p = 0; p < passes_.size(); ++p) {
+		Pass& pass = passes_[p];
+		if (!pass.live) {
+			continue;
+		}
+
+		const GLbitfield barriers = barrierFor(pass);
+		if (barriers != 0) {
+			commands.memoryBarrier(barriers);
+			++statistics_.barriers;
+		}
+
+		commands.beginScope(pass.name);
+
+		recording_pass_ = p;
+		pass.execute(commands);
+		recording_pass_ = no_pass;
+
+		commands.endScope();
+	}
+
+	for (const Resource& resource : resources_) {
+		if (!resource.imported) {
+			continue;
+		}
+
+		const void* object = resource.buffer ? static_cast<const void*>(resource.buffer_object)
+		                                     : static_cast<const void*>(resource.texture);
+
+		if (resource.unflushed != 0) {
+			imported_unflushed_[object] = resource.unflushed;
+		} else {
+			imported_unflushed_.erase(object);
+		}
+	}
+
+	for (auto& physical : physical_textures_) {
+		physical->unflushed = resources_[physical->last_resource].unflushed;
+	}
+
+	resources_.clear();
+	accesses_.clear();
+	passes_.clear();
+}
+
+void RenderGraph::constructTexture(uint64_t physical) {
+	auto& texture = reinterpret_cast<PhysicalTexture*>(uintptr_t(physical))->texture;
+	const GraphTextureDescriptor& descriptor =
+		reinterpret_cast<PhysicalTexture*>(uintptr_t(physical))->descriptor;
+
+	new (texture.storage) gl::Texture(descriptor.format, descriptor.width, descriptor.height,
+	                                  nullptr, descriptor.levels);
+	texture.constructed = true;
+}
+
+void RenderGraph::constructFramebuffer(uint64_t physical) {
+	auto& self = *reinterpret_cast<PhysicalFramebuffer*>(uintptr_t(physical));
+
+	new (self.framebuffer.storage) gl::Framebuffer(std::span(self.colors, self.color_count),
+	                                               self.depth);
+	self.framebuffer.constructed = true;
+}
+
+void RenderGraph::releaseTexture(void* graph, uint32_t slot) {
+	auto& self = *static_cast<RenderGraph*>(graph);
+
+	std::lock_guard lock(self.mutex_);
+	self.retired_textures_[slot].reset();
+}
+
+void RenderGraph::releaseFramebuffer(void* graph, uint32_t slot) {
+	auto& self = *static_cast<RenderGraph*>(graph);
+
+	std::lock_guard lock(self.mutex_);
+	self.retired_framebuffers_[slot].reset();
+}
+
+} // namespace glint::graphics
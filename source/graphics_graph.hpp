@@ -0,0 +1,221 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "graphics_gl.hpp"
+
+namespace glint::graphics {
+
+class CommandList;
+
+// Virtual resources, valid until the graph next executes
+struct GraphTexture final {
+	uint32_t index;
+};
+
+struct GraphBuffer final {
+	uint32_t index;
+};
+
+struct GraphTextureDescriptor final {
+	GLenum format;
+	uint32_t width;
+	uint32_t height;
+	// As gl::Texture takes it
+	uint32_t levels = 1;
+
+	bool operator==(const GraphTextureDescriptor&) const = default;
+};
+
+// How a pass touches a resource. Accesses after an image or storage write
+// get the barrier they need; attachments are ordered by GL itself.
+enum class GraphAccess : uint8_t {
+	attachment,
+	sampled,
+	image,
+	storage,
+	uniform,
+	vertex,
+	index,
+	indirect,
+	update,
+};
+
+// Of the last execution
+struct GraphStatistics final {
+	uint32_t passes = 0;
+	uint32_t culled_passes = 0;
+	uint32_t barriers = 0;
+	uint32_t transient_textures = 0;
+	uint32_t physical_textures = 0;
+	// The transient textures each on their own, and what they were put on
+	size_t transient_bytes = 0;
+	size_t physical_bytes = 0;
+};
+
+// Passes are declared anew every frame, with the resources they read and
+// write, and run in declaration order. Execution culls the passes nothing
+// kept depends on, places a barrier wherever an image or storage write is
+// next used, and puts transient textures whose lifetimes do not overlap on
+// the same physical texture, each inheriting the writes the one before it
+// left unflushed. Physical textures and the framebuffers over
+// them persist across frames: new ones are created on the thread executing
+// the commands, before the first pass, and ones a frame did without are
+// retired like destroyed resources.
+class RenderGraph final {
+public:
+	using Execute = std::function<void(CommandList&)>;
+
+	RenderGraph() = default;
+	~RenderGraph();
+
+	RenderGraph(const RenderGraph&) = delete;
+	RenderGraph(RenderGraph&&) noexcept = delete;
+
+	RenderGraph& operator=(const RenderGraph&) = delete;
+	RenderGraph& operator=(RenderGraph&&) noexcept = delete;
+
+	// Contents are undefined until a pass writes them
+	GraphTexture createTexture(const GraphTextureDescriptor& descriptor);
+
+	// Resources living past the frame. Passes writing them are always kept,
+	// and their unflushed writes carry over into the next frame.
+	GraphTexture importTexture(gl::Texture& texture);
+	GraphBuffer importBuffer(gl::Buffer& buffer);
+
+	// The reads and writes declared after it belong to the pass. Writing an
+	// attachment without reading it discards what was there.
+	void addPass(const char* name, Execute execute);
+
+	void read(GraphTexture texture, GraphAccess access);
+	void write(GraphTexture texture, GraphAccess access);
+	void read(GraphBuffer buffer, GraphAccess access);
+	void write(GraphBuffer buffer, GraphAccess access);
+
+	// For passes whose results leave the graph, such as drawing to the screen
+	void keep();
+
+	// Records the surviving passes, each in a scope of its name, and clears
+	// the declarations for the next frame
+	void execute(CommandList& commands);
+
+	// Only while a pass records. Transient textures are not constructed yet,
+	// so only their descriptors may be queried.
+	gl::Texture& texture(GraphTexture texture) const;
+	const GraphTextureDescriptor& descriptor(GraphTexture texture) const;
+
+	// Over the recording pass's attachments, colors in declaration order
+	const gl::Framebuffer& framebuffer() const;
+
+	const GraphStatistics& statistics() const noexcept { return statistics_; }
+
+private:
+	static constexpr uint32_t no_pass = UINT32_MAX;
+	static constexpr uint32_t no_resource = UINT32_MAX;
+
+	// Storage for an object constructed on the thread executing the commands
+	template<typename T>
+	struct Deferred {
+		alignas(T) std::byte storage[sizeof(T)];
+		bool constructed = false;
+
+		T& get() noexcept { return *reinterpret_cast<T*>(storage); }
+
+		~Deferred() {
+			if (constructed) {
+				get().~T();
+			}
+		}
+	};
+
+	struct PhysicalTexture {
+		GraphTextureDescriptor descriptor;
+		Deferred<gl::Texture> texture;
+		// Last pass and resource using it this frame
+		uint32_t busy_until;
+		uint32_t last_resource;
+		// What the last resource on it left unflushed, kept across frames
+		GLbitfield unflushed = 0;
+		bool used;
+	};
+
+	struct PhysicalFramebuffer {
+		gl::Texture* colors[gl::max_color_attachments];
+		gl::Texture* depth;
+		uint32_t color_count;
+		Deferred<gl::Framebuffer> framebuffer;
+		bool used;
+	};
+
+	struct Resource {
+		bool buffer;
+		bool imported;
+		GraphTextureDescriptor descriptor;
+		gl::Texture* texture;
+		gl::Buffer* buffer_object;
+		uint32_t first_pass = no_pass;
+		uint32_t last_pass = no_pass;
+		// Of the last image or storage write not yet followed by a barrier
+		// covering each access, or zero
+		GLbitfield unflushed = 0;
+		// Transient placed on the same physical texture before it this frame,
+		// until its unflushed writes are taken over at the first access
+		uint32_t previous_alias = no_resource;
+		bool needed = false;
+	};
+
+	struct Access {
+		uint32_t resource;
+		GraphAccess access;
+		bool write;
+	};
+
+	struct Pass {
+		const char* name;
+		Execute execute;
+		uint32_t first_access;
+		uint32_t access_count;
+		bool kept;
+		bool live;
+		PhysicalFramebuffer* framebuffer;
+	};
+
+	uint32_t addResource(const Resource& resource);
+	void access(uint32_t resource, GraphAccess access, bool write);
+
+	void cull();
+	void allocate(CommandList& commands);
+	PhysicalFramebuffer* findFramebuffer(const Pass& pass, CommandList& commands);
+	GLbitfield barrierFor(const Pass& pass);
+
+	static void constructTexture(uint64_t physical);
+	static void constructFramebuffer(uint64_t physical);
+	static void releaseTexture(void* graph, uint32_t slot);
+	static void releaseFramebuffer(void* graph, uint32_t slot);
+
+	std::vector<Resource> resources_;
+	std::vector<Access> accesses_;
+	std::vector<Pass> passes_;
+	uint32_t recording_pass_ = no_pass;
+
+	std::vector<std::unique_ptr<PhysicalTexture>> physical_textures_;
+	std::vector<std::unique_ptr<PhysicalFramebuffer>> physical_framebuffers_;
+
+	// Unflushed writes of imported resources, by their address
+	std::unordered_map<const void*, GLbitfield> imported_unflushed_;
+
+	// Released on the thread owning the context once no frame uses them
+	std::mutex mutex_;
+	std::vector<std::unique_ptr<PhysicalTexture>> retired_textures_;
+	std::vector<std::unique_ptr<PhysicalFramebuffer>> retired_framebuffers_;
+
+	GraphStatistics statistics_;
+};
+
+} // namespace glint::graphics
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <glm/vec3.hpp>
+
+namespace glint::graphics {
+
+// Hashes the bits of a position, so only exactly equal positions are welded
+struct PositionHash {
+	size_t operator()(const glm::vec3& p) const noexcept {
+		uint32_t bits[3];
+		std::memcpy(bits, &p, sizeof(bits));
+		return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+	}
+};
+
+} // namespace glint::graphics
@@ -0,0 +1,260 @@
+#include "graphics_meshlets.hpp"
+
+#include <cassert>
+#include <cmath>
+#include <algorithm>
+#include <unordered_map>
+
+#include <glm/geometric.hpp>
+
+#include "graphics_hash.hpp"
+
+namespace glint::graphics {
+
+namespace {
+
+constexpr uint8_t no_local = 0xFF;
+
+// Cones wider than this are not worth testing
+constexpr float min_cone_spread = 0.1f;
+
+void finishMeshlet(const std::span<const Vertex> vertices,
+                   const std::span<const uint32_t> indices,
+                   const std::vector<uint32_t>& triangles,
+                   const std::vector<uint32_t>& meshlet_vertices,
+                   std::vector<uint8_t>& local,
+                   Meshlets& out) {
+	Meshlet meshlet{};
+	meshlet.vertex_offset = out.data.size();
+	meshlet.vertex_count = meshlet_vertices.size();
+	meshlet.triangle_offset = meshlet.vertex_offset + meshlet.vertex_count;
+	meshlet.triangle_count = triangles.size();
+
+	glm::vec3 minimum = vertices[meshlet_vertices.front()].position;
+	glm::vec3 maximum = minimum;
+
+	for (uint32_t vertex : meshlet_vertices) {
+		minimum = glm::min(minimum, vertices[vertex].position);
+		maximum = glm::max(maximum, vertices[vertex].position);
+		out.data.push_back(vertex);
+	}
+
+	meshlet.center = (minimum + maximum) * 0.5f;
+	for (uint32_t vertex : meshlet_vertices) {
+		meshlet.radius = std::max(meshlet.radius,
+		                          glm::length(vertices[vertex].position - meshlet.center));
+	}
+
+	glm::vec3 normals[meshlet_max_triangles];
+	uint32_t normal_count = 0;
+	glm::vec3 axis(0.0f);
+
+	for (uint32_t t : triangles) {
+		const uint32_t* corners = indices.data() + t * 3;
+
+		glm::vec3 a = vertices[corners[0]].position;
+		glm::vec3 normal = glm::cross(vertices[corners[1]].position - a,
+		                              vertices[corners[2]].position - a);
+		float length = glm::length(normal);
+
+		if (length > 0.0f) {
+			normals[normal_count++] = normal / length;
+			axis += normal / length;
+		}
+
+		out.data.push_back(uint32_t(local[corners[0]]) |
+		                   uint32_t(local[corners[1]]) << 8 |
+		                   uint32_t(local[corners[2]]) << 16);
+	}
+
+	meshlet.cone_cutoff = 1.0f;
+
+	float axis_length = glm::length(axis);
+	if (axis_length > 0.0f) {
+		meshlet.cone_axis = axis / axis_length;
+
+		float spread = 1.0f;
+		for (uint32_t i = 0; i < normal_count; ++i) {
+			spread = std::min(spread, glm::dot(meshlet.cone_axis, normals[i]));
+		}
+
+		// The cutoff is the sine of the cone's half angle
+		if (spread > min_cone_spread) {
+			meshlet.cone_cutoff = std::sqrt(1.0f - spread * spread);
+		}
+	}
+
+	for (uint32_t vertex : meshlet_vertices) {
+		local[vertex] = no_local;
+	}
+
+	out.meshlets.push_back(meshlet);
+}
+
+// Grows each meshlet from a seed triangle, always taking the neighbour that
+// adds the fewest vertices, so meshlets stay compact and their bounds tight.
+// Neighbours are found by position, which keeps faces with split normals
+// or UVs together.
+void buildLevel(const std::span<const Vertex> vertices,
+                const std::span<const uint32_t> indices,
+                const std::vector<uint32_t>& remap,
+                Meshlets& out) {
+	const uint32_t triangle_count = indices.size() / 3;
+
+	std::vector<uint32_t> triangle_offsets(vertices.size() + 1, 0);
+	for (uint32_t index : indices) {
+		++triangle_offsets[remap[index] + 1];
+	}
+
+	for (size_t v = 0; v < vertices.size(); ++v) {
+		triangle_offsets[v + 1] += triangle_offsets[v];
+	}
+
+	std::vector<uint32_t> triangle_lists(indices.size());
+	{
+		std::vector<uint32_t> next(triangle_offsets.begin(), triangle_offsets.end() - 1);
+		for (uint32_t t = 0; t < triangle_count; ++t) {
+			for (int c = 0; c < 3; ++c) {
+				triangle_lists[next[remap[indices[t * 3 + c]]]++] = t;
+			}
+		}
+	}
+
+	std::vector<uint8_t> emitted(triangle_count, false);
+	std::vector<uint8_t> local(vertices.size(), no_local);
+
+	std::vector<uint32_t> triangles;
+	std::vector<uint32_t> meshlet_vertices;
+	std::vector<uint32_t> candidates;
+
+	auto newVertices = [&](uint32_t t) {
+		const uint32_t* corners = indices.data() + t * 3;
+		return uint32_t(local[corners[0]] == no_local) +
+		       uint32_t(local[corners[1]] == no_local && corners[1] != corners[0]) +
+		       uint32_t(local[corners[2]] == no_local && corners[2] != corners[0] &&
+		                corners[2] != corners[1]);
+	};
+
+	// Ties go to the triangle nearest the meshlet's centroid, which keeps it round
+	glm::vec3 centroid_sum(0.0f);
+
+	auto centroid = [&](uint32_t t) {
+		const uint32_t* corners = indices.data() + t * 3;
+		return (vertices[corners[0]].position + vertices[corners[1]].position +
+		        vertices[corners[2]].position) / 3.0f;
+	};
+
+	auto add = [&](uint32_t t) {
+		emitted[t] = true;
+		triangles.push_back(t);
+		centroid_sum += centroid(t);
+
+		for (int c = 0; c < 3; ++c) {
+			uint32_t vertex = indices[t * 3 + c];
+
+			if (local[vertex] == no_local) {
+				local[vertex] = meshlet_vertices.size();
+				meshlet_vertices.push_back(vertex);
+			}
+
+			uint32_t position = remap[vertex];
+			for (uint32_t i = triangle_offsets[position]; i < triangle_offsets[position + 1]; ++i) {
+				if (!emitted[triangle_lists[i]]) {
+					candidates.push_back(triangle_lists[i]);
+				}
+			}
+		}
+	};
+
+	uint32_t seed = 0;
+
+	while (true) {
+		while (seed < triangle_count && emitted[seed]) {
+			++seed;
+		}
+
+		if (seed == triangle_count) {
+			break;
+		}
+
+		candidates.clear();
+		centroid_sum = glm::vec3(0.0f);
+		add(seed);
+
+		while (triangles.size() < meshlet_max_triangles) {
+			const glm::vec3 center = centroid_sum / float(triangles.size());
+
+			uint32_t best = triangle_count;
+			uint32_t best_cost = 4;
+			float best_distance = 0.0f;
+
+			// Emitted candidates are dropped as they are found
+			size_t write = 0;
+			for (uint32_t t : candidates) {
+				if (emitted[t]) {
+					continue;
+				}
+
+				candidates[write++] = t;
+
+				uint32_t cost = newVertices(t);
+				if (cost > best_cost) {
+					continue;
+				}
+
+				glm::vec3 offset = centroid(t) - center;
+				float distance = glm::dot(offset, offset);
+
+				if (cost < best_cost || distance < best_distance ||
+				    (distance == best_distance && t < best)) {
+					best = t;
+					best_cost = cost;
+					best_distance = distance;
+				}
+			}
+
+			candidates.resize(write);
+
+			if (best == triangle_count ||
+			    meshlet_vertices.size() + best_cost > meshlet_max_vertices) {
+				break;
+			}
+
+			add(best);
+		}
+
+		finishMeshlet(vertices, indices, triangles, meshlet_vertices, local, out);
+		triangles.clear();
+		meshlet_vertices.clear();
+	}
+}
+
+} // namespace
+
+Meshlets buildMeshlets(const std::span<const Vertex> vertices,
+                       const std::span<const uint32_t> indices,
+                       const std::span<const MeshLod> lods) {
+	std::vector<uint32_t> remap(vertices.size());
+	{
+		std::unordered_map<glm::vec3, uint32_t, PositionHash> first_at;
+		first_at.reserve(vertices.size());
+
+		for (uint32_t v = 0; v < vertices.size(); ++v) {
+			remap[v] = first_at.try_emplace(vertices[v].position, v).first->second;
+		}
+	}
+
+	Meshlets meshlets;
+
+	for (const auto& lod : lods) {
+		assert(lod.offset + lod.count <= indices.size() && lod.count % 3 == 0);
+
+		uint32_t first = meshlets.meshlets.size();
+		buildLevel(vertices, indices.subspan(lod.offset, lod.count), remap, meshlets);
+		meshlets.lods.push_back({first, uint32_t(meshlets.meshlets.size()) - first});
+	}
+
+	return meshlets;
+}
+
+} // namespace glint::graphics
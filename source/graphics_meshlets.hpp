@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "graphics.hpp"
+
+namespace glint::graphics {
+
+constexpr uint32_t meshlet_max_vertices = 64;
+constexpr uint32_t meshlet_max_triangles = 124;
+
+// data holds each meshlet's mesh vertex indices from vertex_offset, then its
+// triangles from triangle_offset as three 8 bit local indices per element
+struct Meshlets final {
+	std::vector<Meshlet> meshlets;
+	std::vector<uint32_t> data;
+	std::vector<MeshletRange> lods;
+};
+
+// Splits every level of detail into meshlets, level i owning lods[i]
+Meshlets buildMeshlets(const std::span<const Vertex> vertices,
+                       const std::span<const uint32_t> indices,
+                       const std::span<const MeshLod> lods);
+
+} // namespace glint::graphics
@@ -0,0 +1,750 @@
+#include "graphics_particles.hpp"
+
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <algorithm>
+#include <bit>
+#include <utility>
+#include <vector>
+
+#include "graphics.hpp"
+#include "graphics_commands.hpp"
+
+namespace glint::graphics {
+
+namespace {
+
+constexpr char particle_emit_compute_shader_code[] = R"(
+#version 310 es
+
+layout(local_size_x = 64) in;
+
+layout(std140, binding = 0) uniform ParticleUniforms {
+	mat4 view_projection;
+	mat4 inverse_view_projection;
+	vec4 camera_position_seconds;
+	vec4 camera_right_size;
+	vec4 camera_up_bounce;
+	vec4 emitter_position_radius;
+	vec4 emitter_velocity_spread;
+	vec4 gravity_lifetime;
+	vec4 start_color;
+	vec4 end_color;
+	uvec4 emitted_seed_current_flags;
+	uvec4 capacity_sort_size;
+};
+
+struct Particle {
+	vec4 position_life;
+	vec4 velocity_lifetime;
+};
+
+layout(std430, binding = 0) writeonly buffer Particles {
+	Particle particles[];
+};
+
+layout(std430, binding = 1) buffer Counters {
+	int dead_count;
+	uint alive_counts[2];
+	uvec4 dispatch_command;
+	uvec4 draw_command;
+};
+
+// The dead list, then the two alive lists
+layout(std430, binding = 2) buffer Lists {
+	uint lists[];
+};
+
+uint hash(uint x) {
+	uint state = x * 747796405u + 2891336453u;
+	uint word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+	return (word >> 22u) ^ word;
+}
+
+float random(inout uint state) {
+	state = hash(state);
+	return float(state >> 8u) / 16777216.0f;
+}
+
+vec3 randomInSphere(inout uint state) {
+	float z = random(state) * 2.0f - 1.0f;
+	float angle = random(state) * 6.28318531f;
+	float r = sqrt(1.0f - z * z);
+	return vec3(r * cos(angle), r * sin(angle), z) * pow(random(state), 1.0f / 3.0f);
+}
+
+// Threads that find the dead list empty put back what they took
+void main() {
+	uint thread = gl_GlobalInvocationID.x;
+	if (thread >= emitted_seed_current_flags.x)
+		return;
+
+	int slot = atomicAdd(dead_count, -1) - 1;
+	if (slot < 0) {
+		atomicAdd(dead_count, 1);
+		return;
+	}
+
+	uint index = lists[slot];
+	uint state = hash(thread ^ hash(emitted_seed_current_flags.y));
+
+	vec3 position = emitter_position_radius.xyz +
+	                randomInSphere(state) * emitter_position_radius.w;
+	vec3 velocity = emitter_velocity_spread.xyz +
+	                randomInSphere(state) * emitter_velocity_spread.w;
+
+	particles[index] = Particle(vec4(position, gravity_lifetime.w),
+	                            vec4(velocity, gravity_lifetime.w));
+
+	uint current = emitted_seed_current_flags.z;
+	uint capacity = capacity_sort_size.x;
+	lists[(1u + current) * capacity + atomicAdd(alive_counts[current], 1u)] = index;
+}
+)";
+
+constexpr char particle_prepare_compute_shader_code[] = R"(
+#version 310 es
+
+layout(local_size_x = 1) in;
+
+layout(location = 0) uniform uint current;
+layout(location = 1) uniform uint finish;
+
+layout(std430, binding = 1) buffer Counters {
+	int dead_count;
+	uint alive_counts[2];
+	uvec4 dispatch_command;
+	uvec4 draw_command;
+};
+
+// Sizes the simulation to the alive list and empties the one it fills, or
+// once finished hands the filled one's length to the draw
+void main() {
+	if (finish == 0u) {
+		dispatch_command = uvec4((alive_counts[current] + 63u) / 64u, 1u, 1u, 0u);
+		alive_counts[1u - current] = 0u;
+	} else {
+		draw_command = uvec4(4u, alive_counts[1u - current], 0u, 0u);
+	}
+}
+)";
+
+constexpr char particle_simulate_compute_shader_code[] = R"(
+#version 310 es
+
+layout(local_size_x = 64) in;
+
+layout(std140, binding = 0) uniform ParticleUniforms {
+	mat4 view_projection;
+	mat4 inverse_view_projection;
+	vec4 camera_position_seconds;
+	vec4 camera_right_size;
+	vec4 camera_up_bounce;
+	vec4 emitter_position_radius;
+	vec4 emitter_velocity_spread;
+	vec4 gravity_lifetime;
+	vec4 start_color;
+	vec4 end_color;
+	uvec4 emitted_seed_current_flags;
+	uvec4 capacity_sort_size;
+};
+
+struct Particle {
+	vec4 position_life;
+	vec4 velocity_lifetime;
+};
+
+layout(std430, binding = 0) buffer Particles {
+	Particle particles[];
+};
+
+layout(std430, binding = 1) buffer Counters {
+	int dead_count;
+	uint alive_counts[2];
+	uvec4 dispatch_command;
+	uvec4 draw_command;
+};
+
+layout(std430, binding = 2) buffer Lists {
+	uint lists[];
+};
+
+// Farthest first, keyed by squared distance with the bits flipped
+layout(std430, binding = 3) writeonly buffer SortEntries {
+	uvec2 entries[];
+};
+
+layout(binding = 0) uniform highp sampler2D scene_depth;
+
+const uint collide_flag = 1u;
+const uint sorted_flag = 2u;
+
+// Surfaces are taken to be this thick, particles farther behind pass
+const float thickness = 0.5f;
+
+vec3 surfacePoint(ivec2 pixel) {
+	vec2 ndc = (vec2(pixel) + 0.5f) / vec2(textureSize(scene_depth, 0)) * 2.0f - 1.0f;
+	float depth = texelFetch(scene_depth, pixel, 0).r * 2.0f - 1.0f;
+	vec4 world = inverse_view_projection * vec4(ndc, depth, 1.0f);
+
+	return world.xyz / world.w;
+}
+
+// Negative at the far plane, where nothing was drawn
+float surfaceDistance(ivec2 pixel) {
+	if (texelFetch(scene_depth, pixel, 0).r >= 1.0f)
+		return -1.0f;
+
+	return distance(surfacePoint(pixel), camera_position_seconds.xyz);
+}
+
+void main() {
+	uint current = emitted_seed_current_flags.z;
+	uint flags = emitted_seed_current_flags.w;
+	uint capacity = capacity_sort_size.x;
+
+	uint thread = gl_GlobalInvocationID.x;
+	if (thread >= alive_counts[current])
+		return;
+
+	uint index = lists[(1u + current) * capacity + thread];
+	Particle particle = particles[index];
+
+	float seconds = camera_position_seconds.w;
+	float life = particle.position_life.w - seconds;
+
+	if (life <= 0.0f) {
+		lists[atomicAdd(dead_count, 1)] = index;
+		return;
+	}
+
+	vec3 velocity = particle.velocity_lifetime.xyz + gravity_lifetime.xyz * seconds;
+	vec3 position = particle.position_life.xyz + velocity * seconds;
+
+	// Particles that went into a surface bounce off it from where they were
+	vec4 clip = view_projection * vec4(position, 1.0f);
+	if ((flags & collide_flag) != 0u && clip.w > 0.0f &&
+	    all(lessThan(abs(clip.xy), vec2(clip.w)))) {
+		ivec2 size = textureSize(scene_depth, 0);
+		ivec2 pixel = min(ivec2((clip.xy / clip.w * 0.5f + 0.5f) * vec2(size)), size - 2);
+
+		float surface = surfaceDistance(pixel);
+		float depth = length(position - camera_position_seconds.xyz);
+
+		if (surface > 0.0f && depth > surface && depth < surface + thickness) {
+			float right = surfaceDistance(pixel + ivec2(1, 0));
+			float up = surfaceDistance(pixel + ivec2(0, 1));
+
+			vec3 point = surfacePoint(pixel);
+			vec3 normal = normalize(camera_position_seconds.xyz - point);
+
+			if (right > 0.0f && up > 0.0f) {
+				vec3 tangents = cross(surfacePoint(pixel + ivec2(1, 0)) - point,
+				                      surfacePoint(pixel + ivec2(0, 1)) - point);
+				if (dot(tangents, tangents) > 0.0f)
+					normal = faceforward(normalize(tangents), point - camera_position_seconds.xyz,
+					                     normalize(tangents));
+			}
+
+			if (dot(velocity, normal) < 0.0f)
+				velocity = reflect(velocity, normal) * camera_up_bounce.w;
+
+			position = particle.position_life.xyz;
+		}
+	}
+
+	particles[index] = Particle(vec4(position, life),
+	                            vec4(velocity, particle.velocity_lifetime.w));
+
+	uint next = 1u - current;
+	uint slot = atomicAdd(alive_counts[next], 1u);
+	lists[(1u + next) * capacity + slot] = index;
+
+	if ((flags & sorted_flag) != 0u) {
+		vec3 offset = position - camera_position_seconds.xyz;
+		entries[slot] = uvec2(~floatBitsToUint(dot(offset, offset)), index);
+	}
+}
+)";
+
+// Bitonic sort of blocks in shared memory. With stage zero it sorts each
+// block from scratch, padding past the alive particles with the largest key.
+// Otherwise it finishes the merge of that stage once pairs fit in a block.
+constexpr char particle_sort_local_compute_shader_code[] = R"(
+#version 310 es
+
+layout(local_size_x = 128) in;
+
+layout(location = 0) uniform uint stage;
+layout(location = 1) uniform uint alive_list;
+
+layout(std430, binding = 1) buffer Counters {
+	int dead_count;
+	uint alive_counts[2];
+	uvec4 dispatch_command;
+	uvec4 draw_command;
+};
+
+layout(std430, binding = 3) buffer SortEntries {
+	uvec2 entries[];
+};
+
+const uint block_size = 256u;
+
+shared uvec2 block[block_size];
+
+void compareExchange(uint base, uint stride, uint size) {
+	barrier();
+
+	uint thread = gl_LocalInvocationID.x;
+	uint i = thread / stride * 2u * stride + thread % stride;
+	uint j = i + stride;
+
+	uvec2 a = block[i];
+	uvec2 b = block[j];
+	if ((a.x > b.x) == (((base + i) & size) == 0u)) {
+		block[i] = b;
+		block[j] = a;
+	}
+}
+
+void main() {
+	uint base = gl_WorkGroupID.x * block_size;
+	uint alive = alive_counts[alive_list];
+
+	for (uint i = gl_LocalInvocationID.x; i < block_size; i += gl_WorkGroupSize.x) {
+		bool padding = stage == 0u && base + i >= alive;
+		block[i] = padding ? uvec2(0xFFFFFFFFu, 0u) : entries[base + i];
+	}
+
+	if (stage == 0u) {
+		for (uint size = 2u; size <= block_size; size <<= 1u) {
+			for (uint stride = size >> 1u; stride > 0u; stride >>= 1u) {
+				compareExchange(base, stride, size);
+			}
+		}
+	} else {
+		for (uint stride = block_size >> 1u; stride > 0u; stride >>= 1u) {
+			compareExchange(base, stride, stage);
+		}
+	}
+
+	barrier();
+
+	for (uint i = gl_LocalInvocationID.x; i < block_size; i += gl_WorkGroupSize.x) {
+		entries[base + i] = block[i];
+	}
+}
+)";
+
+// One step of a bitonic merge with pairs further apart than a block
+constexpr char particle_sort_global_compute_shader_code[] = R"(
+#version 310 es
+
+layout(local_size_x = 128) in;
+
+layout(location = 0) uniform uint stage;
+layout(location = 1) uniform uint stride;
+
+layout(std430, binding = 3) buffer SortEntries {
+	uvec2 entries[];
+};
+
+void main() {
+	uint thread = gl_GlobalInvocationID.x;
+	uint i = thread / stride * 2u * stride + thread % stride;
+	uint j = i + stride;
+
+	uvec2 a = entries[i];
+	uvec2 b = entries[j];
+	if ((a.x > b.x) == ((i & stage) == 0u)) {
+		entries[i] = b;
+		entries[j] = a;
+	}
+}
+)";
+
+constexpr char particle_vertex_shader_code[] = R"(
+#version 310 es
+
+layout(location = 0) in vec2 in_position;
+
+layout(std140, binding = 0) uniform ParticleUniforms {
+	mat4 view_projection;
+	mat4 inverse_view_projection;
+	vec4 camera_position_seconds;
+	vec4 camera_right_size;
+	vec4 camera_up_bounce;
+	vec4 emitter_position_radius;
+	vec4 emitter_velocity_spread;
+	vec4 gravity_lifetime;
+	vec4 start_color;
+	vec4 end_color;
+	uvec4 emitted_seed_current_flags;
+	uvec4 capacity_sort_size;
+};
+
+struct Particle {
+	vec4 position_life;
+	vec4 velocity_lifetime;
+};
+
+layout(std430, binding = 0) readonly buffer Particles {
+	Particle particles[];
+};
+
+// The sort entries, or the alive list the simulation filled
+layout(std430, binding = 1) readonly buffer Order {
+	uint order[];
+};
+
+const uint sorted_flag = 2u;
+
+out vec2 f_uv;
+out vec4 f_color;
+
+void main() {
+	uint instance = uint(gl_InstanceID);
+	uint next = 1u - emitted_seed_current_flags.z;
+
+	uint index = (emitted_seed_current_flags.w & sorted_flag) != 0u
+	           ? order[2u * instance + 1u]
+	           : order[(1u + next) * capacity_sort_size.x + instance];
+
+	Particle particle = particles[index];
+	float age = 1.0f - particle.position_life.w / particle.velocity_lifetime.w;
+
+	vec3 offset = camera_right_size.xyz * in_position.x + camera_up_bounce.xyz * in_position.y;
+	vec3 position = particle.position_life.xyz + offset * camera_right_size.w;
+
+	gl_Position = view_projection * vec4(position, 1.0f);
+	f_uv = in_position;
+	f_color = mix(start_color, end_color, age);
+}
+)";
+
+constexpr char particle_fragment_shader_code[] = R"(
+#version 310 es
+precision mediump float;
+
+in vec2 f_uv;
+in vec4 f_color;
+
+out vec4 frag_color;
+
+void main() {
+	float alpha = f_color.a * clamp(1.0f - dot(f_uv, f_uv), 0.0f, 1.0f);
+
+	if (alpha <= 0.0f)
+		discard;
+
+	frag_color = vec4(f_color.rgb, alpha);
+}
+)";
+
+struct ParticleUniforms {
+	glm::mat4 view_projection;
+	glm::mat4 inverse_view_projection;
+	glm::vec4 camera_position_seconds;
+	glm::vec4 camera_right_size;
+	glm::vec4 camera_up_bounce;
+	glm::vec4 emitter_position_radius;
+	glm::vec4 emitter_velocity_spread;
+	glm::vec4 gravity_lifetime;
+	glm::vec4 start_color;
+	glm::vec4 end_color;
+	glm::uvec4 emitted_seed_current_flags;
+	glm::uvec4 capacity_sort_size;
+};
+
+struct Particle {
+	glm::vec4 position_life;
+	glm::vec4 velocity_lifetime;
+};
+
+struct ParticleCounters {
+	int32_t dead_count;
+	uint32_t alive_counts[2];
+	uint32_t padding;
+	gl::DispatchIndirectCommand dispatch;
+	uint32_t dispatch_padding;
+	gl::DrawArraysIndirectCommand draw;
+};
+
+static_assert(offsetof(ParticleCounters, dispatch) == 16);
+static_assert(offsetof(ParticleCounters, draw) == 32);
+
+constexpr uint32_t collide_flag = 1;
+constexpr uint32_t sorted_flag = 2;
+
+constexpr uint32_t particle_group_size = 64;
+constexpr uint32_t sort_group_size = 128;
+constexpr uint32_t sort_block_size = 256;
+
+constexpr int32_t current_location = 0;
+constexpr int32_t finish_location = 1;
+constexpr int32_t stage_location = 0;
+constexpr int32_t stride_location = 1;
+constexpr int32_t alive_list_location = 1;
+
+gl::Buffer* unit_quad_vertex_buffer;
+
+gl::ComputePipeline* emit_pipeline;
+gl::ComputePipeline* prepare_pipeline;
+gl::ComputePipeline* simulate_pipeline;
+gl::ComputePipeline* sort_local_pipeline;
+gl::ComputePipeline* sort_global_pipeline;
+
+gl::Shader* particle_vertex_shader;
+gl::Shader* particle_fragment_shader;
+gl::Pipeline* blended_pipeline;
+gl::Pipeline* additive_pipeline;
+
+// Dead list holding every slot, alive lists empty
+std::vector<uint32_t> initialLists(uint32_t capacity) {
+	std::vector<uint32_t> lists(3 * size_t(capacity), 0);
+	for (uint32_t i = 0; i < capacity; ++i) {
+		lists[i] = capacity - 1 - i;
+	}
+
+	return lists;
+}
+
+ParticleCounters initialCounters(uint32_t capacity) {
+	return {
+		.dead_count = int32_t(capacity),
+		.alive_counts = {0, 0},
+		.padding = 0,
+		.dispatch = {0, 1, 1},
+		.dispatch_padding = 0,
+		.draw = {4, 0, 0},
+	};
+}
+
+} // namespace
+
+ParticleSystem::ParticleSystem(uint32_t capacity)
+: capacity_{capacity},
+  sort_size_{std::max(std::bit_ceil(capacity), sort_block_size)},
+  particles_(GL_SHADER_STORAGE_BUFFER, GL_DYNAMIC_DRAW, gl::MemoryCategory::scene,
+             size_t(capacity) * sizeof(Particle)),
+  lists_(GL_SHADER_STORAGE_BUFFER, GL_DYNAMIC_DRAW, gl::MemoryCategory::scene,
+         3 * size_t(capacity) * sizeof(uint32_t)),
+  counters_(GL_SHADER_STORAGE_BUFFER, GL_DYNAMIC_DRAW, gl::MemoryCategory::scene,
+            sizeof(ParticleCounters)),
+  sort_entries_(GL_SHADER_STORAGE_BUFFER, GL_DYNAMIC_DRAW, gl::MemoryCategory::scene,
+                size_t(sort_size_) * 2 * sizeof(uint32_t)),
+  uniforms_(GL_UNIFORM_BUFFER, GL_DYNAMIC_DRAW, sizeof(ParticleUniforms)) {
+	assert(capacity > 0 && capacity <= (1u << 24));
+
+	const std::vector<uint32_t> lists = initialLists(capacity);
+	lists_.assign(lists.size() * sizeof(uint32_t), lists.data());
+
+	const ParticleCounters counters = initialCounters(capacity);
+	counters_.assign(sizeof(counters), &counters);
+}
+
+void ParticleSystem::advance(float seconds) {
+	seconds_ += seconds;
+	emission_ += emitter_.rate * seconds;
+}
+
+void ParticleSystem::simulate(CommandList& commands, const Camera& camera,
+                              const glm::mat4& view_projection,
+                              const ParticleCollision* collision) {
+	// Whatever the rate adds up to past the capacity could never find a slot
+	const float whole = std::floor(emission_);
+	emitted_ = uint32_t(std::min(whole, float(capacity_)));
+	emission_ -= whole;
+
+	sorted_ = emitter_.sorted;
+
+	const glm::quat orientation = camera.calculateOrientation();
+	const uint32_t flags = (collision != nullptr ? collide_flag : 0) |
+	                       (sorted_ ? sorted_flag : 0);
+
+	ParticleUniforms uniforms{
+		.view_projection = view_projection,
+		.inverse_view_projection = glm::inverse(view_projection),
+		.camera_position_seconds = glm::vec4(camera.position, seconds_),
+		.camera_right_size = glm::vec4(orientation * glm::vec3(1.0f, 0.0f, 0.0f), emitter_.size),
+		.camera_up_bounce = glm::vec4(orientation * glm::vec3(0.0f, 1.0f, 0.0f), emitter_.bounce),
+		.emitter_position_radius = glm::vec4(emitter_.position, emitter_.radius),
+		.emitter_velocity_spread = glm::vec4(emitter_.velocity, emitter_.spread),
+		.gravity_lifetime = glm::vec4(emitter_.gravity, emitter_.lifetime),
+		.start_color = emitter_.start_color,
+		.end_color = emitter_.end_color,
+		.emitted_seed_current_flags = {emitted_, seed_++, current_, flags},
+		.capacity_sort_size = {capacity_, sort_size_, 0, 0},
+	};
+	commands.assign(uniforms_, sizeof(uniforms), &uniforms);
+
+	seconds_ = 0.0f;
+
+	commands.beginScope("particles");
+
+	commands.setUniformBuffer(uniforms_, 0);
+	commands.setStorageBuffer(particles_, 0);
+	commands.setStorageBuffer(counters_, 1);
+	commands.setStorageBuffer(lists_, 2);
+	commands.setStorageBuffer(sort_entries_, 3);
+
+	if (emitted_ != 0) {
+		commands.setComputePipeline(*emit_pipeline);
+		commands.dispatch((emitted_ + particle_group_size - 1) / particle_group_size);
+		commands.memoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+	}
+
+	commands.setComputePipeline(*prepare_pipeline);
+	commands.setUniform(current_location, current_);
+	commands.setUniform(finish_location, 0);
+	commands.dispatch(1);
+	commands.memoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+
+	if (collision != nullptr) {
+		commands.setTexture(collision->depth, collision->sampler, 0);
+	}
+
+	commands.setComputePipeline(*simulate_pipeline);
+	commands.dispatchIndirect(counters_, offsetof(ParticleCounters, dispatch));
+	commands.memoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+	commands.setComputePipeline(*prepare_pipeline);
+	commands.setUniform(current_location, current_);
+	commands.setUniform(finish_location, 1);
+	commands.dispatch(1);
+	commands.memoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+
+	current_ = 1 - current_;
+
+	if (sorted_) {
+		commands.endScope();
+		commands.beginScope("particle sort");
+
+		const uint32_t blocks = sort_size_ / sort_block_size;
+		const uint32_t pair_groups = sort_size_ / 2 / sort_group_size;
+
+		commands.setComputePipeline(*sort_local_pipeline);
+		commands.setUniform(stage_location, 0);
+		commands.setUniform(alive_list_location, current_);
+		commands.dispatch(blocks);
+		commands.memoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+		for (uint32_t stage = 2 * sort_block_size; stage <= sort_size_; stage <<= 1) {
+			commands.setComputePipeline(*sort_global_pipeline);
+			commands.setUniform(stage_location, stage);
+
+			for (uint32_t stride = stage >> 1; stride >= sort_block_size; stride >>= 1) {
+				commands.setUniform(stride_location, stride);
+				commands.dispatch(pair_groups);
+				commands.memoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+			}
+
+			commands.setComputePipeline(*sort_local_pipeline);
+			commands.setUniform(stage_location, stage);
+			commands.setUniform(alive_list_location, current_);
+			commands.dispatch(blocks);
+			commands.memoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+		}
+	}
+
+	commands.endScope();
+}
+
+void ParticleSystem::draw(CommandList& commands) {
+	commands.beginScope("particle draw");
+
+	commands.setPipeline(sorted_ ? *blended_pipeline : *additive_pipeline);
+	commands.setVertexBuffer(*unit_quad_vertex_buffer);
+	commands.setUniformBuffer(uniforms_, 0);
+	commands.setStorageBuffer(particles_, 0);
+	commands.setStorageBuffer(sorted_ ? sort_entries_ : lists_, 1);
+	commands.drawIndirect(counters_, offsetof(ParticleCounters, draw));
+
+	commands.endScope();
+}
+
+void setupParticles() {
+	const float unit_quad_vertices[] = {
+		-1.0f, -1.0f,
+		1.0f, -1.0f,
+		-1.0f, 1.0f,
+		1.0f, 1.0f,
+	};
+
+	unit_quad_vertex_buffer = new gl::Buffer(GL_ARRAY_BUFFER, GL_STATIC_DRAW,
+	                                         sizeof(unit_quad_vertices), unit_quad_vertices);
+
+	const std::pair<gl::ComputePipeline**, const char*> computes[] = {
+		{&emit_pipeline, particle_emit_compute_shader_code},
+		{&prepare_pipeline, particle_prepare_compute_shader_code},
+		{&simulate_pipeline, particle_simulate_compute_shader_code},
+		{&sort_local_pipeline, particle_sort_local_compute_shader_code},
+		{&sort_global_pipeline, particle_sort_global_compute_shader_code},
+	};
+
+	for (const auto& [pipeline, code] : computes) {
+		gl::Shader shader(GL_COMPUTE_SHADER, code);
+		*pipeline = new gl::ComputePipeline(shader);
+	}
+
+	particle_vertex_shader = new gl::Shader(GL_VERTEX_SHADER, particle_vertex_shader_code);
+	particle_fragment_shader = new gl::Shader(GL_FRAGMENT_SHADER, particle_fragment_shader_code);
+
+	const gl::VertexAttribute vertex_layout[] = {
+		{0, GL_FLOAT, 2, false},
+	};
+
+	// Tested against the scene, but not written, so particles never hide
+	// each other
+	const gl::PrimitiveState primitive_state{
+		.mode = GL_TRIANGLE_STRIP,
+		.cull_mode = GL_NONE,
+	};
+
+	const gl::DepthStencilState depth_stencil_state{
+		.depth_write = false,
+	};
+
+	blended_pipeline = new gl::Pipeline(
+		primitive_state,
+		vertex_layout,
+		*particle_vertex_shader,
+		*particle_fragment_shader,
+		depth_stencil_state,
+		gl::BlendState{
+			.enable = true,
+			.color_src_factor = GL_SRC_ALPHA,
+			.color_dst_factor = GL_ONE_MINUS_SRC_ALPHA,
+		});
+
+	additive_pipeline = new gl::Pipeline(
+		primitive_state,
+		vertex_layout,
+		*particle_vertex_shader,
+		*particle_fragment_shader,
+		depth_stencil_state,
+		gl::BlendState{
+			.enable = true,
+			.color_src_factor = GL_SRC_ALPHA,
+			.color_dst_factor = GL_ONE,
+		});
+}
+
+void shutdownParticles() {
+	delete additive_pipeline;
+	delete blended_pipeline;
+	delete particle_fragment_shader;
+	delete particle_vertex_shader;
+
+	delete sort_global_pipeline;
+	delete sort_local_pipeline;
+	delete simulate_pipeline;
+	delete prepare_pipeline;
+	delete emit_pipeline;
+
+	delete unit_quad_vertex_buffer;
+}
+
+} // namespace glint::graphics
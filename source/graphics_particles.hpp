@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstdint>
+
+#include <glm/ext/vector_float3.hpp>
+#include <glm/ext/vector_float4.hpp>
+#include <glm/ext/matrix_float4x4.hpp>
+
+#include "graphics_gl.hpp"
+
+namespace glint::graphics {
+
+class CommandList;
+struct Camera;
+
+struct ParticleEmitter final {
+	glm::vec3 position = glm::vec3(0.0f);
+	// Particles spawn anywhere within this distance of the position
+	float radius = 0.0f;
+	glm::vec3 velocity = glm::vec3(0.0f, 1.0f, 0.0f);
+	// Added to velocity in a random direction, up to this length
+	float spread = 0.0f;
+	glm::vec3 gravity = glm::vec3(0.0f, -9.81f, 0.0f);
+	// Particles per second, past the capacity they are dropped
+	float rate = 0.0f;
+	float lifetime = 1.0f;
+	// Fraction of velocity kept bouncing off the depth buffer
+	float bounce = 0.5f;
+	float size = 0.05f;
+	glm::vec4 start_color = glm::vec4(1.0f);
+	glm::vec4 end_color = glm::vec4(1.0f, 1.0f, 1.0f, 0.0f);
+	// Sorted back to front and alpha blended, otherwise added up unsorted
+	bool sorted = true;
+};
+
+// The scene's depth, as the deferred path's g-buffer keeps it
+struct ParticleCollision final {
+	const gl::Texture& depth;
+	const gl::Sampler& sampler;
+};
+
+// Particles live in storage buffers only; the CPU hands over how many to
+// spawn and the emitter, everything else runs in compute shaders. Each frame
+// spawns into slots popped off a dead list, advances the alive list into a
+// compacted one, pushing expired slots back, and draws the survivors as
+// camera-facing quads, instanced through a command the GPU fills in. Sorted
+// systems order the survivors by distance with a bitonic sort.
+class ParticleSystem final {
+public:
+	explicit ParticleSystem(uint32_t capacity);
+	~ParticleSystem() = default;
+
+	ParticleSystem(const ParticleSystem&) = delete;
+	ParticleSystem(ParticleSystem&&) noexcept = delete;
+
+	ParticleSystem& operator=(const ParticleSystem&) = delete;
+	ParticleSystem& operator=(ParticleSystem&&) noexcept = delete;
+
+	ParticleEmitter& emitter() noexcept { return emitter_; }
+	const ParticleEmitter& emitter() const noexcept { return emitter_; }
+
+	// Steps the next simulation by seconds, emitting what the rate adds up to
+	void advance(float seconds);
+
+	// Records the frame's simulation, colliding with the scene when given,
+	// as seen through view_projection. Called by render().
+	void simulate(CommandList& commands, const Camera& camera, const glm::mat4& view_projection,
+	              const ParticleCollision* collision);
+
+	// Inside a pass with the depth the scene was drawn with
+	void draw(CommandList& commands);
+
+	uint32_t capacity() const noexcept { return capacity_; }
+	// Spawned by the last simulation, some may have found no free slot
+	uint32_t emitted() const noexcept { return emitted_; }
+
+private:
+	ParticleEmitter emitter_;
+	uint32_t capacity_;
+	// Elements the sort runs over, a power of two
+	uint32_t sort_size_;
+
+	float seconds_ = 0.0f;
+	float emission_ = 0.0f;
+	uint32_t emitted_ = 0;
+	uint32_t seed_ = 0;
+	// Alive list the next simulation reads, the other one it writes
+	uint32_t current_ = 0;
+	// As the emitter was when the last simulation was recorded
+	bool sorted_ = true;
+
+	gl::Buffer particles_;
+	// Dead list, then the two alive lists
+	gl::Buffer lists_;
+	gl::Buffer counters_;
+	gl::Buffer sort_entries_;
+	gl::Buffer uniforms_;
+};
+
+// Owned by graphics::setup() and graphics::shutdown()
+void setupParticles();
+void shutdownParticles();
+
+} // namespace glint::graphics
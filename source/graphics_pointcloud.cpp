@@ -0,0 +1,382 @@
+#include "graphics_pointcloud.hpp"
+
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <queue>
+#include <stdexcept>
+#include <algorithm>
+
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "graphics.hpp"
+#include "graphics_commands.hpp"
+#include "scene_bvh.hpp"
+
+namespace glint::graphics {
+
+namespace {
+
+constexpr uint32_t file_magic = 0x4350'4C47; // "GLPC"
+constexpr uint32_t file_version = 1;
+
+// Deep enough for any real scan, it only stops stacks of duplicate points
+constexpr uint32_t max_level = 20;
+
+struct FileHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t node_count;
+	uint32_t node_capacity;
+	uint32_t grid;
+	uint32_t reserved;
+	uint64_t point_count;
+};
+
+static_assert(sizeof(FileHeader) % alignof(PointCloudNode) == 0);
+
+struct BuildNode {
+	glm::vec3 minimum;
+	float size;
+	uint32_t level;
+	std::vector<CloudPoint> points;
+};
+
+void* mapFile(const std::string& path, size_t& size) {
+#if defined(_WIN32)
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+	                          OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		return nullptr;
+	}
+
+	LARGE_INTEGER file_size;
+	HANDLE mapping = nullptr;
+	if (GetFileSizeEx(file, &file_size) && file_size.QuadPart != 0) {
+		mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	}
+
+	CloseHandle(file);
+	if (mapping == nullptr) {
+		return nullptr;
+	}
+
+	// The view keeps the mapping alive
+	void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle(mapping);
+
+	size = size_t(file_size.QuadPart);
+	return data;
+#else
+	int file = open(path.c_str(), O_RDONLY);
+	if (file < 0) {
+		return nullptr;
+	}
+
+	struct stat status;
+	void* data = MAP_FAILED;
+	if (fstat(file, &status) == 0 && status.st_size != 0) {
+		data = mmap(nullptr, size_t(status.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+	}
+
+	close(file);
+	if (data == MAP_FAILED) {
+		return nullptr;
+	}
+
+	size = size_t(status.st_size);
+	return data;
+#endif
+}
+
+uint32_t slotCount(uint32_t resident_points) {
+	return std::max(resident_points / point_cloud_node_capacity, 1u);
+}
+
+void unmapFile(void* data, [[maybe_unused]] size_t size) {
+#if defined(_WIN32)
+	UnmapViewOfFile(data);
+#else
+	munmap(data, size);
+#endif
+}
+
+} // namespace
+
+void writePointCloud(const std::span<const CloudPoint> points, const std::string& path) {
+	assert(!points.empty());
+
+	glm::vec3 minimum = points.front().position;
+	glm::vec3 maximum = minimum;
+	for (const auto& point : points) {
+		minimum = glm::min(minimum, point.position);
+		maximum = glm::max(maximum, point.position);
+	}
+
+	// Grown a little so the far faces still fall inside the last cell
+	const glm::vec3 extent = maximum - minimum;
+	const float size = std::max({extent.x, extent.y, extent.z, 1e-6f}) * 1.0001f;
+
+	std::vector<PointCloudNode> nodes;
+	std::vector<CloudPoint> kept;
+	std::vector<uint64_t> occupied(point_cloud_grid * point_cloud_grid * point_cloud_grid / 64);
+
+	// Nodes are finished in index order, so their points come out in it too
+	std::queue<BuildNode> pending;
+	pending.push({minimum, size, 0, {points.begin(), points.end()}});
+	nodes.push_back({});
+
+	for (uint32_t index = 0; !pending.empty(); ++index) {
+		BuildNode node = std::move(pending.front());
+		pending.pop();
+
+		std::fill(occupied.begin(), occupied.end(), 0);
+
+		std::vector<CloudPoint> octants[8];
+		const float cell_scale = float(point_cloud_grid) / node.size;
+		const glm::vec3 center = node.minimum + node.size * 0.5f;
+
+		const uint64_t first = kept.size();
+
+		for (const auto& point : node.points) {
+			const glm::uvec3 cell = glm::min(glm::uvec3((point.position - node.minimum) * cell_scale),
+			                                 glm::uvec3(point_cloud_grid - 1));
+			const uint32_t bit = (cell.z * point_cloud_grid + cell.y) * point_cloud_grid + cell.x;
+			const uint64_t mask = uint64_t(1) << (bit % 64);
+
+			if (!(occupied[bit / 64] & mask) && kept.size() - first < point_cloud_node_capacity) {
+				occupied[bit / 64] |= mask;
+				kept.push_back(point);
+			} else if (node.level < max_level) {
+				const uint32_t octant = uint32_t(point.position.x >= center.x) |
+				                        uint32_t(point.position.y >= center.y) << 1 |
+				                        uint32_t(point.position.z >= center.z) << 2;
+				octants[octant].push_back(point);
+			}
+		}
+
+		node.points = {};
+
+		nodes[index] = {
+			.minimum = node.minimum,
+			.size = node.size,
+			.first = first,
+			.count = uint32_t(kept.size() - first),
+			.level = node.level,
+			.children = {},
+		};
+
+		const float half = node.size * 0.5f;
+		for (uint32_t octant = 0; octant < 8; ++octant) {
+			if (octants[octant].empty()) {
+				continue;
+			}
+
+			const glm::vec3 offset(octant & 1 ? half : 0.0f,
+			                       octant & 2 ? half : 0.0f,
+			                       octant & 4 ? half : 0.0f);
+
+			nodes[index].children[octant] = nodes.size();
+			nodes.push_back({});
+			pending.push({node.minimum + offset, half, node.level + 1, std::move(octants[octant])});
+		}
+	}
+
+	const FileHeader header{
+		.magic = file_magic,
+		.version = file_version,
+		.node_count = uint32_t(nodes.size()),
+		.node_capacity = point_cloud_node_capacity,
+		.grid = point_cloud_grid,
+		.reserved = 0,
+		.point_count = kept.size(),
+	};
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(nodes.data()), nodes.size() * sizeof(PointCloudNode));
+	file.write(reinterpret_cast<const char*>(kept.data()), kept.size() * sizeof(CloudPoint));
+
+	if (!file) {
+		throw std::runtime_error("Failed to write point cloud " + path);
+	}
+}
+
+PointCloud::PointCloud(const std::string& path, uint32_t resident_points)
+: buffer_(GL_SHADER_STORAGE_BUFFER, GL_DYNAMIC_DRAW, gl::MemoryCategory::mesh,
+          size_t(slotCount(resident_points)) * point_cloud_node_capacity * sizeof(CloudPoint)),
+  draw_buffer_(GL_SHADER_STORAGE_BUFFER, GL_DYNAMIC_DRAW, gl::MemoryCategory::scene,
+               slotCount(resident_points) * sizeof(Draw)) {
+	mapping_ = mapFile(path, mapping_size_);
+	if (mapping_ == nullptr) {
+		throw std::runtime_error("Failed to map point cloud " + path);
+	}
+
+	FileHeader header{};
+	if (mapping_size_ >= sizeof(FileHeader)) {
+		std::memcpy(&header, mapping_, sizeof(FileHeader));
+	}
+
+	const size_t expected = sizeof(FileHeader) + size_t(header.node_count) * sizeof(PointCloudNode) +
+	                        size_t(header.point_count) * sizeof(CloudPoint);
+
+	if (header.magic != file_magic || header.version != file_version ||
+	    header.node_capacity != point_cloud_node_capacity || header.grid != point_cloud_grid ||
+	    header.node_count == 0 || mapping_size_ < expected) {
+		unmapFile(mapping_, mapping_size_);
+		throw std::runtime_error("Not a point cloud " + path);
+	}
+
+	const auto* bytes = static_cast<const std::byte*>(mapping_);
+	nodes_ = reinterpret_cast<const PointCloudNode*>(bytes + sizeof(FileHeader));
+	points_ = reinterpret_cast<const CloudPoint*>(nodes_ + header.node_count);
+	node_count_ = header.node_count;
+	point_count_ = header.point_count;
+
+	const uint32_t slot_count = slotCount(resident_points);
+	slots_.resize(slot_count, {no_slot, 0});
+	node_slots_.resize(node_count_, no_slot);
+
+	free_slots_.resize(slot_count);
+	for (uint32_t i = 0; i < slot_count; ++i) {
+		free_slots_[i] = slot_count - 1 - i;
+	}
+
+	statistics_.nodes = node_count_;
+}
+
+PointCloud::~PointCloud() {
+	unmapFile(mapping_, mapping_size_);
+}
+
+// Nodes are visited by how far apart their points land on screen, widest
+// first, so the budget goes to where the cloud looks sparsest. A node is
+// only refined once it is drawn, which keeps ancestors ahead of descendants.
+void PointCloud::update(CommandList& commands, const Camera& camera,
+                        const glm::mat4& view_projection,
+                        uint64_t budget, float min_spacing, uint32_t max_loads) {
+	++frame_;
+	draws_.clear();
+
+	statistics_ = {
+		.nodes = node_count_,
+		.resident_nodes = uint32_t(slots_.size() - free_slots_.size()),
+	};
+
+	const scene::Frustum frustum = scene::Frustum::fromMatrix(view_projection);
+	const float pixel_scale = camera.viewport.y / (2.0f * std::tan(camera.fov * 0.5f));
+
+	auto visible = [&](const PointCloudNode& node) {
+		return frustum.intersects({node.minimum, node.minimum + node.size});
+	};
+
+	// Spacing in pixels, as if the camera sat on the node's nearest corner
+	auto spacing = [&](const PointCloudNode& node) {
+		const glm::vec3 center = node.minimum + node.size * 0.5f;
+		const float radius = node.size * 0.8660254f;
+		const float distance = std::max(glm::distance(center, camera.position) - radius,
+		                                Camera::default_near_plane);
+
+		return node.size / float(point_cloud_grid) * pixel_scale / distance;
+	};
+
+	std::priority_queue<std::pair<float, uint32_t>> queue;
+	if (visible(nodes_[0])) {
+		queue.push({spacing(nodes_[0]), 0});
+	}
+
+	uint64_t selected = 0;
+
+	while (!queue.empty()) {
+		const auto [node_spacing, index] = queue.top();
+		const auto& node = nodes_[index];
+
+		if (selected + node.count > budget) {
+			break;
+		}
+
+		queue.pop();
+		selected += node.count;
+
+		uint32_t slot = node_slots_[index];
+
+		if (slot == no_slot && statistics_.loaded_nodes < max_loads) {
+			slot = acquireSlot();
+
+			// Reading the mapping here is what pages the node in
+			if (slot != no_slot) {
+				commands.assign(buffer_, node.count * sizeof(CloudPoint), points_ + node.first,
+				                uintptr_t(slot) * point_cloud_node_capacity * sizeof(CloudPoint));
+
+				slots_[slot].node = index;
+				node_slots_[index] = slot;
+				++statistics_.loaded_nodes;
+			}
+		}
+
+		if (slot == no_slot) {
+			++statistics_.pending_nodes;
+			continue;
+		}
+
+		slots_[slot].last_drawn = frame_;
+		draws_.push_back({slot * point_cloud_node_capacity, node.count});
+
+		++statistics_.visible_nodes;
+		statistics_.visible_points += node.count;
+
+		if (node_spacing <= min_spacing) {
+			continue;
+		}
+
+		for (uint32_t child : node.children) {
+			if (child != 0 && visible(nodes_[child])) {
+				queue.push({spacing(nodes_[child]), child});
+			}
+		}
+	}
+
+	statistics_.resident_nodes = uint32_t(slots_.size() - free_slots_.size());
+
+	// Every slot is drawn at most once
+	if (!draws_.empty()) {
+		commands.assign(draw_buffer_, draws_.size() * sizeof(Draw), draws_.data());
+	}
+}
+
+// Takes a free slot, or the one drawn longest ago as long as that was before
+// this frame
+uint32_t PointCloud::acquireSlot() {
+	if (!free_slots_.empty()) {
+		uint32_t slot = free_slots_.back();
+		free_slots_.pop_back();
+		return slot;
+	}
+
+	auto oldest = std::min_element(slots_.begin(), slots_.end(),
+	                               [](const Slot& a, const Slot& b) {
+	                                   return a.last_drawn < b.last_drawn;
+	                               });
+
+	if (oldest == slots_.end() || oldest->last_drawn == frame_) {
+		return no_slot;
+	}
+
+	node_slots_[oldest->node] = no_slot;
+	return uint32_t(oldest - slots_.begin());
+}
+
+} // namespace glint::graphics
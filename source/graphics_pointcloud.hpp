@@ -0,0 +1,131 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <span>
+#include <string>
+#include <vector>
+
+#include <glm/ext/vector_float3.hpp>
+#include <glm/ext/matrix_float4x4.hpp>
+
+#include "graphics_gl.hpp"
+
+namespace glint::graphics {
+
+class CommandList;
+struct Camera;
+
+// color is RGBA8, red in the lowest byte
+struct CloudPoint final {
+	glm::vec3 position;
+	uint32_t color;
+};
+
+static_assert(sizeof(CloudPoint) == 16);
+
+// Nodes are cubes. Each keeps a subsample of the points under it, at most
+// one per cell of a grid over the cube, so a node and its ancestors together
+// draw the region at the node's spacing. A child index of zero means none,
+// the root being node zero.
+struct PointCloudNode final {
+	glm::vec3 minimum;
+	float size;
+	uint64_t first;
+	uint32_t count;
+	uint32_t level;
+	uint32_t children[8];
+};
+
+static_assert(sizeof(PointCloudNode) == 64);
+
+// Cells per axis of a node's sampling grid
+constexpr uint32_t point_cloud_grid = 64;
+
+// Points a node holds at most, and so the points of a GPU slot
+constexpr uint32_t point_cloud_node_capacity = 1 << 14;
+
+// Builds the octree in memory and writes it to path as a header, the nodes
+// breadth first and then their points in node order, so coarse levels come
+// first in the file. Points in a cell of the deepest level past a full node
+// are dropped. Throws std::runtime_error when the file cannot be written.
+void writePointCloud(const std::span<const CloudPoint> points, const std::string& path);
+
+struct PointCloudStatistics final {
+	uint32_t nodes = 0;
+	uint32_t resident_nodes = 0;
+	uint32_t visible_nodes = 0;
+	uint64_t visible_points = 0;
+	uint32_t loaded_nodes = 0;
+	// Selected but not resident yet, drawn through their ancestors meanwhile
+	uint32_t pending_nodes = 0;
+};
+
+// A file written by writePointCloud(), mapped rather than read, so only the
+// pages of nodes that get drawn are ever brought in. Nodes are streamed into
+// fixed slots of one storage buffer and the least recently drawn slots are
+// reused once it is full. Throws std::runtime_error when the file cannot be
+// opened or is not a point cloud.
+class PointCloud final {
+public:
+	// What update() hands the splatting passes for each selected node
+	struct Draw {
+		uint32_t first;
+		uint32_t count;
+	};
+
+	explicit PointCloud(const std::string& path, uint32_t resident_points = 1 << 22);
+	~PointCloud();
+
+	PointCloud(const PointCloud&) = delete;
+	PointCloud(PointCloud&&) noexcept = delete;
+
+	PointCloud& operator=(const PointCloud&) = delete;
+	PointCloud& operator=(PointCloud&&) noexcept = delete;
+
+	// Picks the nodes to draw, refining where points would be more than
+	// min_spacing pixels apart until budget points are selected, and records
+	// the upload of up to max_loads of those not resident yet and of the
+	// draws of those that are
+	void update(CommandList& commands, const Camera& camera, const glm::mat4& view_projection,
+	            uint64_t budget, float min_spacing, uint32_t max_loads);
+
+	std::span<const Draw> draws() const noexcept { return draws_; }
+	const gl::Buffer& buffer() const & noexcept { return buffer_; }
+	const gl::Buffer& drawBuffer() const & noexcept { return draw_buffer_; }
+
+	std::span<const PointCloudNode> nodes() const noexcept { return {nodes_, node_count_}; }
+	uint64_t pointCount() const noexcept { return point_count_; }
+
+	PointCloudStatistics statistics() const noexcept { return statistics_; }
+
+private:
+	static constexpr uint32_t no_slot = UINT32_MAX;
+
+	struct Slot {
+		uint32_t node;
+		uint64_t last_drawn;
+	};
+
+	uint32_t acquireSlot();
+
+	void* mapping_ = nullptr;
+	size_t mapping_size_ = 0;
+
+	const PointCloudNode* nodes_ = nullptr;
+	const CloudPoint* points_ = nullptr;
+	uint32_t node_count_ = 0;
+	uint64_t point_count_ = 0;
+
+	gl::Buffer buffer_;
+	gl::Buffer draw_buffer_;
+	std::vector<Slot> slots_;
+	std::vector<uint32_t> node_slots_;
+	std::vector<uint32_t> free_slots_;
+	uint64_t frame_ = 0;
+
+	std::vector<Draw> draws_;
+	PointCloudStatistics statistics_;
+};
+
+} // namespace glint::graphics
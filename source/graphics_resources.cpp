@@ -0,0 +1,220 @@
+#include "graphics_resources.hpp"
+
+#include <iostream>
+
+#include "graphics.hpp"
+#include "graphics_commands.hpp"
+#include "frame.hpp"
+
+namespace glint::graphics {
+
+namespace {
+
+// frame counts recorded frames until the entry is fenced, then holds the
+// index of the fence closing the last frame that may use it
+struct Retired {
+	void (*release)(void* pool, uint32_t slot);
+	void* pool;
+	uint32_t slot;
+	bool fenced;
+	uint64_t frame;
+};
+
+Pool<gl::Buffer>* buffer_pool;
+Pool<gl::Texture>* texture_pool;
+Pool<gl::Sampler>* sampler_pool;
+Pool<gl::Pipeline>* pipeline_pool;
+Pool<Mesh>* mesh_pool;
+
+// Filled by destroy() on the recording thread, drained on the context thread
+std::mutex retired_mutex;
+std::vector<Retired> retired;
+
+// Only touched by the recording thread
+uint64_t recorded_frames;
+size_t memory_budget;
+std::vector<EvictionCallback> eviction_callbacks;
+bool over_budget;
+
+// Runs at the end of a frame's commands, once every frame up to
+// recorded has been executed
+void collect(uint64_t recorded) {
+	const uint64_t fence = frame::fencedFrames();
+	const uint64_t completed = frame::completedFrames();
+
+	std::lock_guard lock(retired_mutex);
+
+	size_t write = 0;
+	for (auto& entry : retired) {
+		if (!entry.fenced && entry.frame <= recorded) {
+			entry.fenced = true;
+			entry.frame = fence;
+		}
+
+		if (entry.fenced && entry.frame < completed) {
+			entry.release(entry.pool, entry.slot);
+		} else {
+			retired[write++] = entry;
+		}
+	}
+
+	retired.resize(write);
+}
+
+} // namespace
+
+namespace detail {
+
+void retire(void (*release)(void* pool, uint32_t slot), void* pool, uint32_t slot) {
+	std::lock_guard lock(retired_mutex);
+	retired.push_back({release, pool, slot, false, recorded_frames});
+}
+
+} // namespace detail
+
+template<> Pool<gl::Buffer>& pool() { return *buffer_pool; }
+template<> Pool<gl::Texture>& pool() { return *texture_pool; }
+template<> Pool<gl::Sampler>& pool() { return *sampler_pool; }
+template<> Pool<gl::Pipeline>& pool() { return *pipeline_pool; }
+template<> Pool<Mesh>& pool() { return *mesh_pool; }
+
+ResourceStatistics resourceStatistics() {
+	return {
+		.buffers = buffer_pool->statistics(),
+		.textures = texture_pool->statistics(),
+		.samplers = sampler_pool->statistics(),
+		.pipelines = pipeline_pool->statistics(),
+		.meshes = mesh_pool->statistics(),
+	};
+}
+
+MemoryStatistics memoryStatistics() {
+	const auto statistics = resourceStatistics();
+
+	return {
+		.usage = gl::memoryUsage(),
+		.retiring = statistics.buffers.retiring_memory + statistics.textures.retiring_memory +
+		            statistics.meshes.retiring_memory,
+		.budget = memory_budget,
+	};
+}
+
+void setMemoryBudget(size_t bytes) {
+	memory_budget = bytes;
+	over_budget = false;
+}
+
+size_t memoryBudget() {
+	return memory_budget;
+}
+
+void addEvictionCallback(EvictionCallback callback) {
+	eviction_callbacks.push_back(std::move(callback));
+}
+
+void enforceMemoryBudget() {
+	if (memory_budget == 0) {
+		return;
+	}
+
+	const auto statistics = memoryStatistics();
+	const size_t used = statistics.usage.total() - statistics.retiring;
+
+	if (used <= memory_budget) {
+		over_budget = false;
+		return;
+	}
+
+	size_t excess = used - memory_budget;
+	for (const auto& callback : eviction_callbacks) {
+		excess -= std::min(callback(excess), excess);
+
+		if (excess == 0) {
+			break;
+		}
+	}
+
+	// Reported once per crossing, not every frame
+	if (excess != 0 && !over_budget) {
+		std::cerr << "GPU memory over budget: " << (excess >> 10) << " KiB above "
+		          << (memory_budget >> 10) << " KiB could not be evicted\n";
+	}
+
+	over_budget = excess != 0;
+}
+
+void setupResources() {
+	buffer_pool = new Pool<gl::Buffer>;
+	texture_pool = new Pool<gl::Texture>;
+	sampler_pool = new Pool<gl::Sampler>;
+	pipeline_pool = new Pool<gl::Pipeline>;
+	mesh_pool = new Pool<Mesh>;
+
+	recorded_frames = 0;
+	memory_budget = 0;
+	over_budget = false;
+}
+
+void shutdownResources() {
+	// Nothing is in flight anymore
+	for (const auto& entry : retired) {
+		entry.release(entry.pool, entry.slot);
+	}
+
+	retired.clear();
+	eviction_callbacks.clear();
+
+	delete mesh_pool;
+	delete pipeline_pool;
+	delete sampler_pool;
+	delete texture_pool;
+	delete buffer_pool;
+}
+
+void retireResources(CommandList& commands) {
+	commands.call(collect, ++recorded_frames);
+}
+
+GrowableBuffer::GrowableBuffer(GLenum type, GLenum usage, gl::MemoryCategory category,
+                               size_t size)
+: type_{type}, usage_{usage}, category_{category} {
+	if (size != 0) {
+		storage_ = std::make_unique<Storage>(type, usage, category, size);
+		construct(uint64_t(uintptr_t(storage_.get())));
+	}
+}
+
+void GrowableBuffer::reserve(CommandList& commands, size_t size) {
+	if (size <= this->size()) {
+		return;
+	}
+
+	const size_t grown = std::max(size, this->size() * 2);
+
+	// Commands recorded before may still use the old buffer
+	if (storage_ != nullptr) {
+		detail::retire(release, storage_.release(), 0);
+	}
+
+	storage_ = std::make_unique<Storage>(type_, usage_, category_, grown);
+	commands.call(construct, uint64_t(uintptr_t(storage_.get())));
+}
+
+GrowableBuffer::Storage::~Storage() {
+	if (constructed) {
+		reinterpret_cast<gl::Buffer*>(bytes)->~Buffer();
+	}
+}
+
+void GrowableBuffer::construct(uint64_t storage) {
+	auto& self = *reinterpret_cast<Storage*>(uintptr_t(storage));
+
+	new (self.bytes) gl::Buffer(self.type, self.usage, self.category, self.size);
+	self.constructed = true;
+}
+
+void GrowableBuffer::release(void* storage, uint32_t) {
+	delete static_cast<Storage*>(storage);
+}
+
+} // namespace glint::graphics
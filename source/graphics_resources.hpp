@@ -0,0 +1,351 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+#include <algorithm>
+
+#include "graphics_gl.hpp"
+
+namespace glint::graphics {
+
+class Mesh;
+class CommandList;
+
+// Generational index into a Pool. A slot's generation moves on when its
+// object is destroyed, so stale handles are caught instead of silently
+// reaching whatever reuses the slot. Zero is never a live handle.
+template<typename T>
+class Handle final {
+public:
+	static constexpr uint32_t slot_bits = 20;
+	static constexpr uint32_t max_slots = 1u << slot_bits;
+	static constexpr uint32_t max_generation = (1u << (32 - slot_bits)) - 1;
+
+	constexpr Handle() = default;
+	constexpr Handle(uint32_t slot, uint32_t generation)
+	: value_{generation << slot_bits | slot} {}
+
+	constexpr uint32_t slot() const noexcept { return value_ & (max_slots - 1); }
+	constexpr uint32_t generation() const noexcept { return value_ >> slot_bits; }
+
+	constexpr explicit operator bool() const noexcept { return value_ != 0; }
+	constexpr bool operator==(const Handle&) const noexcept = default;
+
+private:
+	uint32_t value_ = 0;
+};
+
+using BufferHandle = Handle<gl::Buffer>;
+using TextureHandle = Handle<gl::Texture>;
+using SamplerHandle = Handle<gl::Sampler>;
+using PipelineHandle = Handle<gl::Pipeline>;
+using MeshHandle = Handle<Mesh>;
+
+// bytes is the pool's own storage, memory the estimated GPU memory of its
+// objects
+struct PoolStatistics final {
+	uint32_t live = 0;
+	uint32_t retiring = 0;
+	uint32_t capacity = 0;
+	size_t bytes = 0;
+	size_t memory = 0;
+	size_t retiring_memory = 0;
+};
+
+struct ResourceStatistics final {
+	PoolStatistics buffers;
+	PoolStatistics textures;
+	PoolStatistics samplers;
+	PoolStatistics pipelines;
+	PoolStatistics meshes;
+};
+
+struct MemoryStatistics final {
+	gl::MemoryUsage usage;
+	// Still allocated, but already destroyed and waiting on fences
+	size_t retiring = 0;
+	size_t budget = 0;
+};
+
+inline size_t memoryBytes(const gl::Buffer& buffer) { return buffer.size(); }
+inline size_t memoryBytes(const gl::Texture& texture) { return texture.bytes(); }
+inline size_t memoryBytes(const gl::Sampler&) { return 0; }
+inline size_t memoryBytes(const gl::Pipeline&) { return 0; }
+size_t memoryBytes(const Mesh& mesh);
+
+namespace detail {
+
+// Queues a destroyed slot to be released once the GPU has finished every
+// frame recorded before it was destroyed
+void retire(void (*release)(void* pool, uint32_t slot), void* pool, uint32_t slot);
+
+} // namespace detail
+
+// Objects live in fixed pages that never move, so lookups are a shift and a
+// mask and references stay valid until the slot is released. Destroying
+// invalidates the handle at once, but the object itself lives on until the
+// GPU is done with it. Creation and destruction belong to one thread; the
+// release runs on the thread owning the context.
+template<typename T>
+class Pool final {
+public:
+	static constexpr uint32_t page_size = 256;
+
+	Pool() = default;
+
+	~Pool() {
+		for (uint32_t slot = 0; slot < pages_used_ * page_size; ++slot) {
+			if (page(slot).occupied[slot % page_size]) {
+				object(slot)->~T();
+			}
+		}
+	}
+
+	Pool(const Pool&) = delete;
+	Pool(Pool&&) noexcept = delete;
+
+	Pool& operator=(const Pool&) = delete;
+	Pool& operator=(Pool&&) noexcept = delete;
+
+	template<typename... Args>
+	Handle<T> create(Args&&... args) {
+		const uint32_t slot = allocate();
+		new (object(slot)) T(std::forward<Args>(args)...);
+		return occupy(slot, memoryBytes(*object(slot)));
+	}
+
+	// For types that cannot be moved, built in place from what factory returns
+	template<typename F>
+	Handle<T> createFrom(F&& factory) {
+		const uint32_t slot = allocate();
+		new (object(slot)) T(std::forward<F>(factory)());
+		return occupy(slot, memoryBytes(*object(slot)));
+	}
+
+	void destroy(Handle<T> handle) {
+		assert(valid(handle));
+
+		uint32_t& generation = page(handle.slot()).generations[handle.slot() % page_size];
+		generation = generation == Handle<T>::max_generation ? 1 : generation + 1;
+
+		{
+			const size_t memory = memoryBytes(*object(handle.slot()));
+
+			std::lock_guard lock(mutex_);
+			--live_;
+			++retiring_;
+			memory_ -= memory;
+			retiring_memory_ += memory;
+		}
+
+		detail::retire(&Pool::release, this, handle.slot());
+	}
+
+	bool valid(Handle<T> handle) const {
+		const uint32_t slot = handle.slot();
+		return slot < pages_used_ * page_size && handle.generation() != 0 &&
+		       page(slot).generations[slot % page_size] == handle.generation();
+	}
+
+	T& get(Handle<T> handle) const {
+		assert(valid(handle));
+		return *object(handle.slot());
+	}
+
+	PoolStatistics statistics() const {
+		std::lock_guard lock(mutex_);
+		return {live_, retiring_, pages_used_ * page_size, pages_used_ * sizeof(Page),
+		        memory_, retiring_memory_};
+	}
+
+private:
+	static constexpr uint32_t max_pages = Handle<T>::max_slots / page_size;
+
+	struct Page {
+		alignas(T) std::byte objects[page_size * sizeof(T)];
+		uint32_t generations[page_size];
+		bool occupied[page_size];
+	};
+
+	Page& page(uint32_t slot) const { return *pages_[slot / page_size]; }
+
+	T* object(uint32_t slot) const {
+		return std::launder(reinterpret_cast<T*>(page(slot).objects +
+		                                         (slot % page_size) * sizeof(T)));
+	}
+
+	uint32_t allocate() {
+		{
+			std::lock_guard lock(mutex_);
+			if (!free_.empty()) {
+				uint32_t slot = free_.back();
+				free_.pop_back();
+				return slot;
+			}
+		}
+
+		if (next_slot_ == pages_used_ * page_size) {
+			assert(pages_used_ < max_pages);
+
+			auto& fresh = pages_[pages_used_];
+			fresh = std::make_unique<Page>();
+			std::fill_n(fresh->generations, page_size, 1u);
+
+			++pages_used_;
+		}
+
+		return next_slot_++;
+	}
+
+	Handle<T> occupy(uint32_t slot, size_t memory) {
+		std::lock_guard lock(mutex_);
+		page(slot).occupied[slot % page_size] = true;
+		++live_;
+		memory_ += memory;
+
+		return {slot, page(slot).generations[slot % page_size]};
+	}
+
+	static void release(void* pool, uint32_t slot) {
+		auto& self = *static_cast<Pool*>(pool);
+		const size_t memory = memoryBytes(*self.object(slot));
+		self.object(slot)->~T();
+
+		std::lock_guard lock(self.mutex_);
+		self.page(slot).occupied[slot % page_size] = false;
+		self.free_.push_back(slot);
+		--self.retiring_;
+		self.retiring_memory_ -= memory;
+	}
+
+	std::unique_ptr<Page> pages_[max_pages];
+	uint32_t pages_used_ = 0;
+	uint32_t next_slot_ = 0;
+
+	// Guards what release() touches from the context thread
+	mutable std::mutex mutex_;
+	std::vector<uint32_t> free_;
+	uint32_t live_ = 0;
+	uint32_t retiring_ = 0;
+	size_t memory_ = 0;
+	size_t retiring_memory_ = 0;
+};
+
+template<typename T>
+Pool<T>& pool();
+
+template<> Pool<gl::Buffer>& pool();
+template<> Pool<gl::Texture>& pool();
+template<> Pool<gl::Sampler>& pool();
+template<> Pool<gl::Pipeline>& pool();
+template<> Pool<Mesh>& pool();
+
+template<typename T, typename... Args>
+Handle<T> create(Args&&... args) {
+	return pool<T>().create(std::forward<Args>(args)...);
+}
+
+template<typename T, typename F>
+Handle<T> createFrom(F&& factory) {
+	return pool<T>().createFrom(std::forward<F>(factory));
+}
+
+template<typename T>
+T& get(Handle<T> handle) {
+	return pool<T>().get(handle);
+}
+
+template<typename T>
+void destroy(Handle<T> handle) {
+	pool<T>().destroy(handle);
+}
+
+ResourceStatistics resourceStatistics();
+MemoryStatistics memoryStatistics();
+
+// Given how many bytes are over budget, releases what it can, e.g. by
+// destroying pooled resources, and returns how much that was
+using EvictionCallback = std::function<size_t(size_t excess)>;
+
+// Once the memory in use, not counting what is already retiring, exceeds
+// bytes, render() calls the eviction callbacks in the order they were added
+// until the excess is covered, and warns when they fall short. Zero, the
+// default, disables the budget.
+void setMemoryBudget(size_t bytes);
+size_t memoryBudget();
+void addEvictionCallback(EvictionCallback callback);
+
+// Called by render() after the frame's draws are recorded, so evicted
+// resources are still valid for them
+void enforceMemoryBudget();
+
+// Owned by graphics::setup() and graphics::shutdown(); shutdown releases
+// whatever is still alive
+void setupResources();
+void shutdownResources();
+
+// Records, as the frame's last command, the hand over of everything
+// destroyed so far to the fences of the frames that may still use it.
+// Slots are released once frame::completedFrames() passes those fences.
+void retireResources(CommandList& commands);
+
+// A buffer that a thread recording without the context can grow. The bigger
+// buffer is created when the commands run, and the one it replaces is
+// retired like a destroyed resource. Contents are not carried over.
+class GrowableBuffer final {
+public:
+	// A size of zero leaves the buffer to the first reserve(), otherwise it
+	// is created at once, on the thread owning the context
+	GrowableBuffer(GLenum type, GLenum usage, gl::MemoryCategory category, size_t size = 0);
+	~GrowableBuffer() = default;
+
+	GrowableBuffer(const GrowableBuffer&) = delete;
+	GrowableBuffer(GrowableBuffer&&) noexcept = delete;
+
+	GrowableBuffer& operator=(const GrowableBuffer&) = delete;
+	GrowableBuffer& operator=(GrowableBuffer&&) noexcept = delete;
+
+	// Records the creation of a buffer of at least twice the size when the
+	// current one is smaller than size bytes
+	void reserve(CommandList& commands, size_t size);
+
+	// Commands may refer to it as soon as a size has been reserved, even
+	// though it only exists once they run
+	gl::Buffer& get() const noexcept {
+		assert(storage_ != nullptr);
+		return *reinterpret_cast<gl::Buffer*>(storage_->bytes);
+	}
+
+	size_t size() const noexcept { return storage_ != nullptr ? storage_->size : 0; }
+
+private:
+	struct Storage {
+		alignas(gl::Buffer) std::byte bytes[sizeof(gl::Buffer)];
+		GLenum type;
+		GLenum usage;
+		gl::MemoryCategory category;
+		size_t size;
+		bool constructed = false;
+
+		Storage(GLenum type, GLenum usage, gl::MemoryCategory category, size_t size)
+		: type{type}, usage{usage}, category{category}, size{size} {}
+		~Storage();
+	};
+
+	static void construct(uint64_t storage);
+	static void release(void* storage, uint32_t);
+
+	GLenum type_;
+	GLenum usage_;
+	gl::MemoryCategory category_;
+	std::unique_ptr<Storage> storage_;
+};
+
+} // namespace glint::graphics
@@ -3,18 +3,41 @@ constexpr char untextured_unlit_vertex_shader_code[] = R"(
 
 layout(location = 0) in vec3 v_position;
 
+flat out vec3 f_color;
+
 layout(std140, binding = 0) uniform CameraUniforms {
 	mat4 view_projection;
 	vec3 view_position;
 };
 
-layout(std140, binding = 1) uniform ModelUniforms {
+struct Instance {
 	mat4 transform;
-	vec4 color;
+	uint material;
+};
+
+layout(std430, binding = 6) readonly buffer Instances {
+	Instance instances[];
+};
+
+struct Material {
+	vec3 albedo_color;
+	float shininess;
+	vec3 specular_color;
+	float emissiveness;
+};
+
+layout(std430, binding = 7) readonly buffer Materials {
+	Material materials[];
 };
 
+layout(location = 0) uniform uint instance;
+
 void main() {
-	gl_Position = view_projection * transform * vec4(v_position, 1.0f);
+	Instance model = instances[instance];
+	Material material = materials[model.material];
+
+	gl_Position = view_projection * model.transform * vec4(v_position, 1.0f);
+	f_color = material.albedo_color;
 }
 )";
 
@@ -22,15 +45,12 @@ constexpr char untextured_unlit_fragment_shader_code[] = R"(
 #version 310 es
 precision mediump float;
 
-out vec4 frag_color;
+flat in vec3 f_color;
 
-layout(std140, binding = 1) uniform ModelUniforms {
-	mat4 transform;
-	vec4 color;
-};
+out vec4 frag_color;
 
 void main() {
-	frag_color = color;
+	frag_color = vec4(f_color, 1.0f);
 }
 )";
 
@@ -48,6 +68,10 @@ layout(location = 1) in vec3 v_normal;
 out vec3 f_position;
 out vec3 f_normal;
 out vec4 f_ray_position;
+flat out vec3 f_albedo_color;
+flat out vec3 f_specular_color;
+flat out float f_shininess;
+flat out float f_emissiveness;
 
 layout(std140, binding = 0) uniform CameraUniforms {
 	mat4 view_projection;
@@ -58,22 +82,43 @@ layout(std140, binding = 0) uniform CameraUniforms {
 	Light lights[16];
 };
 
-layout(std140, binding = 1) uniform ModelUniforms {
+struct Instance {
 	mat4 transform;
+	uint material;
+};
+
+layout(std430, binding = 6) readonly buffer Instances {
+	Instance instances[];
+};
+
+struct Material {
 	vec3 albedo_color;
-	vec3 specular_color;
 	float shininess;
+	vec3 specular_color;
 	float emissiveness;
 };
 
+layout(std430, binding = 7) readonly buffer Materials {
+	Material materials[];
+};
+
+layout(location = 0) uniform uint instance;
+
 void main() {
-	vec4 position = transform * vec4(v_position, 1.0f);
-	vec4 normal = transform * vec4(v_normal, 0.0f);
+	Instance model = instances[instance];
+	Material material = materials[model.material];
+
+	vec4 position = model.transform * vec4(v_position, 1.0f);
+	vec4 normal = model.transform * vec4(v_normal, 0.0f);
 
 	gl_Position = view_projection * position;
 	f_position = position.xyz;
 	f_normal = normalize(normal.xyz);
 	f_ray_position = shadow_matrix * position;
+	f_albedo_color = material.albedo_color;
+	f_specular_color = material.specular_color;
+	f_shininess = material.shininess;
+	f_emissiveness = material.emissiveness;
 }
 )";
 
@@ -89,6 +134,10 @@ struct Light {
 in vec3 f_position;
 in vec3 f_normal;
 in vec4 f_ray_position;
+flat in vec3 f_albedo_color;
+flat in vec3 f_specular_color;
+flat in float f_shininess;
+flat in float f_emissiveness;
 
 out vec4 frag_color;
 
@@ -103,14 +152,6 @@ layout(std140, binding = 0) uniform CameraUniforms {
 	Light lights[16];
 };
 
-layout(std140, binding = 1) uniform ModelUniforms {
-	mat4 transform;
-	vec3 albedo_color;
-	vec3 specular_color;
-	float shininess;
-	float emissiveness;
-};
-
 void main() {
 	vec3 normal = normalize(f_normal);
 	vec3 view_direction = normalize(view_position - f_position);
@@ -120,7 +161,7 @@ void main() {
 	float depth = texture(shadow_map, ray_position.xy).r;
 	float shadow = ray_position.z > depth ? 0.0f : 1.0f;
 
-	vec3 color = ambience * albedo_color;
+	vec3 color = ambience * f_albedo_color;
 	for (int i = 0; i < light_count; ++i) {
 		Light light = lights[i];
 
@@ -132,13 +173,13 @@ void main() {
 		float falloff = (light.position_size.w * light.position_size.w) /
 		                (1.0f + light_distance * light_distance);
 
-		vec3 specular = pow(max(dot(normal, half_vector), 0.0f), shininess) *
-		                specular_color;
+		vec3 specular = pow(max(dot(normal, half_vector), 0.0f), f_shininess) *
+		                f_specular_color;
 
-		color += (specular + albedo_color) * coeff * light.color * falloff * shadow;
+		color += (specular + f_albedo_color) * coeff * light.color * falloff * shadow;
 	}
 
-	color += albedo_color * emissiveness;
+	color += f_albedo_color * f_emissiveness;
 
 	frag_color = vec4(color, 1.0f);
 }
@@ -160,6 +201,10 @@ out vec3 f_position;
 out vec3 f_normal;
 out vec2 f_uv;
 out vec4 f_ray_position;
+flat out vec3 f_albedo_color;
+flat out vec3 f_specular_color;
+flat out float f_shininess;
+flat out float f_emissiveness;
 
 layout(std140, binding = 0) uniform CameraUniforms {
 	mat4 view_projection;
@@ -170,23 +215,44 @@ layout(std140, binding = 0) uniform CameraUniforms {
 	Light lights[16];
 };
 
-layout(std140, binding = 1) uniform ModelUniforms {
+struct Instance {
 	mat4 transform;
+	uint material;
+};
+
+layout(std430, binding = 6) readonly buffer Instances {
+	Instance instances[];
+};
+
+struct Material {
 	vec3 albedo_color;
-	vec3 specular_color;
 	float shininess;
+	vec3 specular_color;
 	float emissiveness;
 };
 
+layout(std430, binding = 7) readonly buffer Materials {
+	Material materials[];
+};
+
+layout(location = 0) uniform uint instance;
+
 void main() {
-	vec4 position = transform * vec4(v_position, 1.0f);
-	vec4 normal = transform * vec4(v_normal, 0.0f);
+	Instance model = instances[instance];
+	Material material = materials[model.material];
+
+	vec4 position = model.transform * vec4(v_position, 1.0f);
+	vec4 normal = model.transform * vec4(v_normal, 0.0f);
 
 	gl_Position = view_projection * position;
 	f_position = position.xyz;
 	f_normal = normalize(normal.xyz);
 	f_uv = v_uv;
 	f_ray_position = shadow_matrix * position;
+	f_albedo_color = material.albedo_color;
+	f_specular_color = material.specular_color;
+	f_shininess = material.shininess;
+	f_emissiveness = material.emissiveness;
 }
 )";
 
@@ -203,6 +269,10 @@ in vec3 f_position;
 in vec3 f_normal;
 in vec2 f_uv;
 in vec4 f_ray_position;
+flat in vec3 f_albedo_color;
+flat in vec3 f_specular_color;
+flat in float f_shininess;
+flat in float f_emissiveness;
 
 out vec4 frag_color;
 
@@ -218,19 +288,11 @@ layout(std140, binding = 0) uniform CameraUniforms {
 	Light lights[16];
 };
 
-layout(std140, binding = 1) uniform ModelUniforms {
-	mat4 transform;
-	vec3 albedo_color;
-	vec3 specular_color;
-	float shininess;
-	float emissiveness;
-};
-
 void main() {
 	vec3 normal = normalize(f_normal);
 	vec3 view_direction = normalize(view_position - f_position);
 
-	vec3 albedo = texture(albedo_texture, f_uv).rgb * albedo_color;
+	vec3 albedo = texture(albedo_texture, f_uv).rgb * f_albedo_color;
 
 	vec3 ray_position = f_ray_position.xyz / f_ray_position.w;
 	ray_position = 0.5f + ray_position * 0.5f;
@@ -260,13 +322,13 @@ void main() {
 		float falloff = (light.position_size.w * light.position_size.w) /
 		                (1.0f + light_distance * light_distance);
 
-		vec3 specular = pow(max(dot(normal, half_vector), 0.0f), shininess) *
-		                specular_color;
+		vec3 specular = pow(max(dot(normal, half_vector), 0.0f), f_shininess) *
+		                f_specular_color;
 
 		color += (specular + albedo) * coeff * light.color * falloff * shadow;
 	}
 
-	color += albedo * emissiveness;
+	color += albedo * f_emissiveness;
 
 	frag_color = vec4(color, 1.0f);
 }
@@ -282,13 +344,15 @@ out vec3 f_direction;
 layout(std140, binding = 0) uniform SkyUniforms {
 	mat4 view;
 	vec2 viewport;
+	vec2 sun_azimuth;
 };
 
 void main() {
 	vec2 uv = vec2(-v_position.x, -v_position.y * viewport.y / viewport.x);
 	vec4 position = view * vec4(uv, 1.0f, 1.0f);
 
-	gl_Position = vec4(v_position, 0.0f, 1.0f);
+	// At the far plane, so only pixels nothing was drawn to pass the depth test
+	gl_Position = vec4(v_position, 1.0f, 1.0f);
 	f_direction = normalize(position.xyz);
 }
 )";
@@ -308,6 +372,40 @@ void main() {
 }
 )";
 
+constexpr char atmosphere_fragment_shader_code[] = R"(
+#version 310 es
+precision highp float;
+
+in vec3 f_direction;
+
+out vec4 frag_color;
+
+layout(std140, binding = 0) uniform SkyUniforms {
+	mat4 view;
+	vec2 viewport;
+	vec2 sun_azimuth;
+};
+
+layout(binding = 0) uniform mediump sampler2D sky_lut;
+
+const float pi = 3.14159265f;
+
+void main() {
+	// f_direction points back along the view ray
+	vec3 direction = -f_direction;
+
+	float horizontal = length(direction.xz);
+	float azimuth = horizontal > 0.0f
+	              ? acos(clamp(dot(direction.xz / horizontal, sun_azimuth), -1.0f, 1.0f)) / pi
+	              : 0.0f;
+
+	float elevation = asin(clamp(direction.y, -1.0f, 1.0f)) / (0.5f * pi);
+	float v = 0.5f + 0.5f * sign(elevation) * sqrt(abs(elevation));
+
+	frag_color = vec4(texture(sky_lut, vec2(azimuth, v)).rgb, 1.0f);
+}
+)";
+
 constexpr char shadow_map_vertex_shader_code[] = R"(
 #version 310 es
 
@@ -317,12 +415,19 @@ layout(std140, binding = 0) uniform ShadowMapUniforms {
 	mat4 view_projection;
 };
 
-layout(std140, binding = 1) uniform ModelUniforms {
+struct Instance {
 	mat4 transform;
+	uint material;
 };
 
+layout(std430, binding = 6) readonly buffer Instances {
+	Instance instances[];
+};
+
+layout(location = 0) uniform uint instance;
+
 void main() {
-	gl_Position = view_projection * transform * vec4(v_position, 1.0f);
+	gl_Position = view_projection * instances[instance].transform * vec4(v_position, 1.0f);
 }
 )";
 
@@ -332,3 +437,734 @@ precision mediump float;
 
 void main() {}
 )";
+
+constexpr char gbuffer_vertex_shader_code[] = R"(
+#version 310 es
+
+layout(location = 0) in vec3 v_position;
+layout(location = 1) in vec3 v_normal;
+layout(location = 2) in vec2 v_uv;
+
+out vec3 f_normal;
+out vec2 f_uv;
+flat out vec3 f_albedo_color;
+flat out vec3 f_specular_color;
+flat out float f_shininess;
+flat out float f_emissiveness;
+
+layout(std140, binding = 0) uniform CameraUniforms {
+	mat4 view_projection;
+};
+
+struct Instance {
+	mat4 transform;
+	uint material;
+};
+
+layout(std430, binding = 6) readonly buffer Instances {
+	Instance instances[];
+};
+
+struct Material {
+	vec3 albedo_color;
+	float shininess;
+	vec3 specular_color;
+	float emissiveness;
+};
+
+layout(std430, binding = 7) readonly buffer Materials {
+	Material materials[];
+};
+
+layout(location = 0) uniform uint instance;
+
+void main() {
+	Instance model = instances[instance];
+	Material material = materials[model.material];
+
+	vec4 position = model.transform * vec4(v_position, 1.0f);
+	vec4 normal = model.transform * vec4(v_normal, 0.0f);
+
+	gl_Position = view_projection * position;
+	f_normal = normalize(normal.xyz);
+	f_uv = v_uv;
+	f_albedo_color = material.albedo_color;
+	f_specular_color = material.specular_color;
+	f_shininess = material.shininess;
+	f_emissiveness = material.emissiveness;
+}
+)";
+
+// G-buffer layout:
+//   0: RGBA8    albedo, emissiveness / (1 + emissiveness)
+//   1: RGB10A2  octahedral normal, log2(shininess) / 11, lit flag
+//   2: RGBA8    specular
+// Albedo and specular are stored without the normalisation baked into
+// instances, so they fit the unorm targets. Positions are rebuilt from depth.
+// Each fragment shader is this followed by a main() calling writeGbuffer().
+constexpr char gbuffer_fragment_shader_code[] = R"(
+#version 310 es
+precision mediump float;
+
+in vec3 f_normal;
+in vec2 f_uv;
+flat in vec3 f_albedo_color;
+flat in vec3 f_specular_color;
+flat in float f_shininess;
+flat in float f_emissiveness;
+
+layout(location = 0) out vec4 gbuffer_albedo;
+layout(location = 1) out vec4 gbuffer_normal;
+layout(location = 2) out vec4 gbuffer_specular;
+
+vec2 encodeNormal(vec3 n) {
+	n /= abs(n.x) + abs(n.y) + abs(n.z);
+	vec2 s = vec2(n.x >= 0.0f ? 1.0f : -1.0f, n.y >= 0.0f ? 1.0f : -1.0f);
+	vec2 p = n.z >= 0.0f ? n.xy : (1.0f - abs(n.yx)) * s;
+	return p * 0.5f + 0.5f;
+}
+
+void writeGbuffer(vec3 albedo, float lit) {
+	const float pi = 3.14159265f;
+
+	gbuffer_albedo = vec4(albedo * pi, f_emissiveness / (1.0f + f_emissiveness));
+	gbuffer_normal = vec4(encodeNormal(normalize(f_normal)),
+	                      log2(max(f_shininess, 1.0f)) / 11.0f, lit);
+	gbuffer_specular = vec4(f_specular_color * (8.0f * pi) / (f_shininess + 8.0f), 0.0f);
+}
+)";
+
+constexpr char gbuffer_untextured_unlit_fragment_main_code[] = R"(
+void main() {
+	writeGbuffer(f_albedo_color, 0.0f);
+}
+)";
+
+constexpr char gbuffer_untextured_lit_fragment_main_code[] = R"(
+void main() {
+	writeGbuffer(f_albedo_color, 1.0f);
+}
+)";
+
+constexpr char gbuffer_textured_lit_fragment_main_code[] = R"(
+layout(binding = 0) uniform sampler2D albedo_texture;
+
+void main() {
+	writeGbuffer(texture(albedo_texture, f_uv).rgb * f_albedo_color, 1.0f);
+}
+)";
+
+constexpr char deferred_lighting_vertex_shader_code[] = R"(
+#version 310 es
+
+layout(location = 0) in vec2 v_position;
+
+void main() {
+	gl_Position = vec4(v_position, 0.0f, 1.0f);
+}
+)";
+
+constexpr char deferred_lighting_fragment_shader_code[] = R"(
+#version 310 es
+precision highp float;
+
+struct Light {
+	vec4 position_size;
+	vec3 color;
+};
+
+out vec4 frag_color;
+
+layout(binding = 1) uniform mediump sampler2DShadow shadow_map;
+layout(binding = 2) uniform mediump sampler2D gbuffer_albedo;
+layout(binding = 3) uniform mediump sampler2D gbuffer_normal;
+layout(binding = 4) uniform mediump sampler2D gbuffer_specular;
+layout(binding = 5) uniform highp sampler2D gbuffer_depth;
+
+layout(std140, binding = 0) uniform CameraUniforms {
+	mat4 view_projection;
+	mat4 shadow_matrix;
+	vec3 view_position;
+	vec3 ambience;
+	int light_count;
+	Light lights[16];
+};
+
+layout(std140, binding = 1) uniform DeferredUniforms {
+	mat4 inverse_view_projection;
+	vec2 one_over_viewport;
+};
+
+vec3 decodeNormal(vec2 e) {
+	e = e * 2.0f - 1.0f;
+	vec3 n = vec3(e, 1.0f - abs(e.x) - abs(e.y));
+	float t = max(-n.z, 0.0f);
+	n.x += n.x >= 0.0f ? -t : t;
+	n.y += n.y >= 0.0f ? -t : t;
+	return normalize(n);
+}
+
+void main() {
+	const float pi = 3.14159265f;
+
+	ivec2 texel = ivec2(gl_FragCoord.xy);
+
+	float depth = texelFetch(gbuffer_depth, texel, 0).r;
+	if (depth >= 1.0f)
+		discard;
+
+	// Later passes test against the scene as if it had been drawn here
+	gl_FragDepth = depth;
+
+	vec4 albedo_emissive = texelFetch(gbuffer_albedo, texel, 0);
+	vec4 normal_shininess = texelFetch(gbuffer_normal, texel, 0);
+	vec3 specular_color = texelFetch(gbuffer_specular, texel, 0).rgb;
+
+	vec3 albedo = albedo_emissive.rgb / pi;
+
+	if (normal_shininess.a < 0.5f) {
+		frag_color = vec4(albedo, 1.0f);
+		return;
+	}
+
+	float emissiveness = albedo_emissive.a / max(1.0f - albedo_emissive.a, 1e-3f);
+	float shininess = exp2(normal_shininess.b * 11.0f);
+	specular_color *= (shininess + 8.0f) / (8.0f * pi);
+
+	vec4 clip = vec4(vec3(gl_FragCoord.xy * one_over_viewport, depth), 1.0f) * 2.0f - 1.0f;
+	vec4 world = inverse_view_projection * clip;
+	vec3 position = world.xyz / world.w;
+
+	vec3 normal = decodeNormal(normal_shininess.rg);
+	vec3 view_direction = normalize(view_position - position);
+
+	vec4 ray = shadow_matrix * vec4(position, 1.0f);
+	vec3 ray_position = 0.5f + (ray.xyz / ray.w) * 0.5f;
+	ray_position.z += 1e-6f;
+
+	float accum = 0.0f;
+	vec2 texel_size = 1.0f / vec2(textureSize(shadow_map, 0));
+	for (int y = -1; y <= 1; ++y) {
+		for (int x = -1; x <= 1; ++x) {
+			vec3 p = ray_position;
+			p.xy += vec2(x, y) * texel_size;
+			accum += texture(shadow_map, p);
+		}
+	}
+
+	float shadow = 0.5f + (accum / 18.0f);
+
+	vec3 color = ambience * albedo;
+	for (int i = 0; i < light_count; ++i) {
+		Light light = lights[i];
+
+		vec3 light_direction = normalize(light.position_size.xyz - position);
+		vec3 half_vector = normalize(view_direction + light_direction);
+		float light_distance = distance(light.position_size.xyz, position);
+
+		float coeff = max(dot(normal, light_direction), 0.0f);
+		float falloff = (light.position_size.w * light.position_size.w) /
+		                (1.0f + light_distance * light_distance);
+
+		vec3 specular = pow(max(dot(normal, half_vector), 0.0f), shininess) *
+		                specular_color;
+
+		color += (specular + albedo) * coeff * light.color * falloff * shadow;
+	}
+
+	color += albedo * emissiveness;
+
+	frag_color = vec4(color, 1.0f);
+}
+)";
+
+constexpr char point_splat_compute_shader_code[] = R"(
+#version 310 es
+
+layout(local_size_x = 256) in;
+
+struct Point {
+	vec3 position;
+	uint color;
+};
+
+layout(std140, binding = 0) uniform PointUniforms {
+	mat4 view_projection;
+	uvec2 size;
+	// Fixed however big the frame, so depths never land on stale colors
+	uint color_offset;
+};
+
+layout(std430, binding = 0) readonly buffer Points {
+	Point points[];
+};
+
+layout(std430, binding = 1) readonly buffer Draws {
+	uvec2 draws[];
+};
+
+// Depths of every pixel, then their colors from color_offset
+layout(std430, binding = 2) buffer Target {
+	uint target[];
+};
+
+layout(location = 0) uniform uint color_pass;
+
+// Depths are positive, so their bits order like the floats. The first pass
+// keeps the nearest, the second lets the points that made it write color.
+void main() {
+	uvec2 draw = draws[gl_WorkGroupID.x];
+
+	for (uint i = gl_LocalInvocationID.x; i < draw.y; i += gl_WorkGroupSize.x) {
+		Point point = points[draw.x + i];
+
+		vec4 clip = view_projection * vec4(point.position, 1.0f);
+		if (any(greaterThan(abs(clip.xyz), vec3(clip.w))))
+			continue;
+
+		vec3 ndc = clip.xyz / clip.w;
+		uvec2 pixel = min(uvec2((ndc.xy * 0.5f + 0.5f) * vec2(size)), size - 1u);
+		uint index = pixel.y * size.x + pixel.x;
+		uint depth = floatBitsToUint(ndc.z * 0.5f + 0.5f);
+
+		if (color_pass == 0u) {
+			atomicMin(target[index], depth);
+		} else if (target[index] == depth) {
+			target[color_offset + index] = point.color;
+		}
+	}
+}
+)";
+
+constexpr char point_resolve_compute_shader_code[] = R"(
+#version 310 es
+
+layout(local_size_x = 8, local_size_y = 8) in;
+
+layout(std140, binding = 0) uniform PointUniforms {
+	mat4 view_projection;
+	uvec2 size;
+	// Fixed however big the frame, so depths never land on stale colors
+	uint color_offset;
+};
+
+layout(std430, binding = 2) buffer Target {
+	uint target[];
+};
+
+layout(rgba8, binding = 0) writeonly uniform highp image2D color_image;
+layout(r32f, binding = 1) writeonly uniform highp image2D depth_image;
+
+void main() {
+	uvec2 pixel = gl_GlobalInvocationID.xy;
+	if (any(greaterThanEqual(pixel, size)))
+		return;
+
+	uint index = pixel.y * size.x + pixel.x;
+	uint depth = target[index];
+
+	imageStore(color_image, ivec2(pixel), unpackUnorm4x8(target[color_offset + index]));
+	imageStore(depth_image, ivec2(pixel),
+	           vec4(depth == 0xFFFFFFFFu ? 1.0f : uintBitsToFloat(depth)));
+
+	// Cleared for the next frame
+	target[index] = 0xFFFFFFFFu;
+}
+)";
+
+constexpr char point_composite_fragment_shader_code[] = R"(
+#version 310 es
+precision highp float;
+
+layout(binding = 0) uniform mediump sampler2D point_color;
+layout(binding = 1) uniform highp sampler2D point_depth;
+
+out vec4 frag_color;
+
+void main() {
+	ivec2 texel = ivec2(gl_FragCoord.xy);
+
+	float depth = texelFetch(point_depth, texel, 0).r;
+	if (depth >= 1.0f)
+		discard;
+
+	frag_color = vec4(texelFetch(point_color, texel, 0).rgb, 1.0f);
+	gl_FragDepth = depth;
+}
+)";
+
+constexpr char upscale_fragment_shader_code[] = R"(
+#version 310 es
+precision highp float;
+
+layout(std140, binding = 0) uniform UpscaleUniforms {
+	vec2 one_over_viewport;
+};
+
+layout(binding = 0) uniform mediump sampler2D scene_color;
+layout(binding = 1) uniform highp sampler2D scene_depth;
+
+out vec4 frag_color;
+
+// Depth comes along so overlays still hide behind the scene
+void main() {
+	vec2 uv = gl_FragCoord.xy * one_over_viewport;
+
+	frag_color = vec4(texture(scene_color, uv).rgb, 1.0f);
+	gl_FragDepth = texture(scene_depth, uv).r;
+}
+)";
+
+constexpr char sharpened_upscale_fragment_shader_code[] = R"(
+#version 310 es
+precision highp float;
+
+layout(std140, binding = 0) uniform UpscaleUniforms {
+	vec2 one_over_viewport;
+};
+
+layout(binding = 0) uniform mediump sampler2D scene_color;
+layout(binding = 1) uniform highp sampler2D scene_depth;
+
+out vec4 frag_color;
+
+// Negative lobe of the cross at full sharpening
+const float peak = -1.0f / 6.0f;
+
+// The bilinear sample loses the difference to its neighbours a scene texel
+// away, scaled back by how much headroom the neighbourhood leaves, so high
+// contrast edges neither ring nor clip
+void main() {
+	vec2 uv = gl_FragCoord.xy * one_over_viewport;
+	vec2 texel = 1.0f / vec2(textureSize(scene_color, 0));
+
+	vec3 center = texture(scene_color, uv).rgb;
+	vec3 north = texture(scene_color, uv + vec2(0.0f, texel.y)).rgb;
+	vec3 south = texture(scene_color, uv - vec2(0.0f, texel.y)).rgb;
+	vec3 east = texture(scene_color, uv + vec2(texel.x, 0.0f)).rgb;
+	vec3 west = texture(scene_color, uv - vec2(texel.x, 0.0f)).rgb;
+
+	vec3 lowest = min(center, min(min(north, south), min(east, west)));
+	vec3 highest = max(center, max(max(north, south), max(east, west)));
+	vec3 headroom = clamp(min(lowest, 1.0f - highest) / max(highest, 1e-4f), 0.0f, 1.0f);
+	vec3 weight = sqrt(headroom) * peak;
+
+	vec3 color = (center + (north + south + east + west) * weight) / (1.0f + 4.0f * weight);
+
+	frag_color = vec4(clamp(color, 0.0f, 1.0f), 1.0f);
+	gl_FragDepth = texture(scene_depth, uv).r;
+}
+)";
+
+constexpr char cluster_cull_compute_shader_code[] = R"(
+#version 310 es
+precision highp float;
+
+layout(local_size_x = 64) in;
+
+struct Meshlet {
+	vec3 center;
+	float radius;
+	vec3 cone_axis;
+	float cone_cutoff;
+	uint vertex_offset;
+	uint triangle_offset;
+	uint vertex_count;
+	uint triangle_count;
+};
+
+struct Instance {
+	mat4 transform;
+	uint material;
+};
+
+struct ClusterDraw {
+	uint instance;
+	float scale;
+	uint cone_culling;
+	uint meshlet_offset;
+	uint meshlet_count;
+	uint index_offset;
+	uint command;
+	uint retest_offset;
+};
+
+layout(std140, binding = 0) uniform ClusterCullUniforms {
+	vec4 planes[6];
+	mat4 occlusion_view_projection;
+	vec3 view_position;
+	uint pyramid_levels;
+	vec2 pyramid_size;
+	uint first_draw;
+	uint pass;
+	uint late_command_offset;
+};
+
+layout(std430, binding = 0) readonly buffer Meshlets {
+	Meshlet meshlets[];
+};
+
+layout(std430, binding = 1) readonly buffer MeshletData {
+	uint meshlet_data[];
+};
+
+layout(std430, binding = 2) readonly buffer ClusterDraws {
+	ClusterDraw draws[];
+};
+
+layout(std430, binding = 3) writeonly buffer ClusterIndices {
+	uint indices[];
+};
+
+// Five uints per DrawElementsIndirectCommand, count first
+layout(std430, binding = 4) buffer ClusterCommands {
+	uint commands[];
+};
+
+// Set by the early pass for clusters only occlusion rejected
+layout(std430, binding = 5) buffer ClusterRetests {
+	uint retests[];
+};
+
+layout(std430, binding = 6) readonly buffer Instances {
+	Instance instances[];
+};
+
+layout(binding = 0) uniform highp sampler2D depth_pyramid;
+
+// Tests the sphere's screen rectangle against the farthest depth under it,
+// from a level where the rectangle covers at most two by two texels
+bool occluded(vec3 center, float radius) {
+	if (pyramid_levels == 0u)
+		return false;
+
+	vec2 minimum = vec2(1.0f);
+	vec2 maximum = vec2(-1.0f);
+	float depth = 1.0f;
+
+	for (int i = 0; i < 8; ++i) {
+		vec3 corner = center + radius * vec3((i & 1) != 0 ? 1.0f : -1.0f,
+		                                     (i & 2) != 0 ? 1.0f : -1.0f,
+		                                     (i & 4) != 0 ? 1.0f : -1.0f);
+
+		vec4 clip = occlusion_view_projection * vec4(corner, 1.0f);
+		if (clip.w <= 0.0f)
+			return false;
+
+		vec3 ndc = clip.xyz / clip.w;
+		minimum = min(minimum, ndc.xy);
+		maximum = max(maximum, ndc.xy);
+		depth = min(depth, ndc.z * 0.5f + 0.5f);
+	}
+
+	minimum = clamp(minimum * 0.5f + 0.5f, 0.0f, 1.0f);
+	maximum = clamp(maximum * 0.5f + 0.5f, 0.0f, 1.0f);
+
+	vec2 extent = (maximum - minimum) * pyramid_size;
+	int level = min(int(ceil(log2(max(max(extent.x, extent.y), 1.0f)))),
+	                int(pyramid_levels) - 1);
+
+	ivec2 size = max(ivec2(pyramid_size) >> level, ivec2(1));
+	ivec2 first = min(ivec2(minimum * vec2(size)), size - 1);
+	ivec2 last = min(ivec2(maximum * vec2(size)), size - 1);
+
+	float farthest = max(max(texelFetch(depth_pyramid, first, level).r,
+	                         texelFetch(depth_pyramid, ivec2(last.x, first.y), level).r),
+	                     max(texelFetch(depth_pyramid, ivec2(first.x, last.y), level).r,
+	                         texelFetch(depth_pyramid, last, level).r));
+
+	return depth > farthest;
+}
+
+// Appends the meshlet's triangles to the draw's region, late ones after
+// every early one
+void emit(ClusterDraw draw, Meshlet meshlet) {
+	uint count = meshlet.triangle_count * 3u;
+	uint first = draw.index_offset;
+
+	if (pass == 0u) {
+		first += atomicAdd(commands[draw.command * 5u], count);
+	} else {
+		uint command = draw.command + late_command_offset;
+		first += commands[draw.command * 5u];
+
+		commands[command * 5u + 2u] = first;
+		first += atomicAdd(commands[command * 5u], count);
+	}
+
+	for (uint t = 0u; t < meshlet.triangle_count; ++t) {
+		uint triangle = meshlet_data[meshlet.triangle_offset + t];
+
+		indices[first + t * 3u] = meshlet_data[meshlet.vertex_offset + (triangle & 0xFFu)];
+		indices[first + t * 3u + 1u] = meshlet_data[meshlet.vertex_offset + ((triangle >> 8) & 0xFFu)];
+		indices[first + t * 3u + 2u] = meshlet_data[meshlet.vertex_offset + (triangle >> 16)];
+	}
+}
+
+void main() {
+	ClusterDraw draw = draws[first_draw + gl_WorkGroupID.y];
+
+	uint index = gl_GlobalInvocationID.x;
+	if (index >= draw.meshlet_count)
+		return;
+
+	Meshlet meshlet = meshlets[draw.meshlet_offset + index];
+	mat4 transform = instances[draw.instance].transform;
+
+	vec3 center = (transform * vec4(meshlet.center, 1.0f)).xyz;
+	float radius = meshlet.radius * draw.scale;
+
+	uint retest = draw.retest_offset + index;
+
+	if (pass == 1u) {
+		if (retests[retest] != 0u && !occluded(center, radius))
+			emit(draw, meshlet);
+		return;
+	}
+
+	bool visible = true;
+	for (int i = 0; i < 6; ++i) {
+		visible = visible && dot(planes[i].xyz, center) + planes[i].w >= -radius;
+	}
+
+	if (visible && draw.cone_culling != 0u) {
+		vec3 axis = normalize(mat3(transform) * meshlet.cone_axis);
+		vec3 offset = center - view_position;
+
+		visible = dot(offset, axis) < meshlet.cone_cutoff * length(offset) + radius;
+	}
+
+	bool hidden = visible && occluded(center, radius);
+	retests[retest] = hidden ? 1u : 0u;
+
+	if (visible && !hidden)
+		emit(draw, meshlet);
+}
+)";
+
+constexpr char depth_pyramid_seed_compute_shader_code[] = R"(
+#version 310 es
+precision highp float;
+
+layout(local_size_x = 8, local_size_y = 8) in;
+
+layout(binding = 0) uniform highp sampler2D depth;
+layout(r32f, binding = 0) uniform highp writeonly image2D pyramid;
+
+// The top level is a power of two at most the depth buffer's size, so every
+// texel keeps the farthest of the up to three by three depths it overlaps
+void main() {
+	ivec2 size = imageSize(pyramid);
+	ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+
+	if (any(greaterThanEqual(texel, size)))
+		return;
+
+	ivec2 depth_size = textureSize(depth, 0);
+	ivec2 first = texel * depth_size / size;
+	ivec2 last = min(((texel + 1) * depth_size + size - 1) / size, depth_size) - 1;
+
+	float farthest = 0.0f;
+	for (int y = first.y; y <= last.y; ++y) {
+		for (int x = first.x; x <= last.x; ++x) {
+			farthest = max(farthest, texelFetch(depth, ivec2(x, y), 0).r);
+		}
+	}
+
+	imageStore(pyramid, texel, vec4(farthest));
+}
+)";
+
+constexpr char depth_pyramid_reduce_compute_shader_code[] = R"(
+#version 310 es
+precision highp float;
+
+layout(local_size_x = 8, local_size_y = 8) in;
+
+layout(r32f, binding = 0) uniform highp writeonly image2D pyramid;
+layout(r32f, binding = 1) uniform highp readonly image2D previous;
+
+void main() {
+	ivec2 size = imageSize(pyramid);
+	ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+
+	if (any(greaterThanEqual(texel, size)))
+		return;
+
+	// Levels stop halving along an axis once it is one texel wide
+	ivec2 last = imageSize(previous) - 1;
+	ivec2 base = texel * 2;
+
+	float farthest = max(max(imageLoad(previous, min(base, last)).r,
+	                         imageLoad(previous, min(base + ivec2(1, 0), last)).r),
+	                     max(imageLoad(previous, min(base + ivec2(0, 1), last)).r,
+	                         imageLoad(previous, min(base + ivec2(1, 1), last)).r));
+
+	imageStore(pyramid, texel, vec4(farthest));
+}
+)";
+
+constexpr char memory_overlay_vertex_shader_code[] = R"(
+#version 310 es
+
+layout(location = 0) in vec2 v_position;
+
+out float f_fraction;
+
+layout(std140, binding = 0) uniform MemoryOverlayUniforms {
+	vec4 rect;
+	vec4 ends[2];
+	float budget;
+	float marker_width;
+};
+
+void main() {
+	vec2 uv = v_position * 0.5f + 0.5f;
+
+	gl_Position = vec4(mix(rect.xy, rect.zw, uv), 0.0f, 1.0f);
+	f_fraction = uv.x;
+}
+)";
+
+constexpr char memory_overlay_fragment_shader_code[] = R"(
+#version 310 es
+precision mediump float;
+
+in float f_fraction;
+
+out vec4 frag_color;
+
+layout(std140, binding = 0) uniform MemoryOverlayUniforms {
+	vec4 rect;
+	vec4 ends[2];
+	float budget;
+	float marker_width;
+};
+
+// Mesh, texture, render target, uniform, scene, streaming
+const vec3 colors[6] = vec3[6](
+	vec3(0.20f, 0.60f, 0.90f),
+	vec3(0.30f, 0.80f, 0.30f),
+	vec3(0.90f, 0.60f, 0.20f),
+	vec3(0.80f, 0.30f, 0.80f),
+	vec3(0.30f, 0.80f, 0.80f),
+	vec3(0.90f, 0.90f, 0.30f)
+);
+
+void main() {
+	vec3 color = vec3(0.1f);
+
+	for (int i = 0; i < 6; ++i) {
+		if (f_fraction < ends[i / 4][i % 4]) {
+			color = colors[i];
+			break;
+		}
+	}
+
+	if (abs(f_fraction - budget) < marker_width) {
+		color = vec3(1.0f, 0.1f, 0.1f);
+	}
+
+	frag_color = vec4(color, 1.0f);
+}
+)";
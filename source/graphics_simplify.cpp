@@ -0,0 +1,289 @@
+#include "graphics_simplify.hpp"
+
+#include <cassert>
+#include <cmath>
+#include <algorithm>
+#include <unordered_map>
+
+#include <glm/geometric.hpp>
+
+#include "graphics_hash.hpp"
+
+namespace glint::graphics {
+
+namespace {
+
+// Symmetric 4x4 matrix summing squared distances to planes, weighted by area
+struct Quadric {
+	double a00 = 0.0, a01 = 0.0, a02 = 0.0, a03 = 0.0;
+	double a11 = 0.0, a12 = 0.0, a13 = 0.0;
+	double a22 = 0.0, a23 = 0.0;
+	double a33 = 0.0;
+	double weight = 0.0;
+
+	void addPlane(glm::dvec3 n, double d, double w) {
+		a00 += w * n.x * n.x; a01 += w * n.x * n.y; a02 += w * n.x * n.z; a03 += w * n.x * d;
+		a11 += w * n.y * n.y; a12 += w * n.y * n.z; a13 += w * n.y * d;
+		a22 += w * n.z * n.z; a23 += w * n.z * d;
+		a33 += w * d * d;
+		weight += w;
+	}
+
+	void add(const Quadric& q) {
+		a00 += q.a00; a01 += q.a01; a02 += q.a02; a03 += q.a03;
+		a11 += q.a11; a12 += q.a12; a13 += q.a13;
+		a22 += q.a22; a23 += q.a23;
+		a33 += q.a33;
+		weight += q.weight;
+	}
+
+	// Mean squared distance of p to the planes
+	double evaluate(glm::vec3 p) const {
+		double x = p.x, y = p.y, z = p.z;
+		double sum = a00 * x * x + 2.0 * a01 * x * y + 2.0 * a02 * x * z + 2.0 * a03 * x +
+		             a11 * y * y + 2.0 * a12 * y * z + 2.0 * a13 * y +
+		             a22 * z * z + 2.0 * a23 * z +
+		             a33;
+
+		return weight > 0.0 ? std::max(sum, 0.0) / weight : 0.0;
+	}
+};
+
+struct Collapse {
+	uint32_t from;
+	uint32_t to;
+	float cost;
+};
+
+inline glm::vec3 triangleNormal(glm::vec3 a, glm::vec3 b, glm::vec3 c) {
+	return glm::cross(b - a, c - a);
+}
+
+} // namespace
+
+std::vector<uint32_t> simplify(const std::span<const Vertex> vertices,
+                               const std::span<const uint32_t> indices,
+                               size_t target_index_count,
+                               float* error) {
+	assert(indices.size() % 3 == 0);
+
+	const uint32_t vertex_count = vertices.size();
+
+	std::vector<uint32_t> result(indices.begin(), indices.end());
+	double max_cost = 0.0;
+
+	// Vertices sharing a position are merged for the quadrics; all of them
+	// are locked, since moving one would tear the seam open
+	std::vector<uint32_t> remap(vertex_count);
+	std::vector<uint8_t> locked(vertex_count, false);
+	{
+		std::unordered_map<glm::vec3, uint32_t, PositionHash> first_at;
+		first_at.reserve(vertex_count);
+
+		for (uint32_t v = 0; v < vertex_count; ++v) {
+			auto [it, inserted] = first_at.try_emplace(vertices[v].position, v);
+			remap[v] = it->second;
+
+			if (!inserted) {
+				locked[v] = true;
+				locked[it->second] = true;
+			}
+		}
+	}
+
+	std::vector<Quadric> quadrics(vertex_count);
+
+	// Edges seen once in position space lie on a border
+	std::unordered_map<uint64_t, uint32_t> edge_uses;
+
+	for (size_t i = 0; i < result.size(); i += 3) {
+		uint32_t corners[3] = {remap[result[i]], remap[result[i + 1]], remap[result[i + 2]]};
+
+		glm::dvec3 p0(vertices[corners[0]].position);
+		glm::dvec3 p1(vertices[corners[1]].position);
+		glm::dvec3 p2(vertices[corners[2]].position);
+
+		glm::dvec3 normal = glm::cross(p1 - p0, p2 - p0);
+		double length = glm::length(normal);
+
+		if (length > 0.0) {
+			normal /= length;
+			for (uint32_t corner : corners) {
+				quadrics[corner].addPlane(normal, -glm::dot(normal, p0), length * 0.5);
+			}
+		}
+
+		for (int e = 0; e < 3; ++e) {
+			uint32_t a = std::min(corners[e], corners[(e + 1) % 3]);
+			uint32_t b = std::max(corners[e], corners[(e + 1) % 3]);
+			++edge_uses[(uint64_t(a) << 32) | b];
+		}
+	}
+
+	for (const auto& [edge, uses] : edge_uses) {
+		if (uses != 2) {
+			locked[edge >> 32] = true;
+			locked[edge & 0xFFFFFFFF] = true;
+		}
+	}
+
+	for (uint32_t v = 0; v < vertex_count; ++v) {
+		if (locked[remap[v]]) {
+			locked[v] = true;
+		}
+	}
+
+	std::vector<uint32_t> triangle_offsets(vertex_count + 1);
+	std::vector<uint32_t> triangle_lists;
+	std::vector<Collapse> collapses;
+	std::vector<uint32_t> collapse_to(vertex_count);
+	std::vector<uint8_t> touched(vertex_count);
+
+	// Each pass collapses a set of edges that do not share triangles, cheapest
+	// first, then rebuilds adjacency
+	while (result.size() > target_index_count) {
+		const uint32_t triangle_count = result.size() / 3;
+
+		std::fill(triangle_offsets.begin(), triangle_offsets.end(), 0);
+		for (uint32_t index : result) {
+			++triangle_offsets[index + 1];
+		}
+
+		for (uint32_t v = 0; v < vertex_count; ++v) {
+			triangle_offsets[v + 1] += triangle_offsets[v];
+		}
+
+		triangle_lists.resize(result.size());
+		{
+			std::vector<uint32_t> next(triangle_offsets.begin(), triangle_offsets.end() - 1);
+			for (uint32_t t = 0; t < triangle_count; ++t) {
+				for (int c = 0; c < 3; ++c) {
+					triangle_lists[next[result[t * 3 + c]]++] = t;
+				}
+			}
+		}
+
+		collapses.clear();
+		for (uint32_t t = 0; t < triangle_count; ++t) {
+			for (int e = 0; e < 3; ++e) {
+				uint32_t a = result[t * 3 + e];
+				uint32_t b = result[t * 3 + (e + 1) % 3];
+
+				Quadric edge = quadrics[remap[a]];
+				edge.add(quadrics[remap[b]]);
+
+				if (!locked[a]) {
+					collapses.push_back({a, b, float(edge.evaluate(vertices[b].position))});
+				}
+
+				if (!locked[b]) {
+					collapses.push_back({b, a, float(edge.evaluate(vertices[a].position))});
+				}
+			}
+		}
+
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) {
+			return a.cost < b.cost || (a.cost == b.cost && (a.from < b.from ||
+			                                                (a.from == b.from && a.to < b.to)));
+		});
+
+		for (uint32_t v = 0; v < vertex_count; ++v) {
+			collapse_to[v] = v;
+		}
+
+		std::fill(touched.begin(), touched.end(), false);
+
+		// A collapse removes the two triangles sharing its edge
+		size_t triangles_to_remove = (result.size() - target_index_count + 2) / 3;
+		size_t removed = 0;
+		uint32_t collapsed = 0;
+
+		for (const auto& collapse : collapses) {
+			if (removed >= triangles_to_remove) {
+				break;
+			}
+
+			const uint32_t from = collapse.from;
+			const uint32_t to = collapse.to;
+
+			if (touched[from] || touched[to]) {
+				continue;
+			}
+
+			const uint32_t* begin = triangle_lists.data() + triangle_offsets[from];
+			const uint32_t* end = triangle_lists.data() + triangle_offsets[from + 1];
+
+			// Reject collapses that would turn a remaining triangle over
+			bool flips = false;
+			uint32_t degenerate = 0;
+
+			for (const uint32_t* t = begin; t != end && !flips; ++t) {
+				const uint32_t* corners = result.data() + *t * 3;
+
+				if (corners[0] == to || corners[1] == to || corners[2] == to) {
+					++degenerate;
+					continue;
+				}
+
+				glm::vec3 before[3];
+				glm::vec3 after[3];
+				for (int c = 0; c < 3; ++c) {
+					before[c] = vertices[corners[c]].position;
+					after[c] = corners[c] == from ? vertices[to].position : before[c];
+				}
+
+				glm::vec3 normal_before = triangleNormal(before[0], before[1], before[2]);
+				glm::vec3 normal_after = triangleNormal(after[0], after[1], after[2]);
+
+				// Turning by more than about 75 degrees counts as a flip
+				flips = glm::dot(normal_before, normal_after) <=
+				        0.25f * glm::length(normal_before) * glm::length(normal_after);
+			}
+
+			if (flips) {
+				continue;
+			}
+
+			collapse_to[from] = to;
+			quadrics[remap[to]].add(quadrics[from]);
+			max_cost = std::max(max_cost, double(collapse.cost));
+
+			// Everything around the collapse is stale until the next pass
+			for (const uint32_t* t = begin; t != end; ++t) {
+				for (int c = 0; c < 3; ++c) {
+					touched[result[*t * 3 + c]] = true;
+				}
+			}
+
+			removed += degenerate;
+			++collapsed;
+		}
+
+		if (collapsed == 0) {
+			break;
+		}
+
+		size_t write = 0;
+		for (size_t i = 0; i < result.size(); i += 3) {
+			uint32_t a = collapse_to[result[i]];
+			uint32_t b = collapse_to[result[i + 1]];
+			uint32_t c = collapse_to[result[i + 2]];
+
+			if (a != b && b != c && c != a) {
+				result[write++] = a;
+				result[write++] = b;
+				result[write++] = c;
+			}
+		}
+
+		result.resize(write);
+	}
+
+	if (error != nullptr) {
+		*error = float(std::sqrt(max_cost));
+	}
+
+	return result;
+}
+
+} // namespace glint::graphics
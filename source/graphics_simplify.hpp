@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "graphics.hpp"
+
+namespace glint::graphics {
+
+// Quadric error edge collapse down to about target_index_count indices.
+// Vertices are only ever merged into existing ones, so the result indexes the
+// same vertex data. Vertices on borders or attribute seams stay in place.
+// error receives roughly how far the surface moved, in model units.
+std::vector<uint32_t> simplify(const std::span<const Vertex> vertices,
+                               const std::span<const uint32_t> indices,
+                               size_t target_index_count,
+                               float* error = nullptr);
+
+} // namespace glint::graphics
@@ -0,0 +1,238 @@
+#include "graphics_skinning.hpp"
+
+#include <cassert>
+#include <algorithm>
+
+namespace glint::graphics {
+
+namespace {
+
+constexpr char skinning_compute_shader_code[] = R"(
+#version 310 es
+
+layout(local_size_x = 64) in;
+
+layout(location = 0) uniform uint vertex_count;
+layout(location = 1) uniform uint first_target;
+
+// Skinned vertices, 11 words each
+layout(std430, binding = 0) readonly buffer Source {
+	uint source[];
+};
+
+// Per target its palette's first word, base vertex and base position, then
+// the palettes themselves
+layout(std430, binding = 1) readonly buffer Frame {
+	uint frame[];
+};
+
+layout(std430, binding = 2) writeonly buffer Vertices {
+	float vertices[];
+};
+
+layout(std430, binding = 3) writeonly buffer Positions {
+	float positions[];
+};
+
+vec4 jointRow(uint palette, uint joint, uint row) {
+	uint word = palette + joint * 12u + row * 4u;
+	return uintBitsToFloat(uvec4(frame[word], frame[word + 1u], frame[word + 2u],
+	                             frame[word + 3u]));
+}
+
+void main() {
+	uint vertex = gl_GlobalInvocationID.x;
+	if (vertex >= vertex_count)
+		return;
+
+	uint target = (first_target + gl_WorkGroupID.y) * 4u;
+	uint palette = frame[target];
+	uint base_vertex = frame[target + 1u];
+	uint base_position = frame[target + 2u];
+
+	uint word = vertex * 11u;
+	vec4 position = vec4(uintBitsToFloat(uvec3(source[word], source[word + 1u],
+	                                           source[word + 2u])), 1.0f);
+	vec3 normal = uintBitsToFloat(uvec3(source[word + 3u], source[word + 4u],
+	                                    source[word + 5u]));
+	uvec4 joints = (uvec4(source[word + 8u]) >> uvec4(0u, 8u, 16u, 24u)) & 0xFFu;
+	vec4 weights = vec4(unpackUnorm2x16(source[word + 9u]),
+	                    unpackUnorm2x16(source[word + 10u]));
+
+	vec4 rows[3];
+	for (uint row = 0u; row < 3u; ++row) {
+		rows[row] = weights.x * jointRow(palette, joints.x, row) +
+		            weights.y * jointRow(palette, joints.y, row) +
+		            weights.z * jointRow(palette, joints.z, row) +
+		            weights.w * jointRow(palette, joints.w, row);
+	}
+
+	vec3 skinned_position = vec3(dot(rows[0], position), dot(rows[1], position),
+	                             dot(rows[2], position));
+	vec3 skinned_normal = normalize(vec3(dot(rows[0].xyz, normal), dot(rows[1].xyz, normal),
+	                                     dot(rows[2].xyz, normal)));
+
+	uint out_vertex = (base_vertex + vertex) * 8u;
+	uint out_position = (base_position + vertex) * 3u;
+	for (uint i = 0u; i < 3u; ++i) {
+		vertices[out_vertex + i] = skinned_position[i];
+		vertices[out_vertex + 3u + i] = skinned_normal[i];
+		positions[out_position + i] = skinned_position[i];
+	}
+}
+)";
+
+constexpr uint32_t skinning_group_size = 64;
+constexpr uint32_t max_dispatch_targets = 65535;
+
+constexpr uint32_t source_location = 0;
+constexpr uint32_t frame_location = 1;
+constexpr uint32_t vertices_location = 2;
+constexpr uint32_t positions_location = 3;
+
+constexpr int32_t vertex_count_location = 0;
+constexpr int32_t first_target_location = 1;
+
+struct SkinningTarget {
+	uint32_t palette;
+	uint32_t base_vertex;
+	uint32_t base_position;
+	uint32_t padding;
+};
+
+static_assert(sizeof(animation::JointMatrix) == 12 * sizeof(uint32_t));
+
+gl::ComputePipeline* skinning_pipeline;
+GrowableBuffer* frame_buffer;
+
+std::vector<SkinningTarget> targets;
+
+std::vector<Vertex> toVertices(const std::span<const SkinnedVertex> vertices) {
+	std::vector<Vertex> result(vertices.size());
+	std::transform(vertices.begin(), vertices.end(), result.begin(),
+	               [](const SkinnedVertex& vertex) {
+		return Vertex{vertex.position, vertex.normal, vertex.uv};
+	});
+
+	return result;
+}
+
+uint32_t countJoints(const std::span<const SkinnedVertex> vertices) {
+	uint32_t count = 0;
+	for (const auto& vertex : vertices) {
+		for (uint32_t i = 0; i < 4; ++i) {
+			if (vertex.weights[i] != 0) {
+				count = std::max<uint32_t>(count, vertex.joints[i] + 1);
+			}
+		}
+	}
+
+	return count;
+}
+
+} // namespace
+
+SkinnedMesh::SkinnedMesh(const std::span<const SkinnedVertex> vertices,
+                         const std::span<const uint32_t> indices,
+                         const Bounds& bounds)
+: bind_vertices_(toVertices(vertices)),
+  indices_(indices.begin(), indices.end()),
+  bounds_{bounds},
+  joint_count_{countJoints(vertices)},
+  buffer_(GL_SHADER_STORAGE_BUFFER, GL_STATIC_DRAW, gl::MemoryCategory::mesh,
+          vertices.size_bytes(), vertices.data()) {
+	assert(!vertices.empty());
+}
+
+MeshHandle SkinnedMesh::createTarget(CommandList& commands) const {
+	MeshHandle target =
+		createFrom<Mesh>([&]() { return Mesh(commands, bind_vertices_, indices_); });
+	get(target).setDeforming(bounds_);
+
+	return target;
+}
+
+void skin(CommandList& commands, const std::span<const SkinnedModel> models,
+          const std::span<const animation::JointMatrix> palettes) {
+	if (models.empty()) {
+		return;
+	}
+
+	commands.beginScope("skinning");
+
+	// Palettes follow the table, which has room for every model
+	const size_t table_size = models.size() * sizeof(SkinningTarget);
+	const uint32_t palette_base = table_size / sizeof(uint32_t);
+
+	frame_buffer->reserve(commands, table_size + palettes.size_bytes());
+
+	// Targets are numbered by model, so the first model whose palette is
+	// incomplete ends them, and it and the rest keep last frame's pose
+	targets.clear();
+	for (const auto& model : models) {
+		if (size_t(model.palette) + model.mesh->jointCount() > palettes.size()) {
+			break;
+		}
+
+		const Mesh& target = get(model.target);
+		assert(target.deforming() && target.hasPositionStream());
+		assert(target.vertexCount() == model.mesh->vertexCount());
+
+		targets.push_back({palette_base + model.palette * 12, target.baseVertex(),
+		                   target.basePosition(), 0});
+	}
+
+	commands.assign(frame_buffer->get(), targets.size() * sizeof(SkinningTarget),
+	                targets.data());
+	commands.assign(frame_buffer->get(), palettes.size_bytes(), palettes.data(), table_size);
+
+	const Mesh& first = get(models.front().target);
+
+	commands.setComputePipeline(*skinning_pipeline);
+	commands.setStorageBuffer(frame_buffer->get(), frame_location);
+	commands.setStorageBuffer(first.vertexBuffer(), vertices_location);
+	commands.setStorageBuffer(first.positionBuffer(), positions_location);
+
+	const uint32_t model_count = targets.size();
+	for (uint32_t begin = 0; begin < model_count;) {
+		const SkinnedMesh& mesh = *models[begin].mesh;
+
+		uint32_t end = begin + 1;
+		while (end < model_count && models[end].mesh == &mesh &&
+		       end - begin < max_dispatch_targets) {
+			++end;
+		}
+
+		commands.setStorageBuffer(mesh.buffer(), source_location);
+		commands.setUniform(vertex_count_location, mesh.vertexCount());
+		commands.setUniform(first_target_location, begin);
+		commands.dispatch((mesh.vertexCount() + skinning_group_size - 1) / skinning_group_size,
+		                  end - begin);
+
+		begin = end;
+	}
+
+	// Draws fetch the vertices as attributes, geometry defragmentation copies them
+	commands.memoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT |
+	                       GL_BUFFER_UPDATE_BARRIER_BIT);
+
+	commands.endScope();
+}
+
+void setupSkinning() {
+	gl::Shader skinning_compute_shader(GL_COMPUTE_SHADER, skinning_compute_shader_code);
+	skinning_pipeline = new gl::ComputePipeline(skinning_compute_shader);
+
+	// Sized by the first frame skinning anything
+	frame_buffer = new GrowableBuffer(GL_SHADER_STORAGE_BUFFER, GL_DYNAMIC_DRAW,
+	                                  gl::MemoryCategory::scene);
+}
+
+void shutdownSkinning() {
+	delete frame_buffer;
+	delete skinning_pipeline;
+
+	targets.clear();
+}
+
+} // namespace glint::graphics
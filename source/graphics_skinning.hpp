@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "animation.hpp"
+#include "graphics.hpp"
+
+namespace glint::graphics {
+
+// A vertex bound to up to four joints, weights being unorm16 and summing to
+// one. Laid out as the skinning shader reads it.
+struct SkinnedVertex final {
+	glm::vec3 position;
+	glm::vec3 normal;
+	glm::vec2 uv;
+	uint8_t joints[4];
+	uint16_t weights[4];
+};
+
+static_assert(sizeof(SkinnedVertex) == 44);
+
+// The bind pose of a skinned mesh, kept in a storage buffer the skinning
+// pass reads. Each model drawing it needs a target of its own, a regular
+// mesh the pass rewrites in place every frame, so every pass that draws
+// meshes draws the skinned result.
+class SkinnedMesh final {
+public:
+	// bounds must hold the mesh in every pose it is skinned to
+	SkinnedMesh(const std::span<const SkinnedVertex> vertices,
+	            const std::span<const uint32_t> indices,
+	            const Bounds& bounds);
+	~SkinnedMesh() = default;
+
+	SkinnedMesh(const SkinnedMesh&) = delete;
+	SkinnedMesh(SkinnedMesh&&) noexcept = delete;
+
+	SkinnedMesh& operator=(const SkinnedMesh&) = delete;
+	SkinnedMesh& operator=(SkinnedMesh&&) noexcept = delete;
+
+	// A new target in the bind pose, destroyed through its pool like any mesh.
+	// Like creating any mesh it records its uploads into commands.
+	MeshHandle createTarget(CommandList& commands) const;
+
+	const gl::Buffer& buffer() const & noexcept { return buffer_; }
+	uint32_t vertexCount() const noexcept { return bind_vertices_.size(); }
+	// One past the highest joint a vertex has weight on
+	uint32_t jointCount() const noexcept { return joint_count_; }
+	const Bounds& bounds() const noexcept { return bounds_; }
+
+private:
+	std::vector<Vertex> bind_vertices_;
+	std::vector<uint32_t> indices_;
+	Bounds bounds_;
+	uint32_t joint_count_;
+	gl::Buffer buffer_;
+};
+
+struct SkinnedModel final {
+	const SkinnedMesh* mesh;
+	MeshHandle target;
+	// First of the model's joint matrices in the palettes
+	uint32_t palette;
+};
+
+// Records skinning every model's target with its joint matrices, as written
+// by animation::sample(). Models of the same mesh next to each other share
+// a dispatch. Call it at most once per frame, before render(). From the
+// first model whose joints run past the palettes on, models keep their
+// last pose.
+void skin(CommandList& commands, const std::span<const SkinnedModel> models,
+          const std::span<const animation::JointMatrix> palettes);
+
+// Owned by graphics::setup() and graphics::shutdown()
+void setupSkinning();
+void shutdownSkinning();
+
+} // namespace glint::graphics
@@ -1,7 +1,11 @@
 #include "graphics_utils.hpp"
 
+#include <algorithm>
+
 #include <glm/ext/vector_float2.hpp>
 
+#include "graphics_resources.hpp"
+
 namespace glint::graphics::utils {
 
 namespace {
@@ -171,57 +175,100 @@ gl::Pipeline* polygon_batch_pipeline;
 
 } // namespace
 
+template<size_t N, GLenum T>
+Batch<N, T>::Batch(size_t capacity, uint32_t buffer_count) {
+	assert(capacity != 0 && buffer_count != 0);
+
+	staging_.reserve(N * capacity);
+
+	buffers_.reserve(buffer_count);
+	for (uint32_t i = 0; i < buffer_count; ++i) {
+		buffers_.push_back(std::make_unique<GrowableBuffer>(T, GL_DYNAMIC_DRAW,
+		                                                    gl::MemoryCategory::streaming,
+		                                                    N * capacity * sizeof(Point)));
+	}
+}
+
+template<size_t N, GLenum T>
+const gl::Buffer& Batch<N, T>::upload(CommandList& commands) {
+	GrowableBuffer& buffer = *buffers_[next_buffer_];
+	next_buffer_ = (next_buffer_ + 1) % buffers_.size();
+
+	const size_t size = staging_.size() * sizeof(Point);
+	buffer.reserve(commands, size);
+
+	commands.assign(buffer.get(), size, staging_.data());
+	staging_.clear();
+
+	return buffer.get();
+}
+
 template<>
-void PointBatch::draw(const glm::mat4& projected_view) {
+void PointBatch::draw(CommandList& commands, const glm::mat4& projected_view) {
+	const size_t count = staging_.size();
+	if (count == 0) {
+		return;
+	}
+
+	const gl::Buffer& points = upload(commands);
+
 	BatchUniforms uniforms{
 		projected_view,
 		1.0f / gl::viewport(),
 	};
-	batch_uniform_buffer->assign(sizeof(uniforms), &uniforms);
+	commands.assign(*batch_uniform_buffer, sizeof(uniforms), &uniforms);
 	
-	gl::setPipeline(*point_batch_pipeline);
-	gl::setVertexBuffer(*unit_quad_vertex_buffer);
-	gl::setUniformBuffer(*batch_uniform_buffer, 0);
-	gl::setStorageBuffer(points_, 1);
+	commands.setPipeline(*point_batch_pipeline);
+	commands.setVertexBuffer(*unit_quad_vertex_buffer);
+	commands.setUniformBuffer(*batch_uniform_buffer, 0);
+	commands.setStorageBuffer(points, 1);
 
-	gl::drawInstanced(size_, 4);
-
-	size_ = 0;
+	commands.drawInstanced(count, 4);
 }
 
 template<>
-void LineBatch::draw(const glm::mat4& projected_view) {
-	assert(size_ % 2 == 0);
+void LineBatch::draw(CommandList& commands, const glm::mat4& projected_view) {
+	const size_t count = staging_.size();
+	assert(count % 2 == 0);
+
+	if (count == 0) {
+		return;
+	}
+
+	const gl::Buffer& points = upload(commands);
 
 	BatchUniforms uniforms{
 		projected_view,
 		1.0f / gl::viewport(),
 	};
-	batch_uniform_buffer->assign(sizeof(uniforms), &uniforms);
+	commands.assign(*batch_uniform_buffer, sizeof(uniforms), &uniforms);
 	
-	gl::setPipeline(*line_batch_pipeline);
-	gl::setVertexBuffer(*unit_quad_vertex_buffer);
-	gl::setUniformBuffer(*batch_uniform_buffer, 0);
-	gl::setStorageBuffer(points_, 1);
-
-	gl::drawInstanced(size_ / 2, 4);
+	commands.setPipeline(*line_batch_pipeline);
+	commands.setVertexBuffer(*unit_quad_vertex_buffer);
+	commands.setUniformBuffer(*batch_uniform_buffer, 0);
+	commands.setStorageBuffer(points, 1);
 
-	size_ = 0;
+	commands.drawInstanced(count / 2, 4);
 }
 
 template<>
-void PolygonBatch::draw(const glm::mat4& projected_view) {
-	assert(size_ % 3 == 0);
+void PolygonBatch::draw(CommandList& commands, const glm::mat4& projected_view) {
+	const size_t count = staging_.size();
+	assert(count % 3 == 0);
 
-	batch_uniform_buffer->assign(sizeof(glm::mat4), &projected_view);
-	
-	gl::setPipeline(*polygon_batch_pipeline);
-	gl::setVertexBuffer(points_);
-	gl::setUniformBuffer(*batch_uniform_buffer, 0);
+	if (count == 0) {
+		return;
+	}
 
-	gl::draw(size_);
+	const gl::Buffer& points = upload(commands);
+
+	commands.assign(*batch_uniform_buffer, sizeof(glm::mat4), &projected_view);
+	
+	commands.setPipeline(*polygon_batch_pipeline);
+	commands.setVertexBuffer(points);
+	commands.setUniformBuffer(*batch_uniform_buffer, 0);
 
-	size_ = 0;
+	commands.draw(count);
 }
 
 void setup() {
@@ -245,6 +292,7 @@ void setup() {
 
 	const DepthStencilState batch_depth_stencil_state{
 		.depth_write = false,
+		.depth_test = false,
 	};
 
 	const BlendState batch_blend_state{
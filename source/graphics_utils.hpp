@@ -1,10 +1,16 @@
 #pragma once
 
+#include <memory>
+#include <span>
+#include <vector>
+
 #include <glm/ext/vector_float3.hpp>
 #include <glm/ext/vector_float4.hpp>
 #include <glm/ext/matrix_float4x4.hpp>
 
 #include "graphics_gl.hpp"
+#include "graphics_commands.hpp"
+#include "graphics_resources.hpp"
 
 namespace glint::graphics::utils {
 
@@ -20,12 +26,19 @@ struct Point {
 	: position{position}, color{color} {}
 };
 
+// Points are staged on the CPU, which grows as needed, and uploaded once per
+// draw() into the next of a ring of buffers, so an upload never lands in
+// storage the GPU may still be reading for an earlier draw. The ring should
+// cover the draws of every frame in flight. A buffer too small for a draw is
+// replaced through the command list, so draw() may be recorded on any
+// thread, while the batch itself is created on the one owning the context.
 template<size_t N, GLenum T>
 class Batch final {
 public:
-	explicit Batch(size_t capacity)
-	: capacity_{N * capacity},
-	  points_(T, GL_DYNAMIC_DRAW, N * capacity * sizeof(Point)) {}
+	static constexpr uint32_t default_buffer_count = 3;
+
+	// capacity is in primitives and only sizes the initial storage
+	explicit Batch(size_t capacity, uint32_t buffer_count = default_buffer_count);
 	~Batch() = default;
 
 	Batch(const Batch&) = delete;
@@ -34,25 +47,20 @@ public:
 	Batch& operator=(const Batch&) = delete;
 	Batch& operator=(Batch&&) noexcept = delete;
 
-	size_t append(const std::span<const Point> points) {
-		size_t count = std::min(points.size(), capacity_ - size_);
-
-		if (count == 0)
-			return 0;
-
-		points_.assign(count * sizeof(Point), points.data(),
-		               size_ * sizeof(Point));
-		size_ += count;
-
-		return count;
+	void append(const std::span<const Point> points) {
+		staging_.insert(staging_.end(), points.begin(), points.end());
 	}
 
-	void draw(const glm::mat4& projected_view);
+	size_t size() const noexcept { return staging_.size(); }
+
+	void draw(CommandList& commands, const glm::mat4& projected_view);
 
 private:
-	size_t size_ = 0;
-	size_t capacity_;
-	gl::Buffer points_;
+	const gl::Buffer& upload(CommandList& commands);
+
+	std::vector<Point> staging_;
+	std::vector<std::unique_ptr<GrowableBuffer>> buffers_;
+	uint32_t next_buffer_ = 0;
 };
 
 using PointBatch = Batch<1, GL_SHADER_STORAGE_BUFFER>;
@@ -0,0 +1,264 @@
+#include "jobs.hpp"
+
+#include <cassert>
+#include <thread>
+
+namespace glint::jobs {
+
+void finish(Job& job);
+
+namespace {
+
+constexpr size_t deque_capacity = 4096;
+
+// Chase-Lev deque: the owning worker pushes and pops at the bottom, others
+// steal from the top. Follows the C11 formulation by Lê et al.
+class Deque final {
+	static_assert((deque_capacity & (deque_capacity - 1)) == 0);
+
+public:
+	bool push(Job* job) {
+		int64_t bottom = bottom_.load(std::memory_order_relaxed);
+		int64_t top = top_.load(std::memory_order_acquire);
+
+		if (bottom - top >= int64_t(deque_capacity)) {
+			return false;
+		}
+
+		jobs_[bottom % deque_capacity].store(job, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		bottom_.store(bottom + 1, std::memory_order_relaxed);
+
+		return true;
+	}
+
+	Job* pop() {
+		int64_t bottom = bottom_.load(std::memory_order_relaxed) - 1;
+		bottom_.store(bottom, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t top = top_.load(std::memory_order_relaxed);
+
+		if (top > bottom) {
+			bottom_.store(bottom + 1, std::memory_order_relaxed);
+			return nullptr;
+		}
+
+		Job* job = jobs_[bottom % deque_capacity].load(std::memory_order_relaxed);
+
+		// Last one left, race the thieves for it
+		if (top == bottom) {
+			if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst,
+			                                  std::memory_order_relaxed)) {
+				job = nullptr;
+			}
+
+			bottom_.store(bottom + 1, std::memory_order_relaxed);
+		}
+
+		return job;
+	}
+
+	Job* steal() {
+		int64_t top = top_.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t bottom = bottom_.load(std::memory_order_acquire);
+
+		if (top >= bottom) {
+			return nullptr;
+		}
+
+		Job* job = jobs_[top % deque_capacity].load(std::memory_order_relaxed);
+		if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst,
+		                                  std::memory_order_relaxed)) {
+			return nullptr;
+		}
+
+		return job;
+	}
+
+private:
+	alignas(64) std::atomic<int64_t> top_ = 0;
+	alignas(64) std::atomic<int64_t> bottom_ = 0;
+	std::atomic<Job*> jobs_[deque_capacity];
+};
+
+uint32_t worker_count = 1;
+Deque* deques;
+std::thread* threads;
+
+std::atomic<bool> running;
+
+// Bumped on every submission, idle workers sleep on it
+std::atomic<uint32_t> job_signal;
+
+thread_local uint32_t worker_index = 0;
+thread_local uint32_t steal_seed = 0;
+
+void execute(Job& job) {
+	job.function(job.context, job.begin, job.end, worker_index);
+	finish(job);
+}
+
+void submit(Job& job) {
+	if (deques == nullptr || !deques[worker_index].push(&job)) {
+		execute(job);
+		return;
+	}
+
+	job_signal.fetch_add(1, std::memory_order_release);
+	job_signal.notify_one();
+}
+
+Job* find() {
+	if (Job* job = deques[worker_index].pop()) {
+		return job;
+	}
+
+	// xorshift, only picks where to start looking
+	steal_seed ^= steal_seed << 13;
+	steal_seed ^= steal_seed >> 17;
+	steal_seed ^= steal_seed << 5;
+
+	for (uint32_t i = 0; i < worker_count; ++i) {
+		uint32_t victim = (steal_seed + i) % worker_count;
+		if (victim == worker_index) {
+			continue;
+		}
+
+		if (Job* job = deques[victim].steal()) {
+			return job;
+		}
+	}
+
+	return nullptr;
+}
+
+void work(uint32_t index) {
+	worker_index = index;
+	steal_seed = index * 2654435761u + 1;
+
+	while (running.load(std::memory_order_acquire)) {
+		// Loaded before looking, so a submission in between is not slept through
+		uint32_t seen = job_signal.load(std::memory_order_acquire);
+
+		if (Job* job = find()) {
+			execute(*job);
+		} else {
+			job_signal.wait(seen, std::memory_order_acquire);
+		}
+	}
+}
+
+} // namespace
+
+void finish(Job& job) {
+	Counter* counter = job.counter;
+	if (counter == nullptr) {
+		return;
+	}
+
+	std::vector<Job*> released;
+	{
+		std::lock_guard lock(counter->mutex_);
+		if (counter->pending_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+			released.swap(counter->waiting_);
+		}
+	}
+
+	for (Job* waiting : released) {
+		submit(*waiting);
+	}
+}
+
+void setup(uint32_t thread_count) {
+	assert(deques == nullptr);
+
+	if (thread_count == 0) {
+		thread_count = std::max(std::thread::hardware_concurrency(), 1u);
+	}
+
+	worker_count = thread_count;
+	worker_index = 0;
+	steal_seed = 1;
+
+	deques = new Deque[worker_count];
+
+	running = true;
+	job_signal = 0;
+
+	threads = new std::thread[worker_count - 1];
+	for (uint32_t i = 1; i < worker_count; ++i) {
+		threads[i - 1] = std::thread(work, i);
+	}
+}
+
+void shutdown() {
+	running = false;
+	job_signal.fetch_add(1, std::memory_order_release);
+	job_signal.notify_all();
+
+	for (uint32_t i = 1; i < worker_count; ++i) {
+		threads[i - 1].join();
+	}
+
+	delete[] threads;
+	threads = nullptr;
+
+	delete[] deques;
+	deques = nullptr;
+
+	worker_count = 1;
+}
+
+uint32_t workerCount() {
+	return worker_count;
+}
+
+uint32_t workerIndex() {
+	return worker_index;
+}
+
+void run(Job& job) {
+	assert(job.function != nullptr);
+
+	if (job.counter != nullptr) {
+		job.counter->pending_.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	submit(job);
+}
+
+void run(Job& job, Counter& dependency) {
+	assert(job.function != nullptr);
+
+	if (job.counter != nullptr) {
+		job.counter->pending_.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	{
+		std::lock_guard lock(dependency.mutex_);
+		if (dependency.pending_.load(std::memory_order_acquire) != 0) {
+			dependency.waiting_.push_back(&job);
+			return;
+		}
+	}
+
+	submit(job);
+}
+
+void wait(const Counter& counter) {
+	while (counter.pending_.load(std::memory_order_acquire) != 0) {
+		Job* job = deques != nullptr ? find() : nullptr;
+
+		if (job != nullptr) {
+			execute(*job);
+		} else {
+			std::this_thread::yield();
+		}
+	}
+
+	// The last finish() may still hold the lock
+	std::lock_guard lock(counter.mutex_);
+}
+
+} // namespace glint::jobs
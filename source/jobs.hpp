@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <algorithm>
+#include <type_traits>
+
+namespace glint::jobs {
+
+class Counter;
+
+// Jobs are plain data, whoever submits one keeps it alive until its counter
+// reaches zero. begin and end carry the range for parallelFor.
+struct Job final {
+	void (*function)(void* context, uint32_t begin, uint32_t end, uint32_t worker);
+	void* context = nullptr;
+	uint32_t begin = 0;
+	uint32_t end = 0;
+	Counter* counter = nullptr;
+};
+
+// Counts unfinished jobs. Jobs submitted with a counter as dependency are held
+// back until it reaches zero.
+class Counter final {
+public:
+	Counter() = default;
+	~Counter() = default;
+
+	Counter(const Counter&) = delete;
+	Counter(Counter&&) noexcept = delete;
+
+	Counter& operator=(const Counter&) = delete;
+	Counter& operator=(Counter&&) noexcept = delete;
+
+private:
+	friend void run(Job& job);
+	friend void run(Job& job, Counter& dependency);
+	friend void wait(const Counter& counter);
+	friend void finish(Job& job);
+
+	std::atomic<uint32_t> pending_ = 0;
+
+	// Held while the count drops, so waiting jobs are never missed and the
+	// counter is not destroyed under a finishing job
+	mutable std::mutex mutex_;
+	std::vector<Job*> waiting_;
+};
+
+// Spawns thread_count - 1 workers, the calling thread is worker 0. Zero picks
+// one thread per hardware thread. Only worker threads may submit or wait.
+void setup(uint32_t thread_count = 0);
+void shutdown();
+
+uint32_t workerCount();
+uint32_t workerIndex();
+
+void run(Job& job);
+void run(Job& job, Counter& dependency);
+
+// Runs other jobs until the counter reaches zero
+void wait(const Counter& counter);
+
+// Calls function(begin, end, worker) over [0, count) in chunks of at most
+// grain items and returns once all of them are done. Chunk boundaries depend
+// only on count and grain, so per-chunk results can be merged in order.
+template<typename F>
+void parallelFor(uint32_t count, uint32_t grain, F&& function) {
+	if (count == 0) {
+		return;
+	}
+
+	grain = std::max(grain, 1u);
+	uint32_t chunk_count = (count + grain - 1) / grain;
+
+	if (chunk_count == 1 || workerCount() == 1) {
+		for (uint32_t begin = 0; begin < count; begin += grain) {
+			function(begin, std::min(begin + grain, count), workerIndex());
+		}
+
+		return;
+	}
+
+	using Function = std::remove_reference_t<F>;
+
+	Counter counter;
+	std::vector<Job> jobs(chunk_count);
+
+	for (uint32_t i = 0; i < chunk_count; ++i) {
+		jobs[i] = {
+			.function = [](void* context, uint32_t begin, uint32_t end, uint32_t worker) {
+				(*static_cast<Function*>(context))(begin, end, worker);
+			},
+			.context = const_cast<void*>(static_cast<const void*>(&function)),
+			.begin = i * grain,
+			.end = std::min((i + 1) * grain, count),
+			.counter = &counter,
+		};
+
+		run(jobs[i]);
+	}
+
+	wait(counter);
+}
+
+} // namespace glint::jobs
@@ -0,0 +1,347 @@
+#include "profiler.hpp"
+
+#include <cassert>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <algorithm>
+#include <numeric>
+#include <unordered_map>
+
+#include <glad/gles2.h>
+
+namespace glint::profiler {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Query results are read back this many frames after being issued
+constexpr size_t frame_latency = 4;
+constexpr size_t max_frame_events = 64;
+constexpr size_t history_length = 256;
+constexpr size_t max_trace_events = 1 << 16;
+
+struct Event {
+	uint32_t scope;
+	Clock::time_point cpu_begin;
+	Clock::time_point cpu_end;
+};
+
+struct Frame {
+	std::array<Event, max_frame_events> events;
+	std::array<GLuint, 2 * max_frame_events> queries;
+	size_t count = 0;
+	bool pending = false;
+};
+
+struct ScopeHistory {
+	std::string name;
+	std::array<float, history_length> cpu{};
+	std::array<float, history_length> gpu{};
+	size_t cpu_count = 0;
+	size_t gpu_count = 0;
+};
+
+struct TraceEvent {
+	uint32_t scope;
+	bool gpu;
+	double begin;
+	double duration;
+};
+
+bool gpu_timing;
+int64_t gpu_clock_offset;
+Clock::time_point epoch;
+
+std::array<Frame, frame_latency> frames;
+size_t frame_index;
+size_t open_events[max_frame_events];
+size_t open_count;
+
+std::vector<ScopeHistory> histories;
+std::unordered_map<const char*, uint32_t> scope_ids;
+
+std::vector<TraceEvent> trace;
+
+// Read while frames are recorded on another thread
+std::atomic<double> latest_gpu_frame_time;
+
+inline double microseconds(Clock::duration duration) {
+	return std::chrono::duration<double, std::micro>(duration).count();
+}
+
+inline void push(std::array<float, history_length>& samples, size_t& count, float value) {
+	samples[count % history_length] = value;
+	++count;
+}
+
+void record(uint32_t scope, bool gpu, double begin, double duration) {
+	auto& history = histories[scope];
+
+	if (gpu) {
+		push(history.gpu, history.gpu_count, duration / 1000.0);
+	} else {
+		push(history.cpu, history.cpu_count, duration / 1000.0);
+	}
+
+	if (trace.size() < max_trace_events) {
+		trace.push_back({scope, gpu, begin, duration});
+	}
+}
+
+uint32_t scopeId(const char* name) {
+	auto it = scope_ids.find(name);
+	if (it != scope_ids.end()) {
+		return it->second;
+	}
+
+	// Different literals may share a name across translation units
+	auto same = std::find_if(histories.begin(), histories.end(),
+	                         [&](const auto& h) { return h.name == name; });
+
+	uint32_t id = same - histories.begin();
+	if (same == histories.end()) {
+		histories.push_back({.name = name});
+	}
+
+	scope_ids.emplace(name, id);
+	return id;
+}
+
+void calibrate() {
+	GLint64 gpu_now = 0;
+	glGetInteger64vEXT(GL_TIMESTAMP_EXT, &gpu_now);
+
+	int64_t cpu_now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+		Clock::now() - epoch).count();
+
+	gpu_clock_offset = cpu_now - gpu_now;
+}
+
+void resolve(Frame& frame) {
+	for (size_t i = 0; i < frame.count; ++i) {
+		const auto& event = frame.events[i];
+		record(event.scope, false,
+		       microseconds(event.cpu_begin - epoch),
+		       microseconds(event.cpu_end - event.cpu_begin));
+	}
+
+	if (gpu_timing && frame.count != 0) {
+		GLint disjoint = 0;
+		glGetIntegerv(GL_GPU_DISJOINT_EXT, &disjoint);
+
+		// The outermost scope ends last, so its query completes last
+		GLuint available = 0;
+		glGetQueryObjectuivEXT(frame.queries[1], GL_QUERY_RESULT_AVAILABLE_EXT, &available);
+
+		if (disjoint) {
+			calibrate();
+		} else if (available) {
+			for (size_t i = 0; i < frame.count; ++i) {
+				GLuint64 begin = 0, end = 0;
+				glGetQueryObjectui64vEXT(frame.queries[2 * i], GL_QUERY_RESULT_EXT, &begin);
+				glGetQueryObjectui64vEXT(frame.queries[2 * i + 1], GL_QUERY_RESULT_EXT, &end);
+
+				record(frame.events[i].scope, true,
+				       (int64_t(begin) + gpu_clock_offset) / 1000.0,
+				       (end - begin) / 1000.0);
+
+				// The first event is the frame itself
+				if (i == 0) {
+					latest_gpu_frame_time = (end - begin) / 1e6;
+				}
+			}
+		}
+	}
+
+	frame.count = 0;
+	frame.pending = false;
+}
+
+} // namespace
+
+void setup() {
+	epoch = Clock::now();
+
+	gpu_timing = false;
+	if (GLAD_GL_EXT_disjoint_timer_query) {
+		GLint bits = 0;
+		glGetQueryivEXT(GL_TIMESTAMP_EXT, GL_QUERY_COUNTER_BITS_EXT, &bits);
+		gpu_timing = bits != 0;
+	}
+
+	if (gpu_timing) {
+		for (auto& frame : frames) {
+			glGenQueriesEXT(frame.queries.size(), frame.queries.data());
+		}
+
+		calibrate();
+	}
+
+	trace.reserve(max_trace_events);
+}
+
+void shutdown() {
+	if (gpu_timing) {
+		for (auto& frame : frames) {
+			glDeleteQueriesEXT(frame.queries.size(), frame.queries.data());
+		}
+	}
+
+	histories.clear();
+	scope_ids.clear();
+	trace.clear();
+}
+
+void beginFrame() {
+	auto& frame = frames[frame_index % frame_latency];
+
+	if (frame.pending) {
+		resolve(frame);
+	}
+
+	begin("frame");
+}
+
+void endFrame() {
+	end();
+	assert(open_count == 0);
+
+	frames[frame_index % frame_latency].pending = true;
+	++frame_index;
+}
+
+void begin(const char* name) {
+	auto& frame = frames[frame_index % frame_latency];
+
+	if (frame.count == max_frame_events) {
+		open_events[open_count++] = max_frame_events;
+		return;
+	}
+
+	size_t index = frame.count++;
+	open_events[open_count++] = index;
+
+	frame.events[index].scope = scopeId(name);
+	frame.events[index].cpu_begin = Clock::now();
+
+	if (gpu_timing) {
+		glQueryCounterEXT(frame.queries[2 * index], GL_TIMESTAMP_EXT);
+	}
+}
+
+void end() {
+	assert(open_count != 0);
+
+	auto& frame = frames[frame_index % frame_latency];
+	size_t index = open_events[--open_count];
+
+	if (index == max_frame_events) {
+		return;
+	}
+
+	if (gpu_timing) {
+		glQueryCounterEXT(frame.queries[2 * index + 1], GL_TIMESTAMP_EXT);
+	}
+
+	frame.events[index].cpu_end = Clock::now();
+}
+
+void reset() {
+	assert(open_count == 0);
+
+	// Frames still in flight would otherwise land in the fresh history
+	for (auto& frame : frames) {
+		frame.count = 0;
+		frame.pending = false;
+	}
+
+	for (auto& history : histories) {
+		history.cpu_count = 0;
+		history.gpu_count = 0;
+	}
+
+	trace.clear();
+	latest_gpu_frame_time = 0.0;
+}
+
+bool gpuTimingAvailable() {
+	return gpu_timing;
+}
+
+double latestGpuFrameTime() {
+	return latest_gpu_frame_time;
+}
+
+std::vector<std::string> scopes() {
+	std::vector<std::string> names;
+	names.reserve(histories.size());
+
+	for (const auto& history : histories) {
+		names.push_back(history.name);
+	}
+
+	return names;
+}
+
+Statistics statistics(std::string_view name) {
+	auto it = std::find_if(histories.begin(), histories.end(),
+	                       [&](const auto& h) { return h.name == name; });
+	if (it == histories.end()) {
+		return {};
+	}
+
+	auto summarize = [](const std::array<float, history_length>& samples, size_t count,
+	                    double& average, double& p50, double& p95, double& p99) {
+		count = std::min(count, history_length);
+		if (count == 0) {
+			return;
+		}
+
+		std::array<float, history_length> sorted;
+		std::copy_n(samples.begin(), count, sorted.begin());
+		std::sort(sorted.begin(), sorted.begin() + count);
+
+		average = std::accumulate(sorted.begin(), sorted.begin() + count, 0.0) / count;
+		p50 = sorted[(count - 1) * 50 / 100];
+		p95 = sorted[(count - 1) * 95 / 100];
+		p99 = sorted[(count - 1) * 99 / 100];
+	};
+
+	Statistics result;
+	result.cpu_samples = std::min(it->cpu_count, history_length);
+	result.gpu_samples = std::min(it->gpu_count, history_length);
+
+	summarize(it->cpu, it->cpu_count,
+	          result.cpu_average, result.cpu_p50, result.cpu_p95, result.cpu_p99);
+	summarize(it->gpu, it->gpu_count,
+	          result.gpu_average, result.gpu_p50, result.gpu_p95, result.gpu_p99);
+
+	return result;
+}
+
+bool writeChromeTrace(const std::string& path) {
+	std::ofstream file(path);
+	if (!file) {
+		return false;
+	}
+
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":0,\"args\":{\"name\":\"CPU\"}},\n";
+	file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":1,\"args\":{\"name\":\"GPU\"}}";
+
+	for (const auto& event : trace) {
+		file << ",\n{\"name\":\"" << histories[event.scope].name << "\""
+		     << ",\"ph\":\"X\",\"pid\":0,\"tid\":" << (event.gpu ? 1 : 0)
+		     << ",\"ts\":" << event.begin
+		     << ",\"dur\":" << event.duration << '}';
+	}
+
+	file << "\n]}\n";
+
+	return bool(file);
+}
+
+} // namespace glint::profiler
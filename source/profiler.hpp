@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace glint::profiler {
+
+// Timings are in milliseconds. GPU values stay zero when the context lacks
+// EXT_disjoint_timer_query or results have not been read back yet.
+struct Statistics {
+	double cpu_average = 0.0;
+	double cpu_p50 = 0.0;
+	double cpu_p95 = 0.0;
+	double cpu_p99 = 0.0;
+	double gpu_average = 0.0;
+	double gpu_p50 = 0.0;
+	double gpu_p95 = 0.0;
+	double gpu_p99 = 0.0;
+	size_t cpu_samples = 0;
+	size_t gpu_samples = 0;
+};
+
+void setup();
+void shutdown();
+
+// Frames are bracketed by an implicit "frame" scope
+void beginFrame();
+void endFrame();
+
+// Scope names must outlive the frame they are recorded in
+void begin(const char* name);
+void end();
+
+class Scope final {
+public:
+	explicit Scope(const char* name) { begin(name); }
+	~Scope() { end(); }
+
+	Scope(const Scope&) = delete;
+	Scope(Scope&&) noexcept = delete;
+
+	Scope& operator=(const Scope&) = delete;
+	Scope& operator=(Scope&&) noexcept = delete;
+};
+
+// Drops collected samples and traces, e.g. after a warm-up period
+void reset();
+
+bool gpuTimingAvailable();
+
+// Of the newest frame read back, zero until there is one. Unlike the
+// statistics, it may be read while another thread executes frames.
+double latestGpuFrameTime();
+
+std::vector<std::string> scopes();
+Statistics statistics(std::string_view name);
+
+bool writeChromeTrace(const std::string& path);
+
+} // namespace glint::profiler
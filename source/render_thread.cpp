@@ -0,0 +1,162 @@
+#include "render_thread.hpp"
+
+#include <cassert>
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <thread>
+
+#include "frame.hpp"
+#include "profiler.hpp"
+
+namespace glint::render_thread {
+
+namespace {
+
+constexpr size_t command_list_count = 2;
+
+// Lock-free ring for one producer and one consumer. Either side blocks on
+// the other's index with atomic wait when the ring is full or empty.
+template<typename T, size_t N>
+class Queue final {
+	static_assert((N & (N - 1)) == 0);
+
+public:
+	void push(T value) {
+		size_t tail = tail_.load(std::memory_order_relaxed);
+
+		size_t head = head_.load(std::memory_order_acquire);
+		while (tail - head == N) {
+			head_.wait(head, std::memory_order_acquire);
+			head = head_.load(std::memory_order_acquire);
+		}
+
+		items_[tail % N] = value;
+		tail_.store(tail + 1, std::memory_order_release);
+		tail_.notify_one();
+	}
+
+	T pop() {
+		size_t head = head_.load(std::memory_order_relaxed);
+
+		size_t tail = tail_.load(std::memory_order_acquire);
+		while (tail == head) {
+			tail_.wait(tail, std::memory_order_acquire);
+			tail = tail_.load(std::memory_order_acquire);
+		}
+
+		T value = items_[head % N];
+		head_.store(head + 1, std::memory_order_release);
+		head_.notify_one();
+
+		return value;
+	}
+
+private:
+	alignas(64) std::atomic<size_t> head_ = 0;
+	alignas(64) std::atomic<size_t> tail_ = 0;
+	T items_[N];
+};
+
+ContextCallback make_current;
+PresentCallback present;
+
+graphics::CommandList* command_lists[command_list_count];
+graphics::CommandList* recording;
+
+// Null is pushed to stop the thread
+Queue<graphics::CommandList*, command_list_count> submitted;
+Queue<graphics::CommandList*, command_list_count> returned;
+
+uint64_t submitted_count;
+std::atomic<uint64_t> completed_count;
+
+std::thread* thread;
+
+void run() {
+	make_current(true);
+
+	while (graphics::CommandList* commands = submitted.pop()) {
+		profiler::beginFrame();
+		frame::throttle();
+
+		commands->execute();
+
+		frame::fence();
+		profiler::endFrame();
+
+		present();
+
+		commands->clear();
+		returned.push(commands);
+
+		completed_count.fetch_add(1, std::memory_order_release);
+		completed_count.notify_all();
+	}
+
+	make_current(false);
+}
+
+} // namespace
+
+void setup(ContextCallback context_callback, PresentCallback present_callback) {
+	assert(thread == nullptr);
+
+	make_current = std::move(context_callback);
+	present = std::move(present_callback);
+
+	for (auto& commands : command_lists) {
+		commands = new graphics::CommandList;
+		returned.push(commands);
+	}
+
+	submitted_count = 0;
+	completed_count = 0;
+
+	thread = new std::thread(run);
+}
+
+void shutdown() {
+	assert(recording == nullptr);
+
+	submitted.push(nullptr);
+	thread->join();
+
+	delete thread;
+	thread = nullptr;
+
+	for (auto*& commands : command_lists) {
+		returned.pop();
+		delete commands;
+		commands = nullptr;
+	}
+
+	make_current = nullptr;
+	present = nullptr;
+}
+
+graphics::CommandList& beginFrame() {
+	assert(recording == nullptr);
+
+	recording = returned.pop();
+	return *recording;
+}
+
+void endFrame() {
+	assert(recording != nullptr);
+
+	submitted.push(recording);
+	recording = nullptr;
+
+	++submitted_count;
+}
+
+void flush() {
+	uint64_t completed = completed_count.load(std::memory_order_acquire);
+	while (completed != submitted_count) {
+		completed_count.wait(completed, std::memory_order_acquire);
+		completed = completed_count.load(std::memory_order_acquire);
+	}
+}
+
+} // namespace glint::render_thread
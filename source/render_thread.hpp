@@ -0,0 +1,32 @@
+#pragma once
+
+#include <functional>
+
+#include "graphics_commands.hpp"
+
+namespace glint::render_thread {
+
+// Called on the render thread with true before it issues any GL commands and
+// with false before it exits. The context must not be current anywhere else
+// while the thread runs.
+using ContextCallback = std::function<void(bool current)>;
+
+// Called on the render thread after each frame has been executed
+using PresentCallback = std::function<void()>;
+
+void setup(ContextCallback make_current, PresentCallback present);
+
+// Waits for submitted frames to finish, then joins the thread
+void shutdown();
+
+// Two command lists are in use, one being recorded while the other executes.
+// Blocks when both are in flight.
+graphics::CommandList& beginFrame();
+void endFrame();
+
+// Blocks until every submitted frame has been executed and presented. The
+// thread then stays idle until the next endFrame(), so state it touches,
+// such as the profiler, may be read.
+void flush();
+
+} // namespace glint::render_thread
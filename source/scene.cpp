@@ -0,0 +1,170 @@
+#include "scene.hpp"
+
+#include <cassert>
+#include <algorithm>
+
+#include <glm/gtc/quaternion.hpp>
+
+#include "jobs.hpp"
+
+namespace glint::scene {
+
+namespace {
+
+// Nodes per job within one depth level
+constexpr uint32_t update_grain = 1024;
+
+template<typename T>
+void permute(std::vector<T>& values, const std::vector<uint32_t>& remap) {
+	std::vector<T> permuted(values.size());
+	for (size_t i = 0; i < values.size(); ++i) {
+		permuted[remap[i]] = values[i];
+	}
+
+	values = std::move(permuted);
+}
+
+inline glm::mat4 compose(glm::vec3 position, glm::quat rotation, glm::vec3 scale) {
+	glm::mat3 basis = glm::mat3_cast(rotation);
+
+	return glm::mat4(glm::vec4(basis[0] * scale.x, 0.0f),
+	                 glm::vec4(basis[1] * scale.y, 0.0f),
+	                 glm::vec4(basis[2] * scale.z, 0.0f),
+	                 glm::vec4(position, 1.0f));
+}
+
+} // namespace
+
+Node Graph::add(Node parent, glm::vec3 position, glm::quat rotation, glm::vec3 scale) {
+	assert(parent == no_node || parent < slots_.size());
+
+	Node node = slots_.size();
+	uint32_t slot = nodes_.size();
+
+	positions_.push_back(position);
+	rotations_.push_back(rotation);
+	scales_.push_back(scale);
+	parents_.push_back(parent == no_node ? no_node : slots_[parent]);
+	dirty_.push_back(true);
+	worlds_.emplace_back(1.0f);
+	nodes_.push_back(node);
+	slots_.push_back(slot);
+
+	// Appending keeps parents ahead of children but not the depth order
+	sorted_ = false;
+
+	return node;
+}
+
+void Graph::setPosition(Node node, glm::vec3 position) {
+	uint32_t slot = slots_[node];
+	positions_[slot] = position;
+	dirty_[slot] = true;
+}
+
+void Graph::setRotation(Node node, glm::quat rotation) {
+	uint32_t slot = slots_[node];
+	rotations_[slot] = rotation;
+	dirty_[slot] = true;
+}
+
+void Graph::setScale(Node node, glm::vec3 scale) {
+	uint32_t slot = slots_[node];
+	scales_[slot] = scale;
+	dirty_[slot] = true;
+}
+
+Node Graph::parent(Node node) const {
+	uint32_t parent = parents_[slots_[node]];
+	return parent == no_node ? no_node : nodes_[parent];
+}
+
+// Stable counting sort by depth, relies on parents preceding children
+void Graph::sort() {
+	const uint32_t count = nodes_.size();
+
+	std::vector<uint32_t> depths(count);
+	uint32_t max_depth = 0;
+
+	for (uint32_t slot = 0; slot < count; ++slot) {
+		uint32_t parent = parents_[slot];
+		depths[slot] = parent == no_node ? 0 : depths[parent] + 1;
+		max_depth = std::max(max_depth, depths[slot]);
+	}
+
+	levels_.assign(max_depth + 2, 0);
+	for (uint32_t depth : depths) {
+		++levels_[depth + 1];
+	}
+
+	for (size_t i = 1; i < levels_.size(); ++i) {
+		levels_[i] += levels_[i - 1];
+	}
+
+	std::vector<uint32_t> remap(count);
+	std::vector<uint32_t> next(levels_.begin(), levels_.end() - 1);
+
+	for (uint32_t slot = 0; slot < count; ++slot) {
+		remap[slot] = next[depths[slot]]++;
+	}
+
+	for (auto& parent : parents_) {
+		if (parent != no_node) {
+			parent = remap[parent];
+		}
+	}
+
+	permute(positions_, remap);
+	permute(rotations_, remap);
+	permute(scales_, remap);
+	permute(parents_, remap);
+	permute(dirty_, remap);
+	permute(worlds_, remap);
+	permute(nodes_, remap);
+
+	for (uint32_t slot = 0; slot < count; ++slot) {
+		slots_[nodes_[slot]] = slot;
+	}
+
+	sorted_ = true;
+}
+
+void Graph::update() {
+	if (!sorted_) {
+		sort();
+	}
+
+	// A level only reads the one above it, which is already done
+	for (size_t level = 0; level + 1 < levels_.size(); ++level) {
+		const uint32_t first = levels_[level];
+
+		jobs::parallelFor(levels_[level + 1] - first, update_grain,
+		                  [&](uint32_t begin, uint32_t end, uint32_t) {
+			for (uint32_t slot = first + begin; slot < first + end; ++slot) {
+				uint32_t parent = parents_[slot];
+
+				if (parent != no_node && dirty_[parent]) {
+					dirty_[slot] = true;
+				}
+
+				if (!dirty_[slot]) {
+					continue;
+				}
+
+				glm::mat4 local = compose(positions_[slot], rotations_[slot], scales_[slot]);
+				worlds_[slot] = parent == no_node ? local : worlds_[parent] * local;
+			}
+		});
+	}
+
+	changed_.clear();
+
+	for (uint32_t slot = 0; slot < nodes_.size(); ++slot) {
+		if (dirty_[slot]) {
+			changed_.push_back(nodes_[slot]);
+			dirty_[slot] = false;
+		}
+	}
+}
+
+} // namespace glint::scene
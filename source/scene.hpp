@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <vector>
+
+#include <glm/ext/vector_float3.hpp>
+#include <glm/ext/quaternion_float.hpp>
+#include <glm/ext/matrix_float4x4.hpp>
+
+namespace glint::scene {
+
+// Stable for the lifetime of the graph
+using Node = uint32_t;
+
+constexpr Node no_node = std::numeric_limits<Node>::max();
+
+// Transform hierarchy in structure-of-arrays form. Nodes are stored by depth,
+// so parents always precede their children and world matrices update in one
+// linear pass; each depth level is split across the job workers.
+class Graph final {
+public:
+	Graph() = default;
+	~Graph() = default;
+
+	Graph(const Graph&) = delete;
+	Graph(Graph&&) noexcept = default;
+
+	Graph& operator=(const Graph&) = delete;
+	Graph& operator=(Graph&&) noexcept = default;
+
+	Node add(Node parent = no_node,
+	         glm::vec3 position = glm::vec3(0.0f),
+	         glm::quat rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f),
+	         glm::vec3 scale = glm::vec3(1.0f));
+
+	void setPosition(Node node, glm::vec3 position);
+	void setRotation(Node node, glm::quat rotation);
+	void setScale(Node node, glm::vec3 scale);
+
+	glm::vec3 position(Node node) const { return positions_[slots_[node]]; }
+	glm::quat rotation(Node node) const { return rotations_[slots_[node]]; }
+	glm::vec3 scale(Node node) const { return scales_[slots_[node]]; }
+
+	Node parent(Node node) const;
+	size_t size() const noexcept { return slots_.size(); }
+
+	// Recomputes world matrices of changed nodes and everything below them
+	void update();
+
+	// Valid after update()
+	const glm::mat4& world(Node node) const { return worlds_[slots_[node]]; }
+
+	// Nodes whose world matrix was recomputed by the last update(), in storage order
+	std::span<const Node> changed() const noexcept { return changed_; }
+
+private:
+	void sort();
+
+	// Indexed by slot, the position in depth order
+	std::vector<glm::vec3> positions_;
+	std::vector<glm::quat> rotations_;
+	std::vector<glm::vec3> scales_;
+	std::vector<uint32_t> parents_;
+	std::vector<uint8_t> dirty_;
+	std::vector<glm::mat4> worlds_;
+	std::vector<Node> nodes_;
+
+	// Indexed by node
+	std::vector<uint32_t> slots_;
+
+	// First slot of every depth level, followed by the slot count
+	std::vector<uint32_t> levels_;
+	bool sorted_ = true;
+
+	std::vector<Node> changed_;
+};
+
+} // namespace glint::scene
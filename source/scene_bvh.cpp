@@ -0,0 +1,441 @@
+#include "scene_bvh.hpp"
+
+#include <cassert>
+#include <algorithm>
+#include <numeric>
+
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+
+namespace glint::scene {
+
+namespace {
+
+constexpr uint32_t bin_count = 16;
+
+// Splitting stops here even when the heuristic would rather keep going
+constexpr uint32_t min_leaf_items = 2;
+
+// And is forced above this even when keeping the leaf looks cheaper
+constexpr uint32_t max_leaf_items = 8;
+
+enum class Overlap {
+	outside,
+	partial,
+	inside,
+};
+
+struct Bin {
+	Box box = {glm::vec3(std::numeric_limits<float>::max()),
+	           glm::vec3(std::numeric_limits<float>::lowest())};
+	uint32_t count = 0;
+};
+
+inline void grow(Box& box, const Box& other) {
+	box.minimum = glm::min(box.minimum, other.minimum);
+	box.maximum = glm::max(box.maximum, other.maximum);
+}
+
+// Half the surface area, the constant factor does not affect the heuristic
+inline float area(const Box& box) {
+	glm::vec3 size = glm::max(box.maximum - box.minimum, glm::vec3(0.0f));
+	return size.x * size.y + size.y * size.z + size.z * size.x;
+}
+
+inline glm::vec3 centroid(const Box& box) {
+	return (box.minimum + box.maximum) * 0.5f;
+}
+
+Overlap classify(const Frustum& frustum, glm::vec3 minimum, glm::vec3 maximum) {
+	glm::vec3 center = (minimum + maximum) * 0.5f;
+	glm::vec3 extents = (maximum - minimum) * 0.5f;
+
+	Overlap overlap = Overlap::inside;
+
+	for (const auto& plane : frustum.planes) {
+		glm::vec3 normal(plane);
+		float distance = glm::dot(normal, center) + plane.w;
+		float radius = glm::dot(glm::abs(normal), extents);
+
+		if (distance + radius < 0.0f) {
+			return Overlap::outside;
+		}
+
+		if (distance - radius < 0.0f) {
+			overlap = Overlap::partial;
+		}
+	}
+
+	return overlap;
+}
+
+inline float distanceSquared(glm::vec3 point, glm::vec3 minimum, glm::vec3 maximum) {
+	glm::vec3 offset = point - glm::clamp(point, minimum, maximum);
+	return glm::dot(offset, offset);
+}
+
+// Entry distance along the ray, infinity when it misses
+inline float intersect(glm::vec3 origin, glm::vec3 inverse_direction,
+                       glm::vec3 minimum, glm::vec3 maximum, float max_distance) {
+	glm::vec3 t0 = (minimum - origin) * inverse_direction;
+	glm::vec3 t1 = (maximum - origin) * inverse_direction;
+
+	glm::vec3 near = glm::min(t0, t1);
+	glm::vec3 far = glm::max(t0, t1);
+
+	float enter = std::max(std::max(near.x, near.y), std::max(near.z, 0.0f));
+	float exit = std::min(std::min(far.x, far.y), std::min(far.z, max_distance));
+
+	return enter <= exit ? enter : std::numeric_limits<float>::infinity();
+}
+
+} // namespace
+
+Box Box::transformed(glm::vec3 center, glm::vec3 extents, const glm::mat4& transform) {
+	glm::vec3 world_center(transform * glm::vec4(center, 1.0f));
+	glm::vec3 world_extents = glm::abs(glm::vec3(transform[0])) * extents.x +
+	                          glm::abs(glm::vec3(transform[1])) * extents.y +
+	                          glm::abs(glm::vec3(transform[2])) * extents.z;
+
+	return {world_center - world_extents, world_center + world_extents};
+}
+
+Frustum Frustum::fromMatrix(const glm::mat4& view_projection) {
+	auto row = [&](int i) {
+		return glm::vec4(view_projection[0][i], view_projection[1][i],
+		                 view_projection[2][i], view_projection[3][i]);
+	};
+
+	return {{
+		row(3) + row(0), row(3) - row(0),
+		row(3) + row(1), row(3) - row(1),
+		row(3) + row(2), row(3) - row(2),
+	}};
+}
+
+bool Frustum::intersects(const Box& box) const {
+	return classify(*this, box.minimum, box.maximum) != Overlap::outside;
+}
+
+void Bvh::build(std::span<const Box> boxes) {
+	const uint32_t count = boxes.size();
+
+	boxes_.assign(boxes.begin(), boxes.end());
+	items_.resize(count);
+	std::iota(items_.begin(), items_.end(), 0);
+	leaves_.assign(count, no_node);
+
+	nodes_.clear();
+	parents_.clear();
+
+	if (count == 0) {
+		dirty_.clear();
+		return;
+	}
+
+	nodes_.reserve(2 * count);
+	parents_.reserve(2 * count);
+
+	nodes_.push_back({.first = 0, .count = count});
+	parents_.push_back(no_node);
+
+	std::vector<uint32_t> stack{0};
+
+	while (!stack.empty()) {
+		uint32_t index = stack.back();
+		stack.pop_back();
+
+		const uint32_t first = nodes_[index].first;
+		const uint32_t item_count = nodes_[index].count;
+
+		Bin bounds;
+		Bin centroids;
+		for (uint32_t i = first; i < first + item_count; ++i) {
+			const Box& box = boxes_[items_[i]];
+			grow(bounds.box, box);
+			grow(centroids.box, {centroid(box), centroid(box)});
+		}
+
+		nodes_[index].minimum = bounds.box.minimum;
+		nodes_[index].maximum = bounds.box.maximum;
+
+		if (item_count <= min_leaf_items) {
+			continue;
+		}
+
+		// Sweep the bins of every axis for the cheapest split
+		float best_cost = std::numeric_limits<float>::max();
+		int best_axis = -1;
+		uint32_t best_split = 0;
+
+		glm::vec3 extent = centroids.box.maximum - centroids.box.minimum;
+
+		for (int axis = 0; axis < 3; ++axis) {
+			if (extent[axis] <= 0.0f) {
+				continue;
+			}
+
+			float scale = bin_count / extent[axis];
+
+			Bin bins[bin_count];
+			for (uint32_t i = first; i < first + item_count; ++i) {
+				const Box& box = boxes_[items_[i]];
+				uint32_t bin = std::min(uint32_t((centroid(box)[axis] - centroids.box.minimum[axis]) * scale),
+				                        bin_count - 1);
+				grow(bins[bin].box, box);
+				++bins[bin].count;
+			}
+
+			float right_areas[bin_count];
+			uint32_t right_counts[bin_count];
+
+			Bin right;
+			for (uint32_t i = bin_count - 1; i > 0; --i) {
+				grow(right.box, bins[i].box);
+				right.count += bins[i].count;
+				right_areas[i] = area(right.box);
+				right_counts[i] = right.count;
+			}
+
+			Bin left;
+			for (uint32_t split = 1; split < bin_count; ++split) {
+				grow(left.box, bins[split - 1].box);
+				left.count += bins[split - 1].count;
+
+				if (left.count == 0 || right_counts[split] == 0) {
+					continue;
+				}
+
+				float cost = area(left.box) * left.count + right_areas[split] * right_counts[split];
+				if (cost < best_cost) {
+					best_cost = cost;
+					best_axis = axis;
+					best_split = split;
+				}
+			}
+		}
+
+		float leaf_cost = area(bounds.box) * item_count;
+		if (best_cost >= leaf_cost && item_count <= max_leaf_items) {
+			continue;
+		}
+
+		uint32_t* begin = items_.data() + first;
+		uint32_t* end = begin + item_count;
+		uint32_t* middle = begin + item_count / 2;
+
+		if (best_axis >= 0) {
+			float scale = bin_count / extent[best_axis];
+			float minimum = centroids.box.minimum[best_axis];
+
+			middle = std::partition(begin, end, [&](uint32_t item) {
+				uint32_t bin = std::min(uint32_t((centroid(boxes_[item])[best_axis] - minimum) * scale),
+				                        bin_count - 1);
+				return bin < best_split;
+			});
+		}
+
+		// Coincident centroids leave nothing to split on, so halve the range
+		if (middle == begin || middle == end) {
+			middle = begin + item_count / 2;
+		}
+
+		uint32_t left_count = middle - begin;
+		uint32_t left = nodes_.size();
+
+		nodes_.push_back({.first = first, .count = left_count});
+		nodes_.push_back({.first = first + left_count, .count = item_count - left_count});
+		parents_.push_back(index);
+		parents_.push_back(index);
+
+		nodes_[index].first = left;
+		nodes_[index].count = 0;
+
+		stack.push_back(left + 1);
+		stack.push_back(left);
+	}
+
+	for (uint32_t index = 0; index < nodes_.size(); ++index) {
+		const Node& node = nodes_[index];
+		for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+			leaves_[items_[i]] = index;
+		}
+	}
+
+	dirty_.assign(nodes_.size(), false);
+}
+
+void Bvh::refit(std::span<const uint32_t> items, std::span<const Box> boxes) {
+	assert(items.size() == boxes.size());
+
+	dirty_nodes_.clear();
+
+	for (size_t i = 0; i < items.size(); ++i) {
+		boxes_[items[i]] = boxes[i];
+
+		for (uint32_t node = leaves_[items[i]]; node != no_node && !dirty_[node]; node = parents_[node]) {
+			dirty_[node] = true;
+			dirty_nodes_.push_back(node);
+		}
+	}
+
+	// Children always come after their parent in the array
+	std::sort(dirty_nodes_.begin(), dirty_nodes_.end(), std::greater<uint32_t>());
+
+	for (uint32_t node : dirty_nodes_) {
+		refitNode(node);
+		dirty_[node] = false;
+	}
+}
+
+void Bvh::refitNode(uint32_t index) {
+	Node& node = nodes_[index];
+
+	Bin bounds;
+
+	if (node.count == 0) {
+		const Node& left = nodes_[node.first];
+		const Node& right = nodes_[node.first + 1];
+		grow(bounds.box, {left.minimum, left.maximum});
+		grow(bounds.box, {right.minimum, right.maximum});
+	} else {
+		for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+			grow(bounds.box, boxes_[items_[i]]);
+		}
+	}
+
+	node.minimum = bounds.box.minimum;
+	node.maximum = bounds.box.maximum;
+}
+
+void Bvh::queryFrustum(const Frustum& frustum, std::vector<uint32_t>& items) const {
+	if (nodes_.empty()) {
+		return;
+	}
+
+	// Nodes fully inside skip the tests for everything below them
+	struct Entry {
+		uint32_t node;
+		bool inside;
+	};
+
+	std::vector<Entry> stack{{0, false}};
+
+	while (!stack.empty()) {
+		auto [index, inside] = stack.back();
+		stack.pop_back();
+
+		const Node& node = nodes_[index];
+
+		if (!inside) {
+			Overlap overlap = classify(frustum, node.minimum, node.maximum);
+			if (overlap == Overlap::outside) {
+				continue;
+			}
+
+			inside = overlap == Overlap::inside;
+		}
+
+		if (node.count == 0) {
+			stack.push_back({node.first + 1, inside});
+			stack.push_back({node.first, inside});
+			continue;
+		}
+
+		for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+			if (inside || frustum.intersects(boxes_[items_[i]])) {
+				items.push_back(items_[i]);
+			}
+		}
+	}
+}
+
+void Bvh::querySphere(glm::vec3 center, float radius, std::vector<uint32_t>& items) const {
+	if (nodes_.empty()) {
+		return;
+	}
+
+	const float radius_squared = radius * radius;
+
+	std::vector<uint32_t> stack{0};
+
+	while (!stack.empty()) {
+		const Node& node = nodes_[stack.back()];
+		stack.pop_back();
+
+		if (distanceSquared(center, node.minimum, node.maximum) > radius_squared) {
+			continue;
+		}
+
+		if (node.count == 0) {
+			stack.push_back(node.first + 1);
+			stack.push_back(node.first);
+			continue;
+		}
+
+		for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+			const Box& box = boxes_[items_[i]];
+			if (distanceSquared(center, box.minimum, box.maximum) <= radius_squared) {
+				items.push_back(items_[i]);
+			}
+		}
+	}
+}
+
+RayHit Bvh::queryRay(glm::vec3 origin, glm::vec3 direction, float max_distance) const {
+	RayHit hit;
+
+	if (nodes_.empty()) {
+		return hit;
+	}
+
+	// Division by zero gives infinities, which the slab test handles
+	const glm::vec3 inverse_direction = 1.0f / direction;
+	const float miss = std::numeric_limits<float>::infinity();
+
+	std::vector<uint32_t> stack{0};
+
+	while (!stack.empty()) {
+		const Node& node = nodes_[stack.back()];
+		stack.pop_back();
+
+		if (intersect(origin, inverse_direction, node.minimum, node.maximum, max_distance) == miss) {
+			continue;
+		}
+
+		if (node.count == 0) {
+			const Node& left = nodes_[node.first];
+			const Node& right = nodes_[node.first + 1];
+
+			float left_distance = intersect(origin, inverse_direction,
+			                                left.minimum, left.maximum, max_distance);
+			float right_distance = intersect(origin, inverse_direction,
+			                                 right.minimum, right.maximum, max_distance);
+
+			// Nearer child on top, so its hits shorten the ray for the other
+			if (left_distance < right_distance) {
+				stack.push_back(node.first + 1);
+				stack.push_back(node.first);
+			} else {
+				stack.push_back(node.first);
+				stack.push_back(node.first + 1);
+			}
+
+			continue;
+		}
+
+		for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+			const Box& box = boxes_[items_[i]];
+			float distance = intersect(origin, inverse_direction, box.minimum, box.maximum, max_distance);
+
+			if (distance < hit.distance) {
+				hit = {items_[i], distance};
+				max_distance = distance;
+			}
+		}
+	}
+
+	return hit;
+}
+
+} // namespace glint::scene
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <vector>
+
+#include <glm/ext/vector_float3.hpp>
+#include <glm/ext/vector_float4.hpp>
+#include <glm/ext/matrix_float4x4.hpp>
+
+namespace glint::scene {
+
+struct Box final {
+	glm::vec3 minimum;
+	glm::vec3 maximum;
+
+	// World box around a local box given as center and half size
+	static Box transformed(glm::vec3 center, glm::vec3 extents, const glm::mat4& transform);
+};
+
+struct Frustum final {
+	// Inward facing, xyz is the normal and w the distance
+	glm::vec4 planes[6];
+
+	static Frustum fromMatrix(const glm::mat4& view_projection);
+
+	bool intersects(const Box& box) const;
+};
+
+struct RayHit final {
+	uint32_t item = std::numeric_limits<uint32_t>::max();
+	float distance = std::numeric_limits<float>::infinity();
+};
+
+// Bounding volume hierarchy over item boxes, with items identified by their
+// index in the span given to build(). Nodes live in one flat array with
+// siblings next to each other; moving items are refitted in place, a rebuild
+// restores the tree quality once they have moved far.
+class Bvh final {
+public:
+	Bvh() = default;
+	~Bvh() = default;
+
+	Bvh(const Bvh&) = delete;
+	Bvh(Bvh&&) noexcept = default;
+
+	Bvh& operator=(const Bvh&) = delete;
+	Bvh& operator=(Bvh&&) noexcept = default;
+
+	// Binned surface area heuristic
+	void build(std::span<const Box> boxes);
+
+	// Takes new boxes for the given items and refits only their ancestors
+	void refit(std::span<const uint32_t> items, std::span<const Box> boxes);
+
+	// Results are appended to items
+	void queryFrustum(const Frustum& frustum, std::vector<uint32_t>& items) const;
+	void querySphere(glm::vec3 center, float radius, std::vector<uint32_t>& items) const;
+
+	// Nearest item whose box the ray enters within max_distance
+	RayHit queryRay(glm::vec3 origin, glm::vec3 direction,
+	                float max_distance = std::numeric_limits<float>::infinity()) const;
+
+	size_t size() const noexcept { return boxes_.size(); }
+	const Box& box(uint32_t item) const { return boxes_[item]; }
+
+private:
+	static constexpr uint32_t no_node = std::numeric_limits<uint32_t>::max();
+
+	// Leaves hold count items from items_[first], inner nodes have count zero
+	// and their children at first and first + 1
+	struct Node {
+		glm::vec3 minimum = glm::vec3(0.0f);
+		uint32_t first = 0;
+		glm::vec3 maximum = glm::vec3(0.0f);
+		uint32_t count = 0;
+	};
+
+	void refitNode(uint32_t node);
+
+	std::vector<Node> nodes_;
+	std::vector<uint32_t> parents_;
+	std::vector<uint32_t> items_;
+	std::vector<uint32_t> leaves_;
+	std::vector<Box> boxes_;
+
+	std::vector<uint8_t> dirty_;
+	std::vector<uint32_t> dirty_nodes_;
+};
+
+} // namespace glint::scene
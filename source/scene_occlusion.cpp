@@ -0,0 +1,489 @@
+#include "scene_occlusion.hpp"
+
+#include <cassert>
+#include <cmath>
+#include <algorithm>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+#include "jobs.hpp"
+
+namespace glint::scene {
+
+namespace {
+
+constexpr uint32_t full_mask = 0xFFFFFFFF;
+
+// Occluders set up per job, and tile rows rasterized per job
+constexpr uint32_t occluder_grain = 16;
+constexpr uint32_t band_rows = 4;
+
+// Triangles are clipped to this many times the viewport on each axis, so
+// edge equations stay well inside float precision
+constexpr float guard_band = 2.0f;
+
+// And to just in front of the eye, keeping 1/w finite
+constexpr float minimum_w = 1e-4f;
+
+constexpr float empty_layer = std::numeric_limits<float>::infinity();
+
+constexpr uint32_t clip_plane_count = 5;
+constexpr uint32_t max_clipped_vertices = 3 + clip_plane_count;
+
+// Positive inside
+inline float clipDistance(const glm::vec4& v, uint32_t plane) {
+	switch (plane) {
+		case 0: return v.w - minimum_w;
+		case 1: return guard_band * v.w - v.x;
+		case 2: return guard_band * v.w + v.x;
+		case 3: return guard_band * v.w - v.y;
+		default: return guard_band * v.w + v.y;
+	}
+}
+
+inline uint32_t outcode(const glm::vec4& v) {
+	uint32_t code = 0;
+	for (uint32_t plane = 0; plane < clip_plane_count; ++plane) {
+		code |= uint32_t(clipDistance(v, plane) < 0.0f) << plane;
+	}
+
+	return code;
+}
+
+// Sutherland-Hodgman, returns the vertex count left in polygon
+uint32_t clipPolygon(glm::vec4 (&polygon)[max_clipped_vertices], uint32_t count, uint32_t planes) {
+	glm::vec4 clipped[max_clipped_vertices];
+
+	for (uint32_t plane = 0; plane < clip_plane_count && count != 0; ++plane) {
+		if ((planes & (1 << plane)) == 0) {
+			continue;
+		}
+
+		uint32_t clipped_count = 0;
+
+		for (uint32_t i = 0; i < count; ++i) {
+			const glm::vec4& from = polygon[i];
+			const glm::vec4& to = polygon[(i + 1) % count];
+			const float from_distance = clipDistance(from, plane);
+			const float to_distance = clipDistance(to, plane);
+
+			if (from_distance >= 0.0f) {
+				clipped[clipped_count++] = from;
+			}
+
+			if ((from_distance >= 0.0f) != (to_distance >= 0.0f)) {
+				const float t = from_distance / (from_distance - to_distance);
+				clipped[clipped_count++] = from + (to - from) * t;
+			}
+		}
+
+		std::copy_n(clipped, clipped_count, polygon);
+		count = clipped_count;
+	}
+
+	return count;
+}
+
+// Bit y * 8 + x is set when the pixel x, y from the tile's corner has its
+// centre inside every edge; x and y locate the centre of the first pixel
+template<typename Triangle>
+inline uint32_t coverTile(const Triangle& triangle, float x, float y) {
+	uint32_t mask = full_mask;
+
+#if defined(__SSE2__) || defined(_M_X64)
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 offsets = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+
+	for (uint32_t edge = 0; edge < 3 && mask != 0; ++edge) {
+		const float a = triangle.a[edge];
+		const float b = triangle.b[edge];
+		const float start = a * x + b * y + triangle.c[edge];
+
+		__m128 left = _mm_add_ps(_mm_set1_ps(start), _mm_mul_ps(_mm_set1_ps(a), offsets));
+		const __m128 step_x = _mm_set1_ps(4.0f * a);
+		const __m128 step_y = _mm_set1_ps(b);
+
+		uint32_t edge_mask = 0;
+		for (uint32_t row = 0; row < OcclusionBuffer::tile_height; ++row) {
+			const __m128 right = _mm_add_ps(left, step_x);
+			const uint32_t bits = _mm_movemask_ps(_mm_cmpge_ps(left, zero)) |
+			                      _mm_movemask_ps(_mm_cmpge_ps(right, zero)) << 4;
+
+			edge_mask |= bits << (row * OcclusionBuffer::tile_width);
+			left = _mm_add_ps(left, step_y);
+		}
+
+		mask &= edge_mask;
+	}
+#else
+	for (uint32_t edge = 0; edge < 3 && mask != 0; ++edge) {
+		const float a = triangle.a[edge];
+		const float b = triangle.b[edge];
+		float left = a * x + b * y + triangle.c[edge];
+
+		uint32_t edge_mask = 0;
+		for (uint32_t row = 0; row < OcclusionBuffer::tile_height; ++row) {
+			for (uint32_t column = 0; column < OcclusionBuffer::tile_width; ++column) {
+				edge_mask |= uint32_t(left + a * float(column) >= 0.0f)
+				             << (row * OcclusionBuffer::tile_width + column);
+			}
+
+			left += b;
+		}
+
+		mask &= edge_mask;
+	}
+#endif
+
+	return mask;
+}
+
+} // namespace
+
+// Corner i lies at the bits of i
+const glm::vec3 unit_cube_positions[8] = {
+	{-0.5f, -0.5f, -0.5f}, {0.5f, -0.5f, -0.5f}, {-0.5f, 0.5f, -0.5f}, {0.5f, 0.5f, -0.5f},
+	{-0.5f, -0.5f, 0.5f}, {0.5f, -0.5f, 0.5f}, {-0.5f, 0.5f, 0.5f}, {0.5f, 0.5f, 0.5f},
+};
+
+const uint32_t unit_cube_indices[36] = {
+	4, 5, 7, 4, 7, 6,
+	0, 2, 3, 0, 3, 1,
+	1, 3, 7, 1, 7, 5,
+	0, 4, 6, 0, 6, 2,
+	6, 7, 3, 6, 3, 2,
+	0, 1, 5, 0, 5, 4,
+};
+
+OcclusionBuffer::OcclusionBuffer(uint32_t width, uint32_t height)
+: width_{width},
+  height_{height},
+  tiles_x_{(width + tile_width - 1) / tile_width},
+  tiles_y_{(height + tile_height - 1) / tile_height},
+  depths_(tiles_x_ * tiles_y_, 0.0f),
+  layer_depths_(tiles_x_ * tiles_y_, empty_layer),
+  layer_masks_(tiles_x_ * tiles_y_, 0) {
+	assert(width != 0 && height != 0);
+}
+
+void OcclusionBuffer::clear(const glm::mat4& view_projection) {
+	view_projection_ = view_projection;
+
+	std::fill(depths_.begin(), depths_.end(), 0.0f);
+	std::fill(layer_depths_.begin(), layer_depths_.end(), empty_layer);
+	std::fill(layer_masks_.begin(), layer_masks_.end(), 0);
+
+	occluders_.clear();
+	triangles_.clear();
+	statistics_ = {};
+}
+
+void OcclusionBuffer::addOccluder(std::span<const glm::vec3> positions,
+                                  std::span<const uint32_t> indices,
+                                  const glm::mat4& transform) {
+	assert(indices.size() % 3 == 0);
+	occluders_.push_back({positions, indices, transform});
+}
+
+// Set up in parallel and gathered in order, then drawn band by band
+void OcclusionBuffer::rasterize() {
+	const uint32_t count = occluders_.size();
+
+	worker_positions_.resize(jobs::workerCount());
+	worker_triangles_.resize(jobs::workerCount());
+	for (auto& triangles : worker_triangles_) {
+		triangles.clear();
+	}
+
+	chunks_.resize((count + occluder_grain - 1) / occluder_grain);
+
+	jobs::parallelFor(count, occluder_grain, [&](uint32_t begin, uint32_t end, uint32_t worker) {
+		auto& triangles = worker_triangles_[worker];
+		auto& chunk = chunks_[begin / occluder_grain];
+
+		chunk.worker = worker;
+		chunk.offset = triangles.size();
+
+		for (uint32_t i = begin; i < end; ++i) {
+			setupTriangles(occluders_[i], worker_positions_[worker], triangles);
+		}
+
+		chunk.count = triangles.size() - chunk.offset;
+	});
+
+	for (const auto& chunk : chunks_) {
+		const auto& triangles = worker_triangles_[chunk.worker];
+		triangles_.insert(triangles_.end(), triangles.begin() + chunk.offset,
+		                  triangles.begin() + chunk.offset + chunk.count);
+	}
+
+	statistics_.occluders += count;
+	statistics_.triangles += triangles_.size();
+
+	const uint32_t band_count = (tiles_y_ + band_rows - 1) / band_rows;
+
+	jobs::parallelFor(band_count, 1, [&](uint32_t begin, uint32_t end, uint32_t) {
+		for (uint32_t band = begin; band < end; ++band) {
+			drawBand(band * band_rows, std::min((band + 1) * band_rows, tiles_y_) - 1);
+		}
+	});
+
+	occluders_.clear();
+	triangles_.clear();
+}
+
+// The box's nearest corner against the farthest depth of every tile it
+// overlaps, four tiles at a time
+bool OcclusionBuffer::visible(const Box& box) const {
+	float left = std::numeric_limits<float>::max();
+	float top = std::numeric_limits<float>::max();
+	float right = std::numeric_limits<float>::lowest();
+	float bottom = std::numeric_limits<float>::lowest();
+	float nearest = 0.0f;
+
+	for (uint32_t corner = 0; corner < 8; ++corner) {
+		glm::vec4 position(corner & 1 ? box.maximum.x : box.minimum.x,
+		                   corner & 2 ? box.maximum.y : box.minimum.y,
+		                   corner & 4 ? box.maximum.z : box.minimum.z,
+		                   1.0f);
+		glm::vec4 clip = view_projection_ * position;
+
+		// Reaches behind the eye
+		if (clip.w <= minimum_w) {
+			return true;
+		}
+
+		const float inverse_w = 1.0f / clip.w;
+		const float x = (clip.x * inverse_w * 0.5f + 0.5f) * float(width_);
+		const float y = (0.5f - clip.y * inverse_w * 0.5f) * float(height_);
+
+		left = std::min(left, x);
+		right = std::max(right, x);
+		top = std::min(top, y);
+		bottom = std::max(bottom, y);
+		nearest = std::max(nearest, inverse_w);
+	}
+
+	if (right < 0.0f || bottom < 0.0f || left >= float(width_) || top >= float(height_)) {
+		return false;
+	}
+
+	const uint32_t tile_left = uint32_t(std::max(left, 0.0f)) / tile_width;
+	const uint32_t tile_top = uint32_t(std::max(top, 0.0f)) / tile_height;
+	const uint32_t tile_right = std::min(uint32_t(right) / tile_width, tiles_x_ - 1);
+	const uint32_t tile_bottom = std::min(uint32_t(bottom) / tile_height, tiles_y_ - 1);
+
+	for (uint32_t y = tile_top; y <= tile_bottom; ++y) {
+		const float* row = &depths_[y * tiles_x_];
+		uint32_t x = tile_left;
+
+#if defined(__SSE2__) || defined(_M_X64)
+		const __m128 box_depth = _mm_set1_ps(nearest);
+		for (; x + 4 <= tile_right + 1; x += 4) {
+			if (_mm_movemask_ps(_mm_cmpge_ps(box_depth, _mm_loadu_ps(row + x))) != 0) {
+				return true;
+			}
+		}
+#endif
+
+		for (; x <= tile_right; ++x) {
+			if (nearest >= row[x]) {
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+void OcclusionBuffer::setupTriangles(const Occluder& occluder,
+                                     std::vector<glm::vec4>& clip_positions,
+                                     std::vector<Triangle>& triangles) const {
+	const glm::mat4 matrix = view_projection_ * occluder.transform;
+
+	clip_positions.resize(occluder.positions.size());
+	for (size_t i = 0; i < occluder.positions.size(); ++i) {
+		clip_positions[i] = matrix * glm::vec4(occluder.positions[i], 1.0f);
+	}
+
+	const auto& indices = occluder.indices;
+
+	for (size_t i = 0; i < indices.size(); i += 3) {
+		const glm::vec4& v0 = clip_positions[indices[i]];
+		const glm::vec4& v1 = clip_positions[indices[i + 1]];
+		const glm::vec4& v2 = clip_positions[indices[i + 2]];
+
+		const uint32_t code0 = outcode(v0);
+		const uint32_t code1 = outcode(v1);
+		const uint32_t code2 = outcode(v2);
+
+		if ((code0 & code1 & code2) != 0) {
+			continue;
+		}
+
+		const uint32_t planes = code0 | code1 | code2;
+		if (planes == 0) {
+			setupTriangle(v0, v1, v2, triangles);
+			continue;
+		}
+
+		glm::vec4 polygon[max_clipped_vertices] = {v0, v1, v2};
+		const uint32_t count = clipPolygon(polygon, 3, planes);
+
+		for (uint32_t j = 2; j < count; ++j) {
+			setupTriangle(polygon[0], polygon[j - 1], polygon[j], triangles);
+		}
+	}
+}
+
+void OcclusionBuffer::setupTriangle(const glm::vec4& v0, const glm::vec4& v1, const glm::vec4& v2,
+                                    std::vector<Triangle>& triangles) const {
+	glm::vec3 screen[3];
+
+	const glm::vec4* clip[] = {&v0, &v1, &v2};
+	for (uint32_t i = 0; i < 3; ++i) {
+		const float inverse_w = 1.0f / clip[i]->w;
+		screen[i] = {(clip[i]->x * inverse_w * 0.5f + 0.5f) * float(width_),
+		             (0.5f - clip[i]->y * inverse_w * 0.5f) * float(height_),
+		             inverse_w};
+	}
+
+	// Counter-clockwise in clip space turns clockwise with y pointing down,
+	// so front faces have a negative area here and are flipped
+	float area = (screen[1].x - screen[0].x) * (screen[2].y - screen[0].y) -
+	             (screen[2].x - screen[0].x) * (screen[1].y - screen[0].y);
+	if (!(area < 0.0f)) {
+		return;
+	}
+
+	std::swap(screen[1], screen[2]);
+	area = -area;
+
+	const float left = std::min({screen[0].x, screen[1].x, screen[2].x});
+	const float right = std::max({screen[0].x, screen[1].x, screen[2].x});
+	const float top = std::min({screen[0].y, screen[1].y, screen[2].y});
+	const float bottom = std::max({screen[0].y, screen[1].y, screen[2].y});
+
+	if (right < 0.0f || bottom < 0.0f || left >= float(width_) || top >= float(height_)) {
+		return;
+	}
+
+	Triangle& triangle = triangles.emplace_back();
+
+	// Edges are set up from the same end whichever way round they run, so two
+	// triangles sharing one get exactly opposite equations and no pixel centre
+	// on it falls through the crack between them
+	for (uint32_t edge = 0; edge < 3; ++edge) {
+		const glm::vec3* from = &screen[edge];
+		const glm::vec3* to = &screen[(edge + 1) % 3];
+
+		const bool flip = to->x < from->x || (to->x == from->x && to->y < from->y);
+		if (flip) {
+			std::swap(from, to);
+		}
+
+		const float sign = flip ? -1.0f : 1.0f;
+
+		triangle.a[edge] = sign * (from->y - to->y);
+		triangle.b[edge] = sign * (to->x - from->x);
+		triangle.c[edge] = sign * ((to->y - from->y) * from->x - (to->x - from->x) * from->y);
+	}
+
+	const glm::vec3 edge1 = screen[1] - screen[0];
+	const glm::vec3 edge2 = screen[2] - screen[0];
+
+	triangle.z_dx = (edge1.z * edge2.y - edge2.z * edge1.y) / area;
+	triangle.z_dy = (edge2.z * edge1.x - edge1.z * edge2.x) / area;
+	triangle.z = screen[0].z - triangle.z_dx * screen[0].x - triangle.z_dy * screen[0].y;
+	triangle.z_minimum = std::min({screen[0].z, screen[1].z, screen[2].z});
+	triangle.z_maximum = std::max({screen[0].z, screen[1].z, screen[2].z});
+
+	triangle.tile_left = uint32_t(std::max(left, 0.0f)) / tile_width;
+	triangle.tile_top = uint32_t(std::max(top, 0.0f)) / tile_height;
+	triangle.tile_right = std::min(uint32_t(right) / tile_width, tiles_x_ - 1);
+	triangle.tile_bottom = std::min(uint32_t(bottom) / tile_height, tiles_y_ - 1);
+}
+
+void OcclusionBuffer::drawBand(uint32_t first_row, uint32_t last_row) {
+	for (const Triangle& triangle : triangles_) {
+		if (triangle.tile_bottom < first_row || triangle.tile_top > last_row) {
+			continue;
+		}
+
+		const uint32_t top = std::max<uint32_t>(triangle.tile_top, first_row);
+		const uint32_t bottom = std::min<uint32_t>(triangle.tile_bottom, last_row);
+
+		for (uint32_t tile_y = top; tile_y <= bottom; ++tile_y) {
+			const float y = float(tile_y * tile_height) + 0.5f;
+
+			for (uint32_t tile_x = triangle.tile_left; tile_x <= triangle.tile_right; ++tile_x) {
+				const uint32_t tile = tile_y * tiles_x_ + tile_x;
+				float& depth = depths_[tile];
+
+				// Behind everything the tile already holds
+				if (triangle.z_maximum <= depth) {
+					continue;
+				}
+
+				const float x = float(tile_x * tile_width) + 0.5f;
+				const float span_x = float(tile_width - 1);
+				const float span_y = float(tile_height - 1);
+
+				// Each edge at the tile's pixel centres farthest out and in
+				bool inside = true;
+				bool outside = false;
+
+				for (uint32_t edge = 0; edge < 3; ++edge) {
+					const float a = triangle.a[edge];
+					const float b = triangle.b[edge];
+					const float corner = a * x + b * y + triangle.c[edge];
+					const float rise = std::max(a, 0.0f) * span_x + std::max(b, 0.0f) * span_y;
+					const float fall = std::min(a, 0.0f) * span_x + std::min(b, 0.0f) * span_y;
+
+					outside |= corner + rise < 0.0f;
+					inside &= corner + fall >= 0.0f;
+				}
+
+				if (outside) {
+					continue;
+				}
+
+				const uint32_t mask = inside ? full_mask : coverTile(triangle, x, y);
+				if (mask == 0) {
+					continue;
+				}
+
+				// Farthest point of the plane over the tile, but no farther
+				// than the triangle itself
+				float triangle_depth = triangle.z +
+				                       triangle.z_dx * (triangle.z_dx < 0.0f ? x + span_x : x) +
+				                       triangle.z_dy * (triangle.z_dy < 0.0f ? y + span_y : y);
+				triangle_depth = std::max(triangle_depth, triangle.z_minimum);
+
+				float& layer_depth = layer_depths_[tile];
+				uint32_t& layer_mask = layer_masks_[tile];
+
+				// A triangle nearer to the layer than the layer is to the tile
+				// starts the layer over instead of dragging it back
+				if (triangle_depth - layer_depth > layer_depth - depth) {
+					layer_depth = empty_layer;
+					layer_mask = 0;
+				}
+
+				layer_depth = std::min(layer_depth, triangle_depth);
+				layer_mask |= mask;
+
+				if (layer_mask == full_mask) {
+					depth = std::max(depth, layer_depth);
+					layer_depth = empty_layer;
+					layer_mask = 0;
+				}
+			}
+		}
+	}
+}
+
+} // namespace glint::scene
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <glm/ext/vector_float3.hpp>
+#include <glm/ext/vector_float4.hpp>
+#include <glm/ext/matrix_float4x4.hpp>
+
+#include "scene_bvh.hpp"
+
+namespace glint::scene {
+
+// Unit cube around the origin with counter-clockwise faces, a proxy for
+// occluders that fill their bounds
+extern const glm::vec3 unit_cube_positions[8];
+extern const uint32_t unit_cube_indices[36];
+
+struct OcclusionStatistics final {
+	uint32_t occluders = 0;
+	// After back faces were culled and the rest clipped to the guard band
+	uint32_t triangles = 0;
+};
+
+// Masked software occlusion culling, after Andersson et al. The buffer is
+// split into 8x4 pixel tiles, each keeping a conservative farthest depth for
+// the whole tile plus a second, partially covered layer as a 32 bit coverage
+// mask and its own farthest depth, merged into the first once the mask is
+// full. Depth is stored as 1/w, larger being nearer. Occluders are binned by
+// band of tile rows and each band is rasterized by a job worker, four
+// pixels at a time, so the results do not depend on scheduling.
+//
+// Nothing here touches GL; jobs::setup() is all it needs.
+class OcclusionBuffer final {
+public:
+	static constexpr uint32_t tile_width = 8;
+	static constexpr uint32_t tile_height = 4;
+
+	explicit OcclusionBuffer(uint32_t width = 320, uint32_t height = 180);
+	~OcclusionBuffer() = default;
+
+	OcclusionBuffer(const OcclusionBuffer&) = delete;
+	OcclusionBuffer(OcclusionBuffer&&) noexcept = default;
+
+	OcclusionBuffer& operator=(const OcclusionBuffer&) = delete;
+	OcclusionBuffer& operator=(OcclusionBuffer&&) noexcept = default;
+
+	// Empties the buffer and drops queued occluders
+	void clear(const glm::mat4& view_projection);
+
+	// Queues a mesh with counter-clockwise front faces to be drawn by the
+	// next rasterize(). The spans are read then, not copied.
+	void addOccluder(std::span<const glm::vec3> positions, std::span<const uint32_t> indices,
+	                 const glm::mat4& transform);
+
+	// Draws the queued occluders, nearest first in the order they were added
+	void rasterize();
+
+	// Whether any part of the box may be in front of what was rasterized.
+	// Safe to call from several threads at once once rasterize() returned.
+	bool visible(const Box& box) const;
+
+	uint32_t width() const noexcept { return width_; }
+	uint32_t height() const noexcept { return height_; }
+
+	// Conservative farthest depth of every tile, row by row, as 1/w with zero
+	// where nothing was drawn
+	std::span<const float> tileDepths() const noexcept { return depths_; }
+
+	OcclusionStatistics statistics() const noexcept { return statistics_; }
+
+private:
+	// Edges are a * x + b * y + c, positive inside; z is 1/w as a plane over
+	// the screen. Bounds are in tiles, inclusive.
+	struct Triangle {
+		float a[3];
+		float b[3];
+		float c[3];
+		float z;
+		float z_dx;
+		float z_dy;
+		float z_minimum;
+		float z_maximum;
+		uint16_t tile_left;
+		uint16_t tile_right;
+		uint16_t tile_top;
+		uint16_t tile_bottom;
+	};
+
+	struct Occluder {
+		std::span<const glm::vec3> positions;
+		std::span<const uint32_t> indices;
+		glm::mat4 transform;
+	};
+
+	struct Chunk {
+		uint32_t worker;
+		uint32_t offset;
+		uint32_t count;
+	};
+
+	void setupTriangles(const Occluder& occluder, std::vector<glm::vec4>& clip_positions,
+	                    std::vector<Triangle>& triangles) const;
+	void setupTriangle(const glm::vec4& v0, const glm::vec4& v1, const glm::vec4& v2,
+	                   std::vector<Triangle>& triangles) const;
+	void drawBand(uint32_t first_row, uint32_t last_row);
+
+	uint32_t width_;
+	uint32_t height_;
+	uint32_t tiles_x_;
+	uint32_t tiles_y_;
+	glm::mat4 view_projection_ = glm::mat4(1.0f);
+
+	// Per tile, row by row
+	std::vector<float> depths_;
+	std::vector<float> layer_depths_;
+	std::vector<uint32_t> layer_masks_;
+
+	std::vector<Occluder> occluders_;
+	std::vector<std::vector<glm::vec4>> worker_positions_;
+	std::vector<std::vector<Triangle>> worker_triangles_;
+	std::vector<Chunk> chunks_;
+	std::vector<Triangle> triangles_;
+
+	OcclusionStatistics statistics_;
+};
+
+} // namespace glint::scene